@@ -41,7 +41,8 @@ end;
 create table StagingStatsValFloat32 (
 	batchId  smallint     not null,
 	macName  nvarchar(50) not null,
-	statName nvarchar(50) not null,
+	statId   smallint     not null, -- zero when the statistic is identified by name
+	statName nvarchar(50) not null, -- empty when the statistic is identified by ID
 	instant  bigint       not null, -- time in milliseconds since 1970
 	statVal  float(24)    not null,
 	quality  tinyint	  not null
@@ -79,7 +80,8 @@ end;
 create table StagingStatsValInt32 (
 	batchId  smallint     not null,
 	macName  nvarchar(50) not null,
-	statName nvarchar(50) not null,
+	statId   smallint     not null, -- zero when the statistic is identified by name
+	statName nvarchar(50) not null, -- empty when the statistic is identified by ID
 	instant  bigint       not null, -- time in milliseconds since 1970
 	statVal  int          not null,
 	quality  tinyint	  not null
@@ -89,6 +91,41 @@ go
 create nonclustered index IdxStagStatsValInt32ByBatch on StagingStatsValInt32(batchId);
 go
 
+if exists (select * from sys.tables where name = N'MachineSample')
+begin
+	drop table MachineSample;
+end;
+
+/* This table holds the instants at which each machine has sent a sample. The client omits
+   the stats whose values did not leave their deadband since they were last sent, so at an
+   instant found here, a stat without a row of its own kept the value of its previous row
+   (it is unchanged), whereas an instant not found here means the machine did not report
+   at all (the values are missing) */
+create table MachineSample (
+	macId   smallint not null,
+	instant bigint   not null, -- time in milliseconds since 1970
+
+	primary key (macId, instant)
+);
+go
+
+if exists (select * from sys.tables where name = N'StagingMachineSample')
+begin
+	drop index IdxStagMachineSampleByBatch on StagingMachineSample;
+	drop table StagingMachineSample;
+end;
+
+-- This table is an staging area for insertion into MachineSample
+create table StagingMachineSample (
+	batchId  smallint     not null,
+	macName  nvarchar(50) not null,
+	instant  bigint       not null -- time in milliseconds since 1970
+);
+go
+
+create nonclustered index IdxStagMachineSampleByBatch on StagingMachineSample(batchId);
+go
+
 -- Normalization for machine ID and statitic ID:
 
 if exists (select * from sys.tables where name = N'Machine')
@@ -115,8 +152,10 @@ create table Statistic (
 );
 go
 
-create nonclustered index IdxMachineByName on Machine(macName);
-create nonclustered index IdxStatisticByName on Statistic(statName);
+/* The names are unique, so the writers that run in parallel (each with its own connection)
+   cannot both insert a new name: the one that comes last fails, then finds the name there. */
+create unique nonclustered index IdxMachineByName on Machine(macName);
+create unique nonclustered index IdxStatisticByName on Statistic(statName);
 go
 
 alter table StatsValFloat32
@@ -134,6 +173,10 @@ alter table StatsValInt32
 alter table StatsValInt32
 	add foreign key (statId)
 	references Statistic(statId);
+
+alter table MachineSample
+	add foreign key (macId)
+	references Machine(macId);
 go
 
 /* These stored procedures ensure consistency of inserted data
@@ -157,6 +200,7 @@ begin
 
 	declare @timeSinceEpochInMillisecs bigint;
 	declare @macName nvarchar(50);
+	declare @stagStatId smallint;
 	declare @statName nvarchar(50);
 	declare @statValue float(24);
 	declare @quality tinyint;
@@ -164,6 +208,7 @@ begin
 	declare stagingCursor cursor for (
 		select instant
               ,macName
+			  ,statId
 			  ,statName
 			  ,statVal
 			  ,quality
@@ -175,6 +220,7 @@ begin
 	fetch next from stagingCursor
 		into @timeSinceEpochInMillisecs
 			,@macName
+			,@stagStatId
 			,@statName
 			,@statValue
 			,@quality;
@@ -188,40 +234,72 @@ begin
 
 		if @macId is null
 		begin
-			insert into Machine (macName) values (@macName);
+			begin try
+				insert into Machine (macName) values (@macName);
+			end try
+			begin catch
+				-- unless another writer has just inserted the same name (unique index):
+				if error_number() not in (2601, 2627)
+					throw;
+			end catch;
+
 			set @macId = (select macId from Machine where macName = @macName);
 		end;
 
-		-- ensure consistency regarding statistic:
+		/* ensure consistency regarding statistic, unless it came identified by ID (which
+		   the server assigned upon a session opened by the client, so it is already there): */
 
 		declare @statId smallint;
-		set @statId = (select statId from Statistic where statName = @statName);
-	
-		if @statId is null
+		set @statId = @stagStatId;
+
+		if @statId = 0
 		begin
-			insert into Statistic (statName) values (@statName);
 			set @statId = (select statId from Statistic where statName = @statName);
+	
+			if @statId is null
+			begin
+				begin try
+					insert into Statistic (statName) values (@statName);
+				end try
+				begin catch
+					-- unless another writer has just inserted the same name (unique index):
+					if error_number() not in (2601, 2627)
+						throw;
+				end catch;
+
+				set @statId = (select statId from Statistic where statName = @statName);
+			end;
 		end;
 
-		-- finally insert data:
-		insert into StatsValFloat32 (
-			macId,
-			statId,
-			instant,
-			statVal,
-			quality
+		/* finally insert data, unless already there (the same sample might come twice,
+		   when the client replays a request that timed out, or uploads a burst): */
+		if not exists (
+			select 1 from StatsValFloat32
+				where macId = @macId
+				  and statId = @statId
+				  and instant = @timeSinceEpochInMillisecs
 		)
-		values (
-			@macId,
-			@statId,
-			@timeSinceEpochInMillisecs,
-			@statValue,
-			@quality
-		);
+		begin
+			insert into StatsValFloat32 (
+				macId,
+				statId,
+				instant,
+				statVal,
+				quality
+			)
+			values (
+				@macId,
+				@statId,
+				@timeSinceEpochInMillisecs,
+				@statValue,
+				@quality
+			);
+		end;
 
 		fetch next from stagingCursor
 		into @timeSinceEpochInMillisecs
 			,@macName
+			,@stagStatId
 			,@statName
 			,@statValue
 			,@quality;
@@ -248,6 +326,7 @@ begin
 
 	declare @timeSinceEpochInMillisecs bigint;
 	declare @macName nvarchar(50);
+	declare @stagStatId smallint;
 	declare @statName nvarchar(50);
 	declare @statValue int;
 	declare @quality tinyint;
@@ -255,6 +334,7 @@ begin
 	declare stagingCursor cursor for (
 		select instant
               ,macName
+			  ,statId
 			  ,statName
 			  ,statVal
 			  ,quality
@@ -266,6 +346,7 @@ begin
 	fetch next from stagingCursor
 		into @timeSinceEpochInMillisecs
 			,@macName
+			,@stagStatId
 			,@statName
 			,@statValue
 			,@quality;
@@ -279,40 +360,72 @@ begin
 
 		if @macId is null
 		begin
-			insert into Machine (macName) values (@macName);
+			begin try
+				insert into Machine (macName) values (@macName);
+			end try
+			begin catch
+				-- unless another writer has just inserted the same name (unique index):
+				if error_number() not in (2601, 2627)
+					throw;
+			end catch;
+
 			set @macId = (select macId from Machine where macName = @macName);
 		end;
 
-		-- ensure consistency regarding statistic:
+		/* ensure consistency regarding statistic, unless it came identified by ID (which
+		   the server assigned upon a session opened by the client, so it is already there): */
 
 		declare @statId smallint;
-		set @statId = (select statId from Statistic where statName = @statName);
-	
-		if @statId is null
+		set @statId = @stagStatId;
+
+		if @statId = 0
 		begin
-			insert into Statistic (statName) values (@statName);
 			set @statId = (select statId from Statistic where statName = @statName);
+	
+			if @statId is null
+			begin
+				begin try
+					insert into Statistic (statName) values (@statName);
+				end try
+				begin catch
+					-- unless another writer has just inserted the same name (unique index):
+					if error_number() not in (2601, 2627)
+						throw;
+				end catch;
+
+				set @statId = (select statId from Statistic where statName = @statName);
+			end;
 		end;
 
-		-- finally insert data:
-		insert into StatsValInt32 (
-			macId,
-			statId,
-			instant,
-			statVal,
-			quality
+		/* finally insert data, unless already there (the same sample might come twice,
+		   when the client replays a request that timed out, or uploads a burst): */
+		if not exists (
+			select 1 from StatsValInt32
+				where macId = @macId
+				  and statId = @statId
+				  and instant = @timeSinceEpochInMillisecs
 		)
-		values (
-			@macId,
-			@statId,
-			@timeSinceEpochInMillisecs,
-			@statValue,
-			@quality
-		);
+		begin
+			insert into StatsValInt32 (
+				macId,
+				statId,
+				instant,
+				statVal,
+				quality
+			)
+			values (
+				@macId,
+				@statId,
+				@timeSinceEpochInMillisecs,
+				@statValue,
+				@quality
+			);
+		end;
 
 		fetch next from stagingCursor
 		into @timeSinceEpochInMillisecs
 			,@macName
+			,@stagStatId
 			,@statName
 			,@statValue
 			,@quality;
@@ -328,6 +441,56 @@ begin
 end; -- end of stored procedure
 go
 
+if object_id(N'InsertIntoMachineSampleProc', N'P') is not null
+begin
+	drop procedure InsertIntoMachineSampleProc;
+end;
+go
+
+/* Records the instants at which the machines have sent samples. The client omits the
+   stats whose values stay within their deadband, so this is what tells apart a stat
+   that did not change (the machine sent a sample) from one that is missing. */
+create procedure InsertIntoMachineSampleProc (@batchId smallint) as
+begin
+
+	-- ensure consistency regarding machine:
+	begin try
+		insert into Machine (macName)
+			select distinct macName
+				from StagingMachineSample
+				where batchId = @batchId
+				  and macName not in (select macName from Machine);
+	end try
+	begin catch
+		-- another writer has just inserted some of the names (unique index), so try once more without them:
+		if error_number() not in (2601, 2627)
+			throw;
+
+		insert into Machine (macName)
+			select distinct macName
+				from StagingMachineSample
+				where batchId = @batchId
+				  and macName not in (select macName from Machine);
+	end catch;
+
+	-- insert data, unless already there (the same sample might come twice):
+	insert into MachineSample (macId, instant)
+		select distinct mac.macId, stag.instant
+			from StagingMachineSample as stag
+			inner join Machine as mac on mac.macName = stag.macName
+			where stag.batchId = @batchId
+			  and not exists (
+				select 1 from MachineSample as sample
+					where sample.macId = mac.macId
+					  and sample.instant = stag.instant
+			  );
+
+	delete from StagingMachineSample
+		where batchId = @batchId;
+
+end; -- end of stored procedure
+go
+
 begin transaction;
 	delete from Machine;
 
@@ -118,12 +118,501 @@ namespace application
 
 
 #include "WebService.h"
+#include "BinaryCodec.h"
+#include "BinaryHttp.h"
+#include "StreamTransport.h"
 #include "PerfCountersReader.h"
+#include "PerfCountersCatalog.h"
+#include "StatsAggregator.h"
+#include "AdaptiveSampler.h"
+#include "DeadbandFilter.h"
+#include "StatsSpool.h"
+#include "CollectionScheduler.h"
+#include "StatsForwarder.h"
+#include "SelfMonitor.h"
+#include "Utilities.h"
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <numeric>
+#include <vector>
+#include <sstream>
 #include <thread>
 #include <chrono>
 #include <codecvt>
 
 
+namespace application
+{
+    ////////////////////////
+    // Store & Forward
+    ////////////////////////
+
+    /// <summary>
+    /// Sends the samples to the server, either in SOAP or in binary encoding (when the binary
+    /// endpoint is configured). When that fails, the stats are stored in a spool on disk,
+    /// which is replayed in batches once the server answers again. The spool keeps all that
+    /// was collected in a cycle, so the replay sends the same content. When the stats are
+    /// streamed, those not yet acknowledged by the server are kept, and go to the spool when
+    /// the server drops them or the connection breaks.
+    /// </summary>
+    /// <seealso cref="IStatsTransport" />
+    class StoreAndForwardSender : public IStatsTransport
+    {
+    private:
+
+        wws::SvcProxyConfig m_proxyConfig;
+        std::unique_ptr<MacStatsCollectionClient> m_client;
+        std::wstring m_authKey;
+
+        std::wstring m_binaryEndpointUrl; // empty when the stats go in SOAP (or streamed)
+        std::wstring m_streamHost;
+        uint16_t m_streamPort; // zero when the stats are not streamed
+        std::unique_ptr<IBinaryStatsClient> m_binaryClient;
+        StatsStreamClient *m_streamClient; // the binary client, when the stats are streamed
+        std::deque<std::vector<CollectedStats>> m_unackedItems; // the stats of each frame streamed, but not yet acknowledged
+        uint64_t m_streamAckedCount; // frames streamed and acknowledged in the connection
+        size_t m_deflateMinSize;
+        BinaryStatsEncoder m_encoder;
+
+        const std::vector<PerfCounterDescriptor> &m_catalog;
+        SelfMonitor &m_selfMonitor;
+
+        StatsSpool m_spool;
+        uint32_t m_replayBatchSize;
+        std::vector<CollectedStats> m_replayItems;
+        std::vector<const CollectedStats *> m_replayRefs;
+
+        bool IsBinary() const { return !m_binaryEndpointUrl.empty() || m_streamPort != 0; }
+
+        // Creates the HTTP client, if not yet available
+        bool Connect()
+        {
+            if (m_client || m_binaryClient)
+                return true;
+
+            CALL_STACK_TRACE;
+
+            try
+            {
+                if (m_streamPort != 0)
+                {
+                    m_streamClient = new StatsStreamClient(m_streamHost, m_streamPort);
+                    m_binaryClient.reset(m_streamClient);
+                    Logger::Write("Connection to stream endpoint is ready", Logger::PRIO_INFORMATION);
+                    OpenSession();
+                    return true;
+                }
+
+                if (IsBinary())
+                {
+                    m_binaryClient.reset(new BinaryHttpClient(m_binaryEndpointUrl, m_deflateMinSize));
+                    Logger::Write("HTTP client for binary endpoint is ready", Logger::PRIO_INFORMATION);
+                    OpenSession();
+                    return true;
+                }
+
+                m_client.reset(new MacStatsCollectionClient(m_proxyConfig));
+                m_client->Open();
+
+                Logger::Write("HTTP client is ready", Logger::PRIO_INFORMATION);
+                return true;
+            }
+            catch (IAppException &ex)
+            {
+                Disconnect();
+                Logger::Write(ex, Logger::PRIO_ERROR);
+                return false;
+            }
+        }
+
+        // Drops the HTTP client, so it is created again for the next request
+        void Disconnect()
+        {
+            // the stats streamed in the connection, but not acknowledged, are sent again later:
+            DropUnacked(true);
+            m_streamAckedCount = 0;
+            m_streamClient = nullptr;
+
+            m_client.reset();
+            m_binaryClient.reset();
+        }
+
+        // Forgets the stats of the frames streamed but not acknowledged, storing them in the spool when asked
+        void DropUnacked(bool isToSpool)
+        {
+            if (isToSpool)
+            {
+                for (auto &frameItems : m_unackedItems)
+                {
+                    for (auto &item : frameItems)
+                        m_spool.Append(item);
+                }
+            }
+
+            m_unackedItems.clear();
+        }
+
+        /* Asks the server to assign ID's to the stat names, so the requests carry them instead.
+        When the server refuses, the stats keep going by name, which it always accepts. */
+        void OpenSession()
+        {
+            std::vector<uint8_t> response;
+            m_binaryClient->Exchange(m_encoder.EncodeOpenSession(m_catalog), response);
+
+            uint64_t sessionId;
+            std::vector<int16_t> statIds;
+
+            if (DecodeSessionOpened(response.data(), response.size(), sessionId, statIds)
+                && m_encoder.SetSession(sessionId, std::move(statIds)))
+            {
+                Logger::Write("Session with binary endpoint is open, stats go by ID", Logger::PRIO_INFORMATION);
+                return;
+            }
+
+            m_encoder.ResetSession();
+            Logger::Write("Binary endpoint did not open session, stats go by name", Logger::PRIO_WARNING);
+        }
+
+        /* Posts the stats in binary encoding. When the server no longer knows the session (because
+        it has restarted), a new one is opened and the stats are encoded and posted once again.
+        Returns false when the server is too busy, so the stats are kept to be sent later. */
+        template <typename StatsType>
+        bool PostBinary(const StatsType &stats)
+        {
+            auto status = m_binaryClient->Post(m_encoder.Encode(m_catalog, stats));
+
+            if (status == BinaryStatus::UnknownSession)
+            {
+                OpenSession();
+                status = m_binaryClient->Post(m_encoder.Encode(m_catalog, stats));
+            }
+
+            if (status == BinaryStatus::RetryLater)
+            {
+                Logger::Write("Binary endpoint is too busy, stats will be sent later", Logger::PRIO_WARNING);
+                return false;
+            }
+
+            if (status != BinaryStatus::Accepted)
+                Logger::Write("Binary endpoint rejected the stats", Logger::PRIO_ERROR);
+
+            return true;
+        }
+
+        /* Streams the stats collected in one or more cycles, keeping them until acknowledged. The status comes from
+        the acknowledgements of the frames streamed before: once the server refuses some frames (because it is too busy
+        or has lost the session), it drops all those not yet acknowledged, this one included. Their stats go to the
+        spool (unless rejected), and this one is handled like a request that failed. Returns false when the stats of
+        this call must be sent later. */
+        bool StreamItems(const std::vector<const CollectedStats *> &items)
+        {
+            auto status = m_streamClient->Post(m_encoder.Encode(m_catalog, items));
+
+            m_unackedItems.emplace_back();
+            for (auto item : items)
+                m_unackedItems.back().push_back(*item);
+
+            for (; m_streamAckedCount < m_streamClient->GetAckedCount(); ++m_streamAckedCount)
+                m_unackedItems.pop_front();
+
+            if (status == BinaryStatus::Accepted)
+                return true;
+
+            m_unackedItems.pop_back();
+            DropUnacked(status != BinaryStatus::Rejected);
+
+            if (status == BinaryStatus::UnknownSession)
+            {
+                OpenSession();
+                return false; // sent again from the spool, once in the new session
+            }
+
+            if (status == BinaryStatus::RetryLater)
+            {
+                Logger::Write("Stream endpoint is too busy, stats will be sent later", Logger::PRIO_WARNING);
+                return false;
+            }
+
+            Logger::Write("Stream endpoint rejected the stats", Logger::PRIO_ERROR);
+            return true;
+        }
+
+        // Sends all samples in a batch, in a single request. Returns false when the server is too busy.
+        bool SendBatch(const SamplesBatch &batch)
+        {
+            if (IsBinary())
+                return PostBinary(batch);
+
+            m_client->SendStatsSamples(m_authKey.c_str(), m_catalog, batch);
+            return true;
+        }
+
+        /* Sends the stats collected in one or more cycles, in a single request (which in binary
+        encoding also carries the bursts, otherwise uploaded apart). Returns false when the server
+        is too busy. */
+        bool SendItems(const std::vector<const CollectedStats *> &items)
+        {
+            if (m_streamClient != nullptr)
+                return StreamItems(items);
+
+            if (IsBinary())
+                return PostBinary(items);
+
+            if (items.size() > 1)
+                m_client->SendStatsSamples(m_authKey.c_str(), m_catalog, items);
+            else
+                m_client->SendStatsSample(m_authKey.c_str(), m_catalog, *items.front());
+
+            for (auto item : items)
+            {
+                if (item->burst.GetSampleCount() > 0)
+                    SendBurst(item->burst);
+            }
+
+            return true;
+        }
+
+        /* Replays one batch of records from the spool, all of them in a single request, just
+        like the cycles were sent. The batch size limits how fast the client catches up, so a
+        server just restarted is not flooded by the fleet, and also keeps the request within the
+        maximum message size accepted by the server. */
+        void ReplaySpool()
+        {
+            if (m_spool.GetCount() == 0)
+                return;
+
+            CALL_STACK_TRACE;
+
+            uint32_t sentCount(0);
+
+            try
+            {
+                auto count = m_spool.Peek(m_replayItems, m_replayBatchSize);
+
+                if (count > 0)
+                {
+                    m_replayRefs.clear();
+                    for (uint32_t idx = 0; idx < count; ++idx)
+                        m_replayRefs.push_back(&m_replayItems[idx]);
+
+                    if (SendItems(m_replayRefs))
+                        sentCount = count;
+                }
+            }
+            catch (IAppException &ex)
+            {
+                Disconnect(); // reconnect next time
+                Logger::Write(ex, Logger::PRIO_ERROR);
+            }
+
+            m_spool.Discard(sentCount);
+
+            std::ostringstream oss;
+            oss << "Replayed " << sentCount << " cycle(s) from spool, "
+                << m_spool.GetCount() << " remaining";
+
+            Logger::Write(oss.str(), Logger::PRIO_NOTICE);
+        }
+
+        // Uploads a burst of samples taken around an incident. Upon failure, they are
+        // dropped (not spooled), because the aggregates of the cycle summarize them.
+        void SendBurst(const SamplesBatch &batch)
+        {
+            CALL_STACK_TRACE;
+
+            if (!Connect())
+                return;
+
+            std::ostringstream oss;
+            oss << "Uploading burst of " << batch.GetSampleCount() << " sample(s)";
+            Logger::Write(oss.str(), Logger::PRIO_NOTICE);
+
+            try
+            {
+                SendBatch(batch);
+            }
+            catch (IAppException &ex)
+            {
+                Disconnect(); // reconnect next time
+                Logger::Write(ex, Logger::PRIO_ERROR);
+            }
+        }
+
+    public:
+
+        StoreAndForwardSender(const std::wstring &authKey,
+                              const std::vector<PerfCounterDescriptor> &catalog,
+                              SelfMonitor &selfMonitor)
+            : m_authKey(authKey)
+            , m_binaryEndpointUrl(
+                std::wstring_convert<std::codecvt_utf8<wchar_t>>().from_bytes(
+                    AppConfig::GetSettings().application.GetString("webSvcBinaryEndpoint", "")
+                )
+            )
+            , m_streamPort(0)
+            , m_streamClient(nullptr)
+            , m_streamAckedCount(0)
+            , m_deflateMinSize(AppConfig::GetSettings().application.GetUInt("clientDeflateMinBytes", 0))
+            , m_encoder(GetLocalHostName(), authKey)
+            , m_catalog(catalog)
+            , m_selfMonitor(selfMonitor)
+            , m_spool(
+                AppConfig::GetSettings().application.GetString("clientSpoolFilePath", "MSCClient.spool"),
+                AppConfig::GetSettings().application.GetUInt("clientSpoolMaxSizeKBytes", 1024),
+                AppConfig::GetSettings().application.GetUInt("clientSpoolMaxAgeSecs", 604800),
+                catalog
+            )
+            , m_replayBatchSize(AppConfig::GetSettings().application.GetUInt("clientSpoolReplayBatchSize", 100))
+        {
+            // the stream endpoint (if any) is set as "host:port":
+            auto streamEndpoint = std::wstring_convert<std::codecvt_utf8<wchar_t>>().from_bytes(
+                AppConfig::GetSettings().application.GetString("webSvcStreamEndpoint", "")
+            );
+
+            auto colonPos = streamEndpoint.rfind(L':');
+            if (colonPos != std::wstring::npos)
+            {
+                m_streamHost = streamEndpoint.substr(0, colonPos);
+                m_streamPort = static_cast<uint16_t> (std::stoul(streamEndpoint.substr(colonPos + 1)));
+            }
+
+            m_replayItems.reserve(m_replayBatchSize);
+            m_replayRefs.reserve(m_replayBatchSize);
+        }
+
+        /* Waits a moment for the server to acknowledge the stats streamed, then stores
+        in the spool those it did not, so they are sent once the client starts again. */
+        virtual ~StoreAndForwardSender()
+        {
+            if (m_unackedItems.empty())
+                return;
+
+            CALL_STACK_TRACE;
+
+            try
+            {
+                m_streamClient->Flush(std::chrono::seconds(5));
+
+                for (; m_streamAckedCount < m_streamClient->GetAckedCount(); ++m_streamAckedCount)
+                    m_unackedItems.pop_front();
+
+                DropUnacked(true);
+            }
+            catch (IAppException &ex)
+            {
+                Logger::Write(ex, Logger::PRIO_ERROR);
+            }
+            catch (std::exception &ex)
+            {
+                std::ostringstream oss;
+                oss << "Failed to spool the stats not acknowledged: " << ex.what();
+                Logger::Write(oss.str(), Logger::PRIO_ERROR);
+            }
+        }
+
+        /* Sends the stats collected in one or more cycles, in a single request. Upon failure,
+        each cycle goes to the spool: the whole sample (regardless of the mask), the aggregates,
+        the burst and the metrics of the client. */
+        virtual bool Send(const std::vector<const CollectedStats *> &items) override
+        {
+            CALL_STACK_TRACE;
+
+            bool isSent(false);
+
+            if (Connect())
+            {
+                auto startTime = std::chrono::steady_clock::now();
+
+                try
+                {
+                    isSent = SendItems(items);
+                }
+                catch (IAppException &ex)
+                {
+                    Disconnect(); // reconnect next time
+                    Logger::Write(ex, Logger::PRIO_ERROR);
+                }
+
+                m_selfMonitor.RecordSend(std::chrono::steady_clock::now() - startTime);
+            }
+
+            if (!isSent)
+            {
+                for (auto item : items)
+                    m_spool.Append(*item);
+
+                m_selfMonitor.RecordSpoolDepth(m_spool.GetCount());
+                return false;
+            }
+
+            ReplaySpool();
+            m_selfMonitor.RecordSpoolDepth(m_spool.GetCount());
+            return true;
+        }
+    };
+
+
+    /* Pushes the stats collected in a cycle to the sending thread, copying them into the slot
+    of the queue, which keeps its memory from previous cycles. When the queue is full (because
+    the server has been slow for too long), the stats of this cycle are dropped, which is when
+    it returns false. */
+    static bool PushToSend(StatsForwarder &forwarder,
+                           SelfMonitor &selfMonitor,
+                           const SamplesBatch &sample,
+                           const SamplesAggregates *aggregates,
+                           const uint8_t *sendMask,
+                           SamplesBatch *burst)
+    {
+        auto item = forwarder.BeginPush();
+
+        if (item == nullptr)
+        {
+            std::ostringstream oss;
+            oss << "Queue of stats to send is full, so the stats of this cycle are dropped ("
+                << forwarder.GetDroppedCount() << " cycle(s) dropped so far)";
+
+            Logger::Write(oss.str(), Logger::PRIO_WARNING);
+
+            if (burst != nullptr)
+                burst->Clear();
+
+            return false;
+        }
+
+        item->sample.Clear();
+        item->sample.counterIds = sample.counterIds;
+        item->sample.AddSampleFrom(sample, 0);
+
+        if (aggregates != nullptr)
+            item->aggregates = *aggregates;
+        else
+            item->aggregates.counterIds.clear();
+
+        item->sendMask.assign(sendMask, sendMask + sample.GetCounterCount());
+
+        item->burst.Clear();
+
+        if (burst != nullptr && burst->GetSampleCount() > 0)
+        {
+            item->burst.counterIds = burst->counterIds;
+
+            for (size_t row = 0; row < burst->GetSampleCount(); ++row)
+                item->burst.AddSampleFrom(*burst, row);
+
+            burst->Clear();
+        }
+
+        selfMonitor.TakeSnapshot(item->selfMetrics);
+        item->hasSelfMetrics = true;
+
+        forwarder.EndPush();
+        return true;
+    }
+
+}// end of namespace application
+
+
 /////////////////////
 // Entry Point
 /////////////////////
@@ -144,15 +633,15 @@ int main(int argc, const char *argv[])
         if (ParseCommandLineArgs(argc, argv, params) == STATUS_FAIL)
             return EXIT_FAILURE;
 
-        // Create the HTTP client:
-        wws::SvcProxyConfig proxyCfg; // use standard configuration
-        application::MacStatsCollectionClient client(proxyCfg);
-        client.Open();
-
-        Logger::Write("HTTP client is ready", Logger::PRIO_INFORMATION);
-
         if (params.shutdownServer)
         {
+            // Create the HTTP client:
+            wws::SvcProxyConfig proxyCfg; // use standard configuration
+            application::MacStatsCollectionClient client(proxyCfg);
+            client.Open();
+
+            Logger::Write("HTTP client is ready", Logger::PRIO_INFORMATION);
+
             if (client.CloseService())
                 std::cout << "The server accepted the shutdown order!" << std::endl;
             else
@@ -166,29 +655,150 @@ int main(int argc, const char *argv[])
             AppConfig::GetSettings().application.GetString("webClientAuthKey", "NOT SET")
         );
 
-        // Setup performance counters reader
+        // Setup performance counters reader, with the catalog declared in configuration
         PerfCountersReader statsReader;
 
-        // Collection cycle:
-        do
-        {
-            auto t1 = system_clock().now();
+        // Measures the overhead of this client, which is sent along with the stats
+        SelfMonitor selfMonitor;
+
+        // Setup the HTTP client, that falls back to a spool when the server is not available
+        StoreAndForwardSender sender(authKey, statsReader.GetCatalog(), selfMonitor);
+
+        /* The stats collected in each cycle are sent by another thread, so a slow server does
+        not delay the collection. The cycles queued up while the server falls behind are sent
+        in batch, and once the queue is full, the stats of the newest cycles are dropped: */
+        StatsForwarder forwarder(
+            sender,
+            (std::max)(AppConfig::GetSettings().application.GetUInt("clientSendQueueCapacity", 16), 1U),
+            (std::max)(AppConfig::GetSettings().application.GetUInt("clientSendBatchMaxCycles", 8), 1U)
+        );
+
+        // Storage for a sample of all counters in the catalog, reused by every collection
+        SamplesBatch statsNow;
+
+        /* Stats whose value stays within their deadband are not sent (the server takes them
+        as unchanged), except in a heartbeat, which sends them all every few cycles: */
+        DeadbandFilter deadband(
+            LoadDeadbands(statsReader.GetCatalog()),
+            (std::max)(AppConfig::GetSettings().application.GetUInt("clientDeadbandHeartbeatCycles", 10), 1U)
+        );
+
+        /* When set, the counters are sampled at this higher rate, and every
+        collection cycle sends the aggregates of all samples it has taken: */
+        milliseconds samplingInterval(
+            AppConfig::GetSettings().application.GetUInt("clientSamplingIntervalMillisecs", 0)
+        );
 
-            auto statsNow = statsReader.GetCurrentValues();
+        seconds collectCycleTime(params.collectCycleTimeSecs);
 
-            client.SendStatsSample(
-                authKey.c_str(),
-                statsNow
+        /* The cycles end at absolute deadlines in steady clock, with a phase offset derived
+        from the machine name, so the clients of a fleet do not send their requests at once: */
+        CollectionScheduler scheduler(collectCycleTime, GetLocalHostName());
+
+        std::cout << "Collection cycles are phased at "
+                  << duration_cast<milliseconds>(scheduler.GetPhase()).count() << " ms" << std::endl;
+
+        if (samplingInterval.count() > 0 && samplingInterval < collectCycleTime)
+        {
+            milliseconds burstSamplingInterval(
+                AppConfig::GetSettings().application.GetUInt("clientBurstSamplingIntervalMillisecs", 200)
+            );
+
+            /* The sampling interval shortens when a counter changes faster than its trigger,
+            and the burst of samples (starting some samples before the trigger) is uploaded
+            at the end of the cycle. Without triggers, the interval never changes. The reader
+            takes a sample of every counter in the catalog, in the order of the catalog: */
+            std::vector<uint32_t> sampledCounterIds(statsReader.GetCatalog().size());
+            std::iota(sampledCounterIds.begin(), sampledCounterIds.end(), 0);
+
+            AdaptiveSampler sampler(
+                LoadBurstTriggers(statsReader.GetCatalog()),
+                sampledCounterIds,
+                samplingInterval,
+                burstSamplingInterval,
+                seconds(AppConfig::GetSettings().application.GetUInt("clientBurstHoldSecs", 10)),
+                AppConfig::GetSettings().application.GetUInt("clientPreTriggerSampleCount", 30),
+                AppConfig::GetSettings().application.GetUInt("clientBurstMaxSamples", 100)
             );
 
-            auto t2 = system_clock().now();
+            // the aggregator must hold all samples of a cycle, even when they are taken in burst:
+            auto minSamplingInterval = (std::min)(samplingInterval, burstSamplingInterval);
+            StatsAggregator aggregator(static_cast<size_t> (collectCycleTime / minSamplingInterval) + 1);
+            SamplesAggregates aggregates;
+
+            std::cout << "Counters will be sampled every " << samplingInterval.count() << " ms" << std::endl;
+
+            auto nextSampleTime = steady_clock::now();
+
+            // Collection cycle:
+            do
+            {
+                auto cycleEnd = scheduler.GetNextDeadline();
 
-            auto remainingTime = seconds(params.collectCycleTimeSecs) - (t2 - t1);
-            if (remainingTime.count() > 0)
-                std::this_thread::sleep_for(remainingTime);
+                // Sampling within the cycle, at a cadence independent of the cycle:
+                while (nextSampleTime < cycleEnd)
+                {
+                    std::this_thread::sleep_until(nextSampleTime);
+
+                    auto collectStartTime = steady_clock::now();
+                    statsNow.Clear();
+                    statsReader.GetCurrentValues(statsNow);
+                    selfMonitor.RecordCollect(steady_clock::now() - collectStartTime);
+
+                    aggregator.AddSample(statsNow, 0);
+
+                    nextSampleTime += sampler.AddSample(statsNow, 0);
+                }
+
+                std::this_thread::sleep_until(cycleEnd);
+                scheduler.Advance(steady_clock::now());
+
+                // the first cycle might be too short (because of the phase) to have samples:
+                if (aggregator.GetCount() == 0)
+                    continue;
+
+                aggregator.Summarize(aggregates);
+
+                // after stats failed to reach the server, the next ones must be a heartbeat:
+                if (forwarder.TakeFailure())
+                    deadband.ForceHeartbeat();
+
+                if (!PushToSend(forwarder,
+                                selfMonitor,
+                                statsNow,
+                                &aggregates,
+                                deadband.Filter(statsNow, 0, &aggregates),
+                                &sampler.GetBurstSamples()))
+                {
+                    deadband.ForceHeartbeat();
+                }
+
+            } while (params.expirationInSecs <= 0
+                     || params.expirationInSecs >= clock() / CLOCKS_PER_SEC);
+        }
+        else
+        {
+            // Collection cycle:
+            do
+            {
+                scheduler.WaitForNextDeadline();
+
+                auto collectStartTime = steady_clock::now();
+                statsNow.Clear();
+                statsReader.GetCurrentValues(statsNow);
+                selfMonitor.RecordCollect(steady_clock::now() - collectStartTime);
+
+                if (forwarder.TakeFailure())
+                    deadband.ForceHeartbeat();
+
+                if (!PushToSend(forwarder, selfMonitor, statsNow, nullptr, deadband.Filter(statsNow, 0), nullptr))
+                    deadband.ForceHeartbeat();
+
+            } while (params.expirationInSecs <= 0
+                     || params.expirationInSecs >= clock() / CLOCKS_PER_SEC);
+        }
 
-        } while (params.expirationInSecs <= 0
-                 || params.expirationInSecs >= clock() / CLOCKS_PER_SEC);
+        forwarder.Stop(); // sends what is left in the queue
 
         std::cout << "Application running time has expired. Exiting now..." << std::endl;
     }
@@ -8,12 +8,23 @@
 #include <3FD\exceptions.h>
 #include <3FD\logger.h>
 #include "WebService.h"
+#include "BinaryHttp.h"
+#include "UdpTransport.h"
+#include "StreamTransport.h"
 #include "TasksQueue.h"
+#include "StatsPackagePool.h"
+#include "FlushController.h"
 #include "Authenticator.h"
+#include "StatIdDictionary.h"
 #include "MSDStorageWriter.h"
+#include "StorageWriterPool.h"
+#include "WriteAheadLog.h"
 #include <iostream>
 #include <iomanip>
 #include <chrono>
+#include <codecvt>
+#include <memory>
+#include <algorithm>
 
 
 namespace application
@@ -26,6 +37,37 @@ namespace application
     ////////////////////////////////
 
 
+    /* Answers a request with a SOAP fault telling the server is too busy, because the queue of tasks
+       is full. The client keeps the samples of a failed request to send them again later. */
+    static HRESULT SetRetryLaterFault(const char *operation,
+                                      const WS_OPERATION_CONTEXT *wsContextHandle,
+                                      WS_ERROR *wsErrorHandle)
+    {
+        AppException<std::runtime_error> busyEx("Server is too busy to take the samples now, retry later");
+        wws::SetSoapFault(busyEx, operation, wsContextHandle, wsErrorHandle);
+        return E_FAIL;
+    }
+
+
+    /* Extracts the packages from a request into a vector that each thread serving the requests reuses,
+       then moves them to the queue at once, through the write-ahead log, so the request is answered
+       only once they are on disk. When the queue is full, the packages go back to the pool. */
+    template <typename RequestType>
+    static bool EnqueueStatsFrom(const RequestType &payload)
+    {
+        static thread_local std::vector<StatsPackage> packages;
+
+        packages.clear(); // a previous failure might have left something
+        ExtractStatsDataFrom(payload, packages);
+
+        if (WriteAheadLog::GetInstance().Enqueue(std::move(packages), true))
+            return true;
+
+        StatsPackagePool::GetInstance().Recycle(packages);
+        return false;
+    }
+
+
     /* Implements handling of received 'SendStatsSample' requests.
        Requests that fail to authenticate do not get processed, but do not fail either (no SOAP fault). */
     HRESULT CALLBACK SendStatsSample_ServerImpl(
@@ -42,16 +84,16 @@ namespace application
         {
             /* The actual processing of the request does not happen here, but actually in the main
             thread. Here the request is received, the pair machine & key is used for authentication,
-            and if all goes well, a task in enqueued in a lock-free queue for later processing. This
-            way the server can provide quick servicing for all requests. */
+            and if all goes well, a task in enqueued in a bounded queue for later processing. This
+            way the server can provide quick servicing for all requests, but when the queue is full,
+            the client is told to retry later. */
 
             if (Authenticator::GetInstance().IsAuthentic(payload->machine, key))
             {
-                *status = TRUE; // authenticated: accept request
+                if (!EnqueueStatsFrom(*payload))
+                    return SetRetryLaterFault("SendStatsSample", wsContextHandle, wsErrorHandle);
 
-                TasksQueue::GetInstance().Enqueue(
-                    ExtractStatsDataFrom(*payload)
-                );
+                *status = TRUE; // authenticated: accept request
             }
             else
                 *status = FALSE; // NOT authenticated: reject request
@@ -76,6 +118,111 @@ namespace application
         return E_FAIL;
     }
 
+
+    /* Implements handling of received 'SendStatsSamples' requests, which carry several samples
+       of the same machine. Authentication happens once for all of them, and all the extracted
+       packages (taken from the pool) go to the queue in a single call. */
+    HRESULT CALLBACK SendStatsSamples_ServerImpl(
+        _In_ const WS_OPERATION_CONTEXT *wsContextHandle,
+        _In_z_ WCHAR *key,
+        _In_ SendStatsSamplesRequest *payload,
+        _Out_ BOOL *status,
+        _In_ const WS_ASYNC_CONTEXT *wsAsyncContext,
+        _In_ WS_ERROR *wsErrorHandle)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            if (Authenticator::GetInstance().IsAuthentic(payload->machine, key))
+            {
+                if (!EnqueueStatsFrom(*payload))
+                    return SetRetryLaterFault("SendStatsSamples", wsContextHandle, wsErrorHandle);
+
+                *status = TRUE; // authenticated: accept request
+            }
+            else
+                *status = FALSE; // NOT authenticated: reject request
+
+            return S_OK;
+        }
+        catch (IAppException &ex)
+        {
+            Logger::Write(ex, Logger::PRIO_CRITICAL);
+            wws::SetSoapFault(ex, "SendStatsSamples", wsContextHandle, wsErrorHandle);
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when processing service request: " << ex.what();
+
+            AppException<std::runtime_error> appEx(oss.str());
+            Logger::Write(appEx, Logger::PRIO_CRITICAL);
+            wws::SetSoapFault(appEx, "SendStatsSamples", wsContextHandle, wsErrorHandle);
+        }
+
+        return E_FAIL;
+    }
+
+
+    /* Authenticates the machine of a request received by the binary endpoint with stats by name
+       (the key being decoded from the frame), once for all the samples, before they are decoded. */
+    static bool AuthenticateBinaryStats(InternedName machine, const std::wstring &authKey)
+    {
+        return Authenticator::GetInstance().IsAuthentic(machine, authKey.c_str());
+    }
+
+    /* Implements handling of requests received by the binary endpoint, which carry the same content
+       of 'SendStatsSamples' requests, already authenticated when the stats come by name. When they
+       come identified by ID, the session opened for the client stands for authentication instead.
+       The samples are moved to the queue in a single call, and the response waits for them to be on
+       disk, in the write-ahead log. When the queue is full, the client is told to retry later. */
+    static BinaryStatus HandleBinaryStats(const std::wstring &authKey,
+                                          uint64_t sessionId,
+                                          std::vector<StatsPackage> &packages)
+    {
+        if (sessionId != 0)
+        {
+            auto status = StatIdDictionary::GetInstance().ResolveSession(sessionId, packages);
+            if (status != BinaryStatus::Accepted)
+                return status;
+        }
+
+        if (!packages.empty() && !WriteAheadLog::GetInstance().Enqueue(std::move(packages), true))
+        {
+            StatsPackagePool::GetInstance().Recycle(packages);
+            return BinaryStatus::RetryLater;
+        }
+
+        return BinaryStatus::Accepted;
+    }
+
+    // Opens a session for an authentic client of the binary endpoint, so it can send the stats by ID
+    static uint64_t OpenBinarySession(const std::wstring &machine,
+                                      const std::wstring &authKey,
+                                      const std::vector<std::wstring> &statNames,
+                                      std::vector<int16_t> &statIds)
+    {
+        if (!Authenticator::GetInstance().IsAuthentic(machine.c_str(), authKey.c_str()))
+            return 0;
+
+        return StatIdDictionary::GetInstance().OpenSession(machine, statNames, statIds);
+    }
+
+    // Verifies the MAC of a datagram with the key of the machine cached by the authenticator
+    static bool VerifyDatagram(InternedName machine, const uint8_t *frame, size_t size, const uint8_t *mac)
+    {
+        return Authenticator::GetInstance().VerifyMac(machine, frame, size, mac);
+    }
+
+    // Moves the stats of a batch of authentic datagrams to the queue in a single call, through the write-ahead
+    // log without waiting (when the queue is full, they are dropped, as there is no response to tell)
+    static void HandleDatagramStats(std::vector<StatsPackage> &packages)
+    {
+        if (!WriteAheadLog::GetInstance().Enqueue(std::move(packages), false))
+            StatsPackagePool::GetInstance().Recycle(packages);
+    }
+
 }// end of namespace application
 
 
@@ -100,13 +247,38 @@ int main(int argc, char *argv[])
         // Before starting the service, prepare the authenticator
         Authenticator::GetInstance().LoadCredentials();
 
-        MSDStorageWriter dbWriter(
-            AppConfig::GetSettings().application.GetString("dbConnString", "NOT SET")
+        /* Several writers insert into database in parallel, each with its own connection,
+        and the samples of a machine always go through the same one: */
+        auto dbConnString = AppConfig::GetSettings().application.GetString("dbConnString", "NOT SET");
+        auto dbPackagesPerCommit = AppConfig::GetSettings().application.GetUInt("srvDbPackagesPerCommit", 1000);
+
+        StorageWriterPool dbWriters(
+            (std::max)(AppConfig::GetSettings().application.GetUInt("srvDbWriters", 4), 1U),
+            [&dbConnString, dbPackagesPerCommit]()
+            {
+                return std::unique_ptr<IStatsWriter>(new MSDStorageWriter(dbConnString, dbPackagesPerCommit));
+            }
         );
 
+        /* Before taking requests, write to database the packages that a previous execution
+        had accepted, but not written, which were left in the write-ahead log: */
+        std::vector<StatsPackage> tasks;
+        auto &writeAheadLog = WriteAheadLog::GetInstance();
+        writeAheadLog.Replay(tasks);
+
+        if (!tasks.empty())
+        {
+            std::cout << "Writing to database " << tasks.size() << " package(s) of samples replayed from log" << std::endl;
+            dbWriters.WriteStats(tasks);
+            dbWriters.Flush();
+        }
+
+        writeAheadLog.Truncate();
+
         // Function tables contains the service implementation:
         MacStatsCollectionBindingFunctionTable funcTableSvc = {
             &application::SendStatsSample_ServerImpl,
+            &application::SendStatsSamples_ServerImpl,
             &application::CloseService_ServerImpl
         };
 
@@ -130,29 +302,156 @@ int main(int argc, char *argv[])
 
         Logger::Write("HTTP server is ready", Logger::PRIO_INFORMATION);
 
+        /* When configured, the stats can also be posted in binary encoding, to a plain HTTP
+        endpoint which is much cheaper to parse than SOAP (such as "http://+:81/macstatsbin/"): */
+        std::unique_ptr<BinaryHttpEndpoint> binaryEndpoint;
+        auto binaryEndpointUrl = AppConfig::GetSettings().application.GetString("binarySvcHostEndpoint", "");
+
+        if (!binaryEndpointUrl.empty())
+        {
+            binaryEndpoint.reset(new BinaryHttpEndpoint(
+                std::wstring_convert<std::codecvt_utf8<wchar_t>>().from_bytes(binaryEndpointUrl),
+                &AuthenticateBinaryStats,
+                &HandleBinaryStats,
+                &OpenBinarySession
+            ));
+
+            Logger::Write("Binary HTTP endpoint is ready", Logger::PRIO_INFORMATION);
+        }
+
+        // When configured, the stats can also come in datagrams (fire-and-forget) over UDP:
+        std::unique_ptr<UdpStatsEndpoint> udpEndpoint;
+        auto udpPort = AppConfig::GetSettings().application.GetUInt("udpSvcHostPort", 0);
+
+        if (udpPort != 0)
+        {
+            udpEndpoint.reset(new UdpStatsEndpoint(
+                static_cast<uint16_t> (udpPort),
+                &VerifyDatagram,
+                &HandleDatagramStats,
+                seconds(AppConfig::GetSettings().application.GetUInt("udpMaxClockSkewSecs", 300)),
+                AppConfig::GetSettings().application.GetUInt("udpReceiveBatchSize", 64)
+            ));
+
+            Logger::Write("UDP endpoint is ready", Logger::PRIO_INFORMATION);
+        }
+
+        /* When configured, the clients can also keep a connection open, in which they authenticate
+        once (opening a session) and then stream the stats, acknowledged every some frames: */
+        std::unique_ptr<StatsStreamEndpoint> streamEndpoint;
+        auto streamPort = AppConfig::GetSettings().application.GetUInt("streamSvcHostPort", 0);
+
+        if (streamPort != 0)
+        {
+            streamEndpoint.reset(new StatsStreamEndpoint(
+                static_cast<uint16_t> (streamPort),
+                &HandleBinaryStats,
+                &OpenBinarySession,
+                AppConfig::GetSettings().application.GetUInt("streamAckEveryFrames", 16),
+                milliseconds(AppConfig::GetSettings().application.GetUInt("streamAckIntervalMillisecs", 500)),
+                AppConfig::GetSettings().application.GetUInt("streamMaxConnections", 1024)
+            ));
+
+            Logger::Write("Stream endpoint is ready", Logger::PRIO_INFORMATION);
+        }
+
         std::cout << "The application will now enter the processing loop" << std::endl;
 
-        std::vector<std::unique_ptr<StatsPackage>> tasks;
+        /* The tasks are written as soon as the queue holds enough of them for a batch, whose size
+        is tuned from the latency of the commits, or else once the maximum latency has passed: */
+        FlushController flushController(
+            AppConfig::GetSettings().application.GetUInt("srvFlushInitialPackages", 1000),
+            AppConfig::GetSettings().application.GetUInt("srvFlushMinPackages", 100),
+            AppConfig::GetSettings().application.GetUInt("srvFlushMaxPackages", 100000),
+            milliseconds(AppConfig::GetSettings().application.GetUInt("srvFlushGoalCommitMillisecs", 250))
+        );
+
+        const milliseconds flushMaxLatency(
+            AppConfig::GetSettings().application.GetUInt("srvFlushMaxLatencyMillisecs", 1000)
+        );
+
+        const seconds credentialsRefreshPeriod(
+            AppConfig::GetSettings().application.GetUInt("srvCredentialsRefreshSecs", 10)
+        );
+
+        auto lastRefreshTime = steady_clock::now();
+
+        // The depth of the queue and the requests it refused are reported in the log as often as this
+        const seconds queueReportPeriod(
+            AppConfig::GetSettings().application.GetUInt("srvQueueReportSecs", 10)
+        );
+
+        auto lastReportTime = steady_clock::now();
+        size_t maxQueueDepth(0); // since the last report
+        uint64_t lastRejectedCount(0);
+        uint64_t lastReportRejectedCount(0);
 
         // This is the main processing loop:
         bool running(true);
         while (running)
         {
+            // Wait for the tasks enqueued in parallel by client requests
+            auto &queue = TasksQueue::GetInstance();
+            queue.WaitForTasks(flushController.GetTarget(), flushMaxLatency);
+
             // Interrupt service when a request for shutdown arrives
-            running = !ServiceCloser::GetInstance().WaitForCloseRequest(
-                AppConfig::GetSettings().application.GetUInt("srvDbFlushCycleTimeSecs", 5) * 1000,
-                host
-            );
+            running = !ServiceCloser::GetInstance().WaitForCloseRequest(0, host);
+
+            /* Retrieve the tasks, once the log is sealed, so what it holds so far is in the queue
+            (when the log has failed to write to disk, this throws, so the server exits, and the
+            log is replayed once it is started again, rather than refusing every request) */
+            writeAheadLog.Rotate();
+            auto queueDepth = queue.GetDepth();
+            queue.Dequeue(tasks);
+
+            // Report the backpressure, which happens when the database cannot keep up with the clients
+            auto rejectedCount = queue.GetRejectedCount();
+            if (rejectedCount != lastRejectedCount)
+            {
+                std::ostringstream oss;
+                oss << "Tasks queue was full (depth of " << queueDepth << " package(s)) and refused "
+                    << (rejectedCount - lastRejectedCount) << " request(s) since last cycle, "
+                    << rejectedCount << " in total";
 
-            // Retrieve the tasks enqueued in parallel by client requests
-            TasksQueue::GetInstance().Dequeue(tasks);
+                Logger::Write(oss.str(), Logger::PRIO_WARNING);
+                lastRejectedCount = rejectedCount;
+            }
+
+            // Report the load of the queue periodically, even when nothing is refused
+            maxQueueDepth = (std::max)(maxQueueDepth, queueDepth);
+
+            if (steady_clock::now() - lastReportTime >= queueReportPeriod)
+            {
+                std::ostringstream oss;
+                oss << "Tasks queue: depth of " << queueDepth << " package(s), at most " << maxQueueDepth
+                    << " since last report, " << (rejectedCount - lastReportRejectedCount)
+                    << " request(s) refused since last report, " << rejectedCount << " in total";
+
+                Logger::Write(oss.str(), Logger::PRIO_INFORMATION);
+
+                lastReportTime = steady_clock::now();
+                maxQueueDepth = 0;
+                lastReportRejectedCount = rejectedCount;
+            }
 
             if (!tasks.empty())
             {
-                std::cout << "Flushing to database a batch of " << tasks.size() << " package(s) of samples" << std::endl;
+                std::cout << "Flushing to database a batch of " << tasks.size() << " package(s) of samples"
+                          << " (target is " << flushController.GetTarget() << ")" << std::endl;
 
-                // Process the tasks
-                dbWriter.WriteStats(tasks);
+                /* Process the tasks (which are cleared), measuring how long the commit takes. Upon return,
+                the previous batches are in the database, while the last commit of this one goes on, in
+                parallel with gathering and converting the next batch: */
+                flushController.Commit(dbWriters, tasks);
+
+                // Once in the database, the packages are no longer needed in the log (but those of this batch still are)
+                writeAheadLog.Truncate(1);
+            }
+            else
+            {
+                // Nothing new came, so wait for the last batch to be in the database, then truncate the whole log
+                dbWriters.Flush();
+                writeAheadLog.Truncate();
             }
 
             /* Here I would place an implementation for processing the samples looking for
@@ -160,8 +459,16 @@ int main(int argc, char *argv[])
 
             /* Refresh the credentials cached in the authenticator, for when new
             credentials are included in the database while the service is up */
-            Authenticator::GetInstance().LoadCredentials();
+            if (steady_clock::now() - lastRefreshTime >= credentialsRefreshPeriod)
+            {
+                Authenticator::GetInstance().LoadCredentials();
+                lastRefreshTime = steady_clock::now();
+            }
         }
+
+        // The last batch might still be committing
+        dbWriters.Flush();
+        writeAheadLog.Truncate();
     }
     catch (IAppException &ex)
     {
@@ -179,7 +486,12 @@ int main(int argc, char *argv[])
     }
 
     ServiceCloser::Finalize();
+    WriteAheadLog::Finalize(); // before the queue it feeds
+    TasksQueue::Finalize();
+    StatsPackagePool::Finalize();
+    StatIdDictionary::Finalize();
     Authenticator::Finalize();
+    NameInterner::Finalize(); // the last one, because the others keep interned names
 
     return rc;
 }
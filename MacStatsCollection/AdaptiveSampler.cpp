@@ -0,0 +1,286 @@
+#include "stdafx.h"
+#include "AdaptiveSampler.h"
+#include "PerfCountersCatalog.h"
+#include <3FD/callstacktracer.h>
+#include <3FD/exceptions.h>
+#include <3FD/configuration.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <codecvt>
+#include <cstdlib>
+#include <sstream>
+
+namespace application
+{
+    using namespace _3fd::core;
+
+
+    /// <summary>
+    /// Loads the triggers of sampling burst declared in the application configuration under
+    /// the keys "burstTrigger1", "burstTrigger2" and so on (until the first missing key), in
+    /// the format "stat_name;rate_per_sec". A name ending in '*' applies the trigger to every
+    /// counter whose name of stat starts like it, such as the instances of a wildcard.
+    /// </summary>
+    /// <param name="catalog">The catalog of performance counters, with wildcards expanded.</param>
+    /// <returns>The triggers, which might be none.</returns>
+    std::vector<BurstTrigger> LoadBurstTriggers(const std::vector<PerfCounterDescriptor> &catalog)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            std::vector<BurstTrigger> triggers;
+            std::wstring_convert<std::codecvt_utf8<wchar_t>> transcoder;
+
+            for (uint32_t number = 1; true; ++number)
+            {
+                std::ostringstream oss;
+                oss << "burstTrigger" << number;
+                auto key = oss.str();
+
+                auto text = AppConfig::GetSettings().application.GetString(key, "");
+                if (text.empty())
+                    break;
+
+                auto endOfName = text.find(';');
+                const char *rateText = (endOfName != std::string::npos) ? text.c_str() + endOfName + 1 : "";
+                char *endOfRate;
+                double ratePerSec = strtod(rateText, &endOfRate);
+
+                if (endOfName == 0 || endOfName == std::string::npos || endOfRate == rateText || *endOfRate != 0 || ratePerSec <= 0.0)
+                {
+                    oss.str("");
+                    oss << "Invalid declaration of burst trigger in configuration: " << key << " = '" << text << '\'';
+                    throw AppException<std::runtime_error>(oss.str());
+                }
+
+                auto counterIds = FindCounterIds(catalog, transcoder.from_bytes(text.substr(0, endOfName)));
+
+                if (counterIds.empty())
+                {
+                    oss.str("");
+                    oss << "Burst trigger in configuration does not match any counter in the catalog: " << key << " = '" << text << '\'';
+                    throw AppException<std::runtime_error>(oss.str());
+                }
+
+                for (auto counterId : counterIds)
+                    triggers.push_back(BurstTrigger{ counterId, ratePerSec });
+            }
+
+            return triggers;
+        }
+        catch (IAppException &)
+        {
+            throw; // just forward already prepared application exceptions
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when loading triggers of sampling burst: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="AdaptiveSampler"/> class.
+    /// </summary>
+    /// <param name="triggers">The triggers of burst. When there is none, the interval never changes.</param>
+    /// <param name="counterIds">The counters in the columns of every sample to add (index in the catalog),
+    /// which must include the counters of all triggers.</param>
+    /// <param name="baseInterval">The interval between samples while values are flat.</param>
+    /// <param name="burstInterval">The interval between samples right after a trigger.</param>
+    /// <param name="holdTime">How long after the last trigger the burst interval is kept, before
+    /// it starts doubling back to the base interval.</param>
+    /// <param name="preTriggerCapacity">How many samples before the trigger are kept to upload.</param>
+    /// <param name="maxBurstSamples">How many samples the burst can accumulate before they are
+    /// uploaded. Once full, the next samples are no longer kept.</param>
+    AdaptiveSampler::AdaptiveSampler(const std::vector<BurstTrigger> &triggers,
+                                     const std::vector<uint32_t> &counterIds,
+                                     std::chrono::milliseconds baseInterval,
+                                     std::chrono::milliseconds burstInterval,
+                                     std::chrono::milliseconds holdTime,
+                                     size_t preTriggerCapacity,
+                                     size_t maxBurstSamples)
+        : m_triggers(triggers)
+        , m_hasLastSample(false)
+        , m_baseInterval(baseInterval)
+        , m_burstInterval((std::min)(burstInterval, baseInterval))
+        , m_holdTime(holdTime)
+        , m_interval(baseInterval)
+        , m_isBursting(false)
+        , m_ringCapacity(preTriggerCapacity)
+        , m_ringNextPos(0)
+        , m_ringCount(0)
+        , m_maxBurstSamples(maxBurstSamples)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            assert(baseInterval.count() > 0 && burstInterval.count() > 0);
+
+            for (auto &trigger : triggers)
+            {
+                auto iter = std::find(counterIds.begin(), counterIds.end(), trigger.counterId);
+
+                if (iter == counterIds.end())
+                {
+                    std::ostringstream oss;
+                    oss << "Burst trigger refers to counter " << trigger.counterId << ", which is not sampled";
+                    throw AppException<std::runtime_error>(oss.str());
+                }
+
+                m_triggerColumns.push_back(iter - counterIds.begin());
+            }
+
+            m_lastValues.resize(triggers.size());
+            m_lastQualities.resize(triggers.size());
+
+            m_burstSamples.counterIds = counterIds;
+            m_ringTimes.resize(preTriggerCapacity);
+            m_ringValues.resize(preTriggerCapacity * counterIds.size());
+            m_ringQualities.resize(preTriggerCapacity * counterIds.size());
+        }
+        catch (IAppException &)
+        {
+            throw; // just forward already prepared application exceptions
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when creating adaptive sampler: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    // Whether any counter in the sample changed faster than its trigger since the last sample
+    bool AdaptiveSampler::IsTriggered(const SamplesBatch &batch, size_t row) const
+    {
+        double elapsedSecs = std::chrono::duration<double>(batch.times[row] - m_lastTime).count();
+        if (elapsedSecs <= 0.0)
+            return false;
+
+        auto values = batch.GetValues(row);
+        auto qualities = batch.GetQualities(row);
+
+        for (size_t idx = 0; idx < m_triggers.size(); ++idx)
+        {
+            auto column = m_triggerColumns[idx];
+
+            if (qualities[column] == Quality::Good
+                && m_lastQualities[idx] == Quality::Good
+                && std::abs(values[column] - m_lastValues[idx]) >= m_triggers[idx].ratePerSec * elapsedSecs)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+
+    // Keeps the values of the triggering counters, to calculate their rate in the next sample
+    void AdaptiveSampler::KeepLastValues(const SamplesBatch &batch, size_t row)
+    {
+        auto values = batch.GetValues(row);
+        auto qualities = batch.GetQualities(row);
+
+        for (size_t idx = 0; idx < m_triggers.size(); ++idx)
+        {
+            m_lastValues[idx] = values[m_triggerColumns[idx]];
+            m_lastQualities[idx] = qualities[m_triggerColumns[idx]];
+        }
+
+        m_lastTime = batch.times[row];
+        m_hasLastSample = true;
+    }
+
+
+    // Moves the samples in the ring buffer to the burst, from the oldest to the newest
+    void AdaptiveSampler::MoveRingToBurst()
+    {
+        if (m_ringCount == 0)
+            return;
+
+        auto counterCount = m_burstSamples.GetCounterCount();
+        auto oldestPos = (m_ringNextPos + m_ringCapacity - m_ringCount) % m_ringCapacity;
+
+        for (size_t idx = 0; idx < m_ringCount && m_burstSamples.GetSampleCount() < m_maxBurstSamples; ++idx)
+        {
+            auto pos = (oldestPos + idx) % m_ringCapacity;
+            auto row = m_burstSamples.AddSample(m_ringTimes[pos]);
+
+            std::copy(m_ringValues.data() + pos * counterCount,
+                      m_ringValues.data() + (pos + 1) * counterCount,
+                      m_burstSamples.GetValues(row));
+
+            std::copy(m_ringQualities.data() + pos * counterCount,
+                      m_ringQualities.data() + (pos + 1) * counterCount,
+                      m_burstSamples.GetQualities(row));
+        }
+
+        m_ringNextPos = 0;
+        m_ringCount = 0;
+    }
+
+
+    /// <summary>
+    /// Adds a sample, which is either kept in the ring buffer of samples before
+    /// the trigger, or added to the burst to upload. The sample must have the
+    /// columns given upon construction.
+    /// </summary>
+    /// <param name="batch">The batch containing the sample to add.</param>
+    /// <param name="row">The row of the sample in the batch.</param>
+    /// <returns>How long to wait before taking the next sample.</returns>
+    std::chrono::milliseconds AdaptiveSampler::AddSample(const SamplesBatch &batch, size_t row)
+    {
+        assert(m_burstSamples.counterIds == batch.counterIds);
+
+        auto counterCount = batch.GetCounterCount();
+
+        auto time = batch.times[row];
+
+        if (m_hasLastSample && IsTriggered(batch, row))
+        {
+            if (!m_isBursting)
+            {
+                MoveRingToBurst();
+                m_isBursting = true;
+            }
+
+            m_lastTriggerTime = time;
+            m_interval = m_burstInterval;
+        }
+        else if (m_isBursting && time - m_lastTriggerTime >= m_holdTime)
+        {
+            // back off exponentially:
+            m_interval = (std::min)(m_interval * 2, m_baseInterval);
+            m_isBursting = (m_interval < m_baseInterval);
+        }
+
+        KeepLastValues(batch, row);
+
+        if (m_isBursting)
+        {
+            if (m_burstSamples.GetSampleCount() < m_maxBurstSamples)
+                m_burstSamples.AddSampleFrom(batch, row);
+        }
+        else if (m_ringCapacity > 0)
+        {
+            m_ringTimes[m_ringNextPos] = time;
+            std::copy(batch.GetValues(row), batch.GetValues(row) + counterCount, m_ringValues.data() + m_ringNextPos * counterCount);
+            std::copy(batch.GetQualities(row), batch.GetQualities(row) + counterCount, m_ringQualities.data() + m_ringNextPos * counterCount);
+
+            m_ringNextPos = (m_ringNextPos + 1) % m_ringCapacity;
+
+            if (m_ringCount < m_ringCapacity)
+                ++m_ringCount;
+        }
+
+        return m_interval;
+    }
+
+}// end of namespace application
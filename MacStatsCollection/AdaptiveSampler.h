@@ -0,0 +1,95 @@
+#ifndef __AdaptiveSampler_h__ // header guard
+#define __AdaptiveSampler_h__
+
+#include "CommonDataExchange.h"
+#include <vector>
+#include <chrono>
+
+namespace application
+{
+    /// <summary>
+    /// Declares that a burst of sampling starts when the value of
+    /// a performance counter changes faster than a given rate.
+    /// </summary>
+    struct BurstTrigger
+    {
+        uint32_t counterId; // index in the catalog
+        double ratePerSec; // absolute change of value per second
+    };
+
+    std::vector<BurstTrigger> LoadBurstTriggers(const std::vector<PerfCounterDescriptor> &catalog);
+
+
+    /// <summary>
+    /// Decides the interval between samples of performance counters. It stays at a base
+    /// interval while the values are flat, but switches to a shorter one as soon as a counter
+    /// changes faster than its trigger, and backs off once the values are flat again. The
+    /// last samples before the trigger are kept in a ring buffer, so the burst of samples to
+    /// upload starts a bit before the incident.
+    /// </summary>
+    /// <seealso cref="notcopiable" />
+    class AdaptiveSampler
+    {
+    private:
+
+        typedef std::chrono::time_point<std::chrono::system_clock> TimePoint;
+
+        std::vector<BurstTrigger> m_triggers;
+        std::vector<size_t> m_triggerColumns; // column in the batch of each trigger
+        std::vector<double> m_lastValues; // one per trigger
+        std::vector<Quality> m_lastQualities;
+        TimePoint m_lastTime;
+        bool m_hasLastSample;
+
+        std::chrono::milliseconds m_baseInterval;
+        std::chrono::milliseconds m_burstInterval;
+        std::chrono::milliseconds m_holdTime;
+        std::chrono::milliseconds m_interval;
+        TimePoint m_lastTriggerTime;
+        bool m_isBursting;
+
+        // ring buffer of samples before the trigger:
+        std::vector<TimePoint> m_ringTimes;
+        std::vector<double> m_ringValues; // row after row, 'capacity' rows
+        std::vector<Quality> m_ringQualities;
+        size_t m_ringCapacity;
+        size_t m_ringNextPos;
+        size_t m_ringCount;
+
+        SamplesBatch m_burstSamples;
+        size_t m_maxBurstSamples;
+
+        bool IsTriggered(const SamplesBatch &batch, size_t row) const;
+
+        void KeepLastValues(const SamplesBatch &batch, size_t row);
+
+        void MoveRingToBurst();
+
+    public:
+
+        AdaptiveSampler(const std::vector<BurstTrigger> &triggers,
+                        const std::vector<uint32_t> &counterIds,
+                        std::chrono::milliseconds baseInterval,
+                        std::chrono::milliseconds burstInterval,
+                        std::chrono::milliseconds holdTime,
+                        size_t preTriggerCapacity,
+                        size_t maxBurstSamples);
+
+        AdaptiveSampler(const AdaptiveSampler &) = delete;
+
+        std::chrono::milliseconds AddSample(const SamplesBatch &batch, size_t row);
+
+        std::chrono::milliseconds GetInterval() const { return m_interval; }
+
+        bool IsBursting() const { return m_isBursting; }
+
+        /// <summary>
+        /// Gets the samples of the burst (starting with the ones before the trigger)
+        /// that are waiting to be uploaded. The caller must clear them once sent.
+        /// </summary>
+        SamplesBatch &GetBurstSamples() { return m_burstSamples; }
+    };
+
+}// end of namespace application
+
+#endif // end of header guard
@@ -4,7 +4,7 @@
 #include <3FD\exceptions.h>
 #include <3FD\logger.h>
 #include <3FD\configuration.h>
-#include <3FD\utils_algorithms.h>
+#include <algorithm>
 #include <codecvt>
 #include <sstream>
 
@@ -190,6 +190,24 @@ namespace application
     /// </returns>
     bool Authenticator::IsAuthentic(const wchar_t *machine, const wchar_t *idKey) const
     {
+        // a machine whose name was never interned cannot have a credential:
+        return IsAuthentic(InternedName::Find(machine), idKey);
+    }
+
+
+    /// <summary>
+    /// Determines whether the given credential is authentic.
+    /// </summary>
+    /// <param name="machine">The interned machine ID.</param>
+    /// <param name="idKey">The verification key.</param>
+    /// <returns>
+    ///   <c>true</c> if the given credential is authentic, otherwise, <c>false</c>.
+    /// </returns>
+    bool Authenticator::IsAuthentic(InternedName machine, const wchar_t *idKey) const
+    {
+        if (machine.IsEmpty())
+            return false;
+
         CALL_STACK_TRACE;
 
         try
@@ -197,13 +215,9 @@ namespace application
             // Shared lock for read access
             std::shared_lock<std::shared_mutex> lock(m_cacheAccessSharedMutex);
 
-            auto iter = utils::BinarySearch(
-                std::wstring(machine),
-                m_cachedCredentials.begin(),
-                m_cachedCredentials.end()
-            );
-
-            return (m_cachedCredentials.end() != iter);
+            return std::binary_search(m_authenticMachines.begin(),
+                                      m_authenticMachines.end(),
+                                      AuthenticMachine{ machine, std::string() });
         }
         catch (std::system_error &ex)
         {
@@ -222,6 +236,59 @@ namespace application
     }
 
 
+    /// <summary>
+    /// Verifies the MAC of a message (computed by <see cref="HmacSha256"/>)
+    /// with the key of the machine it claims to come from.
+    /// </summary>
+    /// <param name="machine">The interned machine ID.</param>
+    /// <param name="data">The message.</param>
+    /// <param name="size">The size of the message.</param>
+    /// <param name="mac">The MAC to verify.</param>
+    /// <returns>
+    ///   <c>true</c> if the machine has a credential and the MAC is the one of its key, otherwise, <c>false</c>.
+    /// </returns>
+    bool Authenticator::VerifyMac(InternedName machine, const uint8_t *data, size_t size, const uint8_t *mac) const
+    {
+        if (machine.IsEmpty())
+            return false;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            // Shared lock for read access
+            std::shared_lock<std::shared_mutex> lock(m_cacheAccessSharedMutex);
+
+            auto iter = std::lower_bound(m_authenticMachines.begin(),
+                                         m_authenticMachines.end(),
+                                         AuthenticMachine{ machine, std::string() });
+
+            if (m_authenticMachines.end() == iter || iter->machine != machine)
+                return false;
+
+            return m_hmac.Verify(iter->key, data, size, mac);
+        }
+        catch (IAppException &)
+        {
+            throw; // just forward already prepared application exceptions
+        }
+        catch (std::system_error &ex)
+        {
+            CALL_STACK_TRACE;
+            std::ostringstream oss;
+            oss << "System error during verification of MAC: " << StdLibExt::GetDetailsFromSystemError(ex);
+            throw AppException<std::runtime_error>(oss.str());
+        }
+        catch (std::exception &ex)
+        {
+            CALL_STACK_TRACE;
+            std::ostringstream oss;
+            oss << "Generic failure prevented verification of MAC: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
     /// <summary>
     /// Read all credentials from database and load them into cache.
     /// </summary>
@@ -240,6 +307,20 @@ namespace application
                 m_dbSession.reconnect();
 
             m_selectAllCredentials->execute(); // load
+
+            m_authenticMachines.clear();
+            m_authenticMachines.reserve(m_cachedCredentials.size());
+
+            std::wstring_convert<std::codecvt_utf8<wchar_t>> transcoder;
+
+            for (auto &credential : m_cachedCredentials)
+            {
+                m_authenticMachines.push_back(
+                    AuthenticMachine{ InternedName(credential.machine), transcoder.to_bytes(credential.idKey) }
+                );
+            }
+
+            std::sort(m_authenticMachines.begin(), m_authenticMachines.end());
         }
         catch (Poco::Data::DataException &ex)
         {
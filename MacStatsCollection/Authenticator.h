@@ -2,6 +2,8 @@
 #define __Authenticator_h__
 
 #include "Utilities.h"
+#include "NameInterner.h"
+#include "HmacSha256.h"
 #include <POCO\Tuple.h>
 #include <POCO\Data\Session.h>
 #include <shared_mutex>
@@ -22,13 +24,14 @@ namespace application
     {
         std::wstring machine;
         std::wstring idKey;
-
-        const std::wstring &GetKey() const { return machine; }
     };
 
     /// <summary>
     /// Provides fast authentication of requests by keeping
-    /// in cache the credentials read from database.
+    /// in cache the credentials read from database. The names
+    /// of the machines are interned, so they are looked up by handle.
+    /// The keys are kept too, to verify the MAC of messages that
+    /// do not carry the key (such as the datagrams over UDP).
     /// </summary>
     class Authenticator : OdbcClient
     {
@@ -40,6 +43,21 @@ namespace application
 
         std::vector<Credential> m_cachedCredentials;
 
+        /// <summary>
+        /// A machine with credential, and its key in UTF-8.
+        /// </summary>
+        struct AuthenticMachine
+        {
+            InternedName machine;
+            std::string key;
+
+            bool operator <(const AuthenticMachine &other) const { return machine < other.machine; }
+        };
+
+        std::vector<AuthenticMachine> m_authenticMachines; // sorted by handle
+
+        HmacSha256 m_hmac;
+
         /// <summary>
         /// Access to the cache of credentials will be controlled
         /// by this "multiple readers, single writer" lock.
@@ -62,6 +80,10 @@ namespace application
 
         bool IsAuthentic(const wchar_t *machine, const wchar_t *idKey) const;
 
+        bool IsAuthentic(InternedName machine, const wchar_t *idKey) const;
+
+        bool VerifyMac(InternedName machine, const uint8_t *data, size_t size, const uint8_t *mac) const;
+
         void LoadCredentials();
     };
 
@@ -0,0 +1,1139 @@
+#include "stdafx.h"
+#include "BinaryCodec.h"
+#include "GorillaCodec.h"
+#include "StatsPackagePool.h"
+#include <3FD/callstacktracer.h>
+#include <3FD/exceptions.h>
+#include <algorithm>
+#include <cassert>
+#include <codecvt>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <locale>
+#include <sstream>
+
+namespace application
+{
+    using namespace _3fd::core;
+
+
+    // Starts every frame, followed by the version of the format and the kind of frame
+    static const uint8_t frameMagic[] = { 'M', 'S', 'C', 'B' };
+
+    static const uint8_t frameVersion(2);
+
+    static const size_t frameHeaderSize(sizeof frameMagic + 2);
+
+    // How many stats are listed for each counter in the catalog to open a session
+    static const size_t slotsPerCounter(1 + numSupAggregates);
+
+    // How many qualities are packed in a byte
+    static const uint32_t qualitiesPerByte(4);
+
+
+    ////////////////////
+    // Encoding
+    ////////////////////
+
+    static void AppendVarint(std::vector<uint8_t> &buffer, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            buffer.push_back(static_cast<uint8_t> (value | 0x80));
+            value >>= 7;
+        }
+
+        buffer.push_back(static_cast<uint8_t> (value));
+    }
+
+    // Zigzag maps signed integers of small magnitude to small unsigned integers
+    static void AppendSignedVarint(std::vector<uint8_t> &buffer, int64_t value)
+    {
+        AppendVarint(buffer, (static_cast<uint64_t> (value) << 1) ^ static_cast<uint64_t> (value >> 63));
+    }
+
+    static void AppendUInt32(std::vector<uint8_t> &buffer, uint32_t value)
+    {
+        buffer.push_back(static_cast<uint8_t> (value));
+        buffer.push_back(static_cast<uint8_t> (value >> 8));
+        buffer.push_back(static_cast<uint8_t> (value >> 16));
+        buffer.push_back(static_cast<uint8_t> (value >> 24));
+    }
+
+    static void AppendUInt64(std::vector<uint8_t> &buffer, uint64_t value)
+    {
+        AppendUInt32(buffer, static_cast<uint32_t> (value));
+        AppendUInt32(buffer, static_cast<uint32_t> (value >> 32));
+    }
+
+    static void AppendBytes(std::vector<uint8_t> &buffer, const std::string &bytes)
+    {
+        AppendVarint(buffer, bytes.size());
+        buffer.insert(buffer.end(), bytes.begin(), bytes.end());
+    }
+
+    // Appends a string in UTF-8, which for stat names is plain ASCII
+    static void AppendString(std::vector<uint8_t> &buffer, const std::wstring &str)
+    {
+        bool isAscii = std::all_of(str.begin(), str.end(), [](wchar_t ch) { return ch < 0x80; });
+
+        if (!isAscii)
+        {
+            AppendBytes(buffer, std::wstring_convert<std::codecvt_utf8<wchar_t>>().to_bytes(str));
+            return;
+        }
+
+        AppendVarint(buffer, str.size());
+
+        for (auto ch : str)
+            buffer.push_back(static_cast<uint8_t> (ch));
+    }
+
+    static uint8_t ToQualityBits(Quality quality)
+    {
+        return static_cast<uint8_t> (static_cast<uint8_t> (quality) / 4) & 0x3;
+    }
+
+    static int64_t ToMillisecsSinceEpoch(std::chrono::time_point<std::chrono::system_clock> time)
+    {
+        using namespace std::chrono;
+        static const auto epoch = system_clock().from_time_t(0);
+        return duration_cast<milliseconds>(time - epoch).count();
+    }
+
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="BinaryStatsEncoder"/> class.
+    /// </summary>
+    /// <param name="machine">The name of the machine the stats come from.</param>
+    /// <param name="authKey">The key for authentication of the machine.</param>
+    BinaryStatsEncoder::BinaryStatsEncoder(const std::wstring &machine, const std::wstring &authKey)
+        : m_sessionId(0)
+        , m_slotCount(0)
+        , m_lastTime(0)
+        , m_sampleCount(0)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            std::wstring_convert<std::codecvt_utf8<wchar_t>> transcoder;
+            m_machine = transcoder.to_bytes(machine);
+            m_authKey = transcoder.to_bytes(authKey);
+
+            m_selfMetricNames.reserve(numSelfMetrics);
+            for (uint32_t idx = 0; idx < numSelfMetrics; ++idx)
+                m_selfMetricNames.push_back(ToStatName(static_cast<SelfMetricCode> (idx)));
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when creating binary encoder of stats: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    // Gathers the stats of a sample the same way they go in a SOAP request, then encodes them
+    void BinaryStatsEncoder::AddSample(const std::vector<PerfCounterDescriptor> &catalog,
+                                       const SamplesBatch &batch,
+                                       size_t row,
+                                       const SamplesAggregates *aggregates,
+                                       const uint8_t *sendMask,
+                                       const CollectedStats *selfMetricsSource)
+    {
+        m_floatStats.clear();
+        m_floatValues.clear();
+        m_floatQualities.clear();
+        m_intStats.clear();
+        m_intValues.clear();
+        m_intQualities.clear();
+
+        auto values = batch.GetValues(row);
+        auto qualities = batch.GetQualities(row);
+
+        for (size_t idx = 0; idx < batch.GetCounterCount(); ++idx)
+        {
+            if (sendMask != nullptr && sendMask[idx] == 0)
+                continue;
+
+            auto counterId = batch.counterIds[idx];
+            auto &descriptor = catalog[counterId];
+
+            if (descriptor.valueType == StatValueType::Float32)
+            {
+                m_floatStats.push_back(StatRef{ &descriptor.statName, counterId * slotsPerCounter });
+                m_floatValues.push_back(static_cast<float> (values[idx]));
+                m_floatQualities.push_back(qualities[idx]);
+            }
+            else
+            {
+                m_intStats.push_back(StatRef{ &descriptor.statName, counterId * slotsPerCounter });
+                m_intValues.push_back(static_cast<int32_t> (values[idx]));
+                m_intQualities.push_back(qualities[idx]);
+            }
+        }
+
+        if (aggregates != nullptr)
+        {
+            for (size_t idx = 0; idx < aggregates->counterIds.size(); ++idx)
+            {
+                if (sendMask != nullptr && sendMask[idx] == 0)
+                    continue;
+
+                auto counterId = aggregates->counterIds[idx];
+                auto &descriptor = catalog[counterId];
+                auto aggregated = aggregates->GetValues(idx);
+
+                for (uint32_t aggIndex = 0; aggIndex < numSupAggregates; ++aggIndex)
+                {
+                    m_floatStats.push_back(StatRef{ &descriptor.aggregateStatNames[aggIndex],
+                                                    counterId * slotsPerCounter + 1 + aggIndex });
+                    m_floatValues.push_back(aggregated[aggIndex]);
+                    m_floatQualities.push_back(aggregates->qualities[idx]);
+                }
+            }
+        }
+
+        if (selfMetricsSource != nullptr)
+        {
+            for (uint32_t idx = 0; idx < numSelfMetrics; ++idx)
+            {
+                m_floatStats.push_back(StatRef{ &m_selfMetricNames[idx], catalog.size() * slotsPerCounter + idx });
+                m_floatValues.push_back(selfMetricsSource->selfMetrics[idx].value);
+                m_floatQualities.push_back(selfMetricsSource->selfMetrics[idx].quality);
+            }
+        }
+
+        FlushSample(ToMillisecsSinceEpoch(batch.times[row]));
+    }
+
+
+    // Encodes the stats gathered for a sample
+    void BinaryStatsEncoder::FlushSample(int64_t timeSinceEpochInMillisecs)
+    {
+        AppendSignedVarint(m_body, timeSinceEpochInMillisecs - m_lastTime);
+        m_lastTime = timeSinceEpochInMillisecs;
+
+        AppendVarint(m_body, m_floatStats.size());
+        AppendVarint(m_body, m_intStats.size());
+
+        // within a session, the stats go by ID:
+        if (m_sessionId != 0)
+        {
+            for (auto &stat : m_floatStats)
+                AppendVarint(m_body, static_cast<uint16_t> (m_statIds[stat.slot]));
+
+            for (auto &stat : m_intStats)
+                AppendVarint(m_body, static_cast<uint16_t> (m_statIds[stat.slot]));
+        }
+        else
+        {
+            for (auto &stat : m_floatStats)
+                AppendString(m_body, *stat.name);
+
+            for (auto &stat : m_intStats)
+                AppendString(m_body, *stat.name);
+        }
+
+        // the qualities of all stats in the sample (float first) are packed together:
+        auto statCount = m_floatQualities.size() + m_intQualities.size();
+        auto packedOffset = m_body.size();
+        m_body.resize(packedOffset + (statCount + qualitiesPerByte - 1) / qualitiesPerByte, 0);
+
+        for (size_t idx = 0; idx < statCount; ++idx)
+        {
+            auto quality = idx < m_floatQualities.size()
+                ? m_floatQualities[idx]
+                : m_intQualities[idx - m_floatQualities.size()];
+
+            m_body[packedOffset + idx / qualitiesPerByte] |= ToQualityBits(quality) << (2 * (idx % qualitiesPerByte));
+        }
+
+        for (auto value : m_floatValues)
+        {
+            uint32_t bits;
+            memcpy(&bits, &value, sizeof bits);
+            AppendUInt32(m_body, bits);
+        }
+
+        for (auto value : m_intValues)
+            AppendUInt32(m_body, static_cast<uint32_t> (value));
+
+        ++m_sampleCount;
+    }
+
+
+    // Puts the header in front of the body
+    static const std::vector<uint8_t> &MakeFrame(FrameKind kind,
+                                                 const std::vector<uint8_t> &body,
+                                                 std::vector<uint8_t> &frame)
+    {
+        frame.clear();
+        frame.insert(frame.end(), std::begin(frameMagic), std::end(frameMagic));
+        frame.push_back(frameVersion);
+        frame.push_back(static_cast<uint8_t> (kind));
+        AppendVarint(frame, body.size());
+        frame.insert(frame.end(), body.begin(), body.end());
+        return frame;
+    }
+
+
+    // Starts the body of a frame of stats, which identifies either the session or the machine
+    void BinaryStatsEncoder::BeginBody(size_t sampleCount)
+    {
+        m_body.clear();
+
+        if (m_sessionId != 0)
+        {
+            AppendUInt64(m_body, m_sessionId);
+        }
+        else
+        {
+            AppendBytes(m_body, m_machine);
+            AppendBytes(m_body, m_authKey);
+        }
+
+        AppendVarint(m_body, sampleCount);
+
+        m_lastTime = 0;
+        m_sampleCount = 0;
+    }
+
+
+    /// <summary>
+    /// Encodes the request to open a session, which lists every stat the client might send:
+    /// for each counter in the catalog, its own name followed by the names of its aggregates,
+    /// then the names of the metrics of the client. The server responds with their IDs.
+    /// </summary>
+    /// <param name="catalog">The catalog of performance counters.</param>
+    /// <returns>The encoded frame, valid until the next call.</returns>
+    const std::vector<uint8_t> &BinaryStatsEncoder::EncodeOpenSession(const std::vector<PerfCounterDescriptor> &catalog)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            m_slotCount = catalog.size() * slotsPerCounter + m_selfMetricNames.size();
+
+            m_body.clear();
+            AppendBytes(m_body, m_machine);
+            AppendBytes(m_body, m_authKey);
+            AppendVarint(m_body, m_slotCount);
+
+            for (auto &descriptor : catalog)
+            {
+                AppendString(m_body, descriptor.statName);
+
+                for (auto &name : descriptor.aggregateStatNames)
+                    AppendString(m_body, name);
+            }
+
+            for (auto &name : m_selfMetricNames)
+                AppendString(m_body, name);
+
+            return MakeFrame(FrameKind::OpenSession, m_body, m_frame);
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when encoding request to open session: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    /// <summary>
+    /// Sets the session opened by the server, so the stats go by ID from now on.
+    /// </summary>
+    /// <param name="sessionId">The session.</param>
+    /// <param name="statIds">The IDs assigned by the server, one for each
+    /// name in the last request made by <see cref="EncodeOpenSession"/>.</param>
+    /// <returns>Whether the session was set. It is not when the IDs
+    /// do not match that request, so the stats keep going by name.</returns>
+    bool BinaryStatsEncoder::SetSession(uint64_t sessionId, std::vector<int16_t> &&statIds)
+    {
+        if (sessionId == 0 || statIds.size() != m_slotCount)
+            return false;
+
+        m_sessionId = sessionId;
+        m_statIds = std::move(statIds);
+        return true;
+    }
+
+
+    /// <summary>
+    /// Drops the session, so the stats go by name again.
+    /// </summary>
+    void BinaryStatsEncoder::ResetSession()
+    {
+        m_sessionId = 0;
+        m_statIds.clear();
+    }
+
+
+    /// <summary>
+    /// Encodes the stats collected in one or more cycles, with the same content of the
+    /// SOAP request: each cycle becomes a sample (with the aggregates and the metrics of
+    /// the client, if any), followed by a sample for each row in its burst.
+    /// </summary>
+    /// <param name="catalog">The catalog of performance counters.</param>
+    /// <param name="items">The stats collected in each cycle.</param>
+    /// <returns>The encoded frame, valid until the next call.</returns>
+    const std::vector<uint8_t> &BinaryStatsEncoder::Encode(const std::vector<PerfCounterDescriptor> &catalog,
+                                                           const std::vector<const CollectedStats *> &items)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            size_t sampleCount(0);
+            for (auto item : items)
+                sampleCount += 1 + item->burst.GetSampleCount();
+
+            BeginBody(sampleCount);
+
+            for (auto item : items)
+            {
+                AddSample(catalog,
+                          item->sample,
+                          0,
+                          item->HasAggregates() ? &item->aggregates : nullptr,
+                          item->GetSendMask(),
+                          item->hasSelfMetrics ? item : nullptr);
+
+                for (size_t row = 0; row < item->burst.GetSampleCount(); ++row)
+                    AddSample(catalog, item->burst, row, nullptr, nullptr, nullptr);
+            }
+
+            assert(m_sampleCount == sampleCount);
+            return MakeFrame(m_sessionId != 0 ? FrameKind::StatsById : FrameKind::StatsByName, m_body, m_frame);
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when encoding stats in binary: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    /// <summary>
+    /// Encodes all samples in a batch, compressed by <see cref="GorillaEncoder"/>: the body lists the
+    /// counters (value type, then name or ID), followed by the series of samples in a bit stream.
+    /// </summary>
+    /// <param name="catalog">The catalog of performance counters.</param>
+    /// <param name="batch">The batch of samples.</param>
+    /// <returns>The encoded frame, valid until the next call.</returns>
+    const std::vector<uint8_t> &BinaryStatsEncoder::Encode(const std::vector<PerfCounterDescriptor> &catalog,
+                                                           const SamplesBatch &batch)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            BeginBody(batch.GetSampleCount());
+
+            auto counterCount = batch.GetCounterCount();
+            AppendVarint(m_body, counterCount);
+
+            for (auto counterId : batch.counterIds)
+            {
+                auto &descriptor = catalog[counterId];
+                m_body.push_back(static_cast<uint8_t> (descriptor.valueType));
+
+                if (m_sessionId != 0)
+                    AppendVarint(m_body, static_cast<uint16_t> (m_statIds[counterId * slotsPerCounter]));
+                else
+                    AppendString(m_body, descriptor.statName);
+            }
+
+            m_valueBits.resize(counterCount);
+            m_qualityCodes.resize(counterCount);
+
+            GorillaEncoder compressor(m_body, counterCount);
+
+            for (size_t row = 0; row < batch.GetSampleCount(); ++row)
+            {
+                auto values = batch.GetValues(row);
+                auto qualities = batch.GetQualities(row);
+
+                for (size_t idx = 0; idx < counterCount; ++idx)
+                {
+                    if (catalog[batch.counterIds[idx]].valueType == StatValueType::Float32)
+                    {
+                        auto value = static_cast<float> (values[idx]);
+                        memcpy(&m_valueBits[idx], &value, sizeof value);
+                    }
+                    else
+                        m_valueBits[idx] = static_cast<uint32_t> (static_cast<int32_t> (values[idx]));
+
+                    m_qualityCodes[idx] = ToQualityBits(qualities[idx]);
+                }
+
+                compressor.Append(ToMillisecsSinceEpoch(batch.times[row]), m_valueBits.data(), m_qualityCodes.data());
+            }
+
+            compressor.Finish();
+
+            return MakeFrame(m_sessionId != 0 ? FrameKind::BatchById : FrameKind::BatchByName, m_body, m_frame);
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when encoding stats in binary: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    ////////////////////
+    // Decoding
+    ////////////////////
+
+    /// <summary>
+    /// Reads the fields of a frame, never past its end.
+    /// </summary>
+    class BinaryReader
+    {
+    private:
+
+        const uint8_t *m_pos;
+        const uint8_t *m_end;
+
+    public:
+
+        BinaryReader(const uint8_t *data, size_t size)
+            : m_pos(data), m_end(data + size) {}
+
+        size_t GetRemaining() const { return m_end - m_pos; }
+
+        bool ReadVarint(uint64_t &value)
+        {
+            value = 0;
+
+            for (uint32_t shift = 0; shift < 64; shift += 7)
+            {
+                if (m_pos == m_end)
+                    return false;
+
+                auto byte = *m_pos++;
+                value |= static_cast<uint64_t> (byte & 0x7F) << shift;
+
+                if ((byte & 0x80) == 0)
+                    return true;
+            }
+
+            return false; // too long
+        }
+
+        bool ReadSignedVarint(int64_t &value)
+        {
+            uint64_t zigzag;
+            if (!ReadVarint(zigzag))
+                return false;
+
+            value = static_cast<int64_t> (zigzag >> 1) ^ -static_cast<int64_t> (zigzag & 1);
+            return true;
+        }
+
+        // Reads a count of items that take at least the given size each
+        bool ReadCount(size_t minItemSize, size_t &count)
+        {
+            uint64_t value;
+            if (!ReadVarint(value) || value > GetRemaining() / minItemSize)
+                return false;
+
+            count = static_cast<size_t> (value);
+            return true;
+        }
+
+        bool ReadUInt32(uint32_t &value)
+        {
+            if (GetRemaining() < 4)
+                return false;
+
+            value = static_cast<uint32_t> (m_pos[0])
+                | (static_cast<uint32_t> (m_pos[1]) << 8)
+                | (static_cast<uint32_t> (m_pos[2]) << 16)
+                | (static_cast<uint32_t> (m_pos[3]) << 24);
+
+            m_pos += 4;
+            return true;
+        }
+
+        bool ReadUInt64(uint64_t &value)
+        {
+            uint32_t low, high;
+            if (!ReadUInt32(low) || !ReadUInt32(high))
+                return false;
+
+            value = static_cast<uint64_t> (low) | (static_cast<uint64_t> (high) << 32);
+            return true;
+        }
+
+        // Reads the ID of a statistic, which is positive in the database
+        bool ReadStatId(int16_t &statId)
+        {
+            uint64_t value;
+            if (!ReadVarint(value) || value == 0 || value > static_cast<uint64_t> ((std::numeric_limits<int16_t>::max)()))
+                return false;
+
+            statId = static_cast<int16_t> (value);
+            return true;
+        }
+
+        bool ReadString(std::wstring &str)
+        {
+            size_t length;
+            if (!ReadCount(1, length))
+                return false;
+
+            auto begin = reinterpret_cast<const char *> (m_pos);
+            auto end = begin + length;
+            m_pos += length;
+
+            if (std::all_of(begin, end, [](char ch) { return (ch & 0x80) == 0; }))
+            {
+                str.assign(begin, end);
+                return true;
+            }
+
+            try
+            {
+                str = std::wstring_convert<std::codecvt_utf8<wchar_t>>().from_bytes(begin, end);
+                return true;
+            }
+            catch (std::range_error &)
+            {
+                return false; // invalid UTF-8
+            }
+        }
+
+        const uint8_t *Skip(size_t size)
+        {
+            if (GetRemaining() < size)
+                return nullptr;
+
+            auto pos = m_pos;
+            m_pos += size;
+            return pos;
+        }
+    };
+
+
+    // Reads the header of a frame, which must be followed by a body that ends with the data
+    static bool ReadHeader(BinaryReader &reader, FrameKind &kind)
+    {
+        auto header = reader.Skip(frameHeaderSize);
+        if (header == nullptr
+            || memcmp(header, frameMagic, sizeof frameMagic) != 0
+            || header[sizeof frameMagic] != frameVersion
+            || header[sizeof frameMagic + 1] > static_cast<uint8_t> (FrameKind::BatchById))
+        {
+            return false;
+        }
+
+        kind = static_cast<FrameKind> (header[sizeof frameMagic + 1]);
+
+        uint64_t bodySize;
+        return reader.ReadVarint(bodySize) && bodySize == reader.GetRemaining();
+    }
+
+
+    /// <summary>
+    /// Tells what a frame carries, checking only its header.
+    /// </summary>
+    /// <param name="data">The frame.</param>
+    /// <param name="size">The size of the frame.</param>
+    /// <param name="kind">Where to save the kind of frame.</param>
+    /// <returns>Whether the header is well formed.</returns>
+    bool PeekFrameKind(const uint8_t *data, size_t size, FrameKind &kind)
+    {
+        BinaryReader reader(data, size);
+        return ReadHeader(reader, kind);
+    }
+
+
+    /// <summary>
+    /// Tells which machine a frame of stats identified by name comes from, without decoding the stats,
+    /// so the frame can be authenticated before anything else (in the datagrams of <see cref="UdpStatsEndpoint"/>).
+    /// </summary>
+    /// <param name="data">The frame.</param>
+    /// <param name="size">The size of the frame.</param>
+    /// <param name="machine">Where to save the machine.</param>
+    /// <returns>Whether the frame carries stats by name, from a known machine.</returns>
+    bool PeekMachine(const uint8_t *data, size_t size, InternedName &machine)
+    {
+        std::wstring authKey;
+        return PeekCredentials(data, size, machine, authKey) && !machine.IsEmpty();
+    }
+
+
+    /// <summary>
+    /// Tells which machine a frame of stats identified by name comes from, and with which key for
+    /// authentication, without decoding the stats, so the frame can be authenticated before its
+    /// names get into the interner (in the requests of <see cref="BinaryHttpEndpoint"/>).
+    /// </summary>
+    /// <param name="data">The frame.</param>
+    /// <param name="size">The size of the frame.</param>
+    /// <param name="machine">Where to save the machine, which is empty when not known (never interned).</param>
+    /// <param name="authKey">Where to save the key for authentication of the machine.</param>
+    /// <returns>Whether the frame carries stats by name, with a well formed header.</returns>
+    bool PeekCredentials(const uint8_t *data, size_t size, InternedName &machine, std::wstring &authKey)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            BinaryReader reader(data, size);
+
+            FrameKind kind;
+            std::wstring name;
+
+            if (!ReadHeader(reader, kind)
+                || (kind != FrameKind::StatsByName && kind != FrameKind::BatchByName)
+                || !reader.ReadString(name)
+                || !reader.ReadString(authKey))
+            {
+                return false;
+            }
+
+            machine = InternedName::Find(name);
+            return true;
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when decoding machine in binary frame: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    // Decodes the stats of a sample, of any type, identified either by name or by ID
+    template <typename ValType, typename KeyType>
+    static bool DecodeStatsOfType(BinaryReader &reader,
+                                  size_t count,
+                                  const uint8_t *packedQualities,
+                                  size_t qualityOffset,
+                                  const std::vector<KeyType> &keys,
+                                  std::vector<StatSampleValue<ValType>> &samples)
+    {
+        samples.reserve(count);
+
+        for (size_t idx = 0; idx < count; ++idx)
+        {
+            uint32_t bits;
+            if (!reader.ReadUInt32(bits))
+                return false;
+
+            ValType value;
+            memcpy(&value, &bits, sizeof value);
+
+            auto position = qualityOffset + idx;
+            auto qualityBits = (packedQualities[position / qualitiesPerByte] >> (2 * (position % qualitiesPerByte))) & 0x3;
+
+            samples.emplace_back(keys[position], value, static_cast<Quality> (qualityBits * 4));
+        }
+
+        return true;
+    }
+
+
+    // Appends to a package the stats decoded from a sample of a batch
+    template <typename KeyType>
+    static void AddBatchStats(const std::vector<KeyType> &keys,
+                              const std::vector<uint8_t> &valueTypes,
+                              const std::vector<uint32_t> &valueBits,
+                              const std::vector<uint8_t> &qualityCodes,
+                              StatsPackage &package)
+    {
+        for (size_t idx = 0; idx < keys.size(); ++idx)
+        {
+            auto quality = static_cast<Quality> (qualityCodes[idx] * 4);
+
+            if (valueTypes[idx] == static_cast<uint8_t> (StatValueType::Float32))
+            {
+                float value;
+                memcpy(&value, &valueBits[idx], sizeof value);
+                package.statSamplesFloat32.emplace_back(keys[idx], value, quality);
+            }
+            else
+                package.statSamplesInt32.emplace_back(keys[idx], static_cast<int32_t> (valueBits[idx]), quality);
+        }
+    }
+
+
+    /* Decodes the rest of a frame carrying a batch, whose samples are decompressed one at a time,
+    becoming a package each. Upon failure, the packages appended so far are removed. */
+    static bool DecodeBatch(BinaryReader &reader,
+                            bool isById,
+                            InternedName machine,
+                            std::vector<StatsPackage> &packages)
+    {
+        uint64_t sampleCount;
+        size_t counterCount;
+
+        // every counter takes at least a byte of value type and a byte of name (or ID):
+        if (!reader.ReadVarint(sampleCount) || !reader.ReadCount(2, counterCount))
+            return false;
+
+        std::vector<uint8_t> valueTypes(counterCount);
+        std::vector<InternedName> names(isById ? 0 : counterCount);
+        std::vector<int16_t> statIds(isById ? counterCount : 0);
+        std::wstring name;
+        size_t floatCount(0);
+
+        for (size_t idx = 0; idx < counterCount; ++idx)
+        {
+            auto valueType = reader.Skip(1);
+            if (valueType == nullptr || *valueType > static_cast<uint8_t> (StatValueType::Int32))
+                return false;
+
+            valueTypes[idx] = *valueType;
+
+            if (*valueType == static_cast<uint8_t> (StatValueType::Float32))
+                ++floatCount;
+
+            if (isById)
+            {
+                if (!reader.ReadStatId(statIds[idx]))
+                    return false;
+            }
+            else if (!reader.ReadString(name) || !InternedName::TryIntern(name, names[idx]))
+                return false;
+        }
+
+        // every sample takes at least a bit of time, plus a bit of quality and a bit of value per counter:
+        auto streamSize = reader.GetRemaining();
+        if (sampleCount > streamSize * 8 / (1 + 2 * counterCount))
+            return false;
+
+        auto initialCount = packages.size();
+        packages.reserve(initialCount + static_cast<size_t> (sampleCount));
+
+        GorillaDecoder decompressor(reader.Skip(streamSize), streamSize, counterCount);
+        std::vector<uint32_t> valueBits(counterCount);
+        std::vector<uint8_t> qualityCodes(counterCount);
+
+        for (uint64_t row = 0; row < sampleCount; ++row)
+        {
+            auto package = StatsPackagePool::GetInstance().Acquire();
+            package.machine = machine;
+
+            if (!decompressor.Next(package.timeSinceEpochInMillisecs, valueBits.data(), qualityCodes.data()))
+            {
+                packages.erase(packages.begin() + initialCount, packages.end());
+                return false;
+            }
+
+            package.statSamplesFloat32.reserve(floatCount);
+            package.statSamplesInt32.reserve(counterCount - floatCount);
+
+            if (isById)
+                AddBatchStats(statIds, valueTypes, valueBits, qualityCodes, package);
+            else
+                AddBatchStats(names, valueTypes, valueBits, qualityCodes, package);
+
+            packages.push_back(std::move(package));
+        }
+
+        if (!decompressor.IsAtEnd())
+        {
+            packages.erase(packages.begin() + initialCount, packages.end());
+            return false;
+        }
+
+        return true;
+    }
+
+
+    /// <summary>
+    /// Decodes a frame of stats encoded by <see cref="BinaryStatsEncoder"/>, checking every field
+    /// against the bounds of the data, because it comes from the network. Each sample becomes a package.
+    /// When the stats are identified by ID, the packages have no machine, which is known by the session.
+    /// Otherwise, the machine must be already interned (as are those loaded by the authenticator), so
+    /// a frame from an unknown machine is rejected before any of its names gets into the interner.
+    /// The names of the stats are interned, hence the frame must be authenticated before decoding
+    /// (see <see cref="PeekCredentials"/>). When the table of names is full, the frame is refused.
+    /// </summary>
+    /// <param name="data">The frame.</param>
+    /// <param name="size">The size of the frame.</param>
+    /// <param name="authKey">Where to save the key for authentication of the machine
+    /// (empty when the stats are identified by ID).</param>
+    /// <param name="sessionId">Where to save the session (zero when the stats are identified by name).</param>
+    /// <param name="packages">Where to append the decoded packages.</param>
+    /// <returns>Whether the frame is well formed, comes from a known machine and
+    /// has all its names interned. Otherwise, nothing is appended to the packages.</returns>
+    bool DecodeStats(const uint8_t *data,
+                     size_t size,
+                     std::wstring &authKey,
+                     uint64_t &sessionId,
+                     std::vector<StatsPackage> &packages)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            BinaryReader reader(data, size);
+
+            FrameKind kind;
+            if (!ReadHeader(reader, kind)
+                || kind == FrameKind::OpenSession
+                || kind == FrameKind::SessionOpened)
+            {
+                return false;
+            }
+
+            std::wstring name;
+            InternedName machine;
+            authKey.clear();
+            sessionId = 0;
+
+            bool isById = (kind == FrameKind::StatsById || kind == FrameKind::BatchById);
+
+            if (isById)
+            {
+                if (!reader.ReadUInt64(sessionId) || sessionId == 0)
+                    return false;
+            }
+            else if (reader.ReadString(name) && reader.ReadString(authKey))
+            {
+                machine = InternedName::Find(name);
+                if (machine.IsEmpty())
+                    return false;
+            }
+            else
+                return false;
+
+            if (kind == FrameKind::BatchByName || kind == FrameKind::BatchById)
+                return DecodeBatch(reader, isById, machine, packages);
+
+            size_t sampleCount;
+            if (!reader.ReadCount(3, sampleCount)) // time and counts take a byte each at least
+                return false;
+
+            auto initialCount = packages.size();
+            packages.reserve(initialCount + sampleCount);
+
+            std::vector<InternedName> names;
+            std::vector<int16_t> statIds;
+            int64_t time(0);
+
+            for (size_t sampleIdx = 0; sampleIdx < sampleCount; ++sampleIdx)
+            {
+                int64_t timeDelta;
+                size_t floatCount, intCount;
+
+                // every stat takes at least a byte of name (or ID) and 4 bytes of value:
+                if (!reader.ReadSignedVarint(timeDelta)
+                    || !reader.ReadCount(5, floatCount)
+                    || !reader.ReadCount(5, intCount)
+                    || floatCount + intCount > reader.GetRemaining() / 5)
+                {
+                    packages.erase(packages.begin() + initialCount, packages.end());
+                    return false;
+                }
+
+                auto statCount = floatCount + intCount;
+                bool isValid(true);
+
+                if (isById)
+                {
+                    statIds.resize(statCount);
+                    for (size_t idx = 0; isValid && idx < statCount; ++idx)
+                        isValid = reader.ReadStatId(statIds[idx]);
+                }
+                else
+                {
+                    names.resize(statCount);
+                    for (size_t idx = 0; isValid && idx < statCount; ++idx)
+                        isValid = reader.ReadString(name) && InternedName::TryIntern(name, names[idx]);
+                }
+
+                auto packedQualities = isValid
+                    ? reader.Skip((statCount + qualitiesPerByte - 1) / qualitiesPerByte)
+                    : nullptr;
+
+                time += timeDelta;
+
+                auto package = StatsPackagePool::GetInstance().Acquire();
+                package.timeSinceEpochInMillisecs = time;
+                package.machine = machine;
+
+                if (packedQualities == nullptr)
+                    isValid = false;
+                else if (isById)
+                {
+                    isValid = DecodeStatsOfType(reader, floatCount, packedQualities, 0, statIds, package.statSamplesFloat32)
+                        && DecodeStatsOfType(reader, intCount, packedQualities, floatCount, statIds, package.statSamplesInt32);
+                }
+                else
+                {
+                    isValid = DecodeStatsOfType(reader, floatCount, packedQualities, 0, names, package.statSamplesFloat32)
+                        && DecodeStatsOfType(reader, intCount, packedQualities, floatCount, names, package.statSamplesInt32);
+                }
+
+                if (!isValid)
+                {
+                    packages.erase(packages.begin() + initialCount, packages.end());
+                    return false;
+                }
+
+                packages.push_back(std::move(package));
+            }
+
+            if (reader.GetRemaining() != 0)
+            {
+                packages.erase(packages.begin() + initialCount, packages.end());
+                return false;
+            }
+
+            return true;
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when decoding stats in binary: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    /// <summary>
+    /// Decodes a request to open a session, encoded by <see cref="BinaryStatsEncoder::EncodeOpenSession"/>.
+    /// </summary>
+    /// <param name="data">The frame.</param>
+    /// <param name="size">The size of the frame.</param>
+    /// <param name="machine">Where to save the machine.</param>
+    /// <param name="authKey">Where to save the key for authentication of the machine.</param>
+    /// <param name="statNames">Where to save the names of the stats the client might send.</param>
+    /// <returns>Whether the frame is well formed.</returns>
+    bool DecodeOpenSession(const uint8_t *data,
+                           size_t size,
+                           std::wstring &machine,
+                           std::wstring &authKey,
+                           std::vector<std::wstring> &statNames)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            BinaryReader reader(data, size);
+
+            FrameKind kind;
+            size_t nameCount;
+
+            if (!ReadHeader(reader, kind)
+                || kind != FrameKind::OpenSession
+                || !reader.ReadString(machine)
+                || !reader.ReadString(authKey)
+                || !reader.ReadCount(1, nameCount))
+            {
+                return false;
+            }
+
+            statNames.resize(nameCount);
+
+            for (auto &name : statNames)
+            {
+                if (!reader.ReadString(name) || name.empty())
+                    return false;
+            }
+
+            return reader.GetRemaining() == 0;
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when decoding request to open session: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    /// <summary>
+    /// Encodes the response of the server to a request to open a session.
+    /// </summary>
+    /// <param name="sessionId">The session, or zero when the request is rejected.</param>
+    /// <param name="statIds">The IDs assigned to the stat names, in the order of the request.</param>
+    /// <param name="frame">Where to save the encoded frame.</param>
+    void EncodeSessionOpened(uint64_t sessionId,
+                             const std::vector<int16_t> &statIds,
+                             std::vector<uint8_t> &frame)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            std::vector<uint8_t> body;
+            body.reserve(sizeof sessionId + 2 * statIds.size() + 4);
+
+            AppendUInt64(body, sessionId);
+            AppendVarint(body, statIds.size());
+
+            for (auto statId : statIds)
+                AppendVarint(body, static_cast<uint16_t> (statId));
+
+            MakeFrame(FrameKind::SessionOpened, body, frame);
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when encoding response to open session: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    /// <summary>
+    /// Decodes the response of the server to a request to open a session.
+    /// </summary>
+    /// <param name="data">The frame.</param>
+    /// <param name="size">The size of the frame.</param>
+    /// <param name="sessionId">Where to save the session (zero when the request was rejected).</param>
+    /// <param name="statIds">Where to save the IDs assigned to the stat names.</param>
+    /// <returns>Whether the frame is well formed.</returns>
+    bool DecodeSessionOpened(const uint8_t *data,
+                             size_t size,
+                             uint64_t &sessionId,
+                             std::vector<int16_t> &statIds)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            BinaryReader reader(data, size);
+
+            FrameKind kind;
+            size_t idCount;
+
+            if (!ReadHeader(reader, kind)
+                || kind != FrameKind::SessionOpened
+                || !reader.ReadUInt64(sessionId)
+                || !reader.ReadCount(1, idCount))
+            {
+                return false;
+            }
+
+            statIds.resize(idCount);
+
+            for (auto &statId : statIds)
+            {
+                if (!reader.ReadStatId(statId))
+                    return false;
+            }
+
+            return reader.GetRemaining() == 0;
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when decoding response to open session: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+}// end of namespace application
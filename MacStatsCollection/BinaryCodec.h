@@ -0,0 +1,154 @@
+#ifndef __BinaryCodec_h__ // header guard
+#define __BinaryCodec_h__
+
+#include "CommonDataExchange.h"
+#include <string>
+#include <vector>
+
+namespace application
+{
+    /// <summary>
+    /// What a binary frame carries.
+    /// </summary>
+    enum class FrameKind : uint8_t
+    {
+        StatsByName,   // stats identified by name, sent by a client without session
+        OpenSession,   // the stat names of a client, to which the server assigns IDs
+        SessionOpened, // the session and the IDs assigned by the server, in response
+        StatsById,     // stats identified by the IDs assigned in a session
+        BatchByName,   // samples of the same counters, compressed by GorillaEncoder, identified by name
+        BatchById      // samples of the same counters, compressed by GorillaEncoder, identified by ID
+    };
+
+    /// <summary>
+    /// The status in the response of the server to a frame of stats.
+    /// </summary>
+    enum class BinaryStatus : uint8_t
+    {
+        Rejected,      // the machine is not authentic, or the IDs are not from its session
+        Accepted,
+        UnknownSession, // the server no longer knows the session (perhaps it has restarted)
+        RetryLater      // the server is too busy to take the stats now
+    };
+
+
+    /// <summary>
+    /// Encodes the stats collected by the client into a compact binary frame, an alternative to the
+    /// SOAP request carrying the same content. The frame starts with the magic "MSCB", a version, the
+    /// kind of frame and the length of the body (as varint). Until a session is set, the body has the
+    /// machine and the key for authentication, followed by the samples: the time of each one is a varint
+    /// delta to the previous, then come the names of its stats, their qualities packed in 2 bits each,
+    /// and their values in little-endian. Once the server has assigned IDs to the stat names (upon the
+    /// frame made by <see cref="EncodeOpenSession"/>), the body has just the session, and the stats of
+    /// each sample are identified by ID (as varint) instead of name. A batch of samples of the same
+    /// counters (such as replayed from the spool) goes compressed by <see cref="GorillaEncoder"/>.
+    /// The buffers are kept from one call to another, so encoding does not allocate in steady state.
+    /// </summary>
+    /// <seealso cref="notcopiable" />
+    class BinaryStatsEncoder
+    {
+    private:
+
+        std::string m_machine; // in UTF-8
+        std::string m_authKey; // in UTF-8
+
+        std::vector<uint8_t> m_body;
+        std::vector<uint8_t> m_frame;
+
+        /// <summary>
+        /// Refers to a stat in a sample. The slot is the position of the stat in the list
+        /// of names sent to open the session, hence where to find its ID.
+        /// </summary>
+        struct StatRef
+        {
+            const std::wstring *name;
+            size_t slot;
+        };
+
+        // the stats of the sample being encoded, split by type:
+        std::vector<StatRef> m_floatStats;
+        std::vector<float> m_floatValues;
+        std::vector<Quality> m_floatQualities;
+        std::vector<StatRef> m_intStats;
+        std::vector<int32_t> m_intValues;
+        std::vector<Quality> m_intQualities;
+
+        // the sample of a batch being compressed:
+        std::vector<uint32_t> m_valueBits;
+        std::vector<uint8_t> m_qualityCodes;
+
+        std::vector<std::wstring> m_selfMetricNames;
+
+        uint64_t m_sessionId; // zero when there is no session
+        std::vector<int16_t> m_statIds; // indexed by slot
+        size_t m_slotCount; // in the last request to open a session
+
+        int64_t m_lastTime;
+        uint32_t m_sampleCount;
+
+        void AddSample(const std::vector<PerfCounterDescriptor> &catalog,
+                       const SamplesBatch &batch,
+                       size_t row,
+                       const SamplesAggregates *aggregates,
+                       const uint8_t *sendMask,
+                       const CollectedStats *selfMetricsSource);
+
+        void FlushSample(int64_t timeSinceEpochInMillisecs);
+
+        void BeginBody(size_t sampleCount);
+
+    public:
+
+        BinaryStatsEncoder(const std::wstring &machine, const std::wstring &authKey);
+
+        BinaryStatsEncoder(const BinaryStatsEncoder &) = delete;
+
+        const std::vector<uint8_t> &EncodeOpenSession(const std::vector<PerfCounterDescriptor> &catalog);
+
+        bool SetSession(uint64_t sessionId, std::vector<int16_t> &&statIds);
+
+        void ResetSession();
+
+        /// <summary>
+        /// Gets the session in use, or zero when the stats are identified by name.
+        /// </summary>
+        uint64_t GetSessionId() const { return m_sessionId; }
+
+        const std::vector<uint8_t> &Encode(const std::vector<PerfCounterDescriptor> &catalog,
+                                           const std::vector<const CollectedStats *> &items);
+
+        const std::vector<uint8_t> &Encode(const std::vector<PerfCounterDescriptor> &catalog,
+                                           const SamplesBatch &batch);
+    };
+
+
+    bool PeekFrameKind(const uint8_t *data, size_t size, FrameKind &kind);
+
+    bool PeekMachine(const uint8_t *data, size_t size, InternedName &machine);
+
+    bool PeekCredentials(const uint8_t *data, size_t size, InternedName &machine, std::wstring &authKey);
+
+    bool DecodeStats(const uint8_t *data,
+                     size_t size,
+                     std::wstring &authKey,
+                     uint64_t &sessionId,
+                     std::vector<StatsPackage> &packages);
+
+    bool DecodeOpenSession(const uint8_t *data,
+                           size_t size,
+                           std::wstring &machine,
+                           std::wstring &authKey,
+                           std::vector<std::wstring> &statNames);
+
+    void EncodeSessionOpened(uint64_t sessionId,
+                             const std::vector<int16_t> &statIds,
+                             std::vector<uint8_t> &frame);
+
+    bool DecodeSessionOpened(const uint8_t *data,
+                             size_t size,
+                             uint64_t &sessionId,
+                             std::vector<int16_t> &statIds);
+
+}// end of namespace application
+
+#endif // end of header guard
@@ -0,0 +1,634 @@
+#include "stdafx.h"
+#include "BinaryHttp.h"
+#include <3FD\callstacktracer.h>
+#include <3FD\exceptions.h>
+#include <3FD\logger.h>
+#include <cstring>
+#include <cwchar>
+#include <memory>
+#include <sstream>
+
+namespace application
+{
+    using namespace _3fd;
+    using namespace _3fd::core;
+
+
+    /// <summary>
+    /// Throws an exception for a failed call of the HTTP Server API or of WinHTTP.
+    /// </summary>
+    /// <param name="message">The main message.</param>
+    /// <param name="errorCode">The code of the error.</param>
+    /// <param name="funcName">Name of the API function.</param>
+    static void ThrowHttpError(const char *message, DWORD errorCode, const char *funcName)
+    {
+        static HMODULE winHttpLibHandle = GetModuleHandleW(L"winhttp.dll");
+
+        std::ostringstream oss;
+        oss << message << " - ";
+        WWAPI::AppendDWordErrorMessage(errorCode, funcName, oss, winHttpLibHandle);
+        throw AppException<std::runtime_error>(oss.str());
+    }
+
+
+    ///////////////////
+    // Server Side
+    ///////////////////
+
+    // A request whose body is larger than this (even if only once decompressed) is refused
+    static const size_t maxRequestBodySize(4 * 1024 * 1024);
+
+    // The content coding accepted for requests, besides none
+    static const char deflateCoding[] = "deflate";
+
+    // How much of the body is received at a time
+    static const ULONG bodyChunkSize(64 * 1024);
+
+    // A response whose body is larger than this is refused
+    static const size_t maxResponseBodySize(64 * 1024);
+
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="BinaryHttpEndpoint"/> class,
+    /// which starts receiving requests.
+    /// </summary>
+    /// <param name="url">The URL prefix to serve, such as "http://+:81/macstatscollection/binary/".</param>
+    /// <param name="authenticator">Authenticates the machine of the stats sent by name, before they are
+    /// decoded, called by the receiving thread.</param>
+    /// <param name="handler">The handler of the decoded stats, called by the receiving thread.</param>
+    /// <param name="sessionOpener">Opens the sessions requested by the clients, called by the receiving
+    /// thread. When not set, such requests are rejected, so the clients send the stats by name.</param>
+    BinaryHttpEndpoint::BinaryHttpEndpoint(const std::wstring &url,
+                                           const BinaryAuthenticator &authenticator,
+                                           const BinaryStatsHandler &handler,
+                                           const BinarySessionOpener &sessionOpener)
+        : m_url(url)
+        , m_requestQueue(nullptr)
+        , m_authenticator(authenticator)
+        , m_handler(handler)
+        , m_sessionOpener(sessionOpener)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            auto rc = HttpInitialize(HTTPAPI_VERSION_1, HTTP_INITIALIZE_SERVER, nullptr);
+            if (rc != NO_ERROR)
+                ThrowHttpError("Failed to initialize HTTP server", rc, "HttpInitialize");
+
+            rc = HttpCreateHttpHandle(&m_requestQueue, 0);
+            if (rc != NO_ERROR)
+            {
+                HttpTerminate(HTTP_INITIALIZE_SERVER, nullptr);
+                ThrowHttpError("Failed to create queue for HTTP requests", rc, "HttpCreateHttpHandle");
+            }
+
+            rc = HttpAddUrl(m_requestQueue, m_url.c_str(), nullptr);
+            if (rc != NO_ERROR)
+            {
+                CloseHandle(m_requestQueue);
+                HttpTerminate(HTTP_INITIALIZE_SERVER, nullptr);
+                ThrowHttpError("Failed to register URL for binary endpoint", rc, "HttpAddUrl");
+            }
+
+            m_receivingThread = std::thread(&BinaryHttpEndpoint::ReceiveLoop, this);
+        }
+        catch (IAppException &)
+        {
+            throw; // just forward exceptions regarding errors known to have been previously handled
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when starting binary endpoint: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    /// <summary>
+    /// Finalizes an instance of the <see cref="BinaryHttpEndpoint"/> class.
+    /// </summary>
+    BinaryHttpEndpoint::~BinaryHttpEndpoint()
+    {
+        Close();
+    }
+
+
+    /// <summary>
+    /// Stops receiving requests. Closing the queue aborts the pending
+    /// receive call, so the receiving thread comes to an end.
+    /// </summary>
+    void BinaryHttpEndpoint::Close()
+    {
+        if (!m_receivingThread.joinable())
+            return;
+
+        HttpRemoveUrl(m_requestQueue, m_url.c_str());
+        CloseHandle(m_requestQueue);
+        m_receivingThread.join();
+        HttpTerminate(HTTP_INITIALIZE_SERVER, nullptr);
+    }
+
+
+    // Sends a response, with the given body (if any)
+    static void SendResponse(HANDLE requestQueue,
+                             HTTP_REQUEST_ID requestId,
+                             USHORT statusCode,
+                             const char *reason,
+                             const uint8_t *content,
+                             ULONG contentSize = 1)
+    {
+        HTTP_RESPONSE response;
+        memset(&response, 0, sizeof response);
+        response.StatusCode = statusCode;
+        response.pReason = reason;
+        response.ReasonLength = static_cast<USHORT> (strlen(reason));
+
+        static const char contentType[] = "application/octet-stream";
+        static const char acceptEncoding[] = "Accept-Encoding";
+
+        // tells the client it can compress the requests (as in RFC 7694):
+        HTTP_UNKNOWN_HEADER acceptEncodingHeader;
+        acceptEncodingHeader.pName = acceptEncoding;
+        acceptEncodingHeader.NameLength = sizeof acceptEncoding - 1;
+        acceptEncodingHeader.pRawValue = deflateCoding;
+        acceptEncodingHeader.RawValueLength = sizeof deflateCoding - 1;
+        response.Headers.UnknownHeaderCount = 1;
+        response.Headers.pUnknownHeaders = &acceptEncodingHeader;
+
+        HTTP_DATA_CHUNK chunk;
+
+        if (content != nullptr)
+        {
+            auto &header = response.Headers.KnownHeaders[HttpHeaderContentType];
+            header.pRawValue = contentType;
+            header.RawValueLength = sizeof contentType - 1;
+
+            chunk.DataChunkType = HttpDataChunkFromMemory;
+            chunk.FromMemory.pBuffer = const_cast<uint8_t *> (content);
+            chunk.FromMemory.BufferLength = contentSize;
+            response.EntityChunkCount = 1;
+            response.pEntityChunks = &chunk;
+        }
+
+        ULONG sentCount;
+        auto rc = HttpSendHttpResponse(requestQueue, requestId, 0, &response,
+                                       nullptr, &sentCount, nullptr, 0, nullptr, nullptr);
+
+        if (rc != NO_ERROR && rc != ERROR_CONNECTION_INVALID)
+        {
+            std::ostringstream oss;
+            oss << "Failed to respond request to binary endpoint - ";
+            WWAPI::AppendDWordErrorMessage(rc, "HttpSendHttpResponse", oss);
+            Logger::Write(oss.str(), Logger::PRIO_ERROR);
+        }
+    }
+
+
+    // Runs in the receiving thread, until the queue is closed
+    void BinaryHttpEndpoint::ReceiveLoop()
+    {
+        CALL_STACK_TRACE;
+
+        // reused by every request:
+        std::vector<uint8_t> requestBuffer(sizeof(HTTP_REQUEST) + 4096);
+        std::vector<uint8_t> chunk(bodyChunkSize);
+        std::vector<uint8_t> body;
+        std::vector<StatsPackage> packages;
+
+        HTTP_REQUEST_ID requestId;
+        HTTP_SET_NULL_ID(&requestId);
+
+        while (true)
+        {
+            auto request = reinterpret_cast<HTTP_REQUEST *> (requestBuffer.data());
+            ULONG receivedCount;
+
+            auto rc = HttpReceiveHttpRequest(m_requestQueue, requestId, 0, request,
+                                             static_cast<ULONG> (requestBuffer.size()),
+                                             &receivedCount, nullptr);
+            switch (rc)
+            {
+            case NO_ERROR:
+                break;
+
+            case ERROR_MORE_DATA: // the headers do not fit: receive the same request again
+                requestId = request->RequestId;
+                requestBuffer.resize(receivedCount);
+                continue;
+
+            case ERROR_CONNECTION_INVALID: // the client is gone
+                HTTP_SET_NULL_ID(&requestId);
+                continue;
+
+            case ERROR_OPERATION_ABORTED:
+            case ERROR_INVALID_HANDLE:
+                return; // closed
+
+            default:
+            {
+                std::ostringstream oss;
+                oss << "Failed to receive request to binary endpoint - ";
+                WWAPI::AppendDWordErrorMessage(rc, "HttpReceiveHttpRequest", oss);
+                Logger::Write(oss.str(), Logger::PRIO_CRITICAL);
+                return;
+            }
+            }
+
+            try
+            {
+                HandleRequest(*request, chunk, body, packages);
+            }
+            catch (IAppException &ex)
+            {
+                Logger::Write(ex, Logger::PRIO_CRITICAL);
+                SendResponse(m_requestQueue, request->RequestId, 500, "Internal Server Error", nullptr);
+            }
+            catch (std::exception &ex)
+            {
+                std::ostringstream oss;
+                oss << "Generic failure when processing request to binary endpoint: " << ex.what();
+                Logger::Write(oss.str(), Logger::PRIO_CRITICAL);
+                SendResponse(m_requestQueue, request->RequestId, 500, "Internal Server Error", nullptr);
+            }
+
+            HTTP_SET_NULL_ID(&requestId);
+        }
+    }
+
+
+    /* Receives the body of a request. When compressed, each chunk is decompressed as soon as
+    received, so the compressed body is never kept whole. Responds with an error and returns
+    false when the body is too large, compressed in an unknown format or corrupted. */
+    bool BinaryHttpEndpoint::ReceiveBody(const HTTP_REQUEST &request,
+                                         std::vector<uint8_t> &chunk,
+                                         std::vector<uint8_t> &body)
+    {
+        auto &encoding = request.Headers.KnownHeaders[HttpHeaderContentEncoding];
+        bool isDeflated(encoding.RawValueLength != 0);
+
+        if (isDeflated)
+        {
+            if (encoding.RawValueLength != sizeof deflateCoding - 1
+                || _strnicmp(encoding.pRawValue, deflateCoding, encoding.RawValueLength) != 0)
+            {
+                SendResponse(m_requestQueue, request.RequestId, 415, "Unsupported Media Type", nullptr);
+                return false;
+            }
+
+            m_inflater.Reset();
+        }
+
+        body.clear();
+
+        if ((request.Flags & HTTP_REQUEST_FLAG_MORE_ENTITY_BODY_EXISTS) == 0)
+            return true;
+
+        ULONG rc;
+        size_t receivedSize(0);
+        bool isValid(true);
+
+        do
+        {
+            auto offset = body.size();
+            uint8_t *destination;
+
+            if (isDeflated)
+                destination = chunk.data();
+            else
+            {
+                body.resize(offset + bodyChunkSize);
+                destination = body.data() + offset;
+            }
+
+            ULONG receivedCount(0);
+            rc = HttpReceiveRequestEntityBody(m_requestQueue, request.RequestId, 0,
+                                              destination, bodyChunkSize,
+                                              &receivedCount, nullptr);
+            receivedSize += receivedCount;
+
+            if (isDeflated)
+                isValid = m_inflater.Inflate(chunk.data(), receivedCount, body, maxRequestBodySize + 1);
+            else
+                body.resize(offset + receivedCount);
+
+        } while (rc == NO_ERROR && isValid && receivedSize <= maxRequestBodySize && body.size() <= maxRequestBodySize);
+
+        if (receivedSize > maxRequestBodySize || body.size() > maxRequestBodySize)
+        {
+            SendResponse(m_requestQueue, request.RequestId, 413, "Payload Too Large", nullptr);
+            return false;
+        }
+
+        if (!isValid || (isDeflated && rc == ERROR_HANDLE_EOF && !m_inflater.IsComplete()))
+        {
+            SendResponse(m_requestQueue, request.RequestId, 400, "Bad Request", nullptr);
+            return false;
+        }
+
+        if (rc != ERROR_HANDLE_EOF)
+            ThrowHttpError("Failed to receive body of request to binary endpoint", rc, "HttpReceiveRequestEntityBody");
+
+        return true;
+    }
+
+
+    /* Receives the body of a request, decodes it and hands the stats to the handler (or to the session opener).
+    The stats by name are authenticated first, because decoding them interns their names. When the table of
+    names is full, they are rejected. */
+    void BinaryHttpEndpoint::HandleRequest(const HTTP_REQUEST &request,
+                                           std::vector<uint8_t> &chunk,
+                                           std::vector<uint8_t> &body,
+                                           std::vector<StatsPackage> &packages)
+    {
+        if (request.Verb != HttpVerbPOST)
+        {
+            SendResponse(m_requestQueue, request.RequestId, 405, "Method Not Allowed", nullptr);
+            return;
+        }
+
+        if (!ReceiveBody(request, chunk, body))
+            return;
+
+        FrameKind kind;
+        if (PeekFrameKind(body.data(), body.size(), kind) && kind == FrameKind::OpenSession)
+        {
+            HandleOpenSession(request, body);
+            return;
+        }
+
+        std::wstring authKey;
+        uint64_t sessionId;
+        packages.clear();
+
+        InternedName machine;
+        bool isByName = PeekCredentials(body.data(), body.size(), machine, authKey);
+
+        /* The authenticator interns the machines of all credentials, so a machine never interned is not
+        registered, and is rejected like a wrong key (rather than a bad request, which the client retries): */
+        if (isByName && (machine.IsEmpty() || !m_authenticator(machine, authKey)))
+        {
+            auto status = static_cast<uint8_t> (BinaryStatus::Rejected);
+            SendResponse(m_requestQueue, request.RequestId, 200, "OK", &status);
+            return;
+        }
+
+        if (!DecodeStats(body.data(), body.size(), authKey, sessionId, packages))
+        {
+            if (isByName && NameInterner::GetInstance().IsFull())
+            {
+                Logger::Write("Binary endpoint rejected stats by name, because the table of names is full",
+                              Logger::PRIO_WARNING);
+
+                auto status = static_cast<uint8_t> (BinaryStatus::Rejected);
+                SendResponse(m_requestQueue, request.RequestId, 200, "OK", &status);
+            }
+            else
+                SendResponse(m_requestQueue, request.RequestId, 400, "Bad Request", nullptr);
+
+            return;
+        }
+
+        auto status = static_cast<uint8_t> (m_handler(authKey, sessionId, packages));
+        SendResponse(m_requestQueue, request.RequestId, 200, "OK", &status);
+    }
+
+
+    // Opens a session for the client, responding with the IDs assigned to its stat names
+    void BinaryHttpEndpoint::HandleOpenSession(const HTTP_REQUEST &request, const std::vector<uint8_t> &body)
+    {
+        std::wstring machine, authKey;
+        std::vector<std::wstring> statNames;
+
+        if (!DecodeOpenSession(body.data(), body.size(), machine, authKey, statNames))
+        {
+            SendResponse(m_requestQueue, request.RequestId, 400, "Bad Request", nullptr);
+            return;
+        }
+
+        uint64_t sessionId(0);
+        std::vector<int16_t> statIds;
+
+        if (m_sessionOpener)
+            sessionId = m_sessionOpener(machine, authKey, statNames, statIds);
+
+        if (sessionId == 0 || statIds.size() != statNames.size())
+        {
+            sessionId = 0; // rejected
+            statIds.clear();
+        }
+
+        std::vector<uint8_t> response;
+        EncodeSessionOpened(sessionId, statIds, response);
+
+        SendResponse(m_requestQueue, request.RequestId, 200, "OK",
+                     response.data(), static_cast<ULONG> (response.size()));
+    }
+
+
+    ///////////////////
+    // Client Side
+    ///////////////////
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="BinaryHttpClient"/> class.
+    /// </summary>
+    /// <param name="url">The URL of the binary endpoint.</param>
+    /// <param name="deflateMinSize">
+    /// The size from which the frames are compressed (if the server accepts it), or zero to never compress.
+    /// </param>
+    BinaryHttpClient::BinaryHttpClient(const std::wstring &url, size_t deflateMinSize)
+        : m_session(nullptr)
+        , m_connection(nullptr)
+        , m_isSecure(false)
+        , m_deflateMinSize(deflateMinSize)
+        , m_canDeflate(false)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            URL_COMPONENTS components;
+            memset(&components, 0, sizeof components);
+            components.dwStructSize = sizeof components;
+            components.dwHostNameLength = static_cast<DWORD> (-1);
+            components.dwUrlPathLength = static_cast<DWORD> (-1);
+
+            if (WinHttpCrackUrl(url.c_str(), static_cast<DWORD> (url.length()), 0, &components) == FALSE)
+                ThrowHttpError("Failed to parse URL of binary endpoint", GetLastError(), "WinHttpCrackUrl");
+
+            std::wstring host(components.lpszHostName, components.dwHostNameLength);
+            m_path.assign(components.lpszUrlPath, components.dwUrlPathLength);
+            m_isSecure = (components.nScheme == INTERNET_SCHEME_HTTPS);
+
+            m_session = WinHttpOpen(L"MSCClient",
+                                    WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
+                                    WINHTTP_NO_PROXY_NAME,
+                                    WINHTTP_NO_PROXY_BYPASS,
+                                    0);
+
+            if (m_session == nullptr)
+                ThrowHttpError("Failed to open HTTP session", GetLastError(), "WinHttpOpen");
+
+            m_connection = WinHttpConnect(m_session, host.c_str(), components.nPort, 0);
+
+            if (m_connection == nullptr)
+            {
+                auto errorCode = GetLastError();
+                WinHttpCloseHandle(m_session);
+                ThrowHttpError("Failed to connect to binary endpoint", errorCode, "WinHttpConnect");
+            }
+        }
+        catch (IAppException &)
+        {
+            throw; // just forward exceptions regarding errors known to have been previously handled
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when creating client for binary endpoint: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    /// <summary>
+    /// Finalizes an instance of the <see cref="BinaryHttpClient"/> class.
+    /// </summary>
+    BinaryHttpClient::~BinaryHttpClient()
+    {
+        WinHttpCloseHandle(m_connection);
+        WinHttpCloseHandle(m_session);
+    }
+
+
+    /// <summary>
+    /// Posts a frame encoded by <see cref="BinaryStatsEncoder"/>, waiting for the response.
+    /// </summary>
+    /// <param name="frame">The frame to post.</param>
+    /// <param name="response">Where to save the body of the response.</param>
+    void BinaryHttpClient::Exchange(const std::vector<uint8_t> &frame, std::vector<uint8_t> &response)
+    {
+        CALL_STACK_TRACE;
+
+        auto request = WinHttpOpenRequest(m_connection,
+                                          L"POST",
+                                          m_path.c_str(),
+                                          nullptr,
+                                          WINHTTP_NO_REFERER,
+                                          WINHTTP_DEFAULT_ACCEPT_TYPES,
+                                          m_isSecure ? WINHTTP_FLAG_SECURE : 0);
+
+        if (request == nullptr)
+            ThrowHttpError("Failed to create request to binary endpoint", GetLastError(), "WinHttpOpenRequest");
+
+        std::unique_ptr<void, decltype(&WinHttpCloseHandle)> requestGuard(request, &WinHttpCloseHandle);
+
+        const wchar_t *headers = L"Content-Type: application/octet-stream";
+        auto body = frame.data();
+        auto frameSize = static_cast<DWORD> (frame.size());
+
+        // compress only when worth it, and only if the server has told it can take it:
+        if (m_canDeflate && m_deflateMinSize != 0 && frame.size() >= m_deflateMinSize)
+        {
+            m_deflater.Compress(frame.data(), frame.size(), m_deflatedFrame);
+
+            if (m_deflatedFrame.size() < frame.size())
+            {
+                headers = L"Content-Type: application/octet-stream\r\nContent-Encoding: deflate";
+                body = m_deflatedFrame.data();
+                frameSize = static_cast<DWORD> (m_deflatedFrame.size());
+            }
+        }
+
+        if (WinHttpSendRequest(request,
+                               headers,
+                               static_cast<DWORD> (-1),
+                               const_cast<uint8_t *> (body),
+                               frameSize,
+                               frameSize,
+                               0) == FALSE)
+        {
+            ThrowHttpError("Failed to send request to binary endpoint", GetLastError(), "WinHttpSendRequest");
+        }
+
+        if (WinHttpReceiveResponse(request, nullptr) == FALSE)
+            ThrowHttpError("Failed to receive response of binary endpoint", GetLastError(), "WinHttpReceiveResponse");
+
+        // learn whether the server accepts compressed requests:
+        if (m_deflateMinSize != 0)
+        {
+            wchar_t acceptEncoding[64];
+            DWORD acceptEncodingSize(sizeof acceptEncoding);
+
+            m_canDeflate = (WinHttpQueryHeaders(request,
+                                                WINHTTP_QUERY_CUSTOM,
+                                                L"Accept-Encoding",
+                                                acceptEncoding,
+                                                &acceptEncodingSize,
+                                                WINHTTP_NO_HEADER_INDEX) != FALSE
+                            && wcsstr(acceptEncoding, L"deflate") != nullptr);
+        }
+
+        DWORD statusCode(0);
+        DWORD statusCodeSize(sizeof statusCode);
+
+        if (WinHttpQueryHeaders(request,
+                                WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER,
+                                WINHTTP_HEADER_NAME_BY_INDEX,
+                                &statusCode,
+                                &statusCodeSize,
+                                WINHTTP_NO_HEADER_INDEX) == FALSE)
+        {
+            ThrowHttpError("Failed to get status of response of binary endpoint", GetLastError(), "WinHttpQueryHeaders");
+        }
+
+        if (statusCode != 200)
+        {
+            std::ostringstream oss;
+            oss << "Binary endpoint responded with HTTP status " << statusCode;
+            throw AppException<std::runtime_error>(oss.str());
+        }
+
+        response.clear();
+
+        DWORD readCount;
+
+        do
+        {
+            auto offset = response.size();
+            response.resize(offset + 1024);
+
+            readCount = 0;
+            if (WinHttpReadData(request, response.data() + offset, 1024, &readCount) == FALSE)
+                ThrowHttpError("Failed to read response of binary endpoint", GetLastError(), "WinHttpReadData");
+
+            response.resize(offset + readCount);
+
+        } while (readCount > 0 && response.size() <= maxResponseBodySize);
+
+        if (response.size() > maxResponseBodySize)
+            throw AppException<std::runtime_error>("Response of binary endpoint is too large");
+    }
+
+
+    /// <summary>
+    /// Posts a frame of encoded stats, waiting for the response.
+    /// </summary>
+    /// <param name="frame">The frame encoded by <see cref="BinaryStatsEncoder::Encode"/>.</param>
+    /// <returns>The status in the response.</returns>
+    BinaryStatus BinaryHttpClient::Post(const std::vector<uint8_t> &frame)
+    {
+        CALL_STACK_TRACE;
+
+        std::vector<uint8_t> response;
+        Exchange(frame, response);
+
+        if (response.size() != 1 || response[0] > static_cast<uint8_t> (BinaryStatus::RetryLater))
+            throw AppException<std::runtime_error>("Binary endpoint responded with unknown status");
+
+        return static_cast<BinaryStatus> (response[0]);
+    }
+
+}// end of namespace application
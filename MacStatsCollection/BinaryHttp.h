@@ -0,0 +1,161 @@
+#ifndef __BinaryHttp_h__ // header guard
+#define __BinaryHttp_h__
+
+#include "BinaryCodec.h"
+#include "DeflateCodec.h"
+#include <Windows.h>
+#include <http.h>
+#include <winhttp.h>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace application
+{
+    /// <summary>
+    /// Authenticates a machine, before the stats it sent by name to <see cref="BinaryHttpEndpoint"/>
+    /// are decoded (so the names of a forged request never get into the interner).
+    /// </summary>
+    typedef std::function<bool (InternedName machine, const std::wstring &authKey)> BinaryAuthenticator;
+
+    /// <summary>
+    /// Handles the stats decoded from a request received by <see cref="BinaryHttpEndpoint"/>,
+    /// which come either with the key for authentication of the machine (identified by name,
+    /// already authentic), or with the session (identified by ID). Returns the status for the response.
+    /// </summary>
+    typedef std::function<BinaryStatus (const std::wstring &authKey,
+                                        uint64_t sessionId,
+                                        std::vector<StatsPackage> &packages)> BinaryStatsHandler;
+
+    /// <summary>
+    /// Opens a session for a client, assigning IDs to the names of the stats it might send.
+    /// Returns the session, or zero when the request is rejected.
+    /// </summary>
+    typedef std::function<uint64_t (const std::wstring &machine,
+                                    const std::wstring &authKey,
+                                    const std::vector<std::wstring> &statNames,
+                                    std::vector<int16_t> &statIds)> BinarySessionOpener;
+
+
+    ///////////////////
+    // Server Side
+    ///////////////////
+
+    /// <summary>
+    /// Serves a plain HTTP endpoint (next to the SOAP one) for requests that POST the stats
+    /// encoded by <see cref="BinaryStatsEncoder"/>, relying on the HTTP Server API (http.sys).
+    /// A dedicated thread receives the requests, authenticates those carrying stats by name,
+    /// decodes them and calls the handler, then responds with a single byte carrying the
+    /// <see cref="BinaryStatus"/>. Requests to open
+    /// a session go to the session opener instead, whose IDs are sent back in the response.
+    /// Every response tells the client that requests compressed with deflate are accepted,
+    /// and such requests are decompressed as their body is received.
+    /// </summary>
+    /// <seealso cref="notcopiable" />
+    class BinaryHttpEndpoint
+    {
+    private:
+
+        std::wstring m_url;
+        HANDLE m_requestQueue;
+        BinaryAuthenticator m_authenticator;
+        BinaryStatsHandler m_handler;
+        BinarySessionOpener m_sessionOpener;
+        FrameInflater m_inflater; // used by the receiving thread only
+        std::thread m_receivingThread;
+
+        void ReceiveLoop();
+
+        bool ReceiveBody(const HTTP_REQUEST &request, std::vector<uint8_t> &chunk, std::vector<uint8_t> &body);
+
+        void HandleRequest(const HTTP_REQUEST &request,
+                           std::vector<uint8_t> &chunk,
+                           std::vector<uint8_t> &body,
+                           std::vector<StatsPackage> &packages);
+
+        void HandleOpenSession(const HTTP_REQUEST &request, const std::vector<uint8_t> &body);
+
+    public:
+
+        BinaryHttpEndpoint(const std::wstring &url,
+                           const BinaryAuthenticator &authenticator,
+                           const BinaryStatsHandler &handler,
+                           const BinarySessionOpener &sessionOpener = BinarySessionOpener());
+
+        BinaryHttpEndpoint(const BinaryHttpEndpoint &) = delete;
+
+        ~BinaryHttpEndpoint();
+
+        void Close();
+    };
+
+
+    ///////////////////
+    // Client Side
+    ///////////////////
+
+    /// <summary>
+    /// Interface for the clients that take the frames encoded by
+    /// <see cref="BinaryStatsEncoder"/> to the server, whatever the transport.
+    /// </summary>
+    class IBinaryStatsClient
+    {
+    public:
+
+        virtual ~IBinaryStatsClient() {}
+
+        /// <summary>
+        /// Sends a frame and waits for the frame in response.
+        /// </summary>
+        /// <param name="frame">The frame to send.</param>
+        /// <param name="response">Where to save the frame in response.</param>
+        virtual void Exchange(const std::vector<uint8_t> &frame, std::vector<uint8_t> &response) = 0;
+
+        /// <summary>
+        /// Sends a frame of encoded stats.
+        /// </summary>
+        /// <param name="frame">The frame encoded by <see cref="BinaryStatsEncoder::Encode"/>.</param>
+        /// <returns>The status reported by the server.</returns>
+        virtual BinaryStatus Post(const std::vector<uint8_t> &frame) = 0;
+    };
+
+
+    /// <summary>
+    /// Posts the stats encoded by <see cref="BinaryStatsEncoder"/> to the
+    /// endpoint served by <see cref="BinaryHttpEndpoint"/>, using WinHTTP.
+    /// Once the server has told it accepts requests compressed with deflate,
+    /// the frames from a given size on are compressed.
+    /// </summary>
+    /// <seealso cref="IBinaryStatsClient" />
+    /// <seealso cref="notcopiable" />
+    class BinaryHttpClient : public IBinaryStatsClient
+    {
+    private:
+
+        HINTERNET m_session;
+        HINTERNET m_connection;
+        std::wstring m_path;
+        bool m_isSecure;
+
+        size_t m_deflateMinSize; // zero when never compressing
+        bool m_canDeflate; // whether the server accepts compressed requests
+        FrameDeflater m_deflater;
+        std::vector<uint8_t> m_deflatedFrame;
+
+    public:
+
+        BinaryHttpClient(const std::wstring &url, size_t deflateMinSize = 0);
+
+        BinaryHttpClient(const BinaryHttpClient &) = delete;
+
+        virtual ~BinaryHttpClient();
+
+        virtual void Exchange(const std::vector<uint8_t> &frame, std::vector<uint8_t> &response) override;
+
+        virtual BinaryStatus Post(const std::vector<uint8_t> &frame) override;
+    };
+
+}// end of namespace application
+
+#endif // end of header guard
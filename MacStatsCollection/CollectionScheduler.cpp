@@ -0,0 +1,105 @@
+#include "stdafx.h"
+#include "CollectionScheduler.h"
+#include <cassert>
+#include <cwctype>
+#include <thread>
+
+namespace application
+{
+    using namespace std::chrono;
+
+
+    /// <summary>
+    /// Calculates the phase offset of the collection cycle for a machine. It is deterministic
+    /// (FNV-1a hash of the name, regardless of case), so a machine keeps its phase across
+    /// restarts, while the phases of many machines are spread evenly across the cycle.
+    /// </summary>
+    /// <param name="machine">The name of the machine.</param>
+    /// <param name="cycleTime">The duration of the collection cycle.</param>
+    /// <returns>The offset, from zero up to the duration of the cycle (exclusive).</returns>
+    milliseconds CollectionScheduler::CalculatePhase(const std::wstring &machine, milliseconds cycleTime)
+    {
+        assert(cycleTime.count() > 0);
+
+        uint64_t hash(14695981039346656037ULL);
+
+        for (auto ch : machine)
+        {
+            hash ^= static_cast<uint64_t> (towlower(ch));
+            hash *= 1099511628211ULL;
+        }
+
+        return milliseconds(static_cast<milliseconds::rep> (hash % static_cast<uint64_t> (cycleTime.count())));
+    }
+
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="CollectionScheduler"/> class.
+    /// </summary>
+    /// <param name="cycleTime">The duration of the collection cycle.</param>
+    /// <param name="phase">The phase offset of the deadlines within the cycle.</param>
+    /// <param name="systemNow">The current time in the system clock, to which the deadlines are aligned.</param>
+    /// <param name="steadyNow">The same time in the steady clock, where the deadlines are set.</param>
+    CollectionScheduler::CollectionScheduler(milliseconds cycleTime,
+                                             milliseconds phase,
+                                             system_clock::time_point systemNow,
+                                             steady_clock::time_point steadyNow)
+        : m_cycleTime(cycleTime)
+        , m_phase(phase)
+        , m_skippedCount(0)
+    {
+        assert(cycleTime.count() > 0 && phase < cycleTime);
+
+        // the first deadline is the next time the wall clock is at the phase within a cycle:
+        auto intoCycle = duration_cast<milliseconds>(systemNow.time_since_epoch()) % cycleTime;
+        auto untilFirst = (phase - intoCycle + cycleTime) % cycleTime;
+        m_nextDeadline = steadyNow + untilFirst;
+    }
+
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="CollectionScheduler"/> class.
+    /// </summary>
+    /// <param name="cycleTime">The duration of the collection cycle.</param>
+    /// <param name="machine">The name of the machine, from which the phase offset is derived.</param>
+    CollectionScheduler::CollectionScheduler(milliseconds cycleTime, const std::wstring &machine)
+        : CollectionScheduler(cycleTime,
+                              CalculatePhase(machine, cycleTime),
+                              system_clock::now(),
+                              steady_clock::now())
+    {
+    }
+
+
+    /// <summary>
+    /// Moves on to the next deadline after the given time. When a cycle has overrun,
+    /// the deadlines already gone are skipped instead of fired in a row, so the phase
+    /// is kept and the server is not flooded.
+    /// </summary>
+    /// <param name="now">The current time in the steady clock.</param>
+    /// <returns>The next deadline.</returns>
+    steady_clock::time_point CollectionScheduler::Advance(steady_clock::time_point now)
+    {
+        m_nextDeadline += m_cycleTime;
+
+        if (m_nextDeadline <= now)
+        {
+            auto missed = (now - m_nextDeadline) / m_cycleTime + 1;
+            m_nextDeadline += missed * m_cycleTime;
+            m_skippedCount += missed;
+        }
+
+        return m_nextDeadline;
+    }
+
+
+    /// <summary>
+    /// Sleeps until the next deadline, then moves on to the following one.
+    /// </summary>
+    void CollectionScheduler::WaitForNextDeadline()
+    {
+        std::this_thread::sleep_until(m_nextDeadline);
+        Advance(steady_clock::now());
+    }
+
+}// end of namespace application
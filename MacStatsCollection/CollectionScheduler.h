@@ -0,0 +1,54 @@
+#ifndef __CollectionScheduler_h__ // header guard
+#define __CollectionScheduler_h__
+
+#include <cinttypes>
+#include <string>
+#include <chrono>
+
+namespace application
+{
+    /// <summary>
+    /// Schedules the collection cycles of the client at absolute deadlines in steady clock, so
+    /// they do not drift with the time spent in each cycle, nor with adjustments of the system
+    /// clock. The deadlines are aligned to the wall clock with a phase offset that is derived
+    /// from the name of the machine, so the requests of a fleet spread evenly across the cycle,
+    /// even when all clients are started at once.
+    /// </summary>
+    class CollectionScheduler
+    {
+    private:
+
+        std::chrono::steady_clock::duration m_cycleTime;
+        std::chrono::steady_clock::duration m_phase;
+        std::chrono::steady_clock::time_point m_nextDeadline;
+        uint64_t m_skippedCount;
+
+    public:
+
+        static std::chrono::milliseconds CalculatePhase(const std::wstring &machine,
+                                                        std::chrono::milliseconds cycleTime);
+
+        CollectionScheduler(std::chrono::milliseconds cycleTime,
+                            std::chrono::milliseconds phase,
+                            std::chrono::system_clock::time_point systemNow,
+                            std::chrono::steady_clock::time_point steadyNow);
+
+        CollectionScheduler(std::chrono::milliseconds cycleTime, const std::wstring &machine);
+
+        std::chrono::steady_clock::time_point GetNextDeadline() const { return m_nextDeadline; }
+
+        std::chrono::steady_clock::duration GetPhase() const { return m_phase; }
+
+        /// <summary>
+        /// Gets how many deadlines have been skipped because a cycle overran.
+        /// </summary>
+        uint64_t GetSkippedCount() const { return m_skippedCount; }
+
+        std::chrono::steady_clock::time_point Advance(std::chrono::steady_clock::time_point now);
+
+        void WaitForNextDeadline();
+    };
+
+}// end of namespace application
+
+#endif // end of header guard
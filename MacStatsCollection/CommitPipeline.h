@@ -0,0 +1,153 @@
+#ifndef __CommitPipeline_h__ // header guard
+#define __CommitPipeline_h__
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace application
+{
+    /// <summary>
+    /// Commits batches in a thread of its own, over two sets of buffers: while one set is committed,
+    /// the caller fills the other with the next batch, which might come in a later call, so the CPU
+    /// work of filling the buffers overlaps with the wait for the storage. A set is handed over only
+    /// once the previous commit has finished, hence the commits go one at a time and in order.
+    /// </summary>
+    /// <seealso cref="notcopiable" />
+    template <typename BuffersType>
+    class CommitPipeline
+    {
+    private:
+
+        BuffersType m_buffers[2];
+        size_t m_next; // the set the caller fills next
+
+        std::function<void (BuffersType &)> m_commit;
+
+        std::mutex m_mutex;
+        std::condition_variable m_commitAvailable;
+        std::condition_variable m_commitDone;
+        BuffersType *m_handedOver; // the set to commit (or being committed), null when idle
+        std::exception_ptr m_error; // of the last commit, until taken
+        bool m_isClosing;
+
+        std::thread m_thread;
+
+        // Runs in the commit thread, until the pipeline is destroyed
+        void CommitLoop()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            while (true)
+            {
+                m_commitAvailable.wait(lock, [this]() { return m_handedOver != nullptr || m_isClosing; });
+
+                auto buffers = m_handedOver;
+                if (buffers == nullptr)
+                    return;
+
+                lock.unlock();
+
+                std::exception_ptr error;
+
+                try
+                {
+                    m_commit(*buffers);
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+
+                lock.lock();
+
+                m_error = error;
+                m_handedOver = nullptr;
+                m_commitDone.notify_all();
+            }
+        }
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the <see cref="CommitPipeline"/> class,
+        /// which starts the commit thread.
+        /// </summary>
+        /// <param name="commit">Commits a set of buffers, in the commit thread.</param>
+        explicit CommitPipeline(const std::function<void (BuffersType &)> &commit)
+            : m_next(0)
+            , m_commit(commit)
+            , m_handedOver(nullptr)
+            , m_isClosing(false)
+        {
+            m_thread = std::thread(&CommitPipeline::CommitLoop, this);
+        }
+
+        CommitPipeline(const CommitPipeline &) = delete;
+
+        /// <summary>
+        /// Finalizes an instance of the <see cref="CommitPipeline"/> class.
+        /// The commit in flight (if any) finishes first.
+        /// </summary>
+        ~CommitPipeline()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_isClosing = true;
+            }
+
+            m_commitAvailable.notify_one();
+            m_thread.join();
+        }
+
+        /// <summary>
+        /// Gets the set of buffers for the caller to fill, which no commit is using.
+        /// </summary>
+        BuffersType &GetNext() { return m_buffers[m_next]; }
+
+        /// <summary>
+        /// Hands over to the commit thread the set filled after <see cref="GetNext"/>, once the
+        /// previous commit has finished, then returns without waiting for this one. When the
+        /// previous commit has failed, its exception is thrown instead, and nothing is handed over.
+        /// </summary>
+        void HandOver()
+        {
+            auto error = WaitForCommit();
+            if (error)
+                std::rethrow_exception(error);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_handedOver = &m_buffers[m_next];
+            m_next ^= 1;
+            m_commitAvailable.notify_one();
+        }
+
+        /// <summary>
+        /// Waits for the commit in flight (if any) to finish.
+        /// </summary>
+        /// <returns>The exception of the last commit, or null if it succeeded (or was already taken).</returns>
+        std::exception_ptr WaitForCommit()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_commitDone.wait(lock, [this]() { return m_handedOver == nullptr; });
+
+            std::exception_ptr error;
+            std::swap(error, m_error);
+            return error;
+        }
+
+        /// <summary>
+        /// Tells whether a commit is in flight.
+        /// </summary>
+        bool IsCommitting()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_handedOver != nullptr;
+        }
+    };
+
+}// end of namespace application
+
+#endif // end of header guard
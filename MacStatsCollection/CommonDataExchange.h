@@ -1,10 +1,13 @@
 #ifndef __CommonDataExchange_h__ // header guard
 #define __CommonDataExchange_h__
 
+#include "NameInterner.h"
 #include <cinttypes>
 #include <string>
 #include <vector>
+#include <array>
 #include <chrono>
+#include <algorithm>
 
 namespace application
 {
@@ -36,8 +39,9 @@ namespace application
     };
 
     /// <summary>
-    /// Holds all the performance counters values retrieved
-    /// by <see cref="PerfCountersReader"/> in a single call.
+    /// Holds the values of the performance counters enumerated by <see cref="PerfCounterCode"/>
+    /// in a single sample. This is the sample read by <see cref="ProcFsCountersReader"/>
+    /// (everything else uses <see cref="SamplesBatch"/>).
     /// </summary>
     struct PerfCountersValues
     {
@@ -66,52 +70,235 @@ namespace application
         ThreadCount
     };
 
+    /// <summary>
+    /// How many performance counters are enumerated by <see cref="PerfCounterCode"/>.
+    /// </summary>
+    static constexpr uint32_t numSupPerfCounters = 6;
+
     const wchar_t *ToStatName(PerfCounterCode code);
 
 
+    /// <summary>
+    /// Enumerates the functions that summarize the samples of a performance counter
+    /// taken within a send cycle (they must match the internal array indexes: DO NOT
+    /// CHANGE THESE CODES!!!). The last sample is sent with the plain stat name.
+    /// </summary>
+    enum class AggregateCode : uint32_t
+    {
+        Min = 0,
+        Max,
+        Mean,
+        Percentile95
+    };
+
+    /// <summary>
+    /// How many aggregate functions are enumerated by <see cref="AggregateCode"/>.
+    /// </summary>
+    static constexpr uint32_t numSupAggregates = 4;
+
+
+    /// <summary>
+    /// Enumerates the metrics the client takes about its own overhead, which are sent as
+    /// extra stats of type float 32 bits along with the stats of the machine (they must
+    /// match the internal array indexes: DO NOT CHANGE THESE CODES!!!).
+    /// </summary>
+    enum class SelfMetricCode : uint32_t
+    {
+        CollectMillisecs = 0, // longest collection of counters in the cycle
+        SendMillisecs, // round-trip of the last request to the server
+        CpuUsage, // CPU time of the client as percentage of the cycle (in a single core)
+        ResidentMemory, // working set, in kilobytes
+        SpoolDepth // samples waiting in the spool
+    };
+
+    /// <summary>
+    /// How many metrics are enumerated by <see cref="SelfMetricCode"/>.
+    /// </summary>
+    static constexpr uint32_t numSelfMetrics = 5;
+
+    const wchar_t *ToStatName(SelfMetricCode code);
+
+
+    /// <summary>
+    /// Enumerates the types a statistic value can be sent as.
+    /// </summary>
+    enum class StatValueType : uint8_t
+    {
+        Float32,
+        Int32
+    };
+
+    /// <summary>
+    /// Describes an entry in the catalog of performance counters to collect.
+    /// </summary>
+    struct PerfCounterDescriptor
+    {
+        std::wstring statName;
+        std::wstring path; // without the machine, like "\Processor(_Total)\% Processor Time"
+        StatValueType valueType;
+        std::array<std::wstring, numSupAggregates> aggregateStatNames; // indexed by AggregateCode
+    };
+
+
+    /// <summary>
+    /// A columnar batch of samples of performance counters. Every sample (a row) has a time
+    /// and the values of the same counters (the columns), which are identified by their indexes
+    /// in the catalog. Values and qualities are stored row after row in contiguous arrays, the
+    /// qualities packed in a byte each, so aggregation and encoding are plain loops over many
+    /// counters and many samples, without knowing any particular counter.
+    /// </summary>
+    struct SamplesBatch
+    {
+        std::vector<uint32_t> counterIds; // index in the catalog of the counter in each column
+        std::vector<std::chrono::time_point<std::chrono::system_clock>> times; // one per row
+        std::vector<double> values; // double keeps any 32 bits integer exact
+        std::vector<Quality> qualities;
+
+        size_t GetCounterCount() const { return counterIds.size(); }
+
+        size_t GetSampleCount() const { return times.size(); }
+
+        /// <summary>
+        /// Adds a sample to the batch, whose values are yet to be set.
+        /// </summary>
+        /// <param name="time">The time of the sample.</param>
+        /// <returns>The index of the row of the added sample.</returns>
+        size_t AddSample(std::chrono::time_point<std::chrono::system_clock> time)
+        {
+            times.push_back(time);
+            values.resize(values.size() + counterIds.size(), 0.0);
+            qualities.resize(qualities.size() + counterIds.size(), Quality::Unknown);
+            return times.size() - 1;
+        }
+
+        double *GetValues(size_t row) { return values.data() + row * counterIds.size(); }
+
+        const double *GetValues(size_t row) const { return values.data() + row * counterIds.size(); }
+
+        Quality *GetQualities(size_t row) { return qualities.data() + row * counterIds.size(); }
+
+        const Quality *GetQualities(size_t row) const { return qualities.data() + row * counterIds.size(); }
+
+        /// <summary>
+        /// Adds a copy of a sample from another batch, which must have the same counters.
+        /// </summary>
+        /// <param name="other">The batch containing the sample to copy.</param>
+        /// <param name="row">The row of the sample in the other batch.</param>
+        /// <returns>The index of the row of the added sample.</returns>
+        size_t AddSampleFrom(const SamplesBatch &other, size_t row)
+        {
+            auto newRow = AddSample(other.times[row]);
+            std::copy(other.GetValues(row), other.GetValues(row) + counterIds.size(), GetValues(newRow));
+            std::copy(other.GetQualities(row), other.GetQualities(row) + counterIds.size(), GetQualities(newRow));
+            return newRow;
+        }
+
+        /// <summary>
+        /// Removes all samples, but keeps the counters and the allocated memory.
+        /// </summary>
+        void Clear()
+        {
+            times.clear();
+            values.clear();
+            qualities.clear();
+        }
+    };
+
+
+    /// <summary>
+    /// Holds the aggregates of the samples that <see cref="StatsAggregator"/> has accumulated
+    /// in a send cycle, in the same columnar layout of <see cref="SamplesBatch"/>: for each
+    /// counter, the values are indexed by <see cref="AggregateCode"/>.
+    /// </summary>
+    struct SamplesAggregates
+    {
+        uint32_t sampleCount;
+        std::vector<uint32_t> counterIds; // index in the catalog of each counter
+        std::vector<float> values;
+        std::vector<Quality> qualities; // one per counter
+
+        const float *GetValues(size_t counter) const { return values.data() + counter * numSupAggregates; }
+    };
+
+
+    /// <summary>
+    /// Holds what the client has collected in a cycle, to be sent to the server: the last
+    /// sample, plus the aggregates of all samples in the cycle (if sampling at a higher rate),
+    /// which values to send (if filtering by deadband), the burst of samples (if any), and
+    /// the metrics of the client about itself.
+    /// The collection thread fills it in place, and the sending thread reads it in place.
+    /// </summary>
+    struct CollectedStats
+    {
+        SamplesBatch sample; // a single row
+        SamplesAggregates aggregates; // no counters when there are no aggregates
+        std::vector<uint8_t> sendMask; // one flag per column, or empty to send all
+        SamplesBatch burst; // no samples when there is no burst
+        std::array<ValueWithQuality<float>, numSelfMetrics> selfMetrics; // indexed by SelfMetricCode
+        bool hasSelfMetrics;
+
+        CollectedStats() : hasSelfMetrics(false) {}
+
+        bool HasAggregates() const { return !aggregates.counterIds.empty(); }
+
+        const uint8_t *GetSendMask() const { return sendMask.empty() ? nullptr : sendMask.data(); }
+    };
+
+
     ///////////////////
     // Server Side
     ///////////////////
 
     /// <summary>
-    /// Holds data for a single sample of statistic value.
+    /// Holds data for a single sample of statistic value. The statistic is identified either
+    /// by name or, when the client has a session with the server, by the ID in the database.
     /// </summary>
     template <typename ValType>
     struct StatSampleValue
     {
-        std::wstring statName;
+        InternedName statName; // empty when identified by ID
+        int16_t statId; // zero when identified by name
         ValType value;
         Quality quality;
 
-        StatSampleValue(const wchar_t *p_statName, ValType p_value, Quality p_quality)
-            : statName(p_statName), value(p_value), quality(p_quality) {}
+        StatSampleValue(InternedName p_statName, ValType p_value, Quality p_quality)
+            : statName(p_statName), statId(0), value(p_value), quality(p_quality) {}
 
-        StatSampleValue(std::wstring &&p_statName, ValType p_value, Quality p_quality)
-            : statName(std::move(p_statName)), value(p_value), quality(p_quality) {}
-
-        StatSampleValue(const std::wstring &p_statName, ValType p_value, Quality p_quality)
-            : statName(p_statName), value(p_value), quality(p_quality) {}
+        StatSampleValue(int16_t p_statId, ValType p_value, Quality p_quality)
+            : statId(p_statId), value(p_value), quality(p_quality) {}
     };
 
 
     /// <summary>
-    /// Packages all useful data that comes in <see cref="_SendStatsSampleRequest"/>,
-    /// which will also be used to write into storage.
+    /// Packages all useful data that comes in <see cref="_SendStatsSampleRequest"/>
+    /// (or in each sample of <see cref="_SendStatsSamplesRequest"/>), which will
+    /// also be used to write into storage. The names are interned, so the package
+    /// can be built, moved and converted into rows without allocating strings.
     /// </summary>
     struct StatsPackage
     {
         int64_t timeSinceEpochInMillisecs;
-        std::wstring machine;
+        InternedName machine;
         std::vector<StatSampleValue<float>> statSamplesFloat32;
         std::vector<StatSampleValue<int>> statSamplesInt32;
 
         StatsPackage() {};
 
         StatsPackage(StatsPackage &&ob)
-            : machine(std::move(ob.machine))
+            : timeSinceEpochInMillisecs(ob.timeSinceEpochInMillisecs)
+            , machine(ob.machine)
             , statSamplesFloat32(std::move(ob.statSamplesFloat32))
             , statSamplesInt32(std::move(ob.statSamplesInt32))
         {}
+
+        StatsPackage &operator =(StatsPackage &&ob)
+        {
+            timeSinceEpochInMillisecs = ob.timeSinceEpochInMillisecs;
+            machine = ob.machine;
+            statSamplesFloat32 = std::move(ob.statSamplesFloat32);
+            statSamplesInt32 = std::move(ob.statSamplesInt32);
+            return *this;
+        }
     };
 
     typedef StatsPackage StorageWriteTask;
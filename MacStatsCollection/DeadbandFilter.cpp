@@ -0,0 +1,194 @@
+#include "stdafx.h"
+#include "DeadbandFilter.h"
+#include "PerfCountersCatalog.h"
+#include <3FD/callstacktracer.h>
+#include <3FD/exceptions.h>
+#include <3FD/configuration.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <codecvt>
+#include <cstdlib>
+#include <sstream>
+
+namespace application
+{
+    using namespace _3fd::core;
+
+
+    /// <summary>
+    /// Loads the deadbands declared in the application configuration under the keys
+    /// "deadband1", "deadband2" and so on (until the first missing key), in the format
+    /// "stat_name;absolute;relative", where relative is a fraction of the last value sent.
+    /// A name ending in '*' applies the deadband to every counter whose name of stat starts
+    /// like it, such as the instances of a wildcard.
+    /// </summary>
+    /// <param name="catalog">The catalog of performance counters, with wildcards expanded.</param>
+    /// <returns>The deadbands, which might be none.</returns>
+    std::vector<Deadband> LoadDeadbands(const std::vector<PerfCounterDescriptor> &catalog)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            std::vector<Deadband> deadbands;
+            std::wstring_convert<std::codecvt_utf8<wchar_t>> transcoder;
+
+            for (uint32_t number = 1; true; ++number)
+            {
+                std::ostringstream oss;
+                oss << "deadband" << number;
+                auto key = oss.str();
+
+                auto text = AppConfig::GetSettings().application.GetString(key, "");
+                if (text.empty())
+                    break;
+
+                auto endOfName = text.find(';');
+                const char *absoluteText = (endOfName != std::string::npos) ? text.c_str() + endOfName + 1 : "";
+                char *endOfAbsolute;
+                double absolute = strtod(absoluteText, &endOfAbsolute);
+
+                const char *relativeText = (*endOfAbsolute == ';') ? endOfAbsolute + 1 : "";
+                char *endOfRelative;
+                double relative = strtod(relativeText, &endOfRelative);
+
+                if (endOfName == 0
+                    || endOfName == std::string::npos
+                    || endOfAbsolute == absoluteText
+                    || endOfRelative == relativeText
+                    || *endOfRelative != 0
+                    || absolute < 0.0
+                    || relative < 0.0)
+                {
+                    oss.str("");
+                    oss << "Invalid declaration of deadband in configuration: " << key << " = '" << text << '\'';
+                    throw AppException<std::runtime_error>(oss.str());
+                }
+
+                auto counterIds = FindCounterIds(catalog, transcoder.from_bytes(text.substr(0, endOfName)));
+
+                if (counterIds.empty())
+                {
+                    oss.str("");
+                    oss << "Deadband in configuration does not match any counter in the catalog: " << key << " = '" << text << '\'';
+                    throw AppException<std::runtime_error>(oss.str());
+                }
+
+                for (auto counterId : counterIds)
+                    deadbands.push_back(Deadband{ counterId, absolute, relative });
+            }
+
+            return deadbands;
+        }
+        catch (IAppException &)
+        {
+            throw; // just forward already prepared application exceptions
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when loading deadbands: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="DeadbandFilter"/> class.
+    /// </summary>
+    /// <param name="deadbands">The deadbands. Counters without one are always sent.</param>
+    /// <param name="heartbeatCycles">Every how many filtered samples all counters are sent
+    /// (the first sample is always a heartbeat). When 1, nothing is ever omitted.</param>
+    DeadbandFilter::DeadbandFilter(const std::vector<Deadband> &deadbands, uint32_t heartbeatCycles)
+        : m_deadbands(deadbands)
+        , m_heartbeatCycles(heartbeatCycles)
+        , m_cyclesSinceHeartbeat(heartbeatCycles)
+        , m_omittedCount(0)
+    {
+        assert(heartbeatCycles > 0);
+    }
+
+
+    // Sets the deadband of each column, as defined by the counters in the first sample
+    void DeadbandFilter::SetColumns(const SamplesBatch &batch)
+    {
+        auto counterCount = batch.GetCounterCount();
+
+        // a negative absolute deadband means the column has none:
+        m_absolutes.assign(counterCount, -1.0);
+        m_relatives.assign(counterCount, 0.0);
+        m_lastSentValues.assign(counterCount, 0.0);
+        m_lastSentQualities.assign(counterCount, Quality::Unknown);
+        m_sendMask.assign(counterCount, 1);
+
+        for (auto &deadband : m_deadbands)
+        {
+            auto iter = std::find(batch.counterIds.begin(), batch.counterIds.end(), deadband.counterId);
+            assert(iter != batch.counterIds.end());
+            auto column = iter - batch.counterIds.begin();
+            m_absolutes[column] = deadband.absolute;
+            m_relatives[column] = deadband.relative;
+        }
+    }
+
+
+    /// <summary>
+    /// Filters a sample, deciding which values must be sent. The counters in the
+    /// first sample define the columns, and all the next samples must have the same ones.
+    /// </summary>
+    /// <param name="batch">The batch containing the sample to filter.</param>
+    /// <param name="row">The row of the sample in the batch.</param>
+    /// <param name="aggregates">The aggregates to be sent along with the sample, if any, in
+    /// the same columns. The counter is also sent when its min or max leave the deadband.</param>
+    /// <returns>One flag per column of the batch, telling whether the value must be sent.
+    /// It remains valid until the next call.</returns>
+    const uint8_t *DeadbandFilter::Filter(const SamplesBatch &batch, size_t row, const SamplesAggregates *aggregates)
+    {
+        auto counterCount = batch.GetCounterCount();
+
+        if (m_sendMask.empty())
+            SetColumns(batch);
+
+        assert(m_sendMask.size() == counterCount);
+        assert(aggregates == nullptr || aggregates->counterIds == batch.counterIds);
+
+        bool isHeartbeat = (m_cyclesSinceHeartbeat >= m_heartbeatCycles);
+        m_cyclesSinceHeartbeat = isHeartbeat ? 1 : m_cyclesSinceHeartbeat + 1;
+
+        auto values = batch.GetValues(row);
+        auto qualities = batch.GetQualities(row);
+        m_omittedCount = 0;
+
+        for (size_t idx = 0; idx < counterCount; ++idx)
+        {
+            auto lastSent = m_lastSentValues[idx];
+            auto band = (std::max)(m_absolutes[idx], m_relatives[idx] * std::abs(lastSent));
+
+            bool isChanged = isHeartbeat
+                || m_absolutes[idx] < 0.0
+                || qualities[idx] != m_lastSentQualities[idx]
+                || std::abs(values[idx] - lastSent) > band;
+
+            if (!isChanged && aggregates != nullptr && aggregates->qualities[idx] == Quality::Good)
+            {
+                auto aggregated = aggregates->GetValues(idx);
+                isChanged = std::abs(aggregated[static_cast<uint32_t> (AggregateCode::Min)] - lastSent) > band
+                    || std::abs(aggregated[static_cast<uint32_t> (AggregateCode::Max)] - lastSent) > band;
+            }
+
+            if (isChanged)
+            {
+                m_lastSentValues[idx] = values[idx];
+                m_lastSentQualities[idx] = qualities[idx];
+            }
+            else
+                ++m_omittedCount;
+
+            m_sendMask[idx] = isChanged ? 1 : 0;
+        }
+
+        return m_sendMask.data();
+    }
+
+}// end of namespace application
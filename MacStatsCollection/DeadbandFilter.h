@@ -0,0 +1,71 @@
+#ifndef __DeadbandFilter_h__ // header guard
+#define __DeadbandFilter_h__
+
+#include "CommonDataExchange.h"
+#include <vector>
+
+namespace application
+{
+    /// <summary>
+    /// Declares how much the value of a performance counter must change,
+    /// since the last time it was sent, to be sent again.
+    /// </summary>
+    struct Deadband
+    {
+        uint32_t counterId; // index in the catalog
+        double absolute; // change of value
+        double relative; // change as a fraction of the last value sent
+    };
+
+    std::vector<Deadband> LoadDeadbands(const std::vector<PerfCounterDescriptor> &catalog);
+
+
+    /// <summary>
+    /// Decides which performance counters in a sample are worth sending (report by exception):
+    /// a counter with deadband is omitted while its value stays within the deadband around the
+    /// value last sent, and its quality does not change. Every few cycles a heartbeat sends all
+    /// of them, so the server can tell unchanged values from values gone missing.
+    /// </summary>
+    /// <seealso cref="notcopiable" />
+    class DeadbandFilter
+    {
+    private:
+
+        std::vector<Deadband> m_deadbands;
+
+        // one entry per column in the batch:
+        std::vector<double> m_absolutes;
+        std::vector<double> m_relatives;
+        std::vector<double> m_lastSentValues;
+        std::vector<Quality> m_lastSentQualities;
+        std::vector<uint8_t> m_sendMask;
+
+        uint32_t m_heartbeatCycles;
+        uint32_t m_cyclesSinceHeartbeat;
+        size_t m_omittedCount;
+
+        void SetColumns(const SamplesBatch &batch);
+
+    public:
+
+        DeadbandFilter(const std::vector<Deadband> &deadbands, uint32_t heartbeatCycles);
+
+        DeadbandFilter(const DeadbandFilter &) = delete;
+
+        const uint8_t *Filter(const SamplesBatch &batch, size_t row, const SamplesAggregates *aggregates = nullptr);
+
+        /// <summary>
+        /// Makes the next filtered sample a heartbeat, which is needed
+        /// when the last one could not reach the server.
+        /// </summary>
+        void ForceHeartbeat() { m_cyclesSinceHeartbeat = m_heartbeatCycles; }
+
+        /// <summary>
+        /// Gets how many values were omitted by the last filtered sample.
+        /// </summary>
+        size_t GetOmittedCount() const { return m_omittedCount; }
+    };
+
+}// end of namespace application
+
+#endif // end of header guard
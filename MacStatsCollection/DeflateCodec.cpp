@@ -0,0 +1,203 @@
+#include "stdafx.h"
+#include "DeflateCodec.h"
+#include <3FD\callstacktracer.h>
+#include <3FD\exceptions.h>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <sstream>
+
+#if defined(POCO_UNBUNDLED)
+#   include <zlib.h>
+#else
+#   include <Poco/zlib.h> // the copy of zlib built into POCO Foundation
+#endif
+
+namespace application
+{
+    using namespace _3fd::core;
+
+
+    // Throws an exception for a failed call of zlib
+    static void ThrowZlibError(const char *message, const z_stream &stream, int rc)
+    {
+        CALL_STACK_TRACE;
+        std::ostringstream oss;
+        oss << message << " - zlib returned " << rc;
+
+        if (stream.msg != nullptr)
+            oss << ": " << stream.msg;
+
+        throw AppException<std::runtime_error>(oss.str());
+    }
+
+
+    ////////////////////
+    // Compression
+    ////////////////////
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="FrameDeflater"/> class.
+    /// </summary>
+    FrameDeflater::FrameDeflater()
+        : m_stream(new z_stream)
+    {
+        memset(m_stream.get(), 0, sizeof(z_stream));
+
+        // the fastest level: the frames are small and the client must stay lightweight
+        auto rc = deflateInit(m_stream.get(), Z_BEST_SPEED);
+        if (rc != Z_OK)
+            ThrowZlibError("Failed to create context for deflate", *m_stream, rc);
+    }
+
+
+    /// <summary>
+    /// Finalizes an instance of the <see cref="FrameDeflater"/> class.
+    /// </summary>
+    FrameDeflater::~FrameDeflater()
+    {
+        deflateEnd(m_stream.get());
+    }
+
+
+    /// <summary>
+    /// Compresses a frame.
+    /// </summary>
+    /// <param name="data">The frame.</param>
+    /// <param name="size">The size of the frame.</param>
+    /// <param name="compressed">Where to save the compressed frame (its memory is reused).</param>
+    void FrameDeflater::Compress(const uint8_t *data, size_t size, std::vector<uint8_t> &compressed)
+    {
+        auto &stream = *m_stream;
+
+        if (size > (std::numeric_limits<uInt>::max)() / 2)
+            throw AppException<std::runtime_error>("Frame is too large for deflate");
+
+        auto rc = deflateReset(&stream);
+        if (rc != Z_OK)
+            ThrowZlibError("Failed to reset context for deflate", stream, rc);
+
+        compressed.resize(deflateBound(&stream, static_cast<uLong> (size)));
+
+        stream.next_in = const_cast<Bytef *> (data);
+        stream.avail_in = static_cast<uInt> (size);
+        stream.next_out = compressed.data();
+        stream.avail_out = static_cast<uInt> (compressed.size());
+
+        // the output is as large as the bound, so a single call does it:
+        rc = deflate(&stream, Z_FINISH);
+        if (rc != Z_STREAM_END)
+            ThrowZlibError("Failed to deflate frame", stream, rc);
+
+        compressed.resize(stream.total_out);
+    }
+
+
+    ////////////////////
+    // Decompression
+    ////////////////////
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="FrameInflater"/> class.
+    /// </summary>
+    FrameInflater::FrameInflater()
+        : m_stream(new z_stream)
+        , m_isComplete(false)
+    {
+        memset(m_stream.get(), 0, sizeof(z_stream));
+
+        auto rc = inflateInit(m_stream.get());
+        if (rc != Z_OK)
+            ThrowZlibError("Failed to create context for inflate", *m_stream, rc);
+    }
+
+
+    /// <summary>
+    /// Finalizes an instance of the <see cref="FrameInflater"/> class.
+    /// </summary>
+    FrameInflater::~FrameInflater()
+    {
+        inflateEnd(m_stream.get());
+    }
+
+
+    /// <summary>
+    /// Prepares to decompress another frame.
+    /// </summary>
+    void FrameInflater::Reset()
+    {
+        auto rc = inflateReset(m_stream.get());
+        if (rc != Z_OK)
+            ThrowZlibError("Failed to reset context for inflate", *m_stream, rc);
+
+        m_isComplete = false;
+    }
+
+
+    /// <summary>
+    /// Decompresses the next chunk of the compressed frame.
+    /// </summary>
+    /// <param name="chunk">The chunk of compressed data.</param>
+    /// <param name="size">The size of the chunk.</param>
+    /// <param name="frame">Where to append the decompressed data.</param>
+    /// <param name="maxFrameSize">The limit for the size of the decompressed frame.</param>
+    /// <returns>
+    /// Whether the data is valid, which is not the case when corrupted, when it continues after
+    /// the end of the compressed frame, or when the decompressed frame would exceed the limit.
+    /// </returns>
+    bool FrameInflater::Inflate(const uint8_t *chunk, size_t size, std::vector<uint8_t> &frame, size_t maxFrameSize)
+    {
+        if (size == 0)
+            return true;
+
+        if (m_isComplete)
+            return false;
+
+        auto &stream = *m_stream;
+        stream.next_in = const_cast<Bytef *> (chunk);
+        stream.avail_in = static_cast<uInt> (size);
+
+        do
+        {
+            auto offset = frame.size();
+            int rc;
+
+            if (offset < maxFrameSize)
+            {
+                // grow in steps, never past the limit:
+                auto growth = (std::min)(maxFrameSize - offset, (std::max)(static_cast<size_t> (4096), 2 * size));
+                frame.resize(offset + growth);
+
+                stream.next_out = frame.data() + offset;
+                stream.avail_out = static_cast<uInt> (growth);
+
+                rc = inflate(&stream, Z_NO_FLUSH);
+                frame.resize(offset + growth - stream.avail_out);
+            }
+            else
+            {
+                // at the limit, the rest of the input can only be the trailer:
+                uint8_t excess;
+                stream.next_out = &excess;
+                stream.avail_out = 1;
+
+                rc = inflate(&stream, Z_NO_FLUSH);
+                if (stream.avail_out == 0)
+                    return false;
+            }
+
+            if (rc == Z_STREAM_END)
+            {
+                m_isComplete = true;
+                return stream.avail_in == 0;
+            }
+
+            if (rc != Z_OK && rc != Z_BUF_ERROR)
+                return false;
+
+        } while (stream.avail_in > 0 || stream.avail_out == 0);
+
+        return true;
+    }
+
+}// end of namespace application
@@ -0,0 +1,68 @@
+#ifndef __DeflateCodec_h__ // header guard
+#define __DeflateCodec_h__
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct z_stream_s;
+
+namespace application
+{
+    /// <summary>
+    /// Compresses frames with deflate (in the zlib format of "Content-Encoding: deflate"),
+    /// keeping the same context for all of them, so its memory is allocated only once.
+    /// </summary>
+    /// <seealso cref="notcopiable" />
+    class FrameDeflater
+    {
+    private:
+
+        std::unique_ptr<z_stream_s> m_stream;
+
+    public:
+
+        FrameDeflater();
+
+        FrameDeflater(const FrameDeflater &) = delete;
+
+        ~FrameDeflater();
+
+        void Compress(const uint8_t *data, size_t size, std::vector<uint8_t> &compressed);
+    };
+
+
+    /// <summary>
+    /// Decompresses the frames compressed by <see cref="FrameDeflater"/> chunk by chunk,
+    /// as they come from the network, straight into the buffer the decoder reads from.
+    /// The same context is kept for all frames.
+    /// </summary>
+    /// <seealso cref="notcopiable" />
+    class FrameInflater
+    {
+    private:
+
+        std::unique_ptr<z_stream_s> m_stream;
+        bool m_isComplete;
+
+    public:
+
+        FrameInflater();
+
+        FrameInflater(const FrameInflater &) = delete;
+
+        ~FrameInflater();
+
+        void Reset();
+
+        bool Inflate(const uint8_t *chunk, size_t size, std::vector<uint8_t> &frame, size_t maxFrameSize);
+
+        /// <summary>
+        /// Tells whether the compressed data has come to its end.
+        /// </summary>
+        bool IsComplete() const { return m_isComplete; }
+    };
+
+}// end of namespace application
+
+#endif // end of header guard
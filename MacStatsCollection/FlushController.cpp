@@ -0,0 +1,57 @@
+#include "stdafx.h"
+#include "FlushController.h"
+#include <algorithm>
+#include <cassert>
+
+namespace application
+{
+    /// <summary>
+    /// Initializes a new instance of the <see cref="FlushController"/> class.
+    /// </summary>
+    /// <param name="initialTarget">The target before any commit is measured.</param>
+    /// <param name="minTarget">The least the target can be.</param>
+    /// <param name="maxTarget">The most the target can be.</param>
+    /// <param name="goalLatency">How long a commit should take.</param>
+    FlushController::FlushController(size_t initialTarget,
+                                     size_t minTarget,
+                                     size_t maxTarget,
+                                     std::chrono::milliseconds goalLatency)
+        : m_minTarget((std::max)(minTarget, static_cast<size_t> (1)))
+        , m_maxTarget((std::max)(maxTarget, (std::max)(minTarget, static_cast<size_t> (1))))
+        , m_goalLatency(goalLatency)
+    {
+        assert(goalLatency.count() > 0);
+        m_target = static_cast<double> ((std::min)((std::max)(initialTarget, m_minTarget), m_maxTarget));
+    }
+
+
+    /// <summary>
+    /// Records how long the commit of some packages took, updating the target.
+    /// </summary>
+    /// <param name="count">How many packages were written.</param>
+    /// <param name="latency">How long the commit took.</param>
+    void FlushController::RecordCommit(size_t count, std::chrono::steady_clock::duration latency)
+    {
+        if (count == 0)
+            return;
+
+        // the size whose commit would take the goal latency:
+        std::chrono::duration<double> elapsedTime(latency);
+        double ideal = (elapsedTime.count() > 0.0)
+            ? count * (m_goalLatency.count() / elapsedTime.count())
+            : m_target * 2.0;
+
+        /* A commit of fewer packages than the target (upon the deadline) takes longer for each one,
+        as the fixed cost of the commit is not amortized, so it can raise the target, but not lower it: */
+        if (count < GetTarget() && ideal < m_target)
+            return;
+
+        // half way there, so a single slow commit does not throw the target off:
+        double target = m_target + (ideal - m_target) / 2.0;
+        target = (std::min)((std::max)(target, m_target / 2.0), m_target * 2.0);
+
+        m_target = (std::min)((std::max)(target, static_cast<double> (m_minTarget)),
+                              static_cast<double> (m_maxTarget));
+    }
+
+}// end of namespace application
@@ -0,0 +1,59 @@
+#ifndef __FlushController_h__ // header guard
+#define __FlushController_h__
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+namespace application
+{
+    /// <summary>
+    /// Decides how many packages the server gathers in the queue before writing them to the
+    /// database in a single commit. Larger batches amortize the cost of a commit, but take longer
+    /// to write, so the target is tuned from the measured latency of the commits: it moves toward
+    /// the size whose commit would take the goal latency (as if it grows linearly with the count),
+    /// but no more than doubling or halving at once, and always within bounds. The commits of fewer
+    /// packages than the target (upon the deadline) do not lower it.
+    /// </summary>
+    class FlushController
+    {
+    private:
+
+        double m_target;
+        const size_t m_minTarget;
+        const size_t m_maxTarget;
+        const std::chrono::duration<double> m_goalLatency;
+
+    public:
+
+        FlushController(size_t initialTarget,
+                        size_t minTarget,
+                        size_t maxTarget,
+                        std::chrono::milliseconds goalLatency);
+
+        void RecordCommit(size_t count, std::chrono::steady_clock::duration latency);
+
+        /// <summary>
+        /// Writes the tasks in a single call of the writer, which clears them,
+        /// and records how long the commit took for as many tasks as there were.
+        /// </summary>
+        /// <param name="writer">The writer, such as <see cref="StorageWriterPool"/>.</param>
+        /// <param name="tasks">The tasks to write.</param>
+        template <typename WriterType, typename TaskType>
+        void Commit(WriterType &writer, std::vector<TaskType> &tasks)
+        {
+            auto count = tasks.size();
+            auto startTime = std::chrono::steady_clock::now();
+            writer.WriteStats(tasks);
+            RecordCommit(count, std::chrono::steady_clock::now() - startTime);
+        }
+
+        /// <summary>
+        /// Gets how many packages to wait for in the queue before writing them.
+        /// </summary>
+        size_t GetTarget() const { return static_cast<size_t> (m_target); }
+    };
+
+}// end of namespace application
+
+#endif // end of header guard
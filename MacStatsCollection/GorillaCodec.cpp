@@ -0,0 +1,425 @@
+#include "stdafx.h"
+#include "GorillaCodec.h"
+#include <cassert>
+
+namespace application
+{
+    ////////////////////
+    // Bit Stream
+    ////////////////////
+
+    /// <summary>
+    /// Appends bits to the buffer.
+    /// </summary>
+    /// <param name="bits">The bits, aligned to the right.</param>
+    /// <param name="count">How many bits to append (up to 64).</param>
+    void BitWriter::Write(uint64_t bits, uint32_t count)
+    {
+        assert(count <= 64);
+
+        // in chunks of up to 32 bits, so the pending ones always fit:
+        if (count > 32)
+        {
+            Write(bits >> 32, count - 32);
+            bits &= 0xFFFFFFFF;
+            count = 32;
+        }
+
+        if (count == 0)
+            return;
+
+        m_pending = (m_pending << count) | (bits & ((static_cast<uint64_t> (1) << count) - 1));
+        m_pendingCount += count;
+
+        while (m_pendingCount >= 8)
+        {
+            m_pendingCount -= 8;
+            m_buffer.push_back(static_cast<uint8_t> (m_pending >> m_pendingCount));
+        }
+    }
+
+
+    /// <summary>
+    /// Appends to the buffer the bits still pending, padding the last byte with zeros.
+    /// </summary>
+    void BitWriter::Flush()
+    {
+        if (m_pendingCount == 0)
+            return;
+
+        m_buffer.push_back(static_cast<uint8_t> (m_pending << (8 - m_pendingCount)));
+        m_pendingCount = 0;
+    }
+
+
+    /// <summary>
+    /// Reads bits from the data.
+    /// </summary>
+    /// <param name="count">How many bits to read (up to 64).</param>
+    /// <param name="bits">Where to save the bits, aligned to the right.</param>
+    /// <returns>Whether there were enough bits to read.</returns>
+    bool BitReader::Read(uint32_t count, uint64_t &bits)
+    {
+        assert(count <= 64);
+
+        if (count > 32)
+        {
+            uint64_t high, low;
+            if (!Read(count - 32, high) || !Read(32, low))
+                return false;
+
+            bits = (high << 32) | low;
+            return true;
+        }
+
+        while (m_pendingCount < count)
+        {
+            if (m_pos == m_end)
+                return false;
+
+            m_pending = (m_pending << 8) | *m_pos++;
+            m_pendingCount += 8;
+        }
+
+        m_pendingCount -= count;
+        bits = (m_pending >> m_pendingCount) & ((static_cast<uint64_t> (1) << count) - 1);
+        return true;
+    }
+
+
+    /// <summary>
+    /// Determines whether all the data has been read, except for the padding of the last byte.
+    /// </summary>
+    bool BitReader::IsAtEnd() const
+    {
+        return m_pos == m_end
+            && m_pendingCount < 8
+            && (m_pending & ((static_cast<uint64_t> (1) << m_pendingCount) - 1)) == 0;
+    }
+
+
+    ////////////////////
+    // Encoding
+    ////////////////////
+
+    static const uint32_t valueBitCount(32);
+
+    // Marks that a counter has not yet set the window of meaningful bits
+    static const uint32_t noWindow(valueBitCount);
+
+    static uint32_t CountLeadingZeros(uint32_t value)
+    {
+        uint32_t count(0);
+        for (uint32_t mask = 0x80000000; mask != 0 && (value & mask) == 0; mask >>= 1)
+            ++count;
+
+        return count;
+    }
+
+    static uint32_t CountTrailingZeros(uint32_t value)
+    {
+        uint32_t count(0);
+        for (uint32_t mask = 1; mask != 0 && (value & mask) == 0; mask <<= 1)
+            ++count;
+
+        return count;
+    }
+
+    // Interprets the given count of bits (aligned to the right) as a signed integer in two's complement
+    static int64_t SignExtend(uint64_t bits, uint32_t count)
+    {
+        auto signBit = static_cast<uint64_t> (1) << (count - 1);
+        return static_cast<int64_t> ((bits ^ signBit) - signBit);
+    }
+
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="GorillaEncoder"/> class.
+    /// </summary>
+    /// <param name="buffer">The buffer where to append the compressed samples.</param>
+    /// <param name="counterCount">The count of counters in every sample.</param>
+    GorillaEncoder::GorillaEncoder(std::vector<uint8_t> &buffer, size_t counterCount)
+        : m_writer(buffer)
+        , m_columns(counterCount, Column{ 0, noWindow, noWindow, 0 })
+        , m_lastTime(0)
+        , m_lastDelta(0)
+        , m_isFirst(true)
+    {
+    }
+
+
+    /* The time of the first sample goes whole. For the others, the delta of the delta takes a
+    single bit when zero, or else the smallest of the buckets (in milliseconds) that fits it. */
+    void GorillaEncoder::WriteTime(int64_t time)
+    {
+        if (m_isFirst)
+        {
+            m_writer.Write(static_cast<uint64_t> (time), 64);
+            m_lastTime = time;
+            m_isFirst = false;
+            return;
+        }
+
+        // wraps around instead of overflowing:
+        auto delta = static_cast<int64_t> (static_cast<uint64_t> (time) - static_cast<uint64_t> (m_lastTime));
+        auto deltaOfDelta = static_cast<int64_t> (static_cast<uint64_t> (delta) - static_cast<uint64_t> (m_lastDelta));
+
+        if (deltaOfDelta == 0)
+        {
+            m_writer.Write(0x0, 1);
+        }
+        else if (deltaOfDelta >= -64 && deltaOfDelta < 64)
+        {
+            m_writer.Write(0x2, 2);
+            m_writer.Write(static_cast<uint64_t> (deltaOfDelta), 7);
+        }
+        else if (deltaOfDelta >= -256 && deltaOfDelta < 256)
+        {
+            m_writer.Write(0x6, 3);
+            m_writer.Write(static_cast<uint64_t> (deltaOfDelta), 9);
+        }
+        else if (deltaOfDelta >= -2048 && deltaOfDelta < 2048)
+        {
+            m_writer.Write(0xE, 4);
+            m_writer.Write(static_cast<uint64_t> (deltaOfDelta), 12);
+        }
+        else
+        {
+            m_writer.Write(0xF, 4);
+            m_writer.Write(static_cast<uint64_t> (deltaOfDelta), 64);
+        }
+
+        m_lastTime = time;
+        m_lastDelta = delta;
+    }
+
+
+    /* The value goes XOR'ed with the previous one of the counter: a single bit when they are equal,
+    else the meaningful bits of the XOR, within the window of the previous value when they fit,
+    otherwise with a new window (the count of leading zeros and the count of meaningful bits). */
+    void GorillaEncoder::WriteValue(Column &column, uint32_t bits)
+    {
+        auto xored = bits ^ column.lastBits;
+        column.lastBits = bits;
+
+        if (xored == 0)
+        {
+            m_writer.Write(0x0, 1);
+            return;
+        }
+
+        auto leadingZeros = CountLeadingZeros(xored);
+        auto trailingZeros = CountTrailingZeros(xored);
+
+        if (column.leadingZeros <= leadingZeros && column.trailingZeros <= trailingZeros)
+        {
+            m_writer.Write(0x2, 2);
+            m_writer.Write(xored >> column.trailingZeros, valueBitCount - column.leadingZeros - column.trailingZeros);
+            return;
+        }
+
+        auto meaningfulCount = valueBitCount - leadingZeros - trailingZeros;
+
+        m_writer.Write(0x3, 2);
+        m_writer.Write(leadingZeros, 5);
+        m_writer.Write(meaningfulCount - 1, 5);
+        m_writer.Write(xored >> trailingZeros, meaningfulCount);
+
+        column.leadingZeros = leadingZeros;
+        column.trailingZeros = trailingZeros;
+    }
+
+
+    /// <summary>
+    /// Appends a sample.
+    /// </summary>
+    /// <param name="time">The time of the sample, in milliseconds.</param>
+    /// <param name="valueBits">The bits of the value of each counter.</param>
+    /// <param name="qualityCodes">The quality of each counter, in 2 bits.</param>
+    void GorillaEncoder::Append(int64_t time, const uint32_t *valueBits, const uint8_t *qualityCodes)
+    {
+        WriteTime(time);
+
+        for (size_t idx = 0; idx < m_columns.size(); ++idx)
+        {
+            auto &column = m_columns[idx];
+
+            if (qualityCodes[idx] == column.lastQuality)
+            {
+                m_writer.Write(0x0, 1);
+            }
+            else
+            {
+                m_writer.Write(0x4 | (qualityCodes[idx] & 0x3), 3);
+                column.lastQuality = qualityCodes[idx] & 0x3;
+            }
+
+            WriteValue(column, valueBits[idx]);
+        }
+    }
+
+
+    /// <summary>
+    /// Finishes the series, padding the last byte.
+    /// </summary>
+    void GorillaEncoder::Finish()
+    {
+        m_writer.Flush();
+    }
+
+
+    ////////////////////
+    // Decoding
+    ////////////////////
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="GorillaDecoder"/> class.
+    /// </summary>
+    /// <param name="data">The compressed samples.</param>
+    /// <param name="size">The size of the data.</param>
+    /// <param name="counterCount">The count of counters in every sample.</param>
+    GorillaDecoder::GorillaDecoder(const uint8_t *data, size_t size, size_t counterCount)
+        : m_reader(data, size)
+        , m_columns(counterCount, Column{ 0, 0, 0, 0 })
+        , m_lastTime(0)
+        , m_lastDelta(0)
+        , m_isFirst(true)
+    {
+    }
+
+
+    bool GorillaDecoder::ReadTime(int64_t &time)
+    {
+        uint64_t bits;
+
+        if (m_isFirst)
+        {
+            if (!m_reader.Read(64, bits))
+                return false;
+
+            time = m_lastTime = static_cast<int64_t> (bits);
+            m_isFirst = false;
+            return true;
+        }
+
+        // the count of leading ones tells the bucket:
+        static const uint32_t bucketBitCounts[] = { 0, 7, 9, 12, 64 };
+
+        uint32_t bucket(0);
+        while (bucket < 4)
+        {
+            if (!m_reader.Read(1, bits))
+                return false;
+
+            if (bits == 0)
+                break;
+
+            ++bucket;
+        }
+
+        int64_t deltaOfDelta(0);
+
+        if (bucket > 0)
+        {
+            auto bitCount = bucketBitCounts[bucket];
+            if (!m_reader.Read(bitCount, bits))
+                return false;
+
+            deltaOfDelta = bitCount < 64 ? SignExtend(bits, bitCount) : static_cast<int64_t> (bits);
+        }
+
+        m_lastDelta = static_cast<int64_t> (static_cast<uint64_t> (m_lastDelta) + static_cast<uint64_t> (deltaOfDelta));
+        m_lastTime = static_cast<int64_t> (static_cast<uint64_t> (m_lastTime) + static_cast<uint64_t> (m_lastDelta));
+        time = m_lastTime;
+        return true;
+    }
+
+
+    bool GorillaDecoder::ReadValue(Column &column, uint32_t &bits)
+    {
+        uint64_t control;
+        if (!m_reader.Read(1, control))
+            return false;
+
+        if (control == 0)
+        {
+            bits = column.lastBits;
+            return true;
+        }
+
+        if (!m_reader.Read(1, control))
+            return false;
+
+        if (control == 1) // new window
+        {
+            uint64_t leadingZeros, meaningfulCount;
+            if (!m_reader.Read(5, leadingZeros) || !m_reader.Read(5, meaningfulCount))
+                return false;
+
+            column.leadingZeros = static_cast<uint32_t> (leadingZeros);
+            column.meaningfulCount = static_cast<uint32_t> (meaningfulCount) + 1;
+
+            if (column.leadingZeros + column.meaningfulCount > valueBitCount)
+                return false;
+        }
+        else if (column.meaningfulCount == 0)
+            return false; // no window to reuse
+
+        uint64_t meaningful;
+        if (!m_reader.Read(column.meaningfulCount, meaningful))
+            return false;
+
+        auto trailingZeros = valueBitCount - column.leadingZeros - column.meaningfulCount;
+        column.lastBits ^= static_cast<uint32_t> (meaningful << trailingZeros);
+        bits = column.lastBits;
+        return true;
+    }
+
+
+    /// <summary>
+    /// Decodes the next sample.
+    /// </summary>
+    /// <param name="time">Where to save the time of the sample, in milliseconds.</param>
+    /// <param name="valueBits">Where to save the bits of the value of each counter.</param>
+    /// <param name="qualityCodes">Where to save the quality of each counter, in 2 bits.</param>
+    /// <returns>Whether the sample could be decoded. Otherwise, the data is truncated or corrupted.</returns>
+    bool GorillaDecoder::Next(int64_t &time, uint32_t *valueBits, uint8_t *qualityCodes)
+    {
+        if (!ReadTime(time))
+            return false;
+
+        for (size_t idx = 0; idx < m_columns.size(); ++idx)
+        {
+            auto &column = m_columns[idx];
+
+            uint64_t bits;
+            if (!m_reader.Read(1, bits))
+                return false;
+
+            if (bits != 0)
+            {
+                if (!m_reader.Read(2, bits))
+                    return false;
+
+                column.lastQuality = static_cast<uint8_t> (bits);
+            }
+
+            qualityCodes[idx] = column.lastQuality;
+
+            if (!ReadValue(column, valueBits[idx]))
+                return false;
+        }
+
+        return true;
+    }
+
+
+    /// <summary>
+    /// Determines whether all the samples have been decoded.
+    /// </summary>
+    bool GorillaDecoder::IsAtEnd() const
+    {
+        return m_reader.IsAtEnd();
+    }
+
+}// end of namespace application
@@ -0,0 +1,134 @@
+#ifndef __GorillaCodec_h__ // header guard
+#define __GorillaCodec_h__
+
+#include <cstdint>
+#include <vector>
+
+namespace application
+{
+    /// <summary>
+    /// Appends bits to a buffer, the first ones in the most significant bits of each byte.
+    /// </summary>
+    class BitWriter
+    {
+    private:
+
+        std::vector<uint8_t> &m_buffer;
+        uint64_t m_pending; // bits not yet in the buffer, aligned to the right
+        uint32_t m_pendingCount;
+
+    public:
+
+        BitWriter(std::vector<uint8_t> &buffer)
+            : m_buffer(buffer), m_pending(0), m_pendingCount(0) {}
+
+        void Write(uint64_t bits, uint32_t count);
+
+        void Flush();
+    };
+
+
+    /// <summary>
+    /// Reads the bits written by <see cref="BitWriter"/>, never past the end of the data.
+    /// </summary>
+    class BitReader
+    {
+    private:
+
+        const uint8_t *m_pos;
+        const uint8_t *m_end;
+        uint64_t m_pending;
+        uint32_t m_pendingCount;
+
+    public:
+
+        BitReader(const uint8_t *data, size_t size)
+            : m_pos(data), m_end(data + size), m_pending(0), m_pendingCount(0) {}
+
+        bool Read(uint32_t count, uint64_t &bits);
+
+        bool IsAtEnd() const;
+    };
+
+
+    /// <summary>
+    /// Compresses a series of samples in the fashion of Gorilla (the time series database by Facebook),
+    /// which exploits that the samples are taken at nearly regular intervals, and that the value of a
+    /// counter rarely changes much from one sample to the next: the time goes as the delta of the delta
+    /// to the previous sample (a single bit when the interval is kept), and each value goes XOR'ed with
+    /// the previous value of its counter, keeping only the meaningful bits (a single bit when unchanged).
+    /// The qualities take a single bit when unchanged as well. The samples are written row by row, each
+    /// counter keeping its own state, so they can be decoded one at a time by <see cref="GorillaDecoder"/>.
+    /// </summary>
+    class GorillaEncoder
+    {
+    private:
+
+        /// <summary>
+        /// The state of the series of a counter.
+        /// </summary>
+        struct Column
+        {
+            uint32_t lastBits;
+            uint32_t leadingZeros;
+            uint32_t trailingZeros;
+            uint8_t lastQuality;
+        };
+
+        BitWriter m_writer;
+        std::vector<Column> m_columns;
+        int64_t m_lastTime;
+        int64_t m_lastDelta;
+        bool m_isFirst;
+
+        void WriteTime(int64_t time);
+
+        void WriteValue(Column &column, uint32_t bits);
+
+    public:
+
+        GorillaEncoder(std::vector<uint8_t> &buffer, size_t counterCount);
+
+        void Append(int64_t time, const uint32_t *valueBits, const uint8_t *qualityCodes);
+
+        void Finish();
+    };
+
+
+    /// <summary>
+    /// Decodes, one sample at a time, the series compressed by <see cref="GorillaEncoder"/>.
+    /// </summary>
+    class GorillaDecoder
+    {
+    private:
+
+        struct Column
+        {
+            uint32_t lastBits;
+            uint32_t leadingZeros;
+            uint32_t meaningfulCount;
+            uint8_t lastQuality;
+        };
+
+        BitReader m_reader;
+        std::vector<Column> m_columns;
+        int64_t m_lastTime;
+        int64_t m_lastDelta;
+        bool m_isFirst;
+
+        bool ReadTime(int64_t &time);
+
+        bool ReadValue(Column &column, uint32_t &bits);
+
+    public:
+
+        GorillaDecoder(const uint8_t *data, size_t size, size_t counterCount);
+
+        bool Next(int64_t &time, uint32_t *valueBits, uint8_t *qualityCodes);
+
+        bool IsAtEnd() const;
+    };
+
+}// end of namespace application
+
+#endif // end of header guard
@@ -0,0 +1,100 @@
+#include "stdafx.h"
+#include "HmacSha256.h"
+#include <3FD\callstacktracer.h>
+#include <3FD\exceptions.h>
+#include <sstream>
+
+namespace application
+{
+    using namespace _3fd::core;
+
+
+    // Throws an exception for a failed call of CNG
+    static void ThrowCngError(const char *message, NTSTATUS status, const char *funcName)
+    {
+        std::ostringstream oss;
+        oss << message << " - " << funcName << " returned NTSTATUS 0x" << std::hex << static_cast<uint32_t> (status);
+        throw AppException<std::runtime_error>(oss.str());
+    }
+
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="HmacSha256"/> class.
+    /// </summary>
+    HmacSha256::HmacSha256()
+        : m_algorithm(nullptr)
+    {
+        CALL_STACK_TRACE;
+
+        auto status = BCryptOpenAlgorithmProvider(&m_algorithm,
+                                                  BCRYPT_SHA256_ALGORITHM,
+                                                  nullptr,
+                                                  BCRYPT_ALG_HANDLE_HMAC_FLAG);
+        if (!BCRYPT_SUCCESS(status))
+            ThrowCngError("Failed to open provider of HMAC-SHA256", status, "BCryptOpenAlgorithmProvider");
+    }
+
+
+    /// <summary>
+    /// Finalizes an instance of the <see cref="HmacSha256"/> class.
+    /// </summary>
+    HmacSha256::~HmacSha256()
+    {
+        BCryptCloseAlgorithmProvider(m_algorithm, 0);
+    }
+
+
+    /// <summary>
+    /// Computes the MAC of a message.
+    /// </summary>
+    /// <param name="key">The secret key.</param>
+    /// <param name="data">The message.</param>
+    /// <param name="size">The size of the message.</param>
+    /// <param name="mac">Where to save the MAC, which takes <see cref="macSize"/> bytes.</param>
+    void HmacSha256::Compute(const std::string &key, const uint8_t *data, size_t size, uint8_t *mac) const
+    {
+        CALL_STACK_TRACE;
+
+        BCRYPT_HASH_HANDLE hash;
+
+        // the hash object is allocated by CNG:
+        auto status = BCryptCreateHash(m_algorithm, &hash, nullptr, 0,
+                                       reinterpret_cast<PUCHAR> (const_cast<char *> (key.data())),
+                                       static_cast<ULONG> (key.size()),
+                                       0);
+        if (!BCRYPT_SUCCESS(status))
+            ThrowCngError("Failed to create HMAC-SHA256", status, "BCryptCreateHash");
+
+        status = BCryptHashData(hash, const_cast<PUCHAR> (data), static_cast<ULONG> (size), 0);
+
+        if (BCRYPT_SUCCESS(status))
+            status = BCryptFinishHash(hash, mac, static_cast<ULONG> (macSize), 0);
+
+        BCryptDestroyHash(hash);
+
+        if (!BCRYPT_SUCCESS(status))
+            ThrowCngError("Failed to compute HMAC-SHA256", status, "BCryptHashData/BCryptFinishHash");
+    }
+
+
+    /// <summary>
+    /// Verifies the MAC of a message, in time that does not depend on where they differ.
+    /// </summary>
+    /// <param name="key">The secret key.</param>
+    /// <param name="data">The message.</param>
+    /// <param name="size">The size of the message.</param>
+    /// <param name="mac">The MAC to verify, which takes <see cref="macSize"/> bytes.</param>
+    /// <returns>Whether the MAC is the one of the message with the key.</returns>
+    bool HmacSha256::Verify(const std::string &key, const uint8_t *data, size_t size, const uint8_t *mac) const
+    {
+        uint8_t expected[macSize];
+        Compute(key, data, size, expected);
+
+        uint8_t difference(0);
+        for (size_t idx = 0; idx < macSize; ++idx)
+            difference |= expected[idx] ^ mac[idx];
+
+        return difference == 0;
+    }
+
+}// end of namespace application
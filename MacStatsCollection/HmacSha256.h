@@ -0,0 +1,43 @@
+#ifndef __HmacSha256_h__ // header guard
+#define __HmacSha256_h__
+
+#include <Windows.h>
+#include <bcrypt.h>
+#include <cstdint>
+#include <string>
+
+namespace application
+{
+    /// <summary>
+    /// Computes and verifies message authentication codes with HMAC-SHA256 (by CNG),
+    /// so a machine can prove it knows its key without ever sending it. The provider of
+    /// the algorithm is opened once, and can be used by several threads at a time.
+    /// </summary>
+    /// <seealso cref="notcopiable" />
+    class HmacSha256
+    {
+    private:
+
+        BCRYPT_ALG_HANDLE m_algorithm;
+
+    public:
+
+        /// <summary>
+        /// The size of the MAC, in bytes.
+        /// </summary>
+        static const size_t macSize = 32;
+
+        HmacSha256();
+
+        HmacSha256(const HmacSha256 &) = delete;
+
+        ~HmacSha256();
+
+        void Compute(const std::string &key, const uint8_t *data, size_t size, uint8_t *mac) const;
+
+        bool Verify(const std::string &key, const uint8_t *data, size_t size, const uint8_t *mac) const;
+    };
+
+}// end of namespace application
+
+#endif // end of header guard
@@ -1,8 +1,10 @@
 #include "stdafx.h"
 #include "MSDStorageWriter.h"
+#include "StatsPackagePool.h"
 #include <3FD\callstacktracer.h>
 #include <3FD\exceptions.h>
 #include <3FD\logger.h>
+#include <algorithm>
 
 namespace Poco {
 namespace Data {
@@ -18,15 +20,16 @@ namespace Data {
     {
     public:
 
-        static size_t size() { return 6; }
+        static size_t size() { return 7; }
 
         static void bind(size_t pos, const RowStat<ValType> &obj, AbstractBinder::Ptr pBinder, AbstractBinder::Direction dir)
         {
             poco_assert_dbg(!pBinder.isNull());
 
             TypeHandler<int16_t>::bind(pos++, obj.batchId, pBinder, dir);
-            TypeHandler<std::wstring>::bind(pos++, obj.macName, pBinder, dir);
-            TypeHandler<std::wstring>::bind(pos++, obj.statName, pBinder, dir);
+            TypeHandler<std::wstring>::bind(pos++, obj.macName.GetName(), pBinder, dir);
+            TypeHandler<int16_t>::bind(pos++, obj.statId, pBinder, dir);
+            TypeHandler<std::wstring>::bind(pos++, obj.statName.GetName(), pBinder, dir);
             TypeHandler<int64_t>::bind(pos++, obj.instant, pBinder, dir);
             TypeHandler<ValType>::bind(pos++, obj.statVal, pBinder, dir);
             TypeHandler<int8_t>::bind(pos++, obj.quality, pBinder, dir);
@@ -37,8 +40,9 @@ namespace Data {
             poco_assert_dbg(!pPrepare.isNull());
 
             TypeHandler<int16_t>::prepare(pos++, obj.batchId, pPrepare);
-            TypeHandler<std::wstring>::prepare(pos++, obj.macName, pPrepare);
-            TypeHandler<std::wstring>::prepare(pos++, obj.statName, pPrepare);
+            TypeHandler<std::wstring>::prepare(pos++, obj.macName.GetName(), pPrepare);
+            TypeHandler<int16_t>::prepare(pos++, obj.statId, pPrepare);
+            TypeHandler<std::wstring>::prepare(pos++, obj.statName.GetName(), pPrepare);
             TypeHandler<int64_t>::prepare(pos++, obj.instant, pPrepare);
             TypeHandler<ValType>::prepare(pos++, obj.statVal, pPrepare);
             TypeHandler<int8_t>::prepare(pos++, obj.quality, pPrepare);
@@ -48,22 +52,24 @@ namespace Data {
         {
             poco_assert_dbg(!pExt.isNull());
 
-            int16_t batchId;
+            int16_t batchId, statId;
             std::wstring macName, statName;
             int64_t instant;
             ValType statVal;
             int8_t quality;
 
             TypeHandler<int16_t>::extract(pos++, batchId, defVal.batchId, pExt);
-            TypeHandler<std::wstring>::extract(pos++, macName, defVal.macName, pExt);
-            TypeHandler<std::wstring>::extract(pos++, statName, defVal.statName, pExt);
+            TypeHandler<std::wstring>::extract(pos++, macName, defVal.macName.GetName(), pExt);
+            TypeHandler<int16_t>::extract(pos++, statId, defVal.statId, pExt);
+            TypeHandler<std::wstring>::extract(pos++, statName, defVal.statName.GetName(), pExt);
             TypeHandler<int64_t>::extract(pos++, instant, defVal.instant, pExt);
             TypeHandler<ValType>::extract(pos++, statVal, defVal.statVal, pExt);
             TypeHandler<int8_t>::extract(pos++, quality, defVal.quality, pExt);
 
             obj.batchId = batchId;
-            obj.macName = std::move(macName);
-            obj.statName = std::move(statName);
+            obj.macName = macName;
+            obj.statId = statId;
+            obj.statName = statName;
             obj.instant = instant;
             obj.statVal = statVal;
             obj.quality = quality;
@@ -78,6 +84,62 @@ namespace Data {
         TypeHandler &operator=(const TypeHandler &) {}
     };
 
+
+    /// <summary>
+    /// A type handler allows Poco::Data to attempt
+    /// bulk operations on rows of machine samples.
+    /// </summary>
+    template <>
+    class TypeHandler<RowMachineSample>
+    {
+    public:
+
+        static size_t size() { return 3; }
+
+        static void bind(size_t pos, const RowMachineSample &obj, AbstractBinder::Ptr pBinder, AbstractBinder::Direction dir)
+        {
+            poco_assert_dbg(!pBinder.isNull());
+
+            TypeHandler<int16_t>::bind(pos++, obj.batchId, pBinder, dir);
+            TypeHandler<std::wstring>::bind(pos++, obj.macName.GetName(), pBinder, dir);
+            TypeHandler<int64_t>::bind(pos++, obj.instant, pBinder, dir);
+        }
+
+        static void prepare(size_t pos, RowMachineSample &obj, AbstractPreparator::Ptr pPrepare)
+        {
+            poco_assert_dbg(!pPrepare.isNull());
+
+            TypeHandler<int16_t>::prepare(pos++, obj.batchId, pPrepare);
+            TypeHandler<std::wstring>::prepare(pos++, obj.macName.GetName(), pPrepare);
+            TypeHandler<int64_t>::prepare(pos++, obj.instant, pPrepare);
+        }
+
+        static void extract(size_t pos, RowMachineSample &obj, const RowMachineSample &defVal, AbstractExtractor::Ptr pExt)
+        {
+            poco_assert_dbg(!pExt.isNull());
+
+            int16_t batchId;
+            std::wstring macName;
+            int64_t instant;
+
+            TypeHandler<int16_t>::extract(pos++, batchId, defVal.batchId, pExt);
+            TypeHandler<std::wstring>::extract(pos++, macName, defVal.macName.GetName(), pExt);
+            TypeHandler<int64_t>::extract(pos++, instant, defVal.instant, pExt);
+
+            obj.batchId = batchId;
+            obj.macName = macName;
+            obj.instant = instant;
+        }
+
+    private:
+
+        TypeHandler() {}
+        ~TypeHandler() {}
+
+        TypeHandler(const TypeHandler &) {}
+        TypeHandler &operator=(const TypeHandler &) {}
+    };
+
 }// end of namespace Data
 }// end of namespace Poco
 
@@ -91,9 +153,12 @@ namespace application
     /// Initializes a new instance of the <see cref="MSDStorageWriter"/> class.
     /// </summary>
     /// <param name="connString">The backend connection string.</param>
-    MSDStorageWriter::MSDStorageWriter(const string &connString)
+    /// <param name="packagesPerCommit">How many packages at most go in a single transaction.</param>
+    MSDStorageWriter::MSDStorageWriter(const string &connString, size_t packagesPerCommit)
     try :
         m_dbSession("ODBC", connString)
+        , m_packagesPerCommit((std::max)(packagesPerCommit, static_cast<size_t> (1)))
+        , m_pipeline([this](BindBuffers &buffers) { Commit(buffers); })
     {
         CALL_STACK_TRACE;
 
@@ -132,68 +197,78 @@ namespace application
     }
 
 
-    /// <summary>
-    /// Gathers several tasks of database writing carrying packages
-    /// of "machine stats" samples, combines them in a few batches
-    /// then bulk insert them into database.
-    /// </summary>
-    /// <param name="tasks">The database writing tasks.</param>
-    void MSDStorageWriter::WriteStats(std::vector<std::unique_ptr<StorageWriteTask>> &tasks)
+    // Converts some of the tasks into rows bound to the queries, in a set of buffers (copying only the handles of the names)
+    void MSDStorageWriter::Convert(const std::vector<StorageWriteTask> &tasks, size_t first, size_t end, BindBuffers &buffers)
     {
-        if (tasks.empty())
-            return;
+        buffers.rowsInt32.clear();
+        buffers.rowsFloat32.clear();
+        buffers.rowsSamples.clear();
 
-        CALL_STACK_TRACE;
+        buffers.batchIdInt32 = GenerateBatchId();
+        buffers.batchIdFloat32 = GenerateBatchId();
+        buffers.batchIdSamples = GenerateBatchId();
 
-        try
+        for (size_t idx = first; idx < end; ++idx)
         {
-            if (!m_dbSession.isConnected())
-                m_dbSession.reconnect();
+            auto &task = tasks[idx];
 
-            m_rowsInt32DataBind.clear();
-            m_rowsFloat32DataBind.clear();
+            /* Records the instant of the sample, even when the client omitted all
+            stats, because their values did not change beyond the deadband: */
+            buffers.rowsSamples.emplace_back();
+            auto &sampleRow = buffers.rowsSamples.back();
 
-            auto batchIdInt32 = GenerateBatchId();
-            auto batchIdFloat32 = GenerateBatchId();
-            
-            // Combine the data of all tasks in a single batch:
-            for (auto &task : tasks)
+            sampleRow.batchId = buffers.batchIdSamples;
+            sampleRow.instant = task.timeSinceEpochInMillisecs;
+            sampleRow.macName = task.machine;
+
+            // Prepares the rows with samples float32 for insertion:
+            for (auto &sample : task.statSamplesFloat32)
             {
-                // Prepares the rows with samples float32 for insertion:
-                for (auto &sample : task->statSamplesFloat32)
-                {
-                    m_rowsFloat32DataBind.emplace_back();
-                    auto &row = m_rowsFloat32DataBind.back();
-                    
-                    row.batchId = batchIdFloat32;
-                    row.instant = task->timeSinceEpochInMillisecs;
-                    row.macName = task->machine;
-                    row.statName = std::move(sample.statName);
-                    row.statVal = sample.value;
-                    row.quality = static_cast<int8_t> (sample.quality);
-                }
-
-                // Prepares the rows with samples int32 for insertion:
-                for (auto &sample : task->statSamplesInt32)
-                {
-                    m_rowsInt32DataBind.emplace_back();
-                    auto &row = m_rowsInt32DataBind.back();
-
-                    row.batchId = batchIdInt32;
-                    row.instant = task->timeSinceEpochInMillisecs;
-                    row.macName = task->machine;
-                    row.statName = std::move(sample.statName);
-                    row.statVal = sample.value;
-                    row.quality = static_cast<int8_t> (sample.quality);
-                }
+                buffers.rowsFloat32.emplace_back();
+                auto &row = buffers.rowsFloat32.back();
+
+                row.batchId = buffers.batchIdFloat32;
+                row.instant = task.timeSinceEpochInMillisecs;
+                row.macName = task.machine;
+                row.statId = sample.statId;
+                row.statName = sample.statName;
+                row.statVal = sample.value;
+                row.quality = static_cast<int8_t> (sample.quality);
             }
 
-            tasks.clear(); // release some memory
+            // Prepares the rows with samples int32 for insertion:
+            for (auto &sample : task.statSamplesInt32)
+            {
+                buffers.rowsInt32.emplace_back();
+                auto &row = buffers.rowsInt32.back();
+
+                row.batchId = buffers.batchIdInt32;
+                row.instant = task.timeSinceEpochInMillisecs;
+                row.macName = task.machine;
+                row.statId = sample.statId;
+                row.statName = sample.statName;
+                row.statVal = sample.value;
+                row.quality = static_cast<int8_t> (sample.quality);
+            }
+        }
+    }
+
+
+    // Inserts the rows of a set of buffers into database, in a single transaction (runs in the commit thread)
+    void MSDStorageWriter::Commit(BindBuffers &buffers)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            if (!m_dbSession.isConnected())
+                m_dbSession.reconnect();
 
             /* The tables actually holding historical data belong to a normalized data model, where
             foreign keys refer to the machine and stats names in other tables. That collaborates to
             more efficient use of storage, but then insertion implies in previous conversion of names
-            to ID's, which is done more efficiently in the database side via stored procedures.
+            to ID's, which is done more efficiently in the database side via stored procedures (unless
+            the stats came with the ID's already, which the client gets when it opens a session).
             Because ODBC implementation on POCO cannot reliably/efficiently pass parameters to issue
             massive calls to stored procedures (that would lead to several isolated calls leading to a
             growing overhead of data round-trips), the strategy adopted here is to attempt bulk-insertion
@@ -206,23 +281,40 @@ namespace application
             // begin transaction
             m_dbSession.begin();
 
-            m_dbSession << R"(
-	            insert into StagingStatsValInt32 (batchId, macName, statName, instant, statVal, quality)
-	                values (?, ?, ?, ?, ?, ?);
-                )"
-                , use(m_rowsInt32DataBind)
-                , now;
+            // the client omits stats within the deadband, so a batch might lack some type of them:
+
+            if (!buffers.rowsInt32.empty())
+            {
+                m_dbSession << R"(
+	                insert into StagingStatsValInt32 (batchId, macName, statId, statName, instant, statVal, quality)
+	                    values (?, ?, ?, ?, ?, ?, ?);
+                    )"
+                    , use(buffers.rowsInt32)
+                    , now;
+
+                m_dbSession << "exec InsertIntoStatsInt32Proc %hd;", buffers.batchIdInt32, now;
+            }
+
+            if (!buffers.rowsFloat32.empty())
+            {
+                m_dbSession << R"(
+	                insert into StagingStatsValFloat32 (batchId, macName, statId, statName, instant, statVal, quality)
+	                    values (?, ?, ?, ?, ?, ?, ?);
+                    )"
+                    , use(buffers.rowsFloat32)
+                    , now;
+
+                m_dbSession << "exec InsertIntoStatsFloat32Proc %hd;", buffers.batchIdFloat32, now;
+            }
 
             m_dbSession << R"(
-	            insert into StagingStatsValFloat32 (batchId, macName, statName, instant, statVal, quality)
-	                values (?, ?, ?, ?, ?, ?);
+	            insert into StagingMachineSample (batchId, macName, instant)
+	                values (?, ?, ?);
                 )"
-                , use(m_rowsFloat32DataBind)
+                , use(buffers.rowsSamples)
                 , now;
 
-            m_dbSession << "exec InsertIntoStatsFloat32Proc %hd;", batchIdFloat32, now;
-
-            m_dbSession << "exec InsertIntoStatsInt32Proc %hd;", batchIdInt32, now;
+            m_dbSession << "exec InsertIntoMachineSampleProc %hd;", buffers.batchIdSamples, now;
 
             // commit transaction
             m_dbSession.commit();
@@ -263,4 +355,71 @@ namespace application
         }
     }
 
+
+    /// <summary>
+    /// Gathers several tasks of database writing carrying packages
+    /// of "machine stats" samples, combines them in a few batches
+    /// then bulk insert them into database. When there are more tasks
+    /// than fit in a commit, they are split in several ones, and the
+    /// next one is converted while the previous is being committed.
+    /// The last one is still committed upon return, while the tasks of
+    /// the next call are converted.
+    /// </summary>
+    /// <param name="tasks">The database writing tasks.</param>
+    void MSDStorageWriter::WriteStats(std::vector<StorageWriteTask> &tasks)
+    {
+        CALL_STACK_TRACE;
+
+        if (tasks.empty())
+        {
+            Flush();
+            return;
+        }
+
+        try
+        {
+            /* Double buffering: while a set of buffers is committed by the commit thread,
+            the other set receives the next tasks (even those of the next call), so the CPU
+            work of the conversion overlaps with the wait for the database. */
+            for (size_t first = 0; first < tasks.size(); first += m_packagesPerCommit)
+            {
+                auto end = (std::min)(first + m_packagesPerCommit, tasks.size());
+                Convert(tasks, first, end, m_pipeline.GetNext());
+
+                // the previous commit must succeed before the next one starts:
+                m_pipeline.HandOver();
+            }
+
+            // the rows keep only the handles of the names, so the packages go back to the pool already:
+            StatsPackagePool::GetInstance().Recycle(tasks);
+        }
+        catch (IAppException &)
+        {
+            // the commit in flight uses the buffers, so it must finish first:
+            m_pipeline.WaitForCommit();
+            throw; // just forward already prepared application exceptions
+        }
+        catch (std::exception &ex)
+        {
+            m_pipeline.WaitForCommit();
+
+            std::ostringstream oss;
+            oss << "Generic failure prevented writing samples into tables of historic data: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    /// <summary>
+    /// Waits until the stats of all calls of <see cref="WriteStats"/> are committed to database.
+    /// </summary>
+    void MSDStorageWriter::Flush()
+    {
+        CALL_STACK_TRACE;
+
+        auto error = m_pipeline.WaitForCommit();
+        if (error)
+            std::rethrow_exception(error);
+    }
+
 }// end of namespace application
@@ -3,6 +3,7 @@
 
 #include "Utilities.h"
 #include "CommonDataExchange.h"
+#include "CommitPipeline.h"
 #include <Poco/Data/Session.h>
 #include <vector>
 #include <string>
@@ -14,13 +15,15 @@ namespace application
 
 
     /// <summary>
-    /// Base class for rows to bulk-insert.
+    /// Base class for rows to bulk-insert. The names are interned,
+    /// so the strings bound to the query are those in the interner.
     /// </summary>
     struct RowStatBase
     {
         int64_t instant; // time in milliseconds past epoch (1970-01-01)
-        std::wstring macName;
-        std::wstring statName;
+        InternedName macName;
+        InternedName statName; // empty when the stat is identified by ID
+        int16_t statId; // zero when the stat is identified by name
         int16_t batchId;
         int8_t quality;
     };
@@ -37,29 +40,91 @@ namespace application
 
 
     /// <summary>
-    /// Commits to database the samples of machine stats.
+    /// Packages all data to insert into the table of instants
+    /// at which each machine has sent a sample.
+    /// </summary>
+    struct RowMachineSample
+    {
+        int64_t instant; // time in milliseconds past epoch (1970-01-01)
+        InternedName macName;
+        int16_t batchId;
+    };
+
+
+    /// <summary>
+    /// Interface for the writers of samples of machine stats into storage,
+    /// so they can be replaced by a stand-in.
+    /// </summary>
+    class IStatsWriter
+    {
+    public:
+
+        virtual ~IStatsWriter() {}
+
+        /// <summary>
+        /// Writes the stats of the tasks into storage. Upon return, the stats of the previous
+        /// calls are in storage, while those of this call might still be in a commit, which
+        /// goes on until the next call (or <see cref="Flush"/>), reporting there its failure.
+        /// A large batch might go in several transactions, so upon failure some of them might
+        /// be committed already. They are not undone: the caller retries the whole batch,
+        /// which is still in the write-ahead log (replayed upon the next start), and the
+        /// stored procedures in the database skip the samples already stored.
+        /// </summary>
+        /// <param name="tasks">The tasks, which are cleared upon success.</param>
+        virtual void WriteStats(std::vector<StorageWriteTask> &tasks) = 0;
+
+        /// <summary>
+        /// Waits until the stats of all calls of <see cref="WriteStats"/> are in storage.
+        /// </summary>
+        virtual void Flush() = 0;
+    };
+
+
+    /// <summary>
+    /// Commits to database the samples of machine stats. A large batch is split in several
+    /// transactions, each one handed over to the commit thread of the writer while the next
+    /// is converted, and the last one is still committed while the next call converts.
     /// </summary>
     /// <seealso cref="OdbcClient" />
+    /// <seealso cref="IStatsWriter" />
     /// <seealso cref="notcopiable" />
-    class MSDStorageWriter : OdbcClient
+    class MSDStorageWriter : OdbcClient, public IStatsWriter
     {
     private:
 
-        // Query placeholders will bind to the members of this object
-        std::vector<RowStat<float>> m_rowsFloat32DataBind;
+        /// <summary>
+        /// The rows of a batch, to which the query placeholders bind.
+        /// </summary>
+        struct BindBuffers
+        {
+            std::vector<RowStat<float>> rowsFloat32;
+            std::vector<RowStat<int>> rowsInt32;
+            std::vector<RowMachineSample> rowsSamples;
+            int16_t batchIdFloat32;
+            int16_t batchIdInt32;
+            int16_t batchIdSamples;
+        };
+
+        Poco::Data::Session m_dbSession; // used only by the commit thread, once constructed
+
+        size_t m_packagesPerCommit;
 
-        // Query placeholders will bind to the members of this object
-        std::vector<RowStat<int>> m_rowsInt32DataBind;
+        // one set is committed while the other receives the next batch (the last, so it stops first):
+        CommitPipeline<BindBuffers> m_pipeline;
 
-        Poco::Data::Session m_dbSession;
+        static void Convert(const std::vector<StorageWriteTask> &tasks, size_t first, size_t end, BindBuffers &buffers);
+
+        void Commit(BindBuffers &buffers);
 
     public:
 
-        MSDStorageWriter(const string &connString);
+        MSDStorageWriter(const string &connString, size_t packagesPerCommit = 1000);
 
         MSDStorageWriter(const MSDStorageWriter &) = delete;
 
-        void WriteStats(std::vector<std::unique_ptr<StorageWriteTask>> &tasks);
+        virtual void WriteStats(std::vector<StorageWriteTask> &tasks) override;
+
+        virtual void Flush() override;
     };
 
 }// end of namespace application
@@ -46,6 +46,28 @@ typedef struct _MacStatsCollection_wsdlLocalDefinitions
             WS_FIELD_DESCRIPTION statsInt32;
             WS_FIELD_DESCRIPTION* SendStatsSampleRequestFields [4]; 
         } SendStatsSampleRequestdescs; // end of SendStatsSampleRequest
+        struct  // StatsSample
+        {
+            WS_FIELD_DESCRIPTION time;
+            WS_ITEM_RANGE _statsFloat32RangeDesc;
+            WS_FIELD_DESCRIPTION statsFloat32;
+            WS_ITEM_RANGE _statsInt32RangeDesc;
+            WS_FIELD_DESCRIPTION statsInt32;
+            WS_FIELD_DESCRIPTION* StatsSampleFields [3]; 
+        } StatsSampledescs; // end of StatsSample
+        struct  // listOfStatsSamples
+        {
+            WS_ITEM_RANGE _sampleRangeDesc;
+            WS_FIELD_DESCRIPTION sample;
+            WS_FIELD_DESCRIPTION* listOfStatsSamplesFields [1]; 
+        } listOfStatsSamplesdescs; // end of listOfStatsSamples
+        struct  // SendStatsSamplesRequest
+        {
+            WS_FIELD_DESCRIPTION machine;
+            WS_ITEM_RANGE _samplesRangeDesc;
+            WS_FIELD_DESCRIPTION samples;
+            WS_FIELD_DESCRIPTION* SendStatsSamplesRequestFields [2]; 
+        } SendStatsSamplesRequestdescs; // end of SendStatsSamplesRequest
     } globalTypes;  // end of global types
     struct  // global elements
     {
@@ -61,6 +83,17 @@ typedef struct _MacStatsCollection_wsdlLocalDefinitions
             WS_FIELD_DESCRIPTION status;
             WS_FIELD_DESCRIPTION* _SendStatsSampleResponseFields [1]; 
         } _SendStatsSampleResponsedescs; // end of _SendStatsSampleResponse
+        struct  // _WrapSendStatsSamplesRequest
+        {
+            WS_FIELD_DESCRIPTION key;
+            WS_FIELD_DESCRIPTION payload;
+            WS_FIELD_DESCRIPTION* _WrapSendStatsSamplesRequestFields [2]; 
+        } _WrapSendStatsSamplesRequestdescs; // end of _WrapSendStatsSamplesRequest
+        struct  // _SendStatsSamplesResponse
+        {
+            WS_FIELD_DESCRIPTION status;
+            WS_FIELD_DESCRIPTION* _SendStatsSamplesResponseFields [1]; 
+        } _SendStatsSamplesResponsedescs; // end of _SendStatsSamplesResponse
         struct  // _CloseServiceResponse
         {
             WS_FIELD_DESCRIPTION status;
@@ -71,6 +104,8 @@ typedef struct _MacStatsCollection_wsdlLocalDefinitions
     {
         WS_MESSAGE_DESCRIPTION SendStatsSampleRequestMessage;
         WS_MESSAGE_DESCRIPTION SendStatsSampleResponseMessage;
+        WS_MESSAGE_DESCRIPTION SendStatsSamplesRequestMessage;
+        WS_MESSAGE_DESCRIPTION SendStatsSamplesResponseMessage;
         WS_MESSAGE_DESCRIPTION CloseServiceRequestMessage;
         WS_MESSAGE_DESCRIPTION CloseServiceResponseMessage;
     } messages;  // end of messages
@@ -83,12 +118,17 @@ typedef struct _MacStatsCollection_wsdlLocalDefinitions
                 WS_PARAMETER_DESCRIPTION params[3];
                 WS_OPERATION_DESCRIPTION MacStatsCollectionBinding_SendStatsSample;
             } MacStatsCollectionBinding_SendStatsSample;
+            struct  // MacStatsCollectionBinding_SendStatsSamples
+            {
+                WS_PARAMETER_DESCRIPTION params[3];
+                WS_OPERATION_DESCRIPTION MacStatsCollectionBinding_SendStatsSamples;
+            } MacStatsCollectionBinding_SendStatsSamples;
             struct  // MacStatsCollectionBinding_CloseService
             {
                 WS_PARAMETER_DESCRIPTION params[1];
                 WS_OPERATION_DESCRIPTION MacStatsCollectionBinding_CloseService;
             } MacStatsCollectionBinding_CloseService;
-            WS_OPERATION_DESCRIPTION* operations[2];
+            WS_OPERATION_DESCRIPTION* operations[3];
             WS_CONTRACT_DESCRIPTION contractDesc;
         } MacStatsCollectionBinding;
     } contracts;  // endof contracts 
@@ -128,6 +168,14 @@ typedef struct _MacStatsCollection_wsdlLocalDefinitions
             WS_XML_STRING _CloseServiceResponseTypeName;  // CloseServiceResponse
             WS_XML_STRING SendStatsSampleRequestMessageactionName;  // http://assignment.crossover.com/SendStatsSample
             WS_XML_STRING CloseServiceRequestMessageactionName;  // http://assignment.crossover.com/CloseService
+            WS_XML_STRING StatsSampleTypeName;  // StatsSample
+            WS_XML_STRING listOfStatsSamplesTypeName;  // listOfStatsSamples
+            WS_XML_STRING listOfStatsSamplessampleLocalName;  // sample
+            WS_XML_STRING SendStatsSamplesRequestTypeName;  // SendStatsSamplesRequest
+            WS_XML_STRING SendStatsSamplesRequestsamplesWrapperName;  // samples
+            WS_XML_STRING _WrapSendStatsSamplesRequestTypeName;  // WrapSendStatsSamplesRequest
+            WS_XML_STRING _SendStatsSamplesResponseTypeName;  // SendStatsSamplesResponse
+            WS_XML_STRING SendStatsSamplesRequestMessageactionName;  // http://assignment.crossover.com/SendStatsSamples
         } xmlStrings;  // end of XML string list
         WS_XML_DICTIONARY dict;
     } dictionary;  // end of XML dictionary
@@ -167,6 +215,39 @@ HRESULT CALLBACK MacStatsCollectionBinding_SendStatsSampleOperationStub(
 #pragma warning(pop)
 #endif
 
+typedef struct MacStatsCollectionBinding_SendStatsSamplesParamStruct 
+{
+    WCHAR** key;
+    SendStatsSamplesRequest** payload;
+    BOOL* status;
+} MacStatsCollectionBinding_SendStatsSamplesParamStruct;
+
+#if (_MSC_VER >=1400) 
+#pragma warning(push)
+#endif
+#pragma warning(disable: 4055) // conversion from data pointer to function pointer
+HRESULT CALLBACK MacStatsCollectionBinding_SendStatsSamplesOperationStub(
+    _In_ const WS_OPERATION_CONTEXT* _context,
+    _In_ void* _stackStruct,
+    _In_ const void* _callback,
+    _In_ const WS_ASYNC_CONTEXT* _asyncContext,
+    _In_ WS_ERROR* _error)
+{
+    MacStatsCollectionBinding_SendStatsSamplesCallback _operation = (MacStatsCollectionBinding_SendStatsSamplesCallback)_callback;
+    MacStatsCollectionBinding_SendStatsSamplesParamStruct *_stack =(MacStatsCollectionBinding_SendStatsSamplesParamStruct*)_stackStruct;
+    return _operation( 
+        _context,
+        *(_stack->key),
+        *(_stack->payload),
+        (_stack->status),
+        (WS_ASYNC_CONTEXT*)_asyncContext,
+        _error);
+}
+#pragma warning(default: 4055)  // conversion from data pointer to function pointer
+#if (_MSC_VER >=1400) 
+#pragma warning(pop)
+#endif
+
 typedef struct MacStatsCollectionBinding_CloseServiceParamStruct 
 {
     BOOL* status;
@@ -251,7 +332,7 @@ const static _MacStatsCollection_wsdlLocalDefinitions MacStatsCollection_wsdlLoc
                 0,
                 },   // end of struct description for listOfStatsFloat32_entry
             },    // listOfStatsFloat32_entry
-            {1, 4294967295},
+            {0, 4294967295},
             {  // field description for entry
             WS_REPEATING_ELEMENT_FIELD_MAPPING,
             0,
@@ -322,7 +403,7 @@ const static _MacStatsCollection_wsdlLocalDefinitions MacStatsCollection_wsdlLoc
                 0,
                 },   // end of struct description for listOfStatsInt32_entry
             },    // listOfStatsInt32_entry
-            {1, 4294967295},
+            {0, 4294967295},
             {  // field description for entry
             WS_REPEATING_ELEMENT_FIELD_MAPPING,
             0,
@@ -364,7 +445,7 @@ const static _MacStatsCollection_wsdlLocalDefinitions MacStatsCollection_wsdlLoc
             0,
             0xffffffff
             },    // end of field description for machine
-            {1, 4294967295},
+            {0, 4294967295},
             {  // field description for statsFloat32
             WS_REPEATING_ELEMENT_FIELD_MAPPING,
             (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.SendStatsSampleRequeststatsFloat32WrapperName, // statsFloat32
@@ -379,7 +460,7 @@ const static _MacStatsCollection_wsdlLocalDefinitions MacStatsCollection_wsdlLoc
             (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.listOfStatsFloat32TypeNamespace, // http://assignment.crossover.com/
             (WS_ITEM_RANGE*)&MacStatsCollection_wsdlLocalDefinitions.globalTypes.SendStatsSampleRequestdescs._statsFloat32RangeDesc,
             },    // end of field description for statsFloat32
-            {1, 4294967295},
+            {0, 4294967295},
             {  // field description for statsInt32
             WS_REPEATING_ELEMENT_FIELD_MAPPING,
             (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.SendStatsSampleRequeststatsInt32WrapperName, // statsInt32
@@ -401,6 +482,106 @@ const static _MacStatsCollection_wsdlLocalDefinitions MacStatsCollection_wsdlLoc
             (WS_FIELD_DESCRIPTION*)&MacStatsCollection_wsdlLocalDefinitions.globalTypes.SendStatsSampleRequestdescs.statsInt32,
             },
         },    // SendStatsSampleRequest
+        {  // StatsSample
+            {  // field description for time
+            WS_ELEMENT_FIELD_MAPPING,
+            (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.SendStatsSampleRequesttimeLocalName, // time
+            (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.listOfStatsFloat32TypeNamespace, // http://assignment.crossover.com/
+            WS_INT64_TYPE,
+            0,
+            WsOffsetOf(StatsSample, time),
+            0,
+            0,
+            0xffffffff
+            },    // end of field description for time
+            {0, 4294967295},
+            {  // field description for statsFloat32
+            WS_REPEATING_ELEMENT_FIELD_MAPPING,
+            (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.SendStatsSampleRequeststatsFloat32WrapperName, // statsFloat32
+            (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.listOfStatsFloat32TypeNamespace, // http://assignment.crossover.com/
+            WS_STRUCT_TYPE,
+            (void*)&MacStatsCollection_wsdlLocalDefinitions.globalTypes.listOfStatsFloat32descs.listOfStatsFloat32_entrydescs.structDesc,
+            WsOffsetOf(StatsSample, statsFloat32),
+            0,
+            0,
+            WsOffsetOf(StatsSample, statsFloat32Count),
+            (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.listOfStatsFloat32_entryTypeName, // entry
+            (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.listOfStatsFloat32TypeNamespace, // http://assignment.crossover.com/
+            (WS_ITEM_RANGE*)&MacStatsCollection_wsdlLocalDefinitions.globalTypes.StatsSampledescs._statsFloat32RangeDesc,
+            },    // end of field description for statsFloat32
+            {0, 4294967295},
+            {  // field description for statsInt32
+            WS_REPEATING_ELEMENT_FIELD_MAPPING,
+            (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.SendStatsSampleRequeststatsInt32WrapperName, // statsInt32
+            (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.listOfStatsFloat32TypeNamespace, // http://assignment.crossover.com/
+            WS_STRUCT_TYPE,
+            (void*)&MacStatsCollection_wsdlLocalDefinitions.globalTypes.listOfStatsInt32descs.listOfStatsInt32_entrydescs.structDesc,
+            WsOffsetOf(StatsSample, statsInt32),
+            0,
+            0,
+            WsOffsetOf(StatsSample, statsInt32Count),
+            (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.listOfStatsFloat32_entryTypeName, // entry
+            (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.listOfStatsFloat32TypeNamespace, // http://assignment.crossover.com/
+            (WS_ITEM_RANGE*)&MacStatsCollection_wsdlLocalDefinitions.globalTypes.StatsSampledescs._statsInt32RangeDesc,
+            },    // end of field description for statsInt32
+            {  // fields description for StatsSample
+            (WS_FIELD_DESCRIPTION*)&MacStatsCollection_wsdlLocalDefinitions.globalTypes.StatsSampledescs.time,
+            (WS_FIELD_DESCRIPTION*)&MacStatsCollection_wsdlLocalDefinitions.globalTypes.StatsSampledescs.statsFloat32,
+            (WS_FIELD_DESCRIPTION*)&MacStatsCollection_wsdlLocalDefinitions.globalTypes.StatsSampledescs.statsInt32,
+            },
+        },    // StatsSample
+        {  // listOfStatsSamples
+            {1, 4294967295},
+            {  // field description for sample
+            WS_REPEATING_ELEMENT_FIELD_MAPPING,
+            0,
+            0,
+            WS_STRUCT_TYPE,
+            (void*)&MacStatsCollection_wsdl.globalTypes.StatsSample,
+            WsOffsetOf(listOfStatsSamples, sample),
+            0,
+            0,
+            WsOffsetOf(listOfStatsSamples, sampleCount),
+            (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.listOfStatsSamplessampleLocalName, // sample
+            (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.listOfStatsFloat32TypeNamespace, // http://assignment.crossover.com/
+            (WS_ITEM_RANGE*)&MacStatsCollection_wsdlLocalDefinitions.globalTypes.listOfStatsSamplesdescs._sampleRangeDesc,
+            },    // end of field description for sample
+            {  // fields description for listOfStatsSamples
+            (WS_FIELD_DESCRIPTION*)&MacStatsCollection_wsdlLocalDefinitions.globalTypes.listOfStatsSamplesdescs.sample,
+            },
+        },    // listOfStatsSamples
+        {  // SendStatsSamplesRequest
+            {  // field description for machine
+            WS_ELEMENT_FIELD_MAPPING,
+            (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.SendStatsSampleRequestmachineLocalName, // machine
+            (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.listOfStatsFloat32TypeNamespace, // http://assignment.crossover.com/
+            WS_WSZ_TYPE,
+            0,
+            WsOffsetOf(SendStatsSamplesRequest, machine),
+            0,
+            0,
+            0xffffffff
+            },    // end of field description for machine
+            {1, 4294967295},
+            {  // field description for samples
+            WS_REPEATING_ELEMENT_FIELD_MAPPING,
+            (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.SendStatsSamplesRequestsamplesWrapperName, // samples
+            (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.listOfStatsFloat32TypeNamespace, // http://assignment.crossover.com/
+            WS_STRUCT_TYPE,
+            (void*)&MacStatsCollection_wsdl.globalTypes.StatsSample,
+            WsOffsetOf(SendStatsSamplesRequest, samples),
+            0,
+            0,
+            WsOffsetOf(SendStatsSamplesRequest, samplesCount),
+            (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.listOfStatsSamplessampleLocalName, // sample
+            (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.listOfStatsFloat32TypeNamespace, // http://assignment.crossover.com/
+            (WS_ITEM_RANGE*)&MacStatsCollection_wsdlLocalDefinitions.globalTypes.SendStatsSamplesRequestdescs._samplesRangeDesc,
+            },    // end of field description for samples
+            {  // fields description for SendStatsSamplesRequest
+            (WS_FIELD_DESCRIPTION*)&MacStatsCollection_wsdlLocalDefinitions.globalTypes.SendStatsSamplesRequestdescs.machine,
+            (WS_FIELD_DESCRIPTION*)&MacStatsCollection_wsdlLocalDefinitions.globalTypes.SendStatsSamplesRequestdescs.samples,
+            },
+        },    // SendStatsSamplesRequest
     }, // end of global types
     {  // global elements
         0,
@@ -448,6 +629,50 @@ const static _MacStatsCollection_wsdlLocalDefinitions MacStatsCollection_wsdlLoc
             (WS_FIELD_DESCRIPTION*)&MacStatsCollection_wsdlLocalDefinitions.globalElements._SendStatsSampleResponsedescs.status,
             },
         },    // _SendStatsSampleResponse
+        {  // _WrapSendStatsSamplesRequest
+            {  // field description for key
+            WS_ELEMENT_FIELD_MAPPING,
+            (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings._WrapSendStatsSampleRequestkeyLocalName, // key
+            (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.listOfStatsFloat32TypeNamespace, // http://assignment.crossover.com/
+            WS_WSZ_TYPE,
+            0,
+            WsOffsetOf(_WrapSendStatsSamplesRequest, key),
+            0,
+            0,
+            0xffffffff
+            },    // end of field description for key
+            {  // field description for payload
+            WS_ELEMENT_FIELD_MAPPING,
+            (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings._WrapSendStatsSampleRequestpayloadLocalName, // payload
+            (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.listOfStatsFloat32TypeNamespace, // http://assignment.crossover.com/
+            WS_STRUCT_TYPE,
+            (void*)&MacStatsCollection_wsdl.globalTypes.SendStatsSamplesRequest,
+            WsOffsetOf(_WrapSendStatsSamplesRequest, payload),
+            WS_FIELD_POINTER,
+            0,
+            0xffffffff
+            },    // end of field description for payload
+            {  // fields description for _WrapSendStatsSamplesRequest
+            (WS_FIELD_DESCRIPTION*)&MacStatsCollection_wsdlLocalDefinitions.globalElements._WrapSendStatsSamplesRequestdescs.key,
+            (WS_FIELD_DESCRIPTION*)&MacStatsCollection_wsdlLocalDefinitions.globalElements._WrapSendStatsSamplesRequestdescs.payload,
+            },
+        },    // _WrapSendStatsSamplesRequest
+        {  // _SendStatsSamplesResponse
+            {  // field description for status
+            WS_ELEMENT_FIELD_MAPPING,
+            (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings._SendStatsSampleResponsestatusLocalName, // status
+            (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.listOfStatsFloat32TypeNamespace, // http://assignment.crossover.com/
+            WS_BOOL_TYPE,
+            0,
+            WsOffsetOf(_SendStatsSamplesResponse, status),
+            0,
+            0,
+            0xffffffff
+            },    // end of field description for status
+            {  // fields description for _SendStatsSamplesResponse
+            (WS_FIELD_DESCRIPTION*)&MacStatsCollection_wsdlLocalDefinitions.globalElements._SendStatsSamplesResponsedescs.status,
+            },
+        },    // _SendStatsSamplesResponse
         {  // _CloseServiceResponse
             {  // field description for status
             WS_ELEMENT_FIELD_MAPPING,
@@ -474,6 +699,14 @@ const static _MacStatsCollection_wsdlLocalDefinitions MacStatsCollection_wsdlLoc
             0,
             (WS_ELEMENT_DESCRIPTION*)&MacStatsCollection_wsdl.globalElements.SendStatsSampleResponse, 
         },    // message description for SendStatsSampleResponseMessage
+        {  // message description for SendStatsSamplesRequestMessage
+            (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.SendStatsSamplesRequestMessageactionName, // http://assignment.crossover.com/SendStatsSamples
+            (WS_ELEMENT_DESCRIPTION*)&MacStatsCollection_wsdl.globalElements.WrapSendStatsSamplesRequest, 
+        },    // message description for SendStatsSamplesRequestMessage
+        {  // message description for SendStatsSamplesResponseMessage
+            0,
+            (WS_ELEMENT_DESCRIPTION*)&MacStatsCollection_wsdl.globalElements.SendStatsSamplesResponse, 
+        },    // message description for SendStatsSamplesResponseMessage
         {  // message description for CloseServiceRequestMessage
             (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.CloseServiceRequestMessageactionName, // http://assignment.crossover.com/CloseService
             (WS_ELEMENT_DESCRIPTION*)&MacStatsCollection_wsdl.globalElements.CloseServiceRequest, 
@@ -503,6 +736,24 @@ const static _MacStatsCollection_wsdlLocalDefinitions MacStatsCollection_wsdlLoc
                     WS_NON_RPC_LITERAL_OPERATION
                 }, //operation description for MacStatsCollectionBinding_SendStatsSample
             },  // MacStatsCollectionBinding_SendStatsSample
+            {  // MacStatsCollectionBinding_SendStatsSamples
+                {  // parameter descriptions for MacStatsCollectionBinding_SendStatsSamples
+                    {WS_PARAMETER_TYPE_NORMAL, (USHORT)0, (USHORT)-1},
+                    {WS_PARAMETER_TYPE_NORMAL, (USHORT)1, (USHORT)-1},
+                    {WS_PARAMETER_TYPE_NORMAL, (USHORT)-1, (USHORT)0},
+                },  // parameter descriptions for MacStatsCollectionBinding_SendStatsSamples
+                {  // operation description for MacStatsCollectionBinding_SendStatsSamples
+                    1,
+                    (WS_MESSAGE_DESCRIPTION*)&MacStatsCollection_wsdl.messages.SendStatsSamplesRequestMessage, 
+                    (WS_MESSAGE_DESCRIPTION*)&MacStatsCollection_wsdl.messages.SendStatsSamplesResponseMessage, 
+                    0,
+                    0,
+                    3,
+                    (WS_PARAMETER_DESCRIPTION*)MacStatsCollection_wsdlLocalDefinitions.contracts.MacStatsCollectionBinding.MacStatsCollectionBinding_SendStatsSamples.params,
+                    MacStatsCollectionBinding_SendStatsSamplesOperationStub,
+                    WS_NON_RPC_LITERAL_OPERATION
+                }, //operation description for MacStatsCollectionBinding_SendStatsSamples
+            },  // MacStatsCollectionBinding_SendStatsSamples
             {  // MacStatsCollectionBinding_CloseService
                 {  // parameter descriptions for MacStatsCollectionBinding_CloseService
                     {WS_PARAMETER_TYPE_NORMAL, (USHORT)-1, (USHORT)0},
@@ -521,10 +772,11 @@ const static _MacStatsCollection_wsdlLocalDefinitions MacStatsCollection_wsdlLoc
             },  // MacStatsCollectionBinding_CloseService
             {  // array of operations for MacStatsCollectionBinding
                 (WS_OPERATION_DESCRIPTION*)&MacStatsCollection_wsdlLocalDefinitions.contracts.MacStatsCollectionBinding.MacStatsCollectionBinding_SendStatsSample.MacStatsCollectionBinding_SendStatsSample,
+                (WS_OPERATION_DESCRIPTION*)&MacStatsCollection_wsdlLocalDefinitions.contracts.MacStatsCollectionBinding.MacStatsCollectionBinding_SendStatsSamples.MacStatsCollectionBinding_SendStatsSamples,
                 (WS_OPERATION_DESCRIPTION*)&MacStatsCollection_wsdlLocalDefinitions.contracts.MacStatsCollectionBinding.MacStatsCollectionBinding_CloseService.MacStatsCollectionBinding_CloseService,
             },  // array of operations for MacStatsCollectionBinding
             {  // contract description for MacStatsCollectionBinding
-            2,
+            3,
             (WS_OPERATION_DESCRIPTION**)MacStatsCollection_wsdlLocalDefinitions.contracts.MacStatsCollectionBinding.operations,
             },  // end of contract description for MacStatsCollectionBinding
         },  // MacStatsCollectionBinding
@@ -577,13 +829,21 @@ const static _MacStatsCollection_wsdlLocalDefinitions MacStatsCollection_wsdlLoc
             WS_XML_STRING_DICTIONARY_VALUE("CloseServiceResponse",&MacStatsCollection_wsdlLocalDefinitions.dictionary.dict, 19),
             WS_XML_STRING_DICTIONARY_VALUE("http://assignment.crossover.com/SendStatsSample",&MacStatsCollection_wsdlLocalDefinitions.dictionary.dict, 20),
             WS_XML_STRING_DICTIONARY_VALUE("http://assignment.crossover.com/CloseService",&MacStatsCollection_wsdlLocalDefinitions.dictionary.dict, 21),
+            WS_XML_STRING_DICTIONARY_VALUE("StatsSample",&MacStatsCollection_wsdlLocalDefinitions.dictionary.dict, 22),
+            WS_XML_STRING_DICTIONARY_VALUE("listOfStatsSamples",&MacStatsCollection_wsdlLocalDefinitions.dictionary.dict, 23),
+            WS_XML_STRING_DICTIONARY_VALUE("sample",&MacStatsCollection_wsdlLocalDefinitions.dictionary.dict, 24),
+            WS_XML_STRING_DICTIONARY_VALUE("SendStatsSamplesRequest",&MacStatsCollection_wsdlLocalDefinitions.dictionary.dict, 25),
+            WS_XML_STRING_DICTIONARY_VALUE("samples",&MacStatsCollection_wsdlLocalDefinitions.dictionary.dict, 26),
+            WS_XML_STRING_DICTIONARY_VALUE("WrapSendStatsSamplesRequest",&MacStatsCollection_wsdlLocalDefinitions.dictionary.dict, 27),
+            WS_XML_STRING_DICTIONARY_VALUE("SendStatsSamplesResponse",&MacStatsCollection_wsdlLocalDefinitions.dictionary.dict, 28),
+            WS_XML_STRING_DICTIONARY_VALUE("http://assignment.crossover.com/SendStatsSamples",&MacStatsCollection_wsdlLocalDefinitions.dictionary.dict, 29),
         },  // end of xmlStrings
         
         {  // MacStatsCollection_wsdldictionary
           // 0922d2a0-e9ae-415b-8898-e16dd9443ad8 
         { 0x0922d2a0, 0xe9ae, 0x415b, { 0x88, 0x98, 0xe1,0x6d, 0xd9, 0x44, 0x3a, 0xd8 } },
         (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings,
-        22,
+        30,
         TRUE,
         },
     },  //  end of dictionary
@@ -621,6 +881,32 @@ HRESULT WINAPI MacStatsCollectionBinding_SendStatsSample(
         _error);
 }
 
+// operation: MacStatsCollectionBinding_SendStatsSamples
+HRESULT WINAPI MacStatsCollectionBinding_SendStatsSamples(
+    _In_ WS_SERVICE_PROXY* _serviceProxy,
+    _In_z_ WCHAR* key, 
+    _In_ SendStatsSamplesRequest* payload, 
+    _Out_ BOOL* status, 
+    _In_ WS_HEAP* _heap,
+    _In_reads_opt_(_callPropertyCount) const WS_CALL_PROPERTY* _callProperties,
+    _In_ const ULONG _callPropertyCount,
+    _In_opt_ const WS_ASYNC_CONTEXT* _asyncContext,
+    _In_opt_ WS_ERROR* _error)
+{
+    void* _argList[3]; 
+    _argList[0] = &key;
+    _argList[1] = &payload;
+    _argList[2] = &status;
+    return WsCall(_serviceProxy,
+        (WS_OPERATION_DESCRIPTION*)&MacStatsCollection_wsdlLocalDefinitions.contracts.MacStatsCollectionBinding.MacStatsCollectionBinding_SendStatsSamples.MacStatsCollectionBinding_SendStatsSamples,
+        (const void **)&_argList,
+        _heap,
+        _callProperties,
+        _callPropertyCount,
+        _asyncContext,
+        _error);
+}
+
 // operation: MacStatsCollectionBinding_CloseService
 HRESULT WINAPI MacStatsCollectionBinding_CloseService(
     _In_ WS_SERVICE_PROXY* _serviceProxy,
@@ -682,6 +968,39 @@ const _MacStatsCollection_wsdl MacStatsCollection_wsdl =
         0,
         0,
         },   // end of struct description for SendStatsSampleRequest
+        {
+        sizeof(StatsSample),
+        __alignof(StatsSample),
+        (WS_FIELD_DESCRIPTION**)&MacStatsCollection_wsdlLocalDefinitions.globalTypes.StatsSampledescs.StatsSampleFields,
+        WsCountOf(MacStatsCollection_wsdlLocalDefinitions.globalTypes.StatsSampledescs.StatsSampleFields),
+        (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.StatsSampleTypeName, // StatsSample
+        (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.listOfStatsFloat32TypeNamespace, // http://assignment.crossover.com/
+        0,
+        0,
+        0,
+        },   // end of struct description for StatsSample
+        {
+        sizeof(listOfStatsSamples),
+        __alignof(listOfStatsSamples),
+        (WS_FIELD_DESCRIPTION**)&MacStatsCollection_wsdlLocalDefinitions.globalTypes.listOfStatsSamplesdescs.listOfStatsSamplesFields,
+        WsCountOf(MacStatsCollection_wsdlLocalDefinitions.globalTypes.listOfStatsSamplesdescs.listOfStatsSamplesFields),
+        (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.listOfStatsSamplesTypeName, // listOfStatsSamples
+        (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.listOfStatsFloat32TypeNamespace, // http://assignment.crossover.com/
+        0,
+        0,
+        0,
+        },   // end of struct description for listOfStatsSamples
+        {
+        sizeof(SendStatsSamplesRequest),
+        __alignof(SendStatsSamplesRequest),
+        (WS_FIELD_DESCRIPTION**)&MacStatsCollection_wsdlLocalDefinitions.globalTypes.SendStatsSamplesRequestdescs.SendStatsSamplesRequestFields,
+        WsCountOf(MacStatsCollection_wsdlLocalDefinitions.globalTypes.SendStatsSamplesRequestdescs.SendStatsSamplesRequestFields),
+        (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.SendStatsSamplesRequestTypeName, // SendStatsSamplesRequest
+        (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.listOfStatsFloat32TypeNamespace, // http://assignment.crossover.com/
+        0,
+        0,
+        0,
+        },   // end of struct description for SendStatsSamplesRequest
     },  // globalTypes
     {  // globalElements
         {
@@ -696,6 +1015,18 @@ const _MacStatsCollection_wsdl MacStatsCollection_wsdl =
             WS_STRUCT_TYPE,
             (void*)&MacStatsCollection_wsdl.externallyReferencedTypes.SendStatsSampleResponse,
         },
+        {
+            (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings._WrapSendStatsSamplesRequestTypeName, // WrapSendStatsSamplesRequest
+            (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.listOfStatsFloat32TypeNamespace, // http://assignment.crossover.com/
+            WS_STRUCT_TYPE,
+            (void*)&MacStatsCollection_wsdl.externallyReferencedTypes.WrapSendStatsSamplesRequest,
+        },
+        {
+            (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings._SendStatsSamplesResponseTypeName, // SendStatsSamplesResponse
+            (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.listOfStatsFloat32TypeNamespace, // http://assignment.crossover.com/
+            WS_STRUCT_TYPE,
+            (void*)&MacStatsCollection_wsdl.externallyReferencedTypes.SendStatsSamplesResponse,
+        },
         {
             (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings._CloseServiceRequestTypeName, // CloseServiceRequest
             (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.listOfStatsFloat32TypeNamespace, // http://assignment.crossover.com/
@@ -733,6 +1064,28 @@ const _MacStatsCollection_wsdl MacStatsCollection_wsdl =
         0,
         },   // end of struct description for _SendStatsSampleResponse
         {
+        sizeof(_WrapSendStatsSamplesRequest),
+        __alignof(_WrapSendStatsSamplesRequest),
+        (WS_FIELD_DESCRIPTION**)&MacStatsCollection_wsdlLocalDefinitions.globalElements._WrapSendStatsSamplesRequestdescs._WrapSendStatsSamplesRequestFields,
+        WsCountOf(MacStatsCollection_wsdlLocalDefinitions.globalElements._WrapSendStatsSamplesRequestdescs._WrapSendStatsSamplesRequestFields),
+        (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings._WrapSendStatsSamplesRequestTypeName, // WrapSendStatsSamplesRequest
+        (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.listOfStatsFloat32TypeNamespace, // http://assignment.crossover.com/
+        0,
+        0,
+        0,
+        },   // end of struct description for _WrapSendStatsSamplesRequest
+        {
+        sizeof(_SendStatsSamplesResponse),
+        __alignof(_SendStatsSamplesResponse),
+        (WS_FIELD_DESCRIPTION**)&MacStatsCollection_wsdlLocalDefinitions.globalElements._SendStatsSamplesResponsedescs._SendStatsSamplesResponseFields,
+        WsCountOf(MacStatsCollection_wsdlLocalDefinitions.globalElements._SendStatsSamplesResponsedescs._SendStatsSamplesResponseFields),
+        (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings._SendStatsSamplesResponseTypeName, // SendStatsSamplesResponse
+        (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.listOfStatsFloat32TypeNamespace, // http://assignment.crossover.com/
+        0,
+        0,
+        0,
+        },   // end of struct description for _SendStatsSamplesResponse
+        {
         0,
         1,
         0,
@@ -764,6 +1117,14 @@ const _MacStatsCollection_wsdl MacStatsCollection_wsdl =
             0,
             (WS_ELEMENT_DESCRIPTION*)&MacStatsCollection_wsdl.globalElements.SendStatsSampleResponse, 
         },    // message description for SendStatsSampleResponseMessage
+        {  // message description for SendStatsSamplesRequestMessage
+            (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.SendStatsSamplesRequestMessageactionName, // http://assignment.crossover.com/SendStatsSamples
+            (WS_ELEMENT_DESCRIPTION*)&MacStatsCollection_wsdl.globalElements.WrapSendStatsSamplesRequest, 
+        },    // message description for SendStatsSamplesRequestMessage
+        {  // message description for SendStatsSamplesResponseMessage
+            0,
+            (WS_ELEMENT_DESCRIPTION*)&MacStatsCollection_wsdl.globalElements.SendStatsSamplesResponse, 
+        },    // message description for SendStatsSamplesResponseMessage
         {  // message description for CloseServiceRequestMessage
             (WS_XML_STRING*)&MacStatsCollection_wsdlLocalDefinitions.dictionary.xmlStrings.CloseServiceRequestMessageactionName, // http://assignment.crossover.com/CloseService
             (WS_ELEMENT_DESCRIPTION*)&MacStatsCollection_wsdl.globalElements.CloseServiceRequest, 
@@ -775,7 +1136,7 @@ const _MacStatsCollection_wsdl MacStatsCollection_wsdl =
     },  // messages
     {  // contracts
         {  // MacStatsCollectionBinding
-            2,
+            3,
             (WS_OPERATION_DESCRIPTION**)MacStatsCollection_wsdlLocalDefinitions.contracts.MacStatsCollectionBinding.operations,
         },  // end of MacStatsCollectionBinding
     },  // contracts
@@ -150,6 +150,7 @@ extern "C" {
 // The following client functions were generated:
 
 //     MacStatsCollectionBinding_SendStatsSample
+//     MacStatsCollectionBinding_SendStatsSamples
 //     MacStatsCollectionBinding_CloseService
 
 // The following server function tables were generated:
@@ -161,8 +162,13 @@ extern "C" {
 //     struct listOfStatsFloat32;
 //     struct listOfStatsInt32;
 //     struct SendStatsSampleRequest;
+//     struct StatsSample;
+//     struct listOfStatsSamples;
+//     struct SendStatsSamplesRequest;
 //     struct _WrapSendStatsSampleRequest;
 //     struct _SendStatsSampleResponse;
+//     struct _WrapSendStatsSamplesRequest;
+//     struct _SendStatsSamplesResponse;
 //     struct _CloseServiceRequest;
 //     struct _CloseServiceResponse;
 
@@ -182,8 +188,8 @@ extern "C" {
 // typeDescription: MacStatsCollection_wsdl.globalTypes.listOfStatsFloat32
 typedef struct listOfStatsFloat32 
 {
-    _Field_range_(1, 4294967295) unsigned int entryCount;
-    _Field_size_(entryCount)struct listOfStatsFloat32_entry* entry; // 1..unbounded
+    _Field_range_(0, 4294967295) unsigned int entryCount;
+    _Field_size_(entryCount)struct listOfStatsFloat32_entry* entry; // 0..unbounded
 } listOfStatsFloat32;
 
 // typeDescription: n/a
@@ -197,8 +203,8 @@ typedef struct listOfStatsFloat32_entry
 // typeDescription: MacStatsCollection_wsdl.globalTypes.listOfStatsInt32
 typedef struct listOfStatsInt32 
 {
-    _Field_range_(1, 4294967295) unsigned int entryCount;
-    _Field_size_(entryCount)struct listOfStatsInt32_entry* entry; // 1..unbounded
+    _Field_range_(0, 4294967295) unsigned int entryCount;
+    _Field_size_(entryCount)struct listOfStatsInt32_entry* entry; // 0..unbounded
 } listOfStatsInt32;
 
 // typeDescription: n/a
@@ -214,12 +220,37 @@ typedef struct SendStatsSampleRequest
 {
     __int64 time;
     WCHAR* machine;
-    _Field_range_(1, 4294967295) unsigned int statsFloat32Count;
-    _Field_size_(statsFloat32Count)struct listOfStatsFloat32_entry* statsFloat32; // 1..unbounded
-    _Field_range_(1, 4294967295) unsigned int statsInt32Count;
-    _Field_size_(statsInt32Count)struct listOfStatsInt32_entry* statsInt32; // 1..unbounded
+    _Field_range_(0, 4294967295) unsigned int statsFloat32Count;
+    _Field_size_(statsFloat32Count)struct listOfStatsFloat32_entry* statsFloat32; // 0..unbounded
+    _Field_range_(0, 4294967295) unsigned int statsInt32Count;
+    _Field_size_(statsInt32Count)struct listOfStatsInt32_entry* statsInt32; // 0..unbounded
 } SendStatsSampleRequest;
 
+// typeDescription: MacStatsCollection_wsdl.globalTypes.StatsSample
+typedef struct StatsSample 
+{
+    __int64 time;
+    _Field_range_(0, 4294967295) unsigned int statsFloat32Count;
+    _Field_size_(statsFloat32Count)struct listOfStatsFloat32_entry* statsFloat32; // 0..unbounded
+    _Field_range_(0, 4294967295) unsigned int statsInt32Count;
+    _Field_size_(statsInt32Count)struct listOfStatsInt32_entry* statsInt32; // 0..unbounded
+} StatsSample;
+
+// typeDescription: MacStatsCollection_wsdl.globalTypes.listOfStatsSamples
+typedef struct listOfStatsSamples 
+{
+    _Field_range_(1, 4294967295) unsigned int sampleCount;
+    _Field_size_(sampleCount)struct StatsSample* sample; // 1..unbounded
+} listOfStatsSamples;
+
+// typeDescription: MacStatsCollection_wsdl.globalTypes.SendStatsSamplesRequest
+typedef struct SendStatsSamplesRequest 
+{
+    WCHAR* machine;
+    _Field_range_(1, 4294967295) unsigned int samplesCount;
+    _Field_size_(samplesCount)struct StatsSample* samples; // 1..unbounded
+} SendStatsSamplesRequest;
+
 // typeDescription: n/a
 typedef struct _WrapSendStatsSampleRequest 
 {
@@ -233,6 +264,19 @@ typedef struct _SendStatsSampleResponse
     BOOL status;
 } _SendStatsSampleResponse;
 
+// typeDescription: n/a
+typedef struct _WrapSendStatsSamplesRequest 
+{
+    WCHAR* key;
+    struct SendStatsSamplesRequest* payload;
+} _WrapSendStatsSamplesRequest;
+
+// typeDescription: n/a
+typedef struct _SendStatsSamplesResponse 
+{
+    BOOL status;
+} _SendStatsSamplesResponse;
+
 typedef struct _CloseServiceRequest _CloseServiceRequest;
 
 // typeDescription: n/a
@@ -285,6 +329,18 @@ HRESULT WINAPI MacStatsCollectionBinding_SendStatsSample(
     _In_opt_ const WS_ASYNC_CONTEXT* _asyncContext,
     _In_opt_ WS_ERROR* _error);
 
+// operation: MacStatsCollectionBinding_SendStatsSamples
+HRESULT WINAPI MacStatsCollectionBinding_SendStatsSamples(
+    _In_ WS_SERVICE_PROXY* _serviceProxy,
+    _In_z_ WCHAR* key, 
+    _In_ SendStatsSamplesRequest* payload, 
+    _Out_ BOOL* status, 
+    _In_ WS_HEAP* _heap,
+    _In_reads_opt_(_callPropertyCount) const WS_CALL_PROPERTY* _callProperties,
+    _In_ const ULONG _callPropertyCount,
+    _In_opt_ const WS_ASYNC_CONTEXT* _asyncContext,
+    _In_opt_ WS_ERROR* _error);
+
 // operation: MacStatsCollectionBinding_CloseService
 HRESULT WINAPI MacStatsCollectionBinding_CloseService(
     _In_ WS_SERVICE_PROXY* _serviceProxy,
@@ -307,6 +363,14 @@ typedef HRESULT (CALLBACK* MacStatsCollectionBinding_SendStatsSampleCallback) (
     _In_ const WS_ASYNC_CONTEXT* _asyncContext,
     _In_ WS_ERROR* _error);
 
+typedef HRESULT (CALLBACK* MacStatsCollectionBinding_SendStatsSamplesCallback) (
+    _In_ const WS_OPERATION_CONTEXT* _context,
+    _In_z_ WCHAR* key, 
+    _In_ SendStatsSamplesRequest* payload, 
+    _Out_ BOOL* status, 
+    _In_ const WS_ASYNC_CONTEXT* _asyncContext,
+    _In_ WS_ERROR* _error);
+
 typedef HRESULT (CALLBACK* MacStatsCollectionBinding_CloseServiceCallback) (
     _In_ const WS_OPERATION_CONTEXT* _context,
     _Out_ BOOL* status, 
@@ -317,6 +381,7 @@ typedef HRESULT (CALLBACK* MacStatsCollectionBinding_CloseServiceCallback) (
 typedef struct MacStatsCollectionBindingFunctionTable 
 {
     MacStatsCollectionBinding_SendStatsSampleCallback MacStatsCollectionBinding_SendStatsSample;
+    MacStatsCollectionBinding_SendStatsSamplesCallback MacStatsCollectionBinding_SendStatsSamples;
     MacStatsCollectionBinding_CloseServiceCallback MacStatsCollectionBinding_CloseService;
 } MacStatsCollectionBindingFunctionTable;
 
@@ -346,6 +411,24 @@ typedef struct _MacStatsCollection_wsdl
         // typeDescription: MacStatsCollection_wsdl.globalTypes.SendStatsSampleRequest
         WS_STRUCT_DESCRIPTION SendStatsSampleRequest;
         
+        // xml type: StatsSample ("http://assignment.crossover.com/")
+        // c type: StatsSample
+        // WS_TYPE: WS_STRUCT_TYPE
+        // typeDescription: MacStatsCollection_wsdl.globalTypes.StatsSample
+        WS_STRUCT_DESCRIPTION StatsSample;
+        
+        // xml type: listOfStatsSamples ("http://assignment.crossover.com/")
+        // c type: listOfStatsSamples
+        // WS_TYPE: WS_STRUCT_TYPE
+        // typeDescription: MacStatsCollection_wsdl.globalTypes.listOfStatsSamples
+        WS_STRUCT_DESCRIPTION listOfStatsSamples;
+        
+        // xml type: SendStatsSamplesRequest ("http://assignment.crossover.com/")
+        // c type: SendStatsSamplesRequest
+        // WS_TYPE: WS_STRUCT_TYPE
+        // typeDescription: MacStatsCollection_wsdl.globalTypes.SendStatsSamplesRequest
+        WS_STRUCT_DESCRIPTION SendStatsSamplesRequest;
+        
     } globalTypes;
     struct // globalElements
     {
@@ -359,6 +442,16 @@ typedef struct _MacStatsCollection_wsdl
         // elementDescription: MacStatsCollection_wsdl.globalElements.SendStatsSampleResponse
         WS_ELEMENT_DESCRIPTION SendStatsSampleResponse;
         
+        // xml element: WrapSendStatsSamplesRequest ("http://assignment.crossover.com/")
+        // c type: _WrapSendStatsSamplesRequest
+        // elementDescription: MacStatsCollection_wsdl.globalElements.WrapSendStatsSamplesRequest
+        WS_ELEMENT_DESCRIPTION WrapSendStatsSamplesRequest;
+        
+        // xml element: SendStatsSamplesResponse ("http://assignment.crossover.com/")
+        // c type: _SendStatsSamplesResponse
+        // elementDescription: MacStatsCollection_wsdl.globalElements.SendStatsSamplesResponse
+        WS_ELEMENT_DESCRIPTION SendStatsSamplesResponse;
+        
         // xml element: CloseServiceRequest ("http://assignment.crossover.com/")
         // c type: _CloseServiceRequest
         // elementDescription: MacStatsCollection_wsdl.globalElements.CloseServiceRequest
@@ -374,6 +467,8 @@ typedef struct _MacStatsCollection_wsdl
     {
         WS_STRUCT_DESCRIPTION WrapSendStatsSampleRequest;
         WS_STRUCT_DESCRIPTION SendStatsSampleResponse;
+        WS_STRUCT_DESCRIPTION WrapSendStatsSamplesRequest;
+        WS_STRUCT_DESCRIPTION SendStatsSamplesResponse;
         WS_STRUCT_DESCRIPTION CloseServiceRequest;
         WS_STRUCT_DESCRIPTION CloseServiceResponse;
     } externallyReferencedTypes;
@@ -391,6 +486,18 @@ typedef struct _MacStatsCollection_wsdl
         // messageDescription: MacStatsCollection_wsdl.messages.SendStatsSampleResponseMessage
         WS_MESSAGE_DESCRIPTION SendStatsSampleResponseMessage;
         
+        // message: SendStatsSamplesRequestMessage
+        // c type: _WrapSendStatsSamplesRequest
+        // action: "http://assignment.crossover.com/SendStatsSamples"
+        // messageDescription: MacStatsCollection_wsdl.messages.SendStatsSamplesRequestMessage
+        WS_MESSAGE_DESCRIPTION SendStatsSamplesRequestMessage;
+        
+        // message: SendStatsSamplesResponseMessage
+        // c type: _SendStatsSamplesResponse
+        // action: ""
+        // messageDescription: MacStatsCollection_wsdl.messages.SendStatsSamplesResponseMessage
+        WS_MESSAGE_DESCRIPTION SendStatsSamplesResponseMessage;
+        
         // message: CloseServiceRequestMessage
         // c type: _CloseServiceRequest
         // action: "http://assignment.crossover.com/CloseService"
@@ -411,6 +518,9 @@ typedef struct _MacStatsCollection_wsdl
         // operation: MacStatsCollectionBinding_SendStatsSample
         //     input message: SendStatsSampleRequestMessage
         //     output message: SendStatsSampleResponseMessage
+        // operation: MacStatsCollectionBinding_SendStatsSamples
+        //     input message: SendStatsSamplesRequestMessage
+        //     output message: SendStatsSamplesResponseMessage
         // operation: MacStatsCollectionBinding_CloseService
         //     input message: CloseServiceRequestMessage
         //     output message: CloseServiceResponseMessage
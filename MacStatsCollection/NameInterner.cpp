@@ -0,0 +1,327 @@
+#include "stdafx.h"
+#include "NameInterner.h"
+#include <3FD\callstacktracer.h>
+#include <3FD\exceptions.h>
+#include <3FD\configuration.h>
+#include <algorithm>
+#include <cassert>
+#include <cwchar>
+#include <sstream>
+
+namespace application
+{
+    using namespace _3fd::core;
+
+
+    std::unique_ptr<NameInterner> NameInterner::singleton;
+
+    std::mutex NameInterner::singletonCreationMutex;
+
+
+    /// <summary>
+    /// Provides access to the singleton.
+    /// </summary>
+    /// <returns>A reference to the singleton.</returns>
+    NameInterner & NameInterner::GetInstance()
+    {
+        if (singleton)
+            return *singleton;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            std::lock_guard<std::mutex> lock(singletonCreationMutex);
+
+            if (!singleton)
+            {
+                singleton.reset(
+                    new NameInterner(AppConfig::GetSettings().application.GetUInt("maxInternedNames", 65536))
+                );
+            }
+
+            return *singleton;
+        }
+        catch (IAppException &)
+        {
+            throw; // just forward already prepared application exceptions
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when instantiating table of interned names: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    /// <summary>
+    /// Finalizes the singleton, which must take place after
+    /// no other thread can use the interned names anymore.
+    /// </summary>
+    void NameInterner::Finalize()
+    {
+        singleton.reset(nullptr);
+    }
+
+
+    // Gets the smallest power of 2 not less than the given value
+    static size_t RoundUpToPowerOf2(size_t value)
+    {
+        size_t result(1);
+        while (result < value)
+            result <<= 1;
+
+        return result;
+    }
+
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="NameInterner"/> class.
+    /// </summary>
+    /// <param name="maxNames">How many names the table can hold.</param>
+    NameInterner::NameInterner(uint32_t maxNames)
+        : m_slots(new std::atomic<Entry *>[RoundUpToPowerOf2(2 * static_cast<size_t> (maxNames))])
+        , m_entriesByHandle(new std::atomic<Entry *>[static_cast<size_t> (maxNames) + 1])
+        , m_nextHandle(1)
+        , m_maxNames(maxNames)
+        , m_slotMask(RoundUpToPowerOf2(2 * static_cast<size_t> (maxNames)) - 1)
+    {
+        assert(maxNames > 0);
+
+        for (size_t idx = 0; idx <= m_slotMask; ++idx)
+            m_slots[idx].store(nullptr, std::memory_order_relaxed);
+
+        for (size_t idx = 0; idx <= m_maxNames; ++idx)
+            m_entriesByHandle[idx].store(nullptr, std::memory_order_relaxed);
+    }
+
+
+    /// <summary>
+    /// Finalizes an instance of the <see cref="NameInterner"/> class.
+    /// </summary>
+    NameInterner::~NameInterner()
+    {
+        for (size_t idx = 1; idx <= m_maxNames; ++idx)
+            delete m_entriesByHandle[idx].load(std::memory_order_relaxed);
+    }
+
+
+    // FNV-1a hash of the characters in a name
+    uint64_t NameInterner::Hash(const wchar_t *name, size_t length)
+    {
+        uint64_t hash(14695981039346656037ULL);
+
+        for (size_t idx = 0; idx < length; ++idx)
+        {
+            hash ^= static_cast<uint64_t> (name[idx]);
+            hash *= 1099511628211ULL;
+        }
+
+        return hash;
+    }
+
+
+    /// <summary>
+    /// Interns a name, unless already there. Once the name is in the table, this does not allocate.
+    /// Any thread can call this concurrently: when two threads insert the same name at once, only
+    /// one of them succeeds, and the other takes the handle of the winner (wasting a handle).
+    /// </summary>
+    /// <param name="name">The name.</param>
+    /// <param name="length">The length of the name.</param>
+    /// <returns>The handle of the name, which is zero only for the empty name.</returns>
+    uint32_t NameInterner::Intern(const wchar_t *name, size_t length)
+    {
+        uint32_t handle;
+        if (TryIntern(name, length, handle))
+            return handle;
+
+        CALL_STACK_TRACE;
+        std::ostringstream oss;
+        oss << "Failed to intern name: the table is full, with " << m_maxNames << " names";
+        throw AppException<std::runtime_error>(oss.str());
+    }
+
+
+    /// <summary>
+    /// Interns a name, unless already there, just like <see cref="Intern"/>, but without
+    /// throwing when the table is full, because the name comes from the network.
+    /// </summary>
+    /// <param name="name">The name.</param>
+    /// <param name="length">The length of the name.</param>
+    /// <param name="handle">Where to save the handle of the name, which is zero only for the empty name.</param>
+    /// <returns>Whether the name is in the table, or else the table is full.</returns>
+    bool NameInterner::TryIntern(const wchar_t *name, size_t length, uint32_t &handle)
+    {
+        handle = 0;
+
+        if (length == 0)
+            return true;
+
+        auto hash = Hash(name, length);
+        auto index = static_cast<size_t> (hash) & m_slotMask;
+
+        std::unique_ptr<Entry> newEntry;
+
+        while (true)
+        {
+            auto entry = m_slots[index].load(std::memory_order_acquire);
+
+            if (entry == nullptr)
+            {
+                if (!newEntry)
+                {
+                    auto newHandle = m_nextHandle.fetch_add(1, std::memory_order_relaxed);
+
+                    if (newHandle > m_maxNames)
+                    {
+                        m_nextHandle.store(m_maxNames + 1, std::memory_order_relaxed);
+                        return false;
+                    }
+
+                    newEntry.reset(new Entry{ std::wstring(name, length), hash, newHandle });
+                    m_entriesByHandle[newHandle].store(newEntry.get(), std::memory_order_release);
+                }
+
+                // the entry is owned by the table since its handle was published:
+                if (m_slots[index].compare_exchange_strong(entry, newEntry.get(), std::memory_order_acq_rel))
+                {
+                    handle = newEntry.release()->handle;
+                    return true;
+                }
+
+                // another thread took the slot first, maybe with the same name
+            }
+
+            if (entry->hash == hash
+                && entry->name.length() == length
+                && wmemcmp(entry->name.data(), name, length) == 0)
+            {
+                newEntry.release(); // (if any) stays unreachable in the table until finalization
+                handle = entry->handle;
+                return true;
+            }
+
+            index = (index + 1) & m_slotMask;
+        }
+    }
+
+
+    /// <summary>
+    /// Finds a name in the table, without ever inserting it.
+    /// </summary>
+    /// <param name="name">The name.</param>
+    /// <param name="length">The length of the name.</param>
+    /// <returns>The handle of the name, or zero when not found.</returns>
+    uint32_t NameInterner::Find(const wchar_t *name, size_t length) const
+    {
+        if (length == 0)
+            return 0;
+
+        auto hash = Hash(name, length);
+        auto index = static_cast<size_t> (hash) & m_slotMask;
+
+        while (true)
+        {
+            auto entry = m_slots[index].load(std::memory_order_acquire);
+
+            if (entry == nullptr)
+                return 0;
+
+            if (entry->hash == hash
+                && entry->name.length() == length
+                && wmemcmp(entry->name.data(), name, length) == 0)
+            {
+                return entry->handle;
+            }
+
+            index = (index + 1) & m_slotMask;
+        }
+    }
+
+
+    /// <summary>
+    /// Gets the name of a handle returned by this table.
+    /// </summary>
+    /// <param name="handle">The handle.</param>
+    /// <returns>The interned name, which lives as long as the table.</returns>
+    const std::wstring & NameInterner::GetName(uint32_t handle) const
+    {
+        static const std::wstring emptyName;
+
+        if (handle == 0)
+            return emptyName;
+
+        assert(handle <= m_maxNames);
+        return m_entriesByHandle[handle].load(std::memory_order_acquire)->name;
+    }
+
+
+    /// <summary>
+    /// Gets how many handles were given so far.
+    /// </summary>
+    uint32_t NameInterner::GetCount() const
+    {
+        return (std::min)(m_nextHandle.load(std::memory_order_relaxed) - 1, m_maxNames);
+    }
+
+
+    /// <summary>
+    /// Tells whether the table is full, so no other name can be interned anymore.
+    /// </summary>
+    bool NameInterner::IsFull() const
+    {
+        return m_nextHandle.load(std::memory_order_relaxed) > m_maxNames;
+    }
+
+
+    InternedName::InternedName(const wchar_t *name)
+        : m_handle(name != nullptr ? NameInterner::GetInstance().Intern(name, wcslen(name)) : 0)
+    {}
+
+    InternedName::InternedName(const std::wstring &name)
+        : m_handle(NameInterner::GetInstance().Intern(name.data(), name.length()))
+    {}
+
+    /// <summary>
+    /// Interns a name that comes from the network, without throwing when the table is full.
+    /// </summary>
+    /// <param name="name">The name.</param>
+    /// <param name="interned">Where to save the interned name.</param>
+    /// <returns>Whether the name is interned, or else the table is full.</returns>
+    bool InternedName::TryIntern(const std::wstring &name, InternedName &interned)
+    {
+        uint32_t handle;
+        if (!NameInterner::GetInstance().TryIntern(name.data(), name.length(), handle))
+            return false;
+
+        interned = InternedName(handle);
+        return true;
+    }
+
+    /// <summary>
+    /// Finds a name already interned, without inserting it.
+    /// </summary>
+    /// <param name="name">The name.</param>
+    /// <returns>The interned name, which is empty when not found.</returns>
+    InternedName InternedName::Find(const wchar_t *name)
+    {
+        return InternedName(name != nullptr ? NameInterner::GetInstance().Find(name, wcslen(name)) : 0);
+    }
+
+    /// <summary>
+    /// Finds a name already interned, without inserting it.
+    /// </summary>
+    /// <param name="name">The name.</param>
+    /// <returns>The interned name, which is empty when not found.</returns>
+    InternedName InternedName::Find(const std::wstring &name)
+    {
+        return InternedName(NameInterner::GetInstance().Find(name.data(), name.length()));
+    }
+
+    const std::wstring & InternedName::GetName() const
+    {
+        return NameInterner::GetInstance().GetName(m_handle);
+    }
+
+}// end of namespace application
@@ -0,0 +1,118 @@
+#ifndef __NameInterner_h__ // header guard
+#define __NameInterner_h__
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace application
+{
+    /// <summary>
+    /// Keeps a single copy of each name of machine or statistic that goes through the server,
+    /// mapping it to a small integer (the handle) that never changes, so the packages of stats
+    /// carry handles instead of strings. Lookups are lock-free: the names live in an open
+    /// addressing table of atomic pointers, where an insertion is a single compare-and-swap,
+    /// and whose entries are never moved nor released until finalization. The capacity is
+    /// fixed, because the names come from the network.
+    /// </summary>
+    /// <seealso cref="notcopiable" />
+    class NameInterner
+    {
+    private:
+
+        /// <summary>
+        /// An interned name, immutable once published.
+        /// </summary>
+        struct Entry
+        {
+            std::wstring name;
+            uint64_t hash;
+            uint32_t handle;
+        };
+
+        std::unique_ptr<std::atomic<Entry *>[]> m_slots; // indexed by hash, at most half of them in use
+
+        std::unique_ptr<std::atomic<Entry *>[]> m_entriesByHandle;
+
+        std::atomic<uint32_t> m_nextHandle;
+
+        const uint32_t m_maxNames;
+
+        const size_t m_slotMask;
+
+        static std::unique_ptr<NameInterner> singleton;
+
+        static std::mutex singletonCreationMutex;
+
+        static uint64_t Hash(const wchar_t *name, size_t length);
+
+    public:
+
+        explicit NameInterner(uint32_t maxNames);
+
+        NameInterner(const NameInterner &) = delete;
+
+        ~NameInterner();
+
+        static NameInterner &GetInstance();
+
+        static void Finalize();
+
+        uint32_t Intern(const wchar_t *name, size_t length);
+
+        bool TryIntern(const wchar_t *name, size_t length, uint32_t &handle);
+
+        uint32_t Find(const wchar_t *name, size_t length) const;
+
+        const std::wstring &GetName(uint32_t handle) const;
+
+        uint32_t GetCount() const;
+
+        bool IsFull() const;
+    };
+
+
+    /// <summary>
+    /// The handle of a name interned by <see cref="NameInterner"/>, which is copied and compared
+    /// as an integer. The empty name (the default) is never interned, having handle zero.
+    /// </summary>
+    class InternedName
+    {
+    private:
+
+        uint32_t m_handle;
+
+        explicit InternedName(uint32_t handle) : m_handle(handle) {}
+
+    public:
+
+        InternedName() : m_handle(0) {}
+
+        InternedName(const wchar_t *name);
+
+        InternedName(const std::wstring &name);
+
+        static bool TryIntern(const std::wstring &name, InternedName &interned);
+
+        static InternedName Find(const wchar_t *name);
+
+        static InternedName Find(const std::wstring &name);
+
+        uint32_t GetHandle() const { return m_handle; }
+
+        bool IsEmpty() const { return m_handle == 0; }
+
+        const std::wstring &GetName() const;
+
+        bool operator ==(InternedName other) const { return m_handle == other.m_handle; }
+
+        bool operator !=(InternedName other) const { return m_handle != other.m_handle; }
+
+        bool operator <(InternedName other) const { return m_handle < other.m_handle; }
+    };
+
+}// end of namespace application
+
+#endif // end of header guard
@@ -0,0 +1,340 @@
+#include "stdafx.h"
+#include "PerfCountersCatalog.h"
+#include <3FD/callstacktracer.h>
+#include <3FD/exceptions.h>
+#include <3FD/configuration.h>
+#include <array>
+#include <cassert>
+#include <cwctype>
+#include <codecvt>
+#include <locale>
+#include <sstream>
+
+namespace application
+{
+    using namespace _3fd;
+    using namespace _3fd::core;
+
+
+    /// <summary>
+    /// This array gathers the labels for the supported performance counters.
+    /// The entries are ordered to match the indexes that are listed in the enumeration
+    /// <see cref"PerfCounterCode"/>, so: DO NOT CHANGE THE ORDER!!!
+    /// </summary>
+    static const std::array<const wchar_t *, numSupPerfCounters> perfCounterLabels =
+    {
+        L"cpu_usage_percentage",
+        L"available_memory_mbytes",
+        L"disk_read_bps",
+        L"disk_write_bps",
+        L"process_count",
+        L"thread_count"
+    };
+
+
+    /// <summary>
+    /// Converts an enumerated code for performance counter into a name for statistic.
+    /// </summary>
+    /// <param name="code">The <see cref="PerfCounterCode"/> code.</param>
+    /// <returns>The correponding name os statistic.</returns>
+    const wchar_t *ToStatName(PerfCounterCode code)
+    {
+        return perfCounterLabels[static_cast<uint32_t> (code)];
+    }
+
+
+    /// <summary>
+    /// Describes a performance counter always present in the catalog.
+    /// </summary>
+    struct BuiltInPerfCounter
+    {
+        PerfCounterCode code;
+        const wchar_t *path;
+        StatValueType valueType;
+    };
+
+    /// <summary>
+    /// This array gathers the performance counters that start the catalog.
+    /// The entries are ordered to match the indexes that are listed in the enumeration
+    /// <see cref"PerfCounterCode"/>, so: DO NOT CHANGE THE ORDER!!!
+    /// </summary>
+    static const std::array<BuiltInPerfCounter, numSupPerfCounters> builtInPerfCounters =
+    {{
+        { PerfCounterCode::CpuUsage,     L"\\Processor(_Total)\\% Processor Time",        StatValueType::Float32 },
+        { PerfCounterCode::MemAvailable, L"\\Memory\\Available MBytes",                   StatValueType::Float32 },
+        { PerfCounterCode::DiskRead,     L"\\LogicalDisk(_Total)\\Disk Read Bytes/sec",   StatValueType::Float32 },
+        { PerfCounterCode::DiskWrite,    L"\\LogicalDisk(_Total)\\Disk Write Bytes/sec",  StatValueType::Float32 },
+        { PerfCounterCode::ProcessCount, L"\\System\\Processes",                          StatValueType::Int32 },
+        { PerfCounterCode::ThreadCount,  L"\\System\\Threads",                            StatValueType::Int32 }
+    }};
+
+
+    /// <summary>
+    /// This array gathers the suffixes for the names of statistic of the aggregates.
+    /// The entries are ordered to match the indexes that are listed in the enumeration
+    /// <see cref"AggregateCode"/>, so: DO NOT CHANGE THE ORDER!!!
+    /// </summary>
+    static const std::array<const wchar_t *, numSupAggregates> aggregateSuffixes =
+    {
+        L"_min",
+        L"_max",
+        L"_mean",
+        L"_p95"
+    };
+
+
+    /// <summary>
+    /// Makes the descriptor of a performance counter, including the names of statistic of its aggregates.
+    /// </summary>
+    /// <param name="statName">The name of statistic.</param>
+    /// <param name="path">The path of the counter, without the machine.</param>
+    /// <param name="valueType">The type of the value.</param>
+    /// <returns>The descriptor of the performance counter.</returns>
+    PerfCounterDescriptor MakePerfCounterDescriptor(const std::wstring &statName,
+                                                    const std::wstring &path,
+                                                    StatValueType valueType)
+    {
+        PerfCounterDescriptor descriptor{ statName, path, valueType };
+
+        for (uint32_t idx = 0; idx < numSupAggregates; ++idx)
+            descriptor.aggregateStatNames[idx] = statName + aggregateSuffixes[idx];
+
+        return descriptor;
+    }
+
+
+    /// <summary>
+    /// Parses the declaration of a performance counter in the configuration, which
+    /// has the format "stat_name;type;path", where type is either "float" or "int",
+    /// and path is the counter path without the machine. The instance in the path
+    /// might be the wildcard '*', like in "\Processor(*)\% Processor Time".
+    /// </summary>
+    /// <param name="text">The text to parse.</param>
+    /// <param name="descriptor">Where to save the parsed descriptor.</param>
+    /// <returns>Whether the text could be parsed.</returns>
+    bool ParsePerfCounterDescriptor(const std::string &text, PerfCounterDescriptor &descriptor)
+    {
+        auto endOfName = text.find(';');
+        if (endOfName == 0 || endOfName == std::string::npos)
+            return false;
+
+        auto endOfType = text.find(';', endOfName + 1);
+        if (endOfType == std::string::npos)
+            return false;
+
+        auto type = text.substr(endOfName + 1, endOfType - endOfName - 1);
+        StatValueType valueType;
+
+        if (type == "float")
+            valueType = StatValueType::Float32;
+        else if (type == "int")
+            valueType = StatValueType::Int32;
+        else
+            return false;
+
+        if (endOfType + 1 >= text.size() || text[endOfType + 1] != '\\')
+            return false;
+
+        std::wstring_convert<std::codecvt_utf8<wchar_t>> transcoder;
+        descriptor = MakePerfCounterDescriptor(transcoder.from_bytes(text.substr(0, endOfName)),
+                                               transcoder.from_bytes(text.substr(endOfType + 1)),
+                                               valueType);
+        return true;
+    }
+
+
+    /// <summary>
+    /// Makes the name of statistic for an instance expanded from a wildcard,
+    /// like "cpu_core_usage_percentage_0" for instance "0" of the processor.
+    /// </summary>
+    /// <param name="statName">The name of statistic declared with the wildcard.</param>
+    /// <param name="instance">The name of the instance.</param>
+    /// <returns>The name of statistic, in lower case and only with alphanumerics.</returns>
+    std::wstring MakeInstanceStatName(const std::wstring &statName, const std::wstring &instance)
+    {
+        std::wstring result;
+        result.reserve(statName.size() + 1 + instance.size());
+        result.append(statName);
+        result.push_back(L'_');
+
+        for (auto ch : instance)
+            result.push_back(iswalnum(ch) ? towlower(ch) : L'_');
+
+        return result;
+    }
+
+
+    /// <summary>
+    /// Gets the catalog with only the performance counters enumerated by <see cref="PerfCounterCode"/>.
+    /// </summary>
+    /// <returns>The descriptors of the built-in performance counters.</returns>
+    std::vector<PerfCounterDescriptor> GetBuiltInPerfCountersCatalog()
+    {
+        std::vector<PerfCounterDescriptor> catalog;
+        catalog.reserve(numSupPerfCounters);
+
+        for (auto &builtIn : builtInPerfCounters)
+            catalog.push_back(MakePerfCounterDescriptor(ToStatName(builtIn.code), builtIn.path, builtIn.valueType));
+
+        return catalog;
+    }
+
+
+    /// <summary>
+    /// Loads the catalog of performance counters to collect. It starts with the counters
+    /// enumerated by <see cref="PerfCounterCode"/>, followed by the ones declared in the
+    /// application configuration under the keys "perfCounter1", "perfCounter2" and so on
+    /// (until the first missing key). Wildcards are left for the reader to expand.
+    /// </summary>
+    /// <returns>The descriptors of all performance counters in the catalog.</returns>
+    std::vector<PerfCounterDescriptor> LoadPerfCountersCatalog()
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            auto catalog = GetBuiltInPerfCountersCatalog();
+
+            for (uint32_t number = 1; true; ++number)
+            {
+                std::ostringstream oss;
+                oss << "perfCounter" << number;
+                auto key = oss.str();
+
+                auto text = AppConfig::GetSettings().application.GetString(key, "");
+                if (text.empty())
+                    break;
+
+                catalog.emplace_back();
+                if (!ParsePerfCounterDescriptor(text, catalog.back()))
+                {
+                    oss.str("");
+                    oss << "Invalid declaration of performance counter in configuration: " << key << " = '" << text << '\'';
+                    throw AppException<std::runtime_error>(oss.str());
+                }
+            }
+
+            return catalog;
+        }
+        catch (IAppException &)
+        {
+            throw; // just forward already prepared application exceptions
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when loading catalog of performance counters: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    /// <summary>
+    /// Finds the performance counters in the catalog whose name of stat matches a pattern,
+    /// which is either the exact name, or ends in '*' to match every name that starts like
+    /// it (such as the instances of a counter declared with wildcard).
+    /// </summary>
+    /// <param name="catalog">The catalog of performance counters, with wildcards expanded.</param>
+    /// <param name="pattern">The pattern of the name of stat.</param>
+    /// <returns>The indexes in the catalog of the matching counters, which might be none.</returns>
+    std::vector<uint32_t> FindCounterIds(const std::vector<PerfCounterDescriptor> &catalog, const std::wstring &pattern)
+    {
+        std::vector<uint32_t> counterIds;
+
+        bool isPrefix = (!pattern.empty() && pattern.back() == L'*');
+        auto length = isPrefix ? pattern.size() - 1 : pattern.size();
+
+        for (uint32_t counterId = 0; counterId < catalog.size(); ++counterId)
+        {
+            auto &name = catalog[counterId].statName;
+
+            if (isPrefix ? name.compare(0, length, pattern, 0, length) == 0 : name == pattern)
+                counterIds.push_back(counterId);
+        }
+
+        return counterIds;
+    }
+
+
+    /// <summary>
+    /// Sets the columns of an empty batch to be the performance counters
+    /// enumerated by <see cref="PerfCounterCode"/>, which start the catalog.
+    /// </summary>
+    /// <param name="batch">The batch.</param>
+    void SetBuiltInCounterIds(SamplesBatch &batch)
+    {
+        assert(batch.GetSampleCount() == 0);
+
+        batch.counterIds.resize(numSupPerfCounters);
+        for (uint32_t idx = 0; idx < numSupPerfCounters; ++idx)
+            batch.counterIds[idx] = idx;
+    }
+
+
+    /// <summary>
+    /// Adds to a batch whose columns are the performance counters enumerated by
+    /// <see cref="PerfCounterCode"/> a sample in the struct used by the spool.
+    /// </summary>
+    /// <param name="batch">The batch, whose columns were set by <see cref="SetBuiltInCounterIds"/>.</param>
+    /// <param name="sample">The sample to add.</param>
+    void AddSampleTo(SamplesBatch &batch, const PerfCountersValues &sample)
+    {
+        assert(batch.GetCounterCount() == numSupPerfCounters);
+
+        auto row = batch.AddSample(sample.time);
+        auto values = batch.GetValues(row);
+        auto qualities = batch.GetQualities(row);
+
+        auto set = [values, qualities](PerfCounterCode code, double value, Quality quality)
+        {
+            values[static_cast<uint32_t> (code)] = value;
+            qualities[static_cast<uint32_t> (code)] = quality;
+        };
+
+        set(PerfCounterCode::CpuUsage, sample.cpuTotalUsage.value, sample.cpuTotalUsage.quality);
+        set(PerfCounterCode::MemAvailable, sample.memAvailableMBytes.value, sample.memAvailableMBytes.quality);
+        set(PerfCounterCode::DiskRead, sample.diskReadBytesPerSec.value, sample.diskReadBytesPerSec.quality);
+        set(PerfCounterCode::DiskWrite, sample.diskWriteBytesPerSec.value, sample.diskWriteBytesPerSec.quality);
+        set(PerfCounterCode::ProcessCount, sample.processCount.value, sample.processCount.quality);
+        set(PerfCounterCode::ThreadCount, sample.threadCount.value, sample.threadCount.quality);
+    }
+
+
+    /// <summary>
+    /// Copies the values of the counters enumerated by <see cref="PerfCounterCode"/>, which
+    /// start the catalog, from a sample in a batch into the struct used by the spool.
+    /// </summary>
+    /// <param name="batch">The batch, whose first columns are the built-in counters.</param>
+    /// <param name="row">The row of the sample in the batch.</param>
+    /// <returns>The values of the counters enumerated by <see cref="PerfCounterCode"/>.</returns>
+    PerfCountersValues ToPerfCountersValues(const SamplesBatch &batch, size_t row)
+    {
+        assert(batch.GetCounterCount() >= numSupPerfCounters && batch.counterIds[numSupPerfCounters - 1] == numSupPerfCounters - 1);
+
+        auto values = batch.GetValues(row);
+        auto qualities = batch.GetQualities(row);
+
+        auto toFloat = [values, qualities](PerfCounterCode code)
+        {
+            auto idx = static_cast<uint32_t> (code);
+            return ValueWithQuality<float>{ static_cast<float> (values[idx]), qualities[idx] };
+        };
+
+        auto toUInt16 = [values, qualities](PerfCounterCode code)
+        {
+            auto idx = static_cast<uint32_t> (code);
+            return ValueWithQuality<uint16_t>{ static_cast<uint16_t> (values[idx]), qualities[idx] };
+        };
+
+        PerfCountersValues object;
+        object.time = batch.times[row];
+        object.cpuTotalUsage = toFloat(PerfCounterCode::CpuUsage);
+        object.memAvailableMBytes = toFloat(PerfCounterCode::MemAvailable);
+        object.diskReadBytesPerSec = toFloat(PerfCounterCode::DiskRead);
+        object.diskWriteBytesPerSec = toFloat(PerfCounterCode::DiskWrite);
+        object.processCount = toUInt16(PerfCounterCode::ProcessCount);
+        object.threadCount = toUInt16(PerfCounterCode::ThreadCount);
+        return object;
+    }
+
+}// end of namespace application
@@ -0,0 +1,32 @@
+#ifndef __PerfCountersCatalog_h__ // header guard
+#define __PerfCountersCatalog_h__
+
+#include "CommonDataExchange.h"
+#include <string>
+#include <vector>
+
+namespace application
+{
+    PerfCounterDescriptor MakePerfCounterDescriptor(const std::wstring &statName,
+                                                    const std::wstring &path,
+                                                    StatValueType valueType);
+
+    bool ParsePerfCounterDescriptor(const std::string &text, PerfCounterDescriptor &descriptor);
+
+    std::wstring MakeInstanceStatName(const std::wstring &statName, const std::wstring &instance);
+
+    std::vector<PerfCounterDescriptor> GetBuiltInPerfCountersCatalog();
+
+    std::vector<PerfCounterDescriptor> LoadPerfCountersCatalog();
+
+    std::vector<uint32_t> FindCounterIds(const std::vector<PerfCounterDescriptor> &catalog, const std::wstring &pattern);
+
+    void SetBuiltInCounterIds(SamplesBatch &batch);
+
+    void AddSampleTo(SamplesBatch &batch, const PerfCountersValues &sample);
+
+    PerfCountersValues ToPerfCountersValues(const SamplesBatch &batch, size_t row);
+
+}// end of namespace application
+
+#endif // end of header guard
@@ -1,78 +1,22 @@
 #include "stdafx.h"
 #include "PerfCountersReader.h"
+
+#ifdef _WIN32 // this backend uses PDH API, only available on Windows
+
+#include "PerfCountersCatalog.h"
 #include "Utilities.h"
 #include <3FD\callstacktracer.h>
 #include <3FD\exceptions.h>
 #include <3FD\logger.h>
 #include <3FD\utils_io.h>
+#include <array>
 #include <cstdlib>
 #include <sstream>
-#include <array>
 #include <thread>
 #include <PdhMsg.h>
 
 namespace application
 {
-    static constexpr uint32_t numSupPerfCounters = 6;
-
-
-    /// <summary>
-    /// This array gathers the suffixes to compose the full path of the performance counters.
-    /// The entries are ordered to match the indexes that are listed in the enumeration
-    /// <see cref"PerfCounterCode"/>, so: DO NOT CHANGE THE ORDER!!!
-    /// </summary>
-    static const std::array<const wchar_t *, numSupPerfCounters> perfCounterPathSuffixes =
-    {
-        L"\\Processor(_Total)\\% Processor Time",
-        L"\\Memory\\Available MBytes",
-        L"\\LogicalDisk(_Total)\\Disk Read Bytes/sec",
-        L"\\LogicalDisk(_Total)\\Disk Write Bytes/sec",
-        L"\\System\\Processes",
-        L"\\System\\Threads"
-    };
-
-    /// <summary>
-    /// This array gathers formats for values of the performance counters.
-    /// The entries are ordered to match the indexes that are listed in the enumeration
-    /// <see cref"PerfCounterCode"/>, so: DO NOT CHANGE THE ORDER!!!
-    /// </summary>
-    static const std::array<DWORD, numSupPerfCounters> perfCounterValFormats =
-    {
-        PDH_FMT_DOUBLE,
-        PDH_FMT_DOUBLE,
-        PDH_FMT_DOUBLE,
-        PDH_FMT_DOUBLE,
-        PDH_FMT_LONG,
-        PDH_FMT_LONG
-    };
-
-    /// <summary>
-    /// This array gathers the labels for the supported performance counters.
-    /// The entries are ordered to match the indexes that are listed in the enumeration
-    /// <see cref"PerfCounterCode"/>, so: DO NOT CHANGE THE ORDER!!!
-    /// </summary>
-    static const std::array<const wchar_t *, numSupPerfCounters> perfCounterLabels =
-    {
-        L"cpu_usage_percentage",
-        L"available_memory_mbytes",
-        L"disk_read_bps",
-        L"disk_write_bps",
-        L"process_count",
-        L"thread_count"
-    };
-
-
-    /// <summary>
-    /// Converts an enumerated code for performance counter into a name for statistic.
-    /// </summary>
-    /// <param name="code">The <see cref="PerfCounterCode"/> code.</param>
-    /// <returns>The correponding name os statistic.</returns>
-    const wchar_t *ToStatName(PerfCounterCode code)
-    {
-        return perfCounterLabels[static_cast<uint32_t> (code)];
-    }
-
-
     /// <summary>
     /// Translates a value status reported by PDH API to its corresponding quality.
     /// </summary>
@@ -145,10 +89,117 @@ namespace application
     }
 
 
+    /// <summary>
+    /// Gets the paths of all counters that match a path with wildcard.
+    /// </summary>
+    /// <param name="wildcardPath">The full path with wildcard.</param>
+    /// <returns>The full paths of the counters, localized as in the system.</returns>
+    static std::vector<std::wstring> ExpandWildCardPath(const std::wstring &wildcardPath)
+    {
+        DWORD length(0);
+        PDH_STATUS status;
+        status = PdhExpandWildCardPathW(nullptr, wildcardPath.c_str(), nullptr, &length, 0);
+
+        if (status != PDH_MORE_DATA)
+            CheckStatus(status, "Failed to expand wildcard in path of performance counter", "PdhExpandWildCardPath");
+
+        std::vector<wchar_t> buffer(length);
+        status = PdhExpandWildCardPathW(nullptr, wildcardPath.c_str(), buffer.data(), &length, 0);
+        CheckStatus(status, "Failed to expand wildcard in path of performance counter", "PdhExpandWildCardPath");
+
+        // the paths come in a list of null terminated strings, ending with an empty one:
+        std::vector<std::wstring> paths;
+        for (auto path = buffer.data(); *path != 0; path += paths.back().size() + 1)
+            paths.emplace_back(path);
+
+        return paths;
+    }
+
+
+    /// <summary>
+    /// Gets the instance in the path of a performance counter, prefixed
+    /// by the parent instance when there is one, like in "Thread(proc/0)".
+    /// </summary>
+    /// <param name="fullPath">The full path of the performance counter.</param>
+    /// <returns>The instance, or an empty string when absent.</returns>
+    static std::wstring GetInstanceFrom(const std::wstring &fullPath)
+    {
+        DWORD size(0);
+        PDH_STATUS status;
+        status = PdhParseCounterPathW(fullPath.c_str(), nullptr, &size, 0);
+
+        if (status != PDH_MORE_DATA)
+            CheckStatus(status, "Failed to parse path of performance counter", "PdhParseCounterPath");
+
+        std::vector<BYTE> buffer(size);
+        auto elements = reinterpret_cast<PDH_COUNTER_PATH_ELEMENTS_W *> (buffer.data());
+        status = PdhParseCounterPathW(fullPath.c_str(), elements, &size, 0);
+        CheckStatus(status, "Failed to parse path of performance counter", "PdhParseCounterPath");
+
+        std::wstring instance;
+
+        if (elements->szParentInstance != nullptr)
+        {
+            instance.append(elements->szParentInstance);
+            instance.push_back(L'_');
+        }
+
+        if (elements->szInstanceName != nullptr)
+            instance.append(elements->szInstanceName);
+
+        return instance;
+    }
+
+
+    /// <summary>
+    /// Adds a performance counter to the PDH query and to the catalog.
+    /// </summary>
+    /// <param name="descriptor">The descriptor of the counter.</param>
+    /// <param name="fullPath">The full path of the counter.</param>
+    /// <param name="isLocalized">Whether the path is localized (otherwise it is in English).</param>
+    void PerfCountersReader::AddPerfCounter(const PerfCounterDescriptor &descriptor,
+                                            const std::wstring &fullPath,
+                                            bool isLocalized)
+    {
+        m_perfCounters.emplace_back();
+        auto &perfCounter = m_perfCounters.back();
+
+        perfCounter.fullPath = fullPath;
+        perfCounter.userData = rand();
+        perfCounter.valFormat = (descriptor.valueType == StatValueType::Int32) ? PDH_FMT_LONG : PDH_FMT_DOUBLE;
+
+        PDH_STATUS status;
+
+        if (isLocalized)
+        {
+            status = PdhAddCounterW(m_pdhQuery,
+                                    perfCounter.fullPath.c_str(),
+                                    perfCounter.userData,
+                                    &perfCounter.handle);
+        }
+        else
+        {
+            status = PdhAddEnglishCounterW(m_pdhQuery,
+                                           perfCounter.fullPath.c_str(),
+                                           perfCounter.userData,
+                                           &perfCounter.handle);
+        }
+
+        CheckStatus(status, "Failed to performance counter to PDH query", "PdhAddCounter");
+
+        m_catalog.push_back(descriptor);
+    }
+
+
     /// <summary>
     /// Initializes a new instance of the <see cref="PerfCountersReader"/> class.
+    /// The catalog of performance counters is loaded from configuration, and
+    /// wildcards are expanded into all instances available at this moment (in
+    /// that case the path must be localized as the system, because PDH API
+    /// provides no way to expand wildcards in English paths).
     /// </summary>
     PerfCountersReader::PerfCountersReader()
+        : m_hasLastCollection(false)
     {
         CALL_STACK_TRACE;
 
@@ -173,27 +224,40 @@ namespace application
             status = PdhOpenQueryW(nullptr, m_queryUserData, &m_pdhQuery);
             CheckStatus(status, "Failed to create PDH query", "PdhOpenQuery");
 
-            // Add some performance counters to the PDH query:
-
-            m_perfCounters.reserve(perfCounterPathSuffixes.size());
+            // Add the performance counters in the catalog to the PDH query:
 
-            for (auto pathSuffix : perfCounterPathSuffixes)
-            {
-                m_perfCounters.emplace_back();
-                auto &perfCounter = m_perfCounters.back();
-
-                perfCounter.userData = rand();
+            auto catalog = LoadPerfCountersCatalog();
 
-                utils::SerializeTo(perfCounter.fullPath, L"\\\\", GetLocalHostName(), pathSuffix);
+            m_catalog.reserve(catalog.size());
+            m_perfCounters.reserve(catalog.size());
 
-                status = PdhAddEnglishCounterW(m_pdhQuery,
-                                               perfCounter.fullPath.c_str(),
-                                               perfCounter.userData,
-                                               &perfCounter.handle);
-
-                CheckStatus(status, "Failed to performance counter to PDH query", "PdhAddCounter");
+            for (auto &descriptor : catalog)
+            {
+                std::wstring fullPath;
+                utils::SerializeTo(fullPath, L"\\\\", GetLocalHostName(), descriptor.path);
+
+                if (descriptor.path.find(L'*') == std::wstring::npos)
+                {
+                    AddPerfCounter(descriptor, fullPath, false);
+                    continue;
+                }
+
+                for (auto &expandedPath : ExpandWildCardPath(fullPath))
+                {
+                    auto expanded = MakePerfCounterDescriptor(
+                        MakeInstanceStatName(descriptor.statName, GetInstanceFrom(expandedPath)),
+                        expandedPath.substr(expandedPath.find(L'\\', 2)),
+                        descriptor.valueType
+                    );
+
+                    AddPerfCounter(expanded, expandedPath, true);
+                }
             }
 
+            std::ostringstream oss;
+            oss << "The catalog has " << m_catalog.size() << " performance counter(s)";
+            Logger::Write(oss.str(), Logger::PRIO_INFORMATION);
+
             logScope.LogSuccess();
         }
         catch (IAppException &)
@@ -222,110 +286,121 @@ namespace application
 
 
     /// <summary>
-    /// Sets the value of a given performance counter in a struct <see cref="PerfCountersValues" />.
+    /// Gets the value of a given performance counter in the catalog.
     /// </summary>
-    /// <param name="object">The struct whose value will be set.</param>
-    /// <param name="perfCounterCode">The code of the performance counter value to set.</param>
-    void PerfCountersReader::SetValueIn(PerfCountersValues &object, PerfCounterCode perfCounterCode) const
+    /// <param name="index">The index of the performance counter in the catalog.</param>
+    /// <param name="value">Where to save the value.</param>
+    /// <param name="quality">Where to save the quality of the value.</param>
+    void PerfCountersReader::GetValueOf(size_t index, double &value, Quality &quality) const
     {
         CALL_STACK_TRACE;
 
         PDH_STATUS status;
         PDH_FMT_COUNTERVALUE pdhFormatVal;
-        auto pcIndex = static_cast<uint32_t> (perfCounterCode);
-        
-        status = PdhGetFormattedCounterValue(m_perfCounters[pcIndex].handle,
-                                             perfCounterValFormats[pcIndex],
+        auto &perfCounter = m_perfCounters[index];
+
+        status = PdhGetFormattedCounterValue(perfCounter.handle,
+                                             perfCounter.valFormat,
                                              nullptr,
                                              &pdhFormatVal);
 
         if (status != ERROR_SUCCESS)
         {
-            std::array<char, 128> message;
-            utils::SerializeTo(message, "Failed to get formatted value for performance counter ", ToStatName(perfCounterCode));
+            std::array<char, 256> message;
+            utils::SerializeTo(message, "Failed to get formatted value for performance counter ", m_catalog[index].statName);
             CheckStatus(status, message.data(), "PdhGetFormattedCounterValue");
         }
 
-        auto quality = ToQuality(pdhFormatVal.CStatus);
-
-        switch (perfCounterCode)
-        {
-        case PerfCounterCode::CpuUsage:
-            object.cpuTotalUsage.value = static_cast<float> (pdhFormatVal.doubleValue);
-            object.cpuTotalUsage.quality = quality;
-            break;
-
-        case PerfCounterCode::MemAvailable:
-            object.memAvailableMBytes.value = static_cast<float> (pdhFormatVal.doubleValue);
-            object.memAvailableMBytes.quality = quality;
-            break;
-
-        case PerfCounterCode::DiskRead:
-            object.diskReadBytesPerSec.value = static_cast<float> (pdhFormatVal.doubleValue);
-            object.diskReadBytesPerSec.quality = quality;
-            break;
-
-        case PerfCounterCode::DiskWrite:
-            object.diskWriteBytesPerSec.value = static_cast<float> (pdhFormatVal.doubleValue);
-            object.diskWriteBytesPerSec.quality = quality;
-            break;
-
-        case PerfCounterCode::ProcessCount:
-            object.processCount.value = static_cast<uint16_t> (pdhFormatVal.longValue);
-            object.processCount.quality = quality;
-            break;
-
-        case PerfCounterCode::ThreadCount:
-            object.threadCount.value = static_cast<uint16_t> (pdhFormatVal.longValue);
-            object.threadCount.quality = quality;
-            break;
+        quality = ToQuality(pdhFormatVal.CStatus);
+        value = (perfCounter.valFormat == PDH_FMT_LONG)
+            ? static_cast<double> (pdhFormatVal.longValue)
+            : pdhFormatVal.doubleValue;
 
-        default:
-            _ASSERTE(false);
-            break;
-        }
-        
         // In case quality for counter is not good, report to log:
         if (quality != Quality::Good)
         {
             std::array<char, 256> message;
-            utils::SerializeTo(message, "Quality of performance counter '", m_perfCounters[pcIndex].fullPath, "' is NOT GOOD");
+            utils::SerializeTo(message, "Quality of performance counter '", perfCounter.fullPath, "' is NOT GOOD");
             CheckStatus(pdhFormatVal.CStatus, message.data(), "PdhGetFormattedCounterValue", true, Logger::PRIO_WARNING);
         }
     }
 
 
     /// <summary>
-    /// Gets the current values for the performance counters.
-    /// This call blocks for at least 1 second, in order to
-    /// calculate rates given 2 sequential samples.
+    /// The interval between the 2 collections made in the first call, when there is
+    /// no previous collection yet, to calculate rates over a meaningful time base.
     /// </summary>
-    /// <returns>The values for the set of monitored system performance counters.</returns>
-    PerfCountersValues PerfCountersReader::GetCurrentValues() const
-    {
-        CALL_STACK_TRACE;
+    static const std::chrono::milliseconds firstRateInterval(1000);
+
+    /// <summary>
+    /// The shortest interval between 2 collections for the rates calculated by PDH to be
+    /// meaningful. A collection requested sooner than that will wait for the remaining time.
+    /// This is short enough to allow sampling at sub-second rates.
+    /// </summary>
+    static const std::chrono::milliseconds minRateInterval(100);
 
-        // Take first sample:
 
+    /// <summary>
+    /// Collects the raw values for all counters in the PDH query.
+    /// </summary>
+    void PerfCountersReader::CollectQueryData()
+    {
         PDH_STATUS status;
         status = PdhCollectQueryData(m_pdhQuery);
         CheckStatus(status, "Failed to collect data for performance counters", "PdhCollectQueryData");
 
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+        m_lastCollectionTime = std::chrono::steady_clock::now();
+        m_hasLastCollection = true;
+    }
 
-        PerfCountersValues values;
-        values.time = std::chrono::system_clock().now();
 
-        // Take second sample:
+    /// <summary>
+    /// Gets the current values for all performance counters in the catalog, and adds them
+    /// as a sample to a batch. Rates are calculated against the raw values from the previous
+    /// call, so this returns immediately, except in the first call, which blocks for 1 second
+    /// in order to calculate rates given 2 sequential samples (calls in a quick succession
+    /// also wait a bit).
+    /// </summary>
+    /// <param name="batch">The batch that receives the sample. If it has no samples, its
+    /// columns are set to be the whole catalog, otherwise they must already be so.</param>
+    void PerfCountersReader::GetCurrentValues(SamplesBatch &batch)
+    {
+        CALL_STACK_TRACE;
 
-        status = PdhCollectQueryData(m_pdhQuery);
-        CheckStatus(status, "Failed to collect data for performance counters", "PdhCollectQueryData");
+        // No previous sample? Take the first one now:
+        if (!m_hasLastCollection)
+        {
+            CollectQueryData();
+            std::this_thread::sleep_for(firstRateInterval);
+        }
+        else
+        {
+            auto elapsedTime = std::chrono::steady_clock::now() - m_lastCollectionTime;
+            if (elapsedTime < minRateInterval)
+                std::this_thread::sleep_for(minRateInterval - elapsedTime);
+        }
 
-        // Get the calculated values for the performance counters:
-        for (int idx = 0; idx < numSupPerfCounters; ++idx)
-            SetValueIn(values, static_cast<PerfCounterCode> (idx));
+        if (batch.GetSampleCount() == 0)
+        {
+            batch.counterIds.resize(m_perfCounters.size());
+            for (uint32_t idx = 0; idx < batch.counterIds.size(); ++idx)
+                batch.counterIds[idx] = idx;
+        }
+
+        _ASSERTE(batch.GetCounterCount() == m_perfCounters.size());
+
+        // Take the current sample:
+        CollectQueryData();
 
-        return values;
+        auto row = batch.AddSample(std::chrono::system_clock().now());
+        auto values = batch.GetValues(row);
+        auto qualities = batch.GetQualities(row);
+
+        // Get the calculated values for the performance counters:
+        for (size_t idx = 0; idx < m_perfCounters.size(); ++idx)
+            GetValueOf(idx, values[idx], qualities[idx]);
     }
 
 }// end of namespace application
+
+#endif // end of Windows only code
@@ -2,15 +2,21 @@
 #define __PerfCountersReader_h__
 
 #include "CommonDataExchange.h"
+
+#ifdef _WIN32
+
 #include <cinttypes>
 #include <string>
 #include <vector>
+#include <chrono>
 #include <Pdh.h>
 
 namespace application
 {
     /// <summary>
-    /// Reads system performance counters.
+    /// Reads system performance counters declared in a catalog. The PDH query keeps
+    /// the raw values of the last collection, so rates are calculated against it and
+    /// cover the whole interval between 2 calls.
     /// </summary>
     /// <seealso cref="notcopiable" />
     class PerfCountersReader
@@ -25,11 +31,22 @@ namespace application
             std::wstring fullPath;
             PDH_HCOUNTER handle;
             DWORD_PTR userData;
+            DWORD valFormat;
         };
 
-        std::vector<PerfCounter> m_perfCounters;
+        std::vector<PerfCounterDescriptor> m_catalog;
+
+        std::vector<PerfCounter> m_perfCounters; // same order as the catalog
+
+        std::chrono::time_point<std::chrono::steady_clock> m_lastCollectionTime;
+
+        bool m_hasLastCollection;
+
+        void AddPerfCounter(const PerfCounterDescriptor &descriptor, const std::wstring &fullPath, bool isLocalized);
+
+        void CollectQueryData();
 
-        void SetValueIn(PerfCountersValues &object, PerfCounterCode perfCounterCode) const;
+        void GetValueOf(size_t index, double &value, Quality &quality) const;
 
     public:
 
@@ -39,9 +56,26 @@ namespace application
 
         ~PerfCountersReader();
 
-        PerfCountersValues GetCurrentValues() const;
+        /// <summary>
+        /// Gets the catalog of performance counters, with all wildcards expanded.
+        /// </summary>
+        /// <returns>The descriptors, in the same order as the collected values.</returns>
+        const std::vector<PerfCounterDescriptor> &GetCatalog() const { return m_catalog; }
+
+        void GetCurrentValues(SamplesBatch &batch);
     };
 
 }// end of namespace application
 
+#else // Linux: read the counters from procfs
+
+#include "ProcFsCountersReader.h"
+
+namespace application
+{
+    typedef ProcFsCountersReader PerfCountersReader;
+}
+
+#endif
+
 #endif // end of header guard
\ No newline at end of file
@@ -0,0 +1,585 @@
+#include "stdafx.h"
+
+#ifndef _WIN32 // this backend is only available on Linux
+
+#include "ProcFsCountersReader.h"
+#include "PerfCountersCatalog.h"
+#include <3FD/callstacktracer.h>
+#include <3FD/exceptions.h>
+#include <3FD/logger.h>
+#include <cstdlib>
+#include <cstring>
+#include <array>
+#include <cerrno>
+#include <sstream>
+#include <system_error>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+
+namespace application
+{
+    using namespace _3fd::core;
+
+
+    /// <summary>
+    /// The initial size of the buffer to read the files. It is
+    /// enough for 'diskstats' in a machine with a lot of disks.
+    /// </summary>
+    static constexpr size_t readBufferInitialSize(16384);
+
+    /// <summary>
+    /// Linux always reports disk statistics in units of 512 bytes,
+    /// regardless of the actual sector size of the device.
+    /// </summary>
+    static constexpr uint64_t diskStatsSectorSize(512);
+
+
+    /// <summary>
+    /// Parses an unsigned integer in decimal notation, skipping leading blanks.
+    /// </summary>
+    /// <param name="str">Where to start parsing. Will be moved past the parsed number.</param>
+    /// <param name="value">Receives the parsed value.</param>
+    /// <returns>Whether a number could be parsed.</returns>
+    static bool ParseUInt(const char *&str, uint64_t &value)
+    {
+        while (*str == ' ' || *str == '\t')
+            ++str;
+
+        if (*str < '0' || *str > '9')
+            return false;
+
+        value = 0;
+        do
+        {
+            value = value * 10 + (*str - '0');
+            ++str;
+        }
+        while (*str >= '0' && *str <= '9');
+
+        return true;
+    }
+
+
+    /// <summary>
+    /// Moves the pointer to the beginning of the next line.
+    /// </summary>
+    /// <param name="str">The current position in the text.</param>
+    /// <returns>The beginning of the next line, or the end of text.</returns>
+    static const char *SkipLine(const char *str)
+    {
+        while (*str != '\n' && *str != 0)
+            ++str;
+
+        return (*str == '\n') ? (str + 1) : str;
+    }
+
+
+    /// <summary>
+    /// Throws an exception for a failed call of the C runtime.
+    /// </summary>
+    /// <param name="message">The main message.</param>
+    /// <param name="fileName">The name of the file in the procfs tree.</param>
+    /// <param name="errorCode">The value of 'errno' after the call.</param>
+    static void ThrowSysCallError(const char *message, const char *fileName, int errorCode)
+    {
+        std::ostringstream oss;
+        oss << message << " '" << fileName << "': "
+            << std::generic_category().message(errorCode);
+
+        throw AppException<std::runtime_error>(oss.str());
+    }
+
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="ProcFsCountersReader"/> class.
+    /// </summary>
+    /// <param name="procRootDir">The root of the procfs tree. Anything other
+    /// than the default value is only useful for testing with fixtures.</param>
+    /// <param name="sysRootDir">The root of the sysfs tree, likewise.</param>
+    ProcFsCountersReader::ProcFsCountersReader(const char *procRootDir, const char *sysRootDir)
+        : m_rootDir(procRootDir)
+        , m_sysBlockDir(std::string(sysRootDir) + "/block")
+        , m_catalog(GetBuiltInPerfCountersCatalog())
+        , m_fdStat(-1)
+        , m_fdMemInfo(-1)
+        , m_fdDiskStats(-1)
+        , m_fdLoadAvg(-1)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            ScopedLogWrite logScope(
+                "Setting up reader for procfs... ",
+                Logger::PRIO_INFORMATION, "done!",
+                Logger::PRIO_ERROR, "FAILED!"
+            );
+
+            m_readBuffer.resize(readBufferInitialSize);
+            m_diskStatsLines.reserve(64);
+
+            m_fdStat = OpenProcFile("stat");
+            m_fdMemInfo = OpenProcFile("meminfo");
+            m_fdDiskStats = OpenProcFile("diskstats");
+            m_fdLoadAvg = OpenProcFile("loadavg");
+
+            /* Take the first snapshot now, so the rates
+            in the first collection will not block: */
+            TakeSnapshot(m_lastSnapshot);
+
+            logScope.LogSuccess();
+        }
+        catch (IAppException &)
+        {
+            CloseFiles();
+            throw; // just forward already prepared application exceptions
+        }
+        catch (std::exception &ex)
+        {
+            CloseFiles();
+            std::ostringstream oss;
+            oss << "Generic failure when creating reader for procfs: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    /// <summary>
+    /// Finalizes an instance of the <see cref="ProcFsCountersReader"/> class.
+    /// </summary>
+    ProcFsCountersReader::~ProcFsCountersReader()
+    {
+        CloseFiles();
+    }
+
+
+    /// <summary>
+    /// Closes all the files this reader keeps open.
+    /// </summary>
+    void ProcFsCountersReader::CloseFiles()
+    {
+        for (int *fd : { &m_fdStat, &m_fdMemInfo, &m_fdDiskStats, &m_fdLoadAvg })
+        {
+            if (*fd >= 0)
+            {
+                close(*fd);
+                *fd = -1;
+            }
+        }
+    }
+
+
+    /// <summary>
+    /// Opens a file in the procfs tree for reading.
+    /// </summary>
+    /// <param name="fileName">Name of the file relative to the root of the tree.</param>
+    /// <returns>The file descriptor.</returns>
+    int ProcFsCountersReader::OpenProcFile(const char *fileName) const
+    {
+        std::string path = m_rootDir + '/' + fileName;
+
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+        if (fd < 0)
+            ThrowSysCallError("Failed to open file", path.c_str(), errno);
+
+        return fd;
+    }
+
+
+    /// <summary>
+    /// Reads the whole content of an already open file into the internal buffer,
+    /// starting from the offset zero, so the file never has to be reopened.
+    /// </summary>
+    /// <param name="fd">The file descriptor.</param>
+    /// <param name="fileName">The file name, used for error reporting.</param>
+    /// <returns>The amount of bytes read. The content is null-terminated.</returns>
+    size_t ProcFsCountersReader::ReadWholeFile(int fd, const char *fileName)
+    {
+        size_t total(0);
+
+        while (true)
+        {
+            // keep room for the null terminator:
+            if (total + 1 >= m_readBuffer.size())
+                m_readBuffer.resize(m_readBuffer.size() * 2);
+
+            auto count = pread(fd,
+                               m_readBuffer.data() + total,
+                               m_readBuffer.size() - total - 1,
+                               static_cast<off_t> (total));
+
+            if (count < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+
+                ThrowSysCallError("Failed to read file", fileName, errno);
+            }
+
+            if (count == 0)
+                break;
+
+            total += static_cast<size_t> (count);
+        }
+
+        m_readBuffer[total] = 0;
+        return total;
+    }
+
+
+    /// <summary>
+    /// Parses the value of a line in 'stat' that is formatted like "label value".
+    /// </summary>
+    /// <param name="content">The whole content of the file.</param>
+    /// <param name="label">The label of the line, followed by a blank.</param>
+    /// <param name="value">Receives the parsed value.</param>
+    /// <returns>Whether the line was found and its value could be parsed.</returns>
+    static bool ParseStatLine(const char *content, const char *label, uint64_t &value)
+    {
+        auto labelLen = strlen(label);
+
+        for (const char *str = content; *str != 0; str = SkipLine(str))
+        {
+            if (strncmp(str, label, labelLen) == 0)
+            {
+                str += labelLen;
+                return ParseUInt(str, value);
+            }
+        }
+
+        return false;
+    }
+
+
+    /// <summary>
+    /// Reads the aggregated CPU ticks and the count of processes from 'stat'.
+    /// Linux keeps no count of all processes other than the numeric entries of the procfs
+    /// root, which would be too costly to list in every collection. So the count is
+    /// of processes running or blocked waiting for I/O to complete.
+    /// </summary>
+    /// <param name="snapshot">The snapshot to receive the values.</param>
+    /// <returns>Whether the CPU ticks could be parsed.</returns>
+    bool ProcFsCountersReader::ReadStat(RawSnapshot &snapshot)
+    {
+        ReadWholeFile(m_fdStat, "stat");
+
+        const char *str = m_readBuffer.data();
+
+        uint64_t running, blocked;
+        if (ParseStatLine(str, "procs_running ", running) && ParseStatLine(str, "procs_blocked ", blocked))
+            snapshot.processCount = ValueWithQuality<uint16_t>{ static_cast<uint16_t> (running + blocked), Quality::Good };
+        else
+            snapshot.processCount = ValueWithQuality<uint16_t>{ 0, Quality::Error };
+
+        // the first line has the aggregate of all CPU's
+        if (strncmp(str, "cpu ", 4) != 0)
+            return false;
+
+        str += 4;
+
+        /* Fields are: user, nice, system, idle, iowait, irq, softirq & steal.
+        The following ones (guest & guest_nice) are already accounted in user time. */
+        std::array<uint64_t, 8> ticks;
+        for (auto &field : ticks)
+        {
+            if (!ParseUInt(str, field))
+                return false;
+        }
+
+        uint64_t total(0);
+        for (auto field : ticks)
+            total += field;
+
+        auto idle = ticks[3] + ticks[4];
+
+        snapshot.cpuTotalTicks = total;
+        snapshot.cpuBusyTicks = total - idle;
+        return true;
+    }
+
+
+    /// <summary>
+    /// Determines whether the device listed in 'diskstats' must be accounted.
+    /// Partitions, loop, ram & device-mapper devices are left out, because
+    /// their traffic is already accounted by the underlying physical disks.
+    /// Unlike partitions, whole disks have an entry in the 'block' directory
+    /// of sysfs, which is looked up only once for each device.
+    /// </summary>
+    /// <param name="line">The parsed line of the device.</param>
+    /// <returns>Whether this is a physical disk.</returns>
+    bool ProcFsCountersReader::IsPhysicalDisk(const DiskStatsLine &line)
+    {
+        for (auto prefix : { "loop", "ram", "zram", "dm-", "md" })
+        {
+            if (strncmp(line.devName, prefix, strlen(prefix)) == 0)
+                return false;
+        }
+
+        m_devName.assign(line.devName, line.devNameLen);
+
+        auto iter = m_isWholeDisk.find(m_devName);
+        if (iter != m_isWholeDisk.end())
+            return iter->second;
+
+        // sysfs replaces the slash of names like 'cciss/c0d0' by '!':
+        std::string path = m_sysBlockDir + '/' + m_devName;
+        std::replace(path.begin() + m_sysBlockDir.size() + 1, path.end(), '/', '!');
+
+        bool isWholeDisk = (access(path.c_str(), F_OK) == 0);
+        m_isWholeDisk.emplace(m_devName, isWholeDisk);
+        return isWholeDisk;
+    }
+
+
+    /// <summary>
+    /// Reads the total of sectors read and written from 'diskstats'.
+    /// </summary>
+    /// <param name="snapshot">The snapshot to receive the values.</param>
+    /// <returns>Whether the content could be parsed.</returns>
+    bool ProcFsCountersReader::ReadDiskSectors(RawSnapshot &snapshot)
+    {
+        ReadWholeFile(m_fdDiskStats, "diskstats");
+
+        m_diskStatsLines.clear();
+
+        const char *str = m_readBuffer.data();
+        while (*str != 0)
+        {
+            const char *lineStart = str;
+            uint64_t major, minor;
+
+            if (!ParseUInt(str, major) || !ParseUInt(str, minor))
+            {
+                str = SkipLine(lineStart);
+                continue;
+            }
+
+            while (*str == ' ' || *str == '\t')
+                ++str;
+
+            DiskStatsLine line;
+            line.devName = str;
+
+            while (*str != ' ' && *str != '\t' && *str != '\n' && *str != 0)
+                ++str;
+
+            line.devNameLen = static_cast<size_t> (str - line.devName);
+
+            /* Fields are: reads completed, reads merged, sectors read, time reading,
+            writes completed, writes merged, sectors written... (and more we ignore) */
+            std::array<uint64_t, 7> fields;
+            bool parsed(true);
+            for (auto &field : fields)
+            {
+                if (!ParseUInt(str, field))
+                {
+                    parsed = false;
+                    break;
+                }
+            }
+
+            if (parsed)
+            {
+                line.sectorsRead = fields[2];
+                line.sectorsWritten = fields[6];
+                m_diskStatsLines.push_back(line);
+            }
+
+            str = SkipLine(str);
+        }
+
+        if (m_diskStatsLines.empty())
+            return false;
+
+        snapshot.diskSectorsRead = 0;
+        snapshot.diskSectorsWritten = 0;
+
+        for (auto &line : m_diskStatsLines)
+        {
+            if (IsPhysicalDisk(line))
+            {
+                snapshot.diskSectorsRead += line.sectorsRead;
+                snapshot.diskSectorsWritten += line.sectorsWritten;
+            }
+        }
+
+        return true;
+    }
+
+
+    /// <summary>
+    /// Reads the available memory from 'meminfo'.
+    /// </summary>
+    /// <returns>The available memory in MB.</returns>
+    ValueWithQuality<float> ProcFsCountersReader::ReadMemAvailableMBytes()
+    {
+        ReadWholeFile(m_fdMemInfo, "meminfo");
+
+        const char *label = "MemAvailable:";
+        const char *str = strstr(m_readBuffer.data(), label);
+
+        uint64_t kbytes;
+        if (str != nullptr)
+        {
+            str += strlen(label);
+
+            if (ParseUInt(str, kbytes))
+                return ValueWithQuality<float>{ kbytes / 1024.0F, Quality::Good };
+        }
+
+        return ValueWithQuality<float>{ 0.0F, Quality::Error };
+    }
+
+
+    /// <summary>
+    /// Reads the count of threads from 'loadavg', where the fourth field
+    /// is formatted like "running/total" kernel scheduling entities.
+    /// </summary>
+    /// <returns>The count of threads in the system.</returns>
+    ValueWithQuality<uint16_t> ProcFsCountersReader::ReadThreadCount()
+    {
+        ReadWholeFile(m_fdLoadAvg, "loadavg");
+
+        const char *str = strchr(m_readBuffer.data(), '/');
+
+        uint64_t count;
+        if (str != nullptr && ParseUInt(++str, count))
+            return ValueWithQuality<uint16_t>{ static_cast<uint16_t> (count), Quality::Good };
+
+        return ValueWithQuality<uint16_t>{ 0, Quality::Error };
+    }
+
+
+    /// <summary>
+    /// Takes a snapshot of the raw values of cumulative counters.
+    /// </summary>
+    /// <param name="snapshot">The snapshot to receive the values.</param>
+    void ProcFsCountersReader::TakeSnapshot(RawSnapshot &snapshot)
+    {
+        snapshot.time = std::chrono::steady_clock::now();
+        snapshot.cpuIsValid = ReadStat(snapshot);
+        snapshot.diskIsValid = ReadDiskSectors(snapshot);
+    }
+
+
+    /// <summary>
+    /// Gets the current values for the performance counters. Rates are calculated
+    /// against the previous collection (or the creation of the reader, in the first
+    /// call), so this call never blocks waiting for a second sample.
+    /// </summary>
+    /// <returns>The values for the set of monitored system performance counters.</returns>
+    PerfCountersValues ProcFsCountersReader::GetCurrentValues()
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            PerfCountersValues values;
+            values.time = std::chrono::system_clock().now();
+
+            RawSnapshot snapshot;
+            TakeSnapshot(snapshot);
+
+            // CPU usage:
+
+            if (snapshot.cpuIsValid && m_lastSnapshot.cpuIsValid)
+            {
+                auto deltaTotal = snapshot.cpuTotalTicks - m_lastSnapshot.cpuTotalTicks;
+                auto deltaBusy = snapshot.cpuBusyTicks - m_lastSnapshot.cpuBusyTicks;
+
+                if (deltaTotal > 0 && snapshot.cpuTotalTicks > m_lastSnapshot.cpuTotalTicks)
+                {
+                    values.cpuTotalUsage.value = static_cast<float> (100.0 * deltaBusy / deltaTotal);
+                    values.cpuTotalUsage.quality = Quality::Good;
+                }
+                else
+                {
+                    // too little time has passed since the last collection
+                    values.cpuTotalUsage.value = 0.0F;
+                    values.cpuTotalUsage.quality = Quality::Invalid;
+                }
+            }
+            else
+            {
+                values.cpuTotalUsage.value = 0.0F;
+                values.cpuTotalUsage.quality = Quality::Error;
+            }
+
+            // Disk transfer rates:
+
+            using namespace std::chrono;
+            auto elapsedSecs = duration_cast<duration<double>>(snapshot.time - m_lastSnapshot.time).count();
+
+            if (snapshot.diskIsValid && m_lastSnapshot.diskIsValid && elapsedSecs > 0.0)
+            {
+                auto quality = (snapshot.diskSectorsRead >= m_lastSnapshot.diskSectorsRead
+                                && snapshot.diskSectorsWritten >= m_lastSnapshot.diskSectorsWritten)
+                    ? Quality::Good
+                    : Quality::Invalid; // a disk has been removed
+
+                values.diskReadBytesPerSec.quality = quality;
+                values.diskWriteBytesPerSec.quality = quality;
+
+                if (quality == Quality::Good)
+                {
+                    values.diskReadBytesPerSec.value = static_cast<float> (
+                        (snapshot.diskSectorsRead - m_lastSnapshot.diskSectorsRead) * diskStatsSectorSize / elapsedSecs
+                    );
+
+                    values.diskWriteBytesPerSec.value = static_cast<float> (
+                        (snapshot.diskSectorsWritten - m_lastSnapshot.diskSectorsWritten) * diskStatsSectorSize / elapsedSecs
+                    );
+                }
+                else
+                {
+                    values.diskReadBytesPerSec.value = 0.0F;
+                    values.diskWriteBytesPerSec.value = 0.0F;
+                }
+            }
+            else
+            {
+                values.diskReadBytesPerSec = ValueWithQuality<float>{ 0.0F, Quality::Error };
+                values.diskWriteBytesPerSec = ValueWithQuality<float>{ 0.0F, Quality::Error };
+            }
+
+            m_lastSnapshot = snapshot;
+
+            // Instantaneous values:
+
+            values.memAvailableMBytes = ReadMemAvailableMBytes();
+            values.processCount = snapshot.processCount;
+            values.threadCount = ReadThreadCount();
+
+            return values;
+        }
+        catch (IAppException &)
+        {
+            throw; // just forward already prepared application exceptions
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when reading performance counters from procfs: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    /// <summary>
+    /// Gets the current values for the performance counters, and adds them as a sample to a batch.
+    /// </summary>
+    /// <param name="batch">The batch that receives the sample. If it has no samples, its
+    /// columns are set to be the whole catalog, otherwise they must already be so.</param>
+    void ProcFsCountersReader::GetCurrentValues(SamplesBatch &batch)
+    {
+        if (batch.GetSampleCount() == 0)
+            SetBuiltInCounterIds(batch);
+
+        AddSampleTo(batch, GetCurrentValues());
+    }
+
+}// end of namespace application
+
+#endif // end of Linux only code
@@ -0,0 +1,110 @@
+#ifndef __ProcFsCountersReader_h__ // header guard
+#define __ProcFsCountersReader_h__
+
+#include "CommonDataExchange.h"
+#include <cinttypes>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+
+namespace application
+{
+    /// <summary>
+    /// Reads system performance counters from the Linux proc filesystem.
+    /// The files are opened only once, and then re-read at every collection
+    /// using 'pread', so collecting the stats costs just a few system calls.
+    /// The sys filesystem is only looked up when a new block device shows up.
+    /// </summary>
+    /// <seealso cref="notcopiable" />
+    class ProcFsCountersReader
+    {
+    private:
+
+        std::string m_rootDir;
+        std::string m_sysBlockDir;
+
+        std::vector<PerfCounterDescriptor> m_catalog;
+
+        int m_fdStat;
+        int m_fdMemInfo;
+        int m_fdDiskStats;
+        int m_fdLoadAvg;
+
+        std::vector<char> m_readBuffer;
+
+        /// <summary>
+        /// Holds the parsed fields of a line in 'diskstats'.
+        /// </summary>
+        struct DiskStatsLine
+        {
+            const char *devName;
+            size_t devNameLen;
+            uint64_t sectorsRead;
+            uint64_t sectorsWritten;
+        };
+
+        std::vector<DiskStatsLine> m_diskStatsLines;
+
+        // whether each device listed in 'diskstats' is a whole disk:
+        std::map<std::string, bool> m_isWholeDisk;
+        std::string m_devName;
+
+        /// <summary>
+        /// Raw values of cumulative counters, which are
+        /// needed to calculate rates between collections.
+        /// </summary>
+        struct RawSnapshot
+        {
+            std::chrono::time_point<std::chrono::steady_clock> time;
+            uint64_t cpuBusyTicks;
+            uint64_t cpuTotalTicks;
+            uint64_t diskSectorsRead;
+            uint64_t diskSectorsWritten;
+            ValueWithQuality<uint16_t> processCount; // not cumulative, but read along with the CPU ticks
+            bool cpuIsValid;
+            bool diskIsValid;
+        };
+
+        RawSnapshot m_lastSnapshot;
+
+        void CloseFiles();
+
+        int OpenProcFile(const char *fileName) const;
+
+        size_t ReadWholeFile(int fd, const char *fileName);
+
+        bool ReadStat(RawSnapshot &snapshot);
+
+        bool IsPhysicalDisk(const DiskStatsLine &line);
+
+        bool ReadDiskSectors(RawSnapshot &snapshot);
+
+        ValueWithQuality<float> ReadMemAvailableMBytes();
+
+        ValueWithQuality<uint16_t> ReadThreadCount();
+
+        void TakeSnapshot(RawSnapshot &snapshot);
+
+    public:
+
+        ProcFsCountersReader(const char *procRootDir = "/proc", const char *sysRootDir = "/sys");
+
+        ProcFsCountersReader(const ProcFsCountersReader &) = delete;
+
+        ~ProcFsCountersReader();
+
+        /// <summary>
+        /// Gets the catalog of performance counters, which has only the built-in ones.
+        /// </summary>
+        /// <returns>The descriptors, in the same order as the collected values.</returns>
+        const std::vector<PerfCounterDescriptor> &GetCatalog() const { return m_catalog; }
+
+        PerfCountersValues GetCurrentValues();
+
+        void GetCurrentValues(SamplesBatch &batch);
+    };
+
+}// end of namespace application
+
+#endif // end of header guard
@@ -0,0 +1,189 @@
+#include "stdafx.h"
+#include "SelfMonitor.h"
+#include <cstdio>
+
+#ifdef _WIN32
+#   include <Windows.h>
+#   include <Psapi.h>
+#else
+#   include <sys/resource.h>
+#   include <unistd.h>
+#endif
+
+namespace application
+{
+    using namespace std::chrono;
+
+
+    static const std::array<const wchar_t *, numSelfMetrics> selfMetricLabels =
+    {
+        L"mscclient_collect_millisecs",
+        L"mscclient_send_millisecs",
+        L"mscclient_cpu_usage_percentage",
+        L"mscclient_resident_memory_kbytes",
+        L"mscclient_spool_depth"
+    };
+
+
+    /// <summary>
+    /// Converts an enumerated code for metric of the client about itself into a name for statistic.
+    /// </summary>
+    /// <param name="code">The <see cref="SelfMetricCode"/> code.</param>
+    /// <returns>The corresponding name of statistic.</returns>
+    const wchar_t *ToStatName(SelfMetricCode code)
+    {
+        return selfMetricLabels[static_cast<uint32_t> (code)];
+    }
+
+
+    /// <summary>
+    /// Gets how much CPU time (user and kernel) this process has used so far.
+    /// </summary>
+    /// <returns>The CPU time in seconds, or a negative value when not available.</returns>
+    double SelfMonitor::GetProcessCpuSecs()
+    {
+#ifdef _WIN32
+        FILETIME creationTime, exitTime, kernelTime, userTime;
+        if (GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime) == FALSE)
+            return -1.0;
+
+        // FILETIME is in units of 100 ns:
+        auto toSecs = [](const FILETIME &ft)
+        {
+            return ((static_cast<uint64_t> (ft.dwHighDateTime) << 32) | ft.dwLowDateTime) / 1e7;
+        };
+
+        return toSecs(kernelTime) + toSecs(userTime);
+#else
+        rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return -1.0;
+
+        return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+            + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+#endif
+    }
+
+
+    /// <summary>
+    /// Gets how much memory of this process is resident (the working set).
+    /// </summary>
+    /// <returns>The resident memory in kilobytes, or a negative value when not available.</returns>
+    double SelfMonitor::GetResidentMemoryKBytes()
+    {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters;
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof counters) == FALSE)
+            return -1.0;
+
+        return counters.WorkingSetSize / 1024.0;
+#else
+        // the second field in 'statm' is the count of resident pages:
+        auto file = fopen("/proc/self/statm", "r");
+        if (file == nullptr)
+            return -1.0;
+
+        unsigned long totalPages, residentPages;
+        auto count = fscanf(file, "%lu %lu", &totalPages, &residentPages);
+        fclose(file);
+
+        if (count != 2)
+            return -1.0;
+
+        return residentPages * (sysconf(_SC_PAGESIZE) / 1024.0);
+#endif
+    }
+
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="SelfMonitor"/> class.
+    /// The CPU usage in the first snapshot is measured since now.
+    /// </summary>
+    SelfMonitor::SelfMonitor()
+        : m_longestCollect(steady_clock::duration::zero())
+        , m_hasCollect(false)
+        , m_lastSnapshotTime(steady_clock::now())
+        , m_lastCpuSecs(GetProcessCpuSecs())
+        , m_lastSendMicrosecs(-1)
+        , m_spoolDepth(-1)
+    {
+    }
+
+
+    /// <summary>
+    /// Records how long a collection of counters took. Only the longest
+    /// since the last snapshot is reported. Called by the collection thread.
+    /// </summary>
+    /// <param name="elapsedTime">The duration of the collection.</param>
+    void SelfMonitor::RecordCollect(steady_clock::duration elapsedTime)
+    {
+        if (!m_hasCollect || elapsedTime > m_longestCollect)
+            m_longestCollect = elapsedTime;
+
+        m_hasCollect = true;
+    }
+
+
+    /// <summary>
+    /// Records the round-trip of a request to the server, regardless of its
+    /// outcome (a timeout is also overhead). Called by the sending thread.
+    /// </summary>
+    /// <param name="roundTrip">The duration of the request.</param>
+    void SelfMonitor::RecordSend(steady_clock::duration roundTrip)
+    {
+        m_lastSendMicrosecs.store(duration_cast<microseconds>(roundTrip).count());
+    }
+
+
+    /// <summary>
+    /// Records how many samples are waiting in the spool. Called by the sending thread.
+    /// </summary>
+    /// <param name="count">The count of samples in the spool.</param>
+    void SelfMonitor::RecordSpoolDepth(size_t count)
+    {
+        m_spoolDepth.store(static_cast<int64_t> (count));
+    }
+
+
+    /// <summary>
+    /// Takes a snapshot of the metrics. The longest collection and the CPU usage cover
+    /// the time since the last snapshot. A metric not yet measured has unknown quality.
+    /// Called by the collection thread, once per cycle.
+    /// </summary>
+    /// <param name="metrics">Where to save the metrics, indexed by <see cref="SelfMetricCode"/>.</param>
+    void SelfMonitor::TakeSnapshot(std::array<ValueWithQuality<float>, numSelfMetrics> &metrics)
+    {
+        auto setMetric = [&metrics](SelfMetricCode code, double value, bool isKnown)
+        {
+            auto &metric = metrics[static_cast<uint32_t> (code)];
+            metric.value = isKnown ? static_cast<float> (value) : 0.0F;
+            metric.quality = isKnown ? Quality::Good : Quality::Unknown;
+        };
+
+        setMetric(SelfMetricCode::CollectMillisecs,
+                  duration<double, std::milli>(m_longestCollect).count(),
+                  m_hasCollect);
+
+        auto sendMicrosecs = m_lastSendMicrosecs.load();
+        setMetric(SelfMetricCode::SendMillisecs, sendMicrosecs / 1000.0, sendMicrosecs >= 0);
+
+        auto now = steady_clock::now();
+        auto cpuSecs = GetProcessCpuSecs();
+        auto elapsedSecs = duration<double>(now - m_lastSnapshotTime).count();
+
+        setMetric(SelfMetricCode::CpuUsage,
+                  100.0 * (cpuSecs - m_lastCpuSecs) / elapsedSecs,
+                  cpuSecs >= 0.0 && m_lastCpuSecs >= 0.0 && elapsedSecs > 0.0);
+
+        auto residentKBytes = GetResidentMemoryKBytes();
+        setMetric(SelfMetricCode::ResidentMemory, residentKBytes, residentKBytes >= 0.0);
+
+        auto spoolDepth = m_spoolDepth.load();
+        setMetric(SelfMetricCode::SpoolDepth, static_cast<double> (spoolDepth), spoolDepth >= 0);
+
+        m_lastSnapshotTime = now;
+        m_lastCpuSecs = cpuSecs;
+        m_hasCollect = false;
+    }
+
+}// end of namespace application
@@ -0,0 +1,53 @@
+#ifndef __SelfMonitor_h__ // header guard
+#define __SelfMonitor_h__
+
+#include "CommonDataExchange.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+
+namespace application
+{
+    /// <summary>
+    /// Measures the overhead of the client itself, as enumerated by <see cref="SelfMetricCode"/>,
+    /// so it can be proven to stay within budget across the fleet. The collection thread records
+    /// how long collections take and takes the snapshots, while the sending thread records the
+    /// round-trip of requests and the depth of the spool.
+    /// </summary>
+    /// <seealso cref="notcopiable" />
+    class SelfMonitor
+    {
+    private:
+
+        // written by the collection thread only:
+        std::chrono::steady_clock::duration m_longestCollect;
+        bool m_hasCollect;
+        std::chrono::steady_clock::time_point m_lastSnapshotTime;
+        double m_lastCpuSecs;
+
+        // written by the sending thread (negative while not yet recorded):
+        std::atomic<int64_t> m_lastSendMicrosecs;
+        std::atomic<int64_t> m_spoolDepth;
+
+        static double GetProcessCpuSecs();
+
+        static double GetResidentMemoryKBytes();
+
+    public:
+
+        SelfMonitor();
+
+        SelfMonitor(const SelfMonitor &) = delete;
+
+        void RecordCollect(std::chrono::steady_clock::duration elapsedTime);
+
+        void RecordSend(std::chrono::steady_clock::duration roundTrip);
+
+        void RecordSpoolDepth(size_t count);
+
+        void TakeSnapshot(std::array<ValueWithQuality<float>, numSelfMetrics> &metrics);
+    };
+
+}// end of namespace application
+
+#endif // end of header guard
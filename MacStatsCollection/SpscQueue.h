@@ -0,0 +1,113 @@
+#ifndef __SpscQueue_h__ // header guard
+#define __SpscQueue_h__
+
+#include <atomic>
+#include <vector>
+#include <cassert>
+
+namespace application
+{
+    /// <summary>
+    /// A bounded lock-free queue for a single producer thread and a single consumer thread.
+    /// Unlike the queue of tasks in the server, it never allocates after construction: the
+    /// items live in a ring of slots that the producer fills in place and the consumer reads
+    /// in place, so whatever memory they hold is recycled.
+    /// </summary>
+    /// <seealso cref="notcopiable" />
+    template <typename ItemType>
+    class SpscQueue
+    {
+    private:
+
+        std::vector<ItemType> m_slots; // one slot is always free, to tell full from empty
+
+        // each index is written by a single thread, so they are kept apart in memory:
+        alignas(64) std::atomic<size_t> m_head; // next slot to read, written by the consumer
+        alignas(64) std::atomic<size_t> m_tail; // next slot to write, written by the producer
+
+        size_t Next(size_t index) const { return (index + 1 < m_slots.size()) ? index + 1 : 0; }
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the <see cref="SpscQueue"/> class.
+        /// </summary>
+        /// <param name="capacity">How many items the queue can hold.</param>
+        explicit SpscQueue(size_t capacity)
+            : m_slots(capacity + 1)
+            , m_head(0)
+            , m_tail(0)
+        {
+            assert(capacity > 0);
+        }
+
+        SpscQueue(const SpscQueue &) = delete;
+
+        size_t GetCapacity() const { return m_slots.size() - 1; }
+
+        /// <summary>
+        /// Gets how many items are in the queue. It is exact only when
+        /// called by the producer or the consumer, and there is no other.
+        /// </summary>
+        size_t GetCount() const
+        {
+            auto head = m_head.load(std::memory_order_acquire);
+            auto tail = m_tail.load(std::memory_order_acquire);
+            return (tail >= head) ? tail - head : tail + m_slots.size() - head;
+        }
+
+        /// <summary>
+        /// Gets the free slot at the end of the queue for the producer to fill in place.
+        /// </summary>
+        /// <returns>The slot, or null when the queue is full.</returns>
+        ItemType *BeginPush()
+        {
+            auto tail = m_tail.load(std::memory_order_relaxed);
+
+            if (Next(tail) == m_head.load(std::memory_order_acquire))
+                return nullptr;
+
+            return &m_slots[tail];
+        }
+
+        /// <summary>
+        /// Publishes to the consumer the slot filled after <see cref="BeginPush"/>.
+        /// </summary>
+        void EndPush()
+        {
+            auto tail = m_tail.load(std::memory_order_relaxed);
+            m_tail.store(Next(tail), std::memory_order_release);
+        }
+
+        /// <summary>
+        /// Gets an item in the queue for the consumer to read in place.
+        /// </summary>
+        /// <param name="offset">The position of the item, counting from the front.</param>
+        /// <returns>The item, or null when the queue does not have that many.</returns>
+        ItemType *Peek(size_t offset = 0)
+        {
+            auto head = m_head.load(std::memory_order_relaxed);
+            auto tail = m_tail.load(std::memory_order_acquire);
+            auto count = (tail >= head) ? tail - head : tail + m_slots.size() - head;
+
+            if (offset >= count)
+                return nullptr;
+
+            return &m_slots[(head + offset) % m_slots.size()];
+        }
+
+        /// <summary>
+        /// Releases to the producer the slots of items read by the consumer.
+        /// </summary>
+        /// <param name="count">How many items to remove from the front of the queue.</param>
+        void Pop(size_t count = 1)
+        {
+            assert(count <= GetCount());
+            auto head = m_head.load(std::memory_order_relaxed);
+            m_head.store((head + count) % m_slots.size(), std::memory_order_release);
+        }
+    };
+
+}// end of namespace application
+
+#endif // end of header guard
@@ -0,0 +1,317 @@
+#include "stdafx.h"
+#include "StatIdDictionary.h"
+#include <3FD\callstacktracer.h>
+#include <3FD\exceptions.h>
+#include <3FD\logger.h>
+#include <3FD\configuration.h>
+#include <algorithm>
+#include <sstream>
+
+namespace application
+{
+    using namespace _3fd;
+    using namespace _3fd::core;
+
+
+    // The length of the column with the name in the table of statistics
+    static const size_t maxStatNameLength(50);
+
+
+    std::unique_ptr<StatIdDictionary> StatIdDictionary::singleton;
+
+    std::mutex StatIdDictionary::singletonCreationMutex;
+
+
+    /// <summary>
+    /// Provides access to the singleton.
+    /// </summary>
+    /// <returns>A reference to the singleton.</returns>
+    StatIdDictionary & StatIdDictionary::GetInstance()
+    {
+        if (singleton)
+            return *singleton;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            std::lock_guard<std::mutex> lock(singletonCreationMutex);
+
+            if (!singleton)
+            {
+                singleton.reset(
+                    // use connection string defined in the main configuration file
+                    new StatIdDictionary(
+                        AppConfig::GetSettings().application.GetString("dbConnString", "NOT SET")
+                    )
+                );
+            }
+
+            return *singleton;
+        }
+        catch (IAppException &)
+        {
+            throw; // just forward already prepared application exceptions
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when instantiating dictionary of stat ID's: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="StatIdDictionary"/> class.
+    /// </summary>
+    /// <param name="connString">The database connection string.</param>
+    StatIdDictionary::StatIdDictionary(const std::string &connString)
+    try :
+        m_dbSession("ODBC", connString)
+    {
+        CALL_STACK_TRACE;
+
+        // the sessions work as tokens, so their ID's must not be predictable:
+        std::random_device seeder;
+        std::seed_seq seed{ seeder(), seeder(), seeder(), seeder(), seeder(), seeder(), seeder(), seeder() };
+        m_sessionIdGenerator.seed(seed);
+
+        Logger::Write(
+            "Dictionary of stat ID's has succesfully connected to database via ODBC",
+            connString,
+            Logger::PRIO_INFORMATION
+        );
+    }
+    catch (Poco::Data::DataException &ex)
+    {
+        CALL_STACK_TRACE;
+        std::ostringstream oss;
+        oss << "Failed to create dictionary of stat ID's. POCO C++ reported a data access error: " << ex.name();
+        throw AppException<std::runtime_error>(oss.str(), ex.message());
+    }
+    catch (Poco::Exception &ex)
+    {
+        CALL_STACK_TRACE;
+        std::ostringstream oss;
+        oss << "Failed to create dictionary of stat ID's. POCO C++ reported a generic error - " << ex.name();
+
+        if (!ex.message().empty())
+            oss << ": " << ex.message();
+
+        throw AppException<std::runtime_error>(oss.str());
+    }
+    catch (std::exception &ex)
+    {
+        CALL_STACK_TRACE;
+        std::ostringstream oss;
+        oss << "Generic failure prevented creation of dictionary of stat ID's: " << ex.what();
+        throw AppException<std::runtime_error>(oss.str());
+    }
+
+
+    /// <summary>
+    /// Finalizes the singleton.
+    /// </summary>
+    void StatIdDictionary::Finalize()
+    {
+        singleton.reset(nullptr);
+    }
+
+
+    // Gets the ID of a statistic from cache, or else from database (inserting it when missing)
+    int16_t StatIdDictionary::GetStatId(const std::wstring &statName)
+    {
+        auto iter = m_cachedStatIds.find(statName);
+        if (m_cachedStatIds.end() != iter)
+            return iter->second;
+
+        using namespace Poco::Data::Keywords;
+
+        /* The writers of stats insert new names too, in parallel. The name is unique, so when
+        one of them inserts it first, the insertion fails and the ID is selected all the same: */
+        m_dbSession << R"(
+            begin try
+                if not exists (select 1 from Statistic where statName = ?)
+                    insert into Statistic (statName) values (?);
+            end try
+            begin catch
+                if error_number() not in (2601, 2627)
+                    throw;
+            end catch;
+            )"
+            , useRef(statName)
+            , useRef(statName)
+            , now;
+
+        int16_t statId(0);
+
+        m_dbSession << "select statId from Statistic where statName = ?;"
+            , into(statId)
+            , useRef(statName)
+            , now;
+
+        m_cachedStatIds.emplace(statName, statId);
+        return statId;
+    }
+
+
+    /// <summary>
+    /// Opens a session for a machine, assigning the ID's to the names of the stats it might send.
+    /// A machine has a single session, so this replaces the one previously opened (if any).
+    /// </summary>
+    /// <param name="machine">The machine, which must be already authenticated.</param>
+    /// <param name="statNames">The names of the stats.</param>
+    /// <param name="statIds">Where to save the ID's, in the same order of the names.</param>
+    /// <returns>The session, or zero when the request is rejected (because of an invalid name).</returns>
+    uint64_t StatIdDictionary::OpenSession(const std::wstring &machine,
+                                           const std::vector<std::wstring> &statNames,
+                                           std::vector<int16_t> &statIds)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            statIds.clear();
+
+            for (auto &name : statNames)
+            {
+                if (name.empty() || name.length() > maxStatNameLength)
+                    return 0;
+            }
+
+            statIds.reserve(statNames.size());
+
+            {// resolve the names:
+                std::lock_guard<std::mutex> lock(m_dbAccessMutex);
+
+                if (!m_dbSession.isConnected())
+                    m_dbSession.reconnect();
+
+                for (auto &name : statNames)
+                    statIds.push_back(GetStatId(name));
+            }
+
+            Session session;
+            session.machine = machine;
+            session.statIds = statIds;
+            std::sort(session.statIds.begin(), session.statIds.end());
+
+            // Exclusive lock for write access
+            std::unique_lock<std::shared_mutex> lock(m_sessionsSharedMutex);
+
+            uint64_t sessionId;
+            do
+            {
+                sessionId = m_sessionIdGenerator();
+            } while (sessionId == 0 || m_sessions.count(sessionId) != 0);
+
+            auto iter = m_sessionByMachine.find(machine);
+            if (m_sessionByMachine.end() != iter)
+            {
+                m_sessions.erase(iter->second);
+                iter->second = sessionId;
+            }
+            else
+                m_sessionByMachine.emplace(machine, sessionId);
+
+            m_sessions.emplace(sessionId, std::move(session));
+
+            return sessionId;
+        }
+        catch (Poco::Data::DataException &ex)
+        {
+            std::ostringstream oss;
+            oss << "Failed to open session for stat ID's. "
+                   "POCO C++ reported a data access error: " << ex.name();
+
+            throw AppException<std::runtime_error>(oss.str(), ex.message());
+        }
+        catch (Poco::Exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Failed to open session for stat ID's. "
+                   "POCO C++ reported a generic error - " << ex.name() << ": " << ex.message();
+
+            throw AppException<std::runtime_error>(oss.str());
+        }
+        catch (std::system_error &ex)
+        {
+            std::ostringstream oss;
+            oss << "System error prevented opening session for stat ID's: "
+                << StdLibExt::GetDetailsFromSystemError(ex);
+
+            throw AppException<std::runtime_error>(oss.str());
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure prevented opening session for stat ID's: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    /// <summary>
+    /// Resolves the session of packages whose stats are identified by ID, setting their machine.
+    /// </summary>
+    /// <param name="sessionId">The session.</param>
+    /// <param name="packages">The packages, decoded from a request made in the session.</param>
+    /// <returns>
+    /// Whether the packages are accepted, which is when the session is known
+    /// and all their ID's were assigned in it (so they cannot be forged).
+    /// </returns>
+    BinaryStatus StatIdDictionary::ResolveSession(uint64_t sessionId, std::vector<StatsPackage> &packages) const
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            // Shared lock for read access
+            std::shared_lock<std::shared_mutex> lock(m_sessionsSharedMutex);
+
+            auto iter = m_sessions.find(sessionId);
+            if (m_sessions.end() == iter)
+                return BinaryStatus::UnknownSession;
+
+            auto &session = iter->second;
+
+            auto isAssigned = [&session](int16_t statId)
+            {
+                return std::binary_search(session.statIds.begin(), session.statIds.end(), statId);
+            };
+
+            for (auto &package : packages)
+            {
+                for (auto &sample : package.statSamplesFloat32)
+                {
+                    if (!isAssigned(sample.statId))
+                        return BinaryStatus::Rejected;
+                }
+
+                for (auto &sample : package.statSamplesInt32)
+                {
+                    if (!isAssigned(sample.statId))
+                        return BinaryStatus::Rejected;
+                }
+
+                package.machine = session.machine;
+            }
+
+            return BinaryStatus::Accepted;
+        }
+        catch (std::system_error &ex)
+        {
+            std::ostringstream oss;
+            oss << "System error prevented resolving session for stat ID's: " << StdLibExt::GetDetailsFromSystemError(ex);
+            throw AppException<std::runtime_error>(oss.str());
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure prevented resolving session for stat ID's: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+}// end of namespace application
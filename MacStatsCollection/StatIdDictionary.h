@@ -0,0 +1,86 @@
+#ifndef __StatIdDictionary_h__ // header guard
+#define __StatIdDictionary_h__
+
+#include "Utilities.h"
+#include "BinaryCodec.h"
+#include <POCO\Data\Session.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+
+namespace application
+{
+    using std::string;
+
+
+    /// <summary>
+    /// Assigns to the stat names of each client the ID of the statistic in database, so the
+    /// client can send the stats identified by ID in a session, and the server can write them
+    /// into storage without looking up the names. The IDs are kept in cache, as well as the
+    /// sessions, which are not persisted: upon restart of the server, the clients open new ones.
+    /// </summary>
+    /// <seealso cref="OdbcClient" />
+    /// <seealso cref="notcopiable" />
+    class StatIdDictionary : OdbcClient
+    {
+    private:
+
+        /// <summary>
+        /// A session opened for a client.
+        /// </summary>
+        struct Session
+        {
+            InternedName machine;
+            std::vector<int16_t> statIds; // sorted
+        };
+
+        Poco::Data::Session m_dbSession;
+
+        // the access to database and to the cache of IDs is serialized by this mutex
+        std::mutex m_dbAccessMutex;
+
+        std::map<std::wstring, int16_t> m_cachedStatIds;
+
+        std::map<uint64_t, Session> m_sessions;
+
+        std::map<std::wstring, uint64_t> m_sessionByMachine;
+
+        std::mt19937_64 m_sessionIdGenerator;
+
+        /// <summary>
+        /// Access to the sessions will be controlled
+        /// by this "multiple readers, single writer" lock.
+        /// </summary>
+        mutable std::shared_mutex m_sessionsSharedMutex;
+
+        static std::unique_ptr<StatIdDictionary> singleton;
+
+        static std::mutex singletonCreationMutex;
+
+        StatIdDictionary(const string &connString);
+
+        int16_t GetStatId(const std::wstring &statName);
+
+    public:
+
+        StatIdDictionary(const StatIdDictionary &) = delete;
+
+        static StatIdDictionary &GetInstance();
+
+        static void Finalize();
+
+        uint64_t OpenSession(const std::wstring &machine,
+                             const std::vector<std::wstring> &statNames,
+                             std::vector<int16_t> &statIds);
+
+        BinaryStatus ResolveSession(uint64_t sessionId, std::vector<StatsPackage> &packages) const;
+    };
+
+}// end of namespace application
+
+#endif // end of header guard
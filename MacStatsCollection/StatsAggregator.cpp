@@ -0,0 +1,156 @@
+#include "stdafx.h"
+#include "StatsAggregator.h"
+#include <3FD/callstacktracer.h>
+#include <3FD/exceptions.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+namespace application
+{
+    using namespace _3fd::core;
+
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="StatsAggregator"/> class.
+    /// </summary>
+    /// <param name="capacity">How many samples the ring buffer can hold. Once it is
+    /// full, the oldest samples are overwritten. Ideally it should be the amount of
+    /// samples taken in a send cycle.</param>
+    StatsAggregator::StatsAggregator(size_t capacity)
+        : m_capacity(capacity)
+        , m_nextPos(0)
+        , m_count(0)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            assert(capacity > 0);
+            m_sortBuffer.reserve(capacity);
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when creating aggregator of stats: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    /// <summary>
+    /// Adds a sample to the ring buffer. The counters in the first sample define the
+    /// columns of the ring buffer (that is when it gets allocated), and all the next
+    /// samples must have the same counters.
+    /// </summary>
+    /// <param name="batch">The batch containing the sample to add.</param>
+    /// <param name="row">The row of the sample in the batch.</param>
+    void StatsAggregator::AddSample(const SamplesBatch &batch, size_t row)
+    {
+        auto counterCount = batch.GetCounterCount();
+
+        if (m_counterIds.empty())
+        {
+            m_counterIds = batch.counterIds;
+            m_ringValues.resize(m_capacity * counterCount);
+            m_ringQualities.resize(m_capacity * counterCount);
+            m_mins.resize(counterCount);
+            m_maxs.resize(counterCount);
+            m_sums.resize(counterCount);
+            m_goodCounts.resize(counterCount);
+        }
+
+        assert(m_counterIds == batch.counterIds);
+
+        auto values = batch.GetValues(row);
+        std::copy(values, values + counterCount, m_ringValues.data() + m_nextPos * counterCount);
+
+        auto qualities = batch.GetQualities(row);
+        std::copy(qualities, qualities + counterCount, m_ringQualities.data() + m_nextPos * counterCount);
+
+        m_nextPos = (m_nextPos + 1) % m_capacity;
+
+        if (m_count < m_capacity)
+            ++m_count;
+    }
+
+
+    /// <summary>
+    /// Summarizes the samples accumulated so far, using only the samples of good
+    /// quality, then empties the ring buffer for the next cycle. Min, max and mean
+    /// are calculated by loops over all counters of each sample without branches,
+    /// and only the percentile needs to go through the samples of every counter.
+    /// </summary>
+    /// <param name="aggregates">Receives the aggregates for all performance counters.</param>
+    void StatsAggregator::Summarize(SamplesAggregates &aggregates)
+    {
+        const auto counterCount = m_counterIds.size();
+
+        aggregates.sampleCount = static_cast<uint32_t> (m_count);
+        aggregates.counterIds = m_counterIds;
+        aggregates.values.assign(counterCount * numSupAggregates, 0.0F);
+        aggregates.qualities.assign(counterCount, Quality::Unknown);
+
+        std::fill(m_mins.begin(), m_mins.end(), (std::numeric_limits<double>::max)());
+        std::fill(m_maxs.begin(), m_maxs.end(), std::numeric_limits<double>::lowest());
+        std::fill(m_sums.begin(), m_sums.end(), 0.0);
+        std::fill(m_goodCounts.begin(), m_goodCounts.end(), 0);
+
+        // the samples in the ring occupy its first rows, regardless of their order:
+        for (size_t row = 0; row < m_count; ++row)
+        {
+            auto values = m_ringValues.data() + row * counterCount;
+            auto qualities = m_ringQualities.data() + row * counterCount;
+
+            for (size_t idx = 0; idx < counterCount; ++idx)
+            {
+                bool isGood = (qualities[idx] == Quality::Good);
+                auto value = values[idx];
+                m_mins[idx] = (isGood && value < m_mins[idx]) ? value : m_mins[idx];
+                m_maxs[idx] = (isGood && value > m_maxs[idx]) ? value : m_maxs[idx];
+                m_sums[idx] += isGood ? value : 0.0;
+                m_goodCounts[idx] += isGood ? 1 : 0;
+            }
+        }
+
+        // the most recent sample is right before the position to write next:
+        auto lastQualities = m_ringQualities.data() + ((m_nextPos + m_capacity - 1) % m_capacity) * counterCount;
+
+        for (size_t idx = 0; idx < counterCount; ++idx)
+        {
+            auto aggregated = aggregates.values.data() + idx * numSupAggregates;
+
+            if (m_goodCounts[idx] == 0)
+            {
+                auto lastQuality = (m_count > 0) ? lastQualities[idx] : Quality::Unknown;
+                aggregates.qualities[idx] = (lastQuality != Quality::Good) ? lastQuality : Quality::Unknown;
+                continue;
+            }
+
+            aggregated[static_cast<uint32_t> (AggregateCode::Min)] = static_cast<float> (m_mins[idx]);
+            aggregated[static_cast<uint32_t> (AggregateCode::Max)] = static_cast<float> (m_maxs[idx]);
+            aggregated[static_cast<uint32_t> (AggregateCode::Mean)] = static_cast<float> (m_sums[idx] / m_goodCounts[idx]);
+
+            // percentile by nearest rank:
+            m_sortBuffer.clear();
+            for (size_t row = 0; row < m_count; ++row)
+            {
+                if (m_ringQualities[row * counterCount + idx] == Quality::Good)
+                    m_sortBuffer.push_back(static_cast<float> (m_ringValues[row * counterCount + idx]));
+            }
+
+            auto rank = static_cast<size_t> (std::ceil(0.95 * m_sortBuffer.size()));
+            auto nth = m_sortBuffer.begin() + (rank - 1);
+            std::nth_element(m_sortBuffer.begin(), nth, m_sortBuffer.end());
+            aggregated[static_cast<uint32_t> (AggregateCode::Percentile95)] = *nth;
+
+            aggregates.qualities[idx] = Quality::Good;
+        }
+
+        m_nextPos = 0;
+        m_count = 0;
+    }
+
+}// end of namespace application
@@ -0,0 +1,51 @@
+#ifndef __StatsAggregator_h__ // header guard
+#define __StatsAggregator_h__
+
+#include "CommonDataExchange.h"
+#include <vector>
+
+namespace application
+{
+    /// <summary>
+    /// Accumulates samples of performance counters taken at a high frequency
+    /// within a send cycle, and summarizes them, so spikes become visible without
+    /// sending every sample. The storage is a ring buffer allocated only once, with
+    /// the same columnar layout of <see cref="SamplesBatch"/>.
+    /// </summary>
+    /// <seealso cref="notcopiable" />
+    class StatsAggregator
+    {
+    private:
+
+        std::vector<uint32_t> m_counterIds;
+
+        std::vector<double> m_ringValues; // row after row, 'capacity' rows
+        std::vector<Quality> m_ringQualities;
+        size_t m_capacity;
+        size_t m_nextPos;
+        size_t m_count;
+
+        // accumulators, one entry per counter:
+        std::vector<double> m_mins;
+        std::vector<double> m_maxs;
+        std::vector<double> m_sums;
+        std::vector<uint32_t> m_goodCounts;
+
+        std::vector<float> m_sortBuffer;
+
+    public:
+
+        StatsAggregator(size_t capacity);
+
+        StatsAggregator(const StatsAggregator &) = delete;
+
+        void AddSample(const SamplesBatch &batch, size_t row);
+
+        size_t GetCount() const { return m_count; }
+
+        void Summarize(SamplesAggregates &aggregates);
+    };
+
+}// end of namespace application
+
+#endif // end of header guard
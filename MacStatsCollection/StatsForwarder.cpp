@@ -0,0 +1,151 @@
+#include "stdafx.h"
+#include "StatsForwarder.h"
+#include <3FD/callstacktracer.h>
+#include <3FD/exceptions.h>
+#include <3FD/logger.h>
+#include <cassert>
+#include <sstream>
+
+namespace application
+{
+    using namespace _3fd::core;
+
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="StatsForwarder"/> class,
+    /// which starts the sending thread.
+    /// </summary>
+    /// <param name="transport">The transport to send the stats through.</param>
+    /// <param name="queueCapacity">How many cycles of stats the queue can hold.</param>
+    /// <param name="maxBatchCount">How many cycles of stats can go in a single call to the transport.</param>
+    StatsForwarder::StatsForwarder(IStatsTransport &transport, size_t queueCapacity, size_t maxBatchCount)
+        : m_transport(transport)
+        , m_queue(queueCapacity)
+        , m_maxBatchCount(maxBatchCount)
+        , m_isStopping(false)
+        , m_hasFailed(false)
+        , m_droppedCount(0)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            assert(maxBatchCount > 0);
+            m_batch.reserve(maxBatchCount);
+            m_sendingThread = std::thread(&StatsForwarder::SendLoop, this);
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when starting thread to send stats: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    /// <summary>
+    /// Finalizes an instance of the <see cref="StatsForwarder"/> class.
+    /// </summary>
+    StatsForwarder::~StatsForwarder()
+    {
+        Stop();
+    }
+
+
+    // Runs in the sending thread, until stopped and the queue is drained
+    void StatsForwarder::SendLoop()
+    {
+        CALL_STACK_TRACE;
+
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_wakeUpMutex);
+                m_wakeUp.wait(lock, [this]()
+                {
+                    return m_queue.GetCount() > 0 || m_isStopping.load();
+                });
+            }
+
+            m_batch.clear();
+
+            CollectedStats *item;
+            while (m_batch.size() < m_maxBatchCount && (item = m_queue.Peek(m_batch.size())) != nullptr)
+                m_batch.push_back(item);
+
+            if (m_batch.empty())
+                return; // stopped
+
+            try
+            {
+                if (!m_transport.Send(m_batch))
+                    m_hasFailed.store(true);
+            }
+            catch (IAppException &ex)
+            {
+                m_hasFailed.store(true);
+                Logger::Write(ex, Logger::PRIO_ERROR);
+            }
+            catch (std::exception &ex)
+            {
+                m_hasFailed.store(true);
+                std::ostringstream oss;
+                oss << "Generic failure when sending stats: " << ex.what();
+                Logger::Write(oss.str(), Logger::PRIO_ERROR);
+            }
+
+            m_queue.Pop(m_batch.size());
+        }
+    }
+
+
+    /// <summary>
+    /// Gets the free slot at the end of the queue for the collection thread to fill in place.
+    /// It never waits, and when the queue is full, the stats of this cycle are dropped.
+    /// </summary>
+    /// <returns>The slot to fill (keeping the memory it already holds), or null when the queue is full.</returns>
+    CollectedStats *StatsForwarder::BeginPush()
+    {
+        auto item = m_queue.BeginPush();
+
+        if (item == nullptr)
+            ++m_droppedCount;
+
+        return item;
+    }
+
+
+    /// <summary>
+    /// Publishes the slot filled after <see cref="BeginPush"/> and wakes up the sending thread.
+    /// </summary>
+    void StatsForwarder::EndPush()
+    {
+        m_queue.EndPush();
+
+        // the sending thread holds this lock only to check the queue, never while sending:
+        {
+            std::lock_guard<std::mutex> lock(m_wakeUpMutex);
+        }
+
+        m_wakeUp.notify_one();
+    }
+
+
+    /// <summary>
+    /// Stops the sending thread, after it sends what is left in the queue.
+    /// </summary>
+    void StatsForwarder::Stop()
+    {
+        if (!m_sendingThread.joinable())
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(m_wakeUpMutex);
+            m_isStopping.store(true);
+        }
+
+        m_wakeUp.notify_one();
+        m_sendingThread.join();
+    }
+
+}// end of namespace application
@@ -0,0 +1,73 @@
+#ifndef __StatsForwarder_h__ // header guard
+#define __StatsForwarder_h__
+
+#include "CommonDataExchange.h"
+#include "SpscQueue.h"
+#include "StatsTransport.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace application
+{
+    /// <summary>
+    /// Decouples the collection of stats from sending them: the collection thread pushes what
+    /// it collects in each cycle into a bounded lock-free queue, without ever waiting for the
+    /// server, while a sending thread drains the queue and hands the transport all the items
+    /// there are (up to a maximum), so a backlog built while the server was slow goes in batch.
+    /// When the queue is full, the newest items are dropped, so the cadence of collection is
+    /// kept whatever the latency of the server.
+    /// </summary>
+    /// <seealso cref="notcopiable" />
+    class StatsForwarder
+    {
+    private:
+
+        IStatsTransport &m_transport;
+        SpscQueue<CollectedStats> m_queue;
+        size_t m_maxBatchCount;
+        std::vector<const CollectedStats *> m_batch;
+
+        // only for the sending thread to sleep while the queue is empty:
+        std::mutex m_wakeUpMutex;
+        std::condition_variable m_wakeUp;
+
+        std::atomic<bool> m_isStopping;
+        std::atomic<bool> m_hasFailed;
+        std::atomic<uint64_t> m_droppedCount;
+
+        std::thread m_sendingThread;
+
+        void SendLoop();
+
+    public:
+
+        StatsForwarder(IStatsTransport &transport, size_t queueCapacity, size_t maxBatchCount);
+
+        StatsForwarder(const StatsForwarder &) = delete;
+
+        ~StatsForwarder();
+
+        CollectedStats *BeginPush();
+
+        void EndPush();
+
+        void Stop();
+
+        /// <summary>
+        /// Tells whether the transport has failed since the last call,
+        /// which is when the next stats must be a heartbeat.
+        /// </summary>
+        bool TakeFailure() { return m_hasFailed.exchange(false); }
+
+        /// <summary>
+        /// Gets how many items have been dropped because the queue was full.
+        /// </summary>
+        uint64_t GetDroppedCount() const { return m_droppedCount.load(); }
+    };
+
+}// end of namespace application
+
+#endif // end of header guard
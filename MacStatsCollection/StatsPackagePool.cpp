@@ -0,0 +1,164 @@
+#include "stdafx.h"
+#include "StatsPackagePool.h"
+#include <3FD\callstacktracer.h>
+#include <3FD\exceptions.h>
+#include <3FD\configuration.h>
+#include <cassert>
+#include <sstream>
+
+namespace application
+{
+    using namespace _3fd::core;
+
+
+    std::unique_ptr<StatsPackagePool> StatsPackagePool::singleton;
+
+    std::mutex StatsPackagePool::singletonCreationMutex;
+
+
+    // Terminates a stack, or tells it is empty
+    static const uint32_t noSlot(UINT32_MAX);
+
+
+    /// <summary>
+    /// Provides access to the singleton.
+    /// </summary>
+    /// <returns>A reference to the singleton.</returns>
+    StatsPackagePool & StatsPackagePool::GetInstance()
+    {
+        if (singleton)
+            return *singleton;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            std::lock_guard<std::mutex> lock(singletonCreationMutex);
+
+            if (!singleton)
+            {
+                singleton.reset(
+                    new StatsPackagePool(AppConfig::GetSettings().application.GetUInt("srvPackagePoolSize", 131072))
+                );
+            }
+
+            return *singleton;
+        }
+        catch (IAppException &)
+        {
+            throw; // just forward already prepared application exceptions
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when instantiating pool of stats packages: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    /// <summary>
+    /// Finalizes the singleton, which must take place after
+    /// no other thread can use the pool anymore.
+    /// </summary>
+    void StatsPackagePool::Finalize()
+    {
+        singleton.reset(nullptr);
+    }
+
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="StatsPackagePool"/> class.
+    /// </summary>
+    /// <param name="capacity">How many packages the pool can hold.</param>
+    StatsPackagePool::StatsPackagePool(uint32_t capacity)
+        : m_slots(new Slot[capacity])
+        , m_capacity(capacity)
+        , m_filledHead(noSlot)
+        , m_vacantHead(capacity > 0 ? 0 : noSlot)
+    {
+        assert(capacity < noSlot);
+
+        // all slots start vacant:
+        for (uint32_t idx = 0; idx < capacity; ++idx)
+            m_slots[idx].next.store(idx + 1 < capacity ? idx + 1 : noSlot, std::memory_order_relaxed);
+    }
+
+
+    /* Pops the slot at the top of a stack, if any. Every change of the head increments its tag,
+    so a compare-and-swap fails when the top was popped and pushed again by another thread since
+    its next slot was read. */
+    uint32_t StatsPackagePool::Pop(std::atomic<uint64_t> &head)
+    {
+        auto top = head.load(std::memory_order_acquire);
+
+        while (true)
+        {
+            auto index = static_cast<uint32_t> (top);
+            if (index == noSlot)
+                return noSlot;
+
+            auto next = m_slots[index].next.load(std::memory_order_relaxed);
+            auto newTop = ((top >> 32) + 1) << 32 | next;
+
+            if (head.compare_exchange_weak(top, newTop, std::memory_order_acq_rel, std::memory_order_acquire))
+                return index;
+        }
+    }
+
+
+    // Pushes a slot onto the top of a stack
+    void StatsPackagePool::Push(std::atomic<uint64_t> &head, uint32_t index)
+    {
+        auto top = head.load(std::memory_order_relaxed);
+        uint64_t newTop;
+
+        do
+        {
+            m_slots[index].next.store(static_cast<uint32_t> (top), std::memory_order_relaxed);
+            newTop = ((top >> 32) + 1) << 32 | index;
+        }
+        while (!head.compare_exchange_weak(top, newTop, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+
+    /// <summary>
+    /// Takes a package from the pool, or makes a new one when the pool is empty.
+    /// </summary>
+    /// <returns>A package without stats, whose vectors might have capacity already.</returns>
+    StatsPackage StatsPackagePool::Acquire()
+    {
+        auto index = Pop(m_filledHead);
+        if (index == noSlot)
+            return StatsPackage();
+
+        StatsPackage package(std::move(m_slots[index].package));
+        Push(m_vacantHead, index);
+        return package;
+    }
+
+
+    /// <summary>
+    /// Gives packages back to the pool, once their stats are no longer needed.
+    /// The packages that do not fit in the pool are released.
+    /// </summary>
+    /// <param name="packages">The packages, which are cleared.</param>
+    void StatsPackagePool::Recycle(std::vector<StatsPackage> &packages)
+    {
+        for (auto &package : packages)
+        {
+            auto index = Pop(m_vacantHead);
+            if (index == noSlot)
+                break;
+
+            package.statSamplesFloat32.clear();
+            package.statSamplesInt32.clear();
+
+            m_slots[index].package = std::move(package);
+            Push(m_filledHead, index);
+        }
+
+        packages.clear();
+    }
+
+}// end of namespace application
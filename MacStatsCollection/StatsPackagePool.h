@@ -0,0 +1,68 @@
+#ifndef __StatsPackagePool_h__ // header guard
+#define __StatsPackagePool_h__
+
+#include "CommonDataExchange.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace application
+{
+    /// <summary>
+    /// Recycles the packages of stats, so the server does not allocate them for every request: once
+    /// written into storage, the packages come back here with their vectors emptied, but keeping the
+    /// capacity, then the threads serving the requests take them again. The pool is lock-free: the
+    /// packages live in a fixed array of slots, linked in two stacks (the slots holding a package and
+    /// the vacant ones), whose heads carry a tag against the ABA problem. When the pool is full, the
+    /// packages are released. When it is empty, new packages are made.
+    /// </summary>
+    /// <seealso cref="notcopiable" />
+    class StatsPackagePool
+    {
+    private:
+
+        /// <summary>
+        /// A slot for a package, linked in one of the stacks.
+        /// </summary>
+        struct Slot
+        {
+            StatsPackage package;
+            std::atomic<uint32_t> next;
+        };
+
+        std::unique_ptr<Slot[]> m_slots;
+
+        const uint32_t m_capacity;
+
+        // the heads have the index of the top slot in the low half, and the tag in the high half:
+        std::atomic<uint64_t> m_filledHead;
+        std::atomic<uint64_t> m_vacantHead;
+
+        static std::unique_ptr<StatsPackagePool> singleton;
+
+        static std::mutex singletonCreationMutex;
+
+        uint32_t Pop(std::atomic<uint64_t> &head);
+
+        void Push(std::atomic<uint64_t> &head, uint32_t index);
+
+    public:
+
+        explicit StatsPackagePool(uint32_t capacity);
+
+        StatsPackagePool(const StatsPackagePool &) = delete;
+
+        static StatsPackagePool &GetInstance();
+
+        static void Finalize();
+
+        StatsPackage Acquire();
+
+        void Recycle(std::vector<StatsPackage> &packages);
+    };
+
+}// end of namespace application
+
+#endif // end of header guard
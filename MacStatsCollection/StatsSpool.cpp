@@ -0,0 +1,722 @@
+#include "stdafx.h"
+#include "StatsSpool.h"
+#include <3FD\callstacktracer.h>
+#include <3FD\exceptions.h>
+#include <3FD\logger.h>
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+namespace application
+{
+    using namespace _3fd;
+    using namespace _3fd::core;
+
+
+    /// <summary>
+    /// Identifies a file created by this spool ("MSCS").
+    /// </summary>
+    static constexpr uint32_t spoolFileMagic(0x5343534D);
+
+    /// <summary>
+    /// The version of the layout of the records, which changes whenever they do.
+    /// </summary>
+    static constexpr uint32_t spoolRecordVersion(2);
+
+    /// <summary>
+    /// The least capacity of the ring, whatever the configured size.
+    /// </summary>
+    static constexpr uint32_t spoolMinCapacity(1024);
+
+    /// <summary>
+    /// The least size of a record, which starts with its size and the time of the sample.
+    /// </summary>
+    static constexpr uint32_t spoolMinRecordSize(sizeof(uint32_t) + sizeof(int64_t));
+
+
+    /// <summary>
+    /// Throws an exception for a failed call of Win32 API.
+    /// </summary>
+    /// <param name="message">The main message.</param>
+    /// <param name="funcName">Name of the Win32 API function.</param>
+    static void ThrowWin32Error(const char *message, const char *funcName)
+    {
+        std::ostringstream oss;
+        oss << message << " - ";
+        WWAPI::AppendDWordErrorMessage(GetLastError(), funcName, oss);
+        throw AppException<std::runtime_error>(oss.str());
+    }
+
+
+    // Hashes (FNV-1a) the names and types of the counters in the catalog
+    static uint32_t HashCatalog(const std::vector<PerfCounterDescriptor> &catalog)
+    {
+        uint32_t hash(2166136261U);
+
+        auto add = [&hash](uint32_t value)
+        {
+            hash = (hash ^ value) * 16777619U;
+        };
+
+        for (auto &counter : catalog)
+        {
+            for (auto ch : counter.statName)
+                add(static_cast<uint32_t> (ch));
+
+            add(static_cast<uint32_t> (counter.valueType) + 0x100);
+        }
+
+        return hash;
+    }
+
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="StatsSpool"/> class.
+    /// Records left in the file by a previous execution are kept, as long as the file
+    /// layout matches the given size and the catalog is the same. Otherwise the file is reset.
+    /// </summary>
+    /// <param name="filePath">The path of the spool file.</param>
+    /// <param name="maxSizeKBytes">The maximum size (in KB) for the file.</param>
+    /// <param name="maxAgeSecs">How long (in seconds) a record remains in the spool.</param>
+    /// <param name="catalog">The catalog of performance counters being collected.</param>
+    StatsSpool::StatsSpool(const string &filePath,
+                           uint32_t maxSizeKBytes,
+                           uint32_t maxAgeSecs,
+                           const std::vector<PerfCounterDescriptor> &catalog)
+        : m_fileHandle(INVALID_HANDLE_VALUE)
+        , m_fileMappingHandle(nullptr)
+        , m_fileView(nullptr)
+        , m_header(nullptr)
+        , m_ring(nullptr)
+        , m_catalogSize(catalog.size())
+        , m_maxAge(maxAgeSecs)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            ScopedLogWrite logScope(
+                "Opening spool for stats... ",
+                Logger::PRIO_INFORMATION, "done!",
+                Logger::PRIO_ERROR, "FAILED!"
+            );
+
+            uint64_t maxSizeBytes = maxSizeKBytes * 1024ULL;
+            uint32_t capacity = static_cast<uint32_t> (
+                (maxSizeBytes > sizeof(Header) + spoolMinCapacity) ? (maxSizeBytes - sizeof(Header)) : spoolMinCapacity
+            );
+
+            uint64_t fileSize = sizeof(Header) + static_cast<uint64_t> (capacity);
+            auto catalogHash = HashCatalog(catalog);
+
+            m_fileHandle = CreateFileA(filePath.c_str(),
+                                       GENERIC_READ | GENERIC_WRITE,
+                                       0, nullptr,
+                                       OPEN_ALWAYS,
+                                       FILE_ATTRIBUTE_NORMAL,
+                                       nullptr);
+
+            if (m_fileHandle == INVALID_HANDLE_VALUE)
+                ThrowWin32Error("Failed to open spool file", "CreateFile");
+
+            LARGE_INTEGER currentSize;
+            if (GetFileSizeEx(m_fileHandle, &currentSize) == FALSE)
+                ThrowWin32Error("Failed to get size of spool file", "GetFileSizeEx");
+
+            bool sizeMatches = (static_cast<uint64_t> (currentSize.QuadPart) == fileSize);
+
+            if (!sizeMatches)
+            {
+                if (currentSize.QuadPart > 0)
+                    Logger::Write("Spool file does not match the configured size and will be reset", Logger::PRIO_WARNING);
+
+                LARGE_INTEGER newSize;
+                newSize.QuadPart = static_cast<LONGLONG> (fileSize);
+
+                if (SetFilePointerEx(m_fileHandle, newSize, nullptr, FILE_BEGIN) == FALSE
+                    || SetEndOfFile(m_fileHandle) == FALSE)
+                {
+                    ThrowWin32Error("Failed to resize spool file", "SetEndOfFile");
+                }
+            }
+
+            m_fileMappingHandle = CreateFileMappingW(m_fileHandle, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+
+            if (m_fileMappingHandle == nullptr)
+                ThrowWin32Error("Failed to create mapping for spool file", "CreateFileMapping");
+
+            m_fileView = MapViewOfFile(m_fileMappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+
+            if (m_fileView == nullptr)
+                ThrowWin32Error("Failed to map view of spool file", "MapViewOfFile");
+
+            m_header = static_cast<Header *> (m_fileView);
+            m_ring = reinterpret_cast<uint8_t *> (m_header + 1);
+
+            if (sizeMatches
+                && m_header->magic == spoolFileMagic
+                && m_header->version == spoolRecordVersion
+                && m_header->catalogHash != catalogHash
+                && m_header->count > 0)
+            {
+                Logger::Write("Catalog of performance counters has changed, so the spool will be reset", Logger::PRIO_WARNING);
+            }
+
+            // Reset the file when it was just created or has an unexpected content:
+            if (!sizeMatches
+                || m_header->magic != spoolFileMagic
+                || m_header->version != spoolRecordVersion
+                || m_header->catalogHash != catalogHash
+                || m_header->capacity != capacity
+                || m_header->head >= capacity
+                || m_header->usedSize > capacity
+                || m_header->count > m_header->usedSize)
+            {
+                m_header->magic = spoolFileMagic;
+                m_header->version = spoolRecordVersion;
+                m_header->catalogHash = catalogHash;
+                m_header->capacity = capacity;
+                m_header->head = 0;
+                m_header->usedSize = 0;
+                m_header->count = 0;
+                Flush(m_header, sizeof *m_header);
+            }
+            else if (m_header->count > 0)
+            {
+                std::ostringstream oss;
+                oss << "Spool has " << m_header->count << " record(s) left by a previous execution";
+                Logger::Write(oss.str(), Logger::PRIO_NOTICE);
+            }
+
+            logScope.LogSuccess();
+        }
+        catch (IAppException &)
+        {
+            Close();
+            throw; // just forward already prepared application exceptions
+        }
+        catch (std::exception &ex)
+        {
+            Close();
+            std::ostringstream oss;
+            oss << "Generic failure when opening spool for stats: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    /// <summary>
+    /// Finalizes an instance of the <see cref="StatsSpool"/> class.
+    /// </summary>
+    StatsSpool::~StatsSpool()
+    {
+        Close();
+    }
+
+
+    /// <summary>
+    /// Unmaps the view and closes the file.
+    /// </summary>
+    void StatsSpool::Close()
+    {
+        if (m_fileView != nullptr)
+        {
+            FlushViewOfFile(m_fileView, 0);
+            UnmapViewOfFile(m_fileView);
+            m_fileView = nullptr;
+        }
+
+        if (m_fileMappingHandle != nullptr)
+        {
+            CloseHandle(m_fileMappingHandle);
+            m_fileMappingHandle = nullptr;
+        }
+
+        if (m_fileHandle != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(m_fileHandle);
+            m_fileHandle = INVALID_HANDLE_VALUE;
+        }
+    }
+
+
+    /// <summary>
+    /// Writes modified pages of the view to the file.
+    /// </summary>
+    /// <param name="address">The start of the modified region.</param>
+    /// <param name="length">The length of the modified region.</param>
+    void StatsSpool::Flush(const void *address, size_t length)
+    {
+        if (FlushViewOfFile(address, length) == FALSE)
+            ThrowWin32Error("Failed to flush spool file", "FlushViewOfFile");
+    }
+
+
+    /// <summary>
+    /// Writes data to the ring, wrapping around its end, and flushes it to the file.
+    /// </summary>
+    /// <param name="offset">Where to start writing in the ring.</param>
+    /// <param name="data">The data to write.</param>
+    /// <param name="size">The size of the data, which must fit in the ring.</param>
+    void StatsSpool::WriteRing(uint32_t offset, const void *data, uint32_t size)
+    {
+        auto firstPart = (std::min)(size, m_header->capacity - offset);
+        memcpy(m_ring + offset, data, firstPart);
+        Flush(m_ring + offset, firstPart);
+
+        if (firstPart < size)
+        {
+            memcpy(m_ring, static_cast<const uint8_t *> (data) + firstPart, size - firstPart);
+            Flush(m_ring, size - firstPart);
+        }
+    }
+
+
+    /// <summary>
+    /// Reads data from the ring, wrapping around its end.
+    /// </summary>
+    /// <param name="offset">Where to start reading in the ring.</param>
+    /// <param name="data">Receives the data.</param>
+    /// <param name="size">The size of the data to read.</param>
+    void StatsSpool::ReadRing(uint32_t offset, void *data, uint32_t size) const
+    {
+        auto firstPart = (std::min)(size, m_header->capacity - offset);
+        memcpy(data, m_ring + offset, firstPart);
+
+        if (firstPart < size)
+            memcpy(static_cast<uint8_t *> (data) + firstPart, m_ring, size - firstPart);
+    }
+
+
+    // Tells whether the size read for a record is sane, given how much of the ring comes before it
+    bool StatsSpool::IsValidRecordSize(uint32_t recordSize, uint32_t precedingSize) const
+    {
+        return recordSize >= spoolMinRecordSize && recordSize <= m_header->usedSize - precedingSize;
+    }
+
+
+    /// <summary>
+    /// Drops the records from the given position of the ring on, because the spool is corrupted.
+    /// </summary>
+    /// <param name="pos">The position of the first record that cannot be trusted.</param>
+    /// <param name="keptCount">How many records come before it.</param>
+    void StatsSpool::DropCorrupted(uint32_t pos, uint32_t keptCount)
+    {
+        std::ostringstream oss;
+        oss << "Spool is corrupted, so " << (m_header->count - keptCount) << " record(s) are discarded";
+        Logger::Write(oss.str(), Logger::PRIO_ERROR);
+
+        m_header->usedSize = (pos + m_header->capacity - m_header->head) % m_header->capacity;
+        m_header->count = keptCount;
+        Flush(m_header, sizeof *m_header);
+    }
+
+
+    /* Removes the oldest record from the ring, without flushing the header. When its size is
+    corrupted, the spool is reset instead, so it returns whether there is any record left. */
+    bool StatsSpool::DropOldest()
+    {
+        if (m_header->count == 0)
+            return false;
+
+        uint32_t recordSize;
+        ReadRing(m_header->head, &recordSize, sizeof recordSize);
+
+        if (!IsValidRecordSize(recordSize, 0))
+        {
+            DropCorrupted(m_header->head, 0);
+            return false;
+        }
+
+        m_header->head = (m_header->head + recordSize) % m_header->capacity;
+        m_header->usedSize -= recordSize;
+        --m_header->count;
+        return true;
+    }
+
+
+    /// <summary>
+    /// Discards the records in the head of the spool that are older than allowed.
+    /// </summary>
+    void StatsSpool::DiscardExpired()
+    {
+        using namespace std::chrono;
+
+        static const auto epoch = system_clock().from_time_t(0);
+
+        auto minTimeSinceEpochInMillisecs = duration_cast<milliseconds>(system_clock().now() - m_maxAge - epoch).count();
+
+        uint32_t expiredCount(0);
+        uint32_t expiredSize(0);
+        auto pos = m_header->head;
+
+        while (expiredCount < m_header->count)
+        {
+            uint32_t recordSize;
+            ReadRing(pos, &recordSize, sizeof recordSize);
+
+            if (!IsValidRecordSize(recordSize, expiredSize))
+            {
+                DropCorrupted(pos, expiredCount);
+                break;
+            }
+
+            int64_t timeSinceEpochInMillisecs;
+            ReadRing((pos + sizeof recordSize) % m_header->capacity, &timeSinceEpochInMillisecs, sizeof timeSinceEpochInMillisecs);
+
+            if (timeSinceEpochInMillisecs >= minTimeSinceEpochInMillisecs)
+                break;
+
+            ++expiredCount;
+            expiredSize += recordSize;
+            pos = (pos + recordSize) % m_header->capacity;
+        }
+
+        if (expiredCount > 0)
+        {
+            std::ostringstream oss;
+            oss << "Discarding " << expiredCount << " record(s) that expired in the spool";
+            Logger::Write(oss.str(), Logger::PRIO_WARNING);
+
+            Discard(expiredCount);
+        }
+    }
+
+
+    // Appends plain data to a record
+    template <typename Type>
+    static void Write(std::vector<uint8_t> &record, const Type &value)
+    {
+        auto bytes = reinterpret_cast<const uint8_t *> (&value);
+        record.insert(record.end(), bytes, bytes + sizeof value);
+    }
+
+
+    // Appends an array of plain data to a record
+    template <typename Type>
+    static void Write(std::vector<uint8_t> &record, const Type *values, size_t count)
+    {
+        auto bytes = reinterpret_cast<const uint8_t *> (values);
+        record.insert(record.end(), bytes, bytes + count * sizeof *values);
+    }
+
+
+    // Appends the time of a sample to a record, in milliseconds since epoch
+    static void WriteTime(std::vector<uint8_t> &record, std::chrono::time_point<std::chrono::system_clock> time)
+    {
+        using namespace std::chrono;
+        static const auto epoch = system_clock().from_time_t(0);
+        Write(record, static_cast<int64_t> (duration_cast<milliseconds>(time - epoch).count()));
+    }
+
+
+    // Appends a batch of samples to a record
+    static void WriteBatch(std::vector<uint8_t> &record, const SamplesBatch &batch)
+    {
+        Write(record, static_cast<uint32_t> (batch.GetCounterCount()));
+        Write(record, batch.counterIds.data(), batch.counterIds.size());
+        Write(record, static_cast<uint32_t> (batch.GetSampleCount()));
+
+        for (size_t row = 0; row < batch.GetSampleCount(); ++row)
+        {
+            WriteTime(record, batch.times[row]);
+            Write(record, batch.GetValues(row), batch.GetCounterCount());
+            Write(record, batch.GetQualities(row), batch.GetCounterCount());
+        }
+    }
+
+
+    /// <summary>
+    /// Appends the stats collected in a cycle to the spool. All values of the sample go
+    /// to the spool, regardless of the mask of the deadband. When the spool is full, the
+    /// oldest records are overwritten. The record is written before the header, so a crash
+    /// never exposes an incomplete record.
+    /// </summary>
+    /// <param name="stats">The stats to append, which must have a sample.</param>
+    void StatsSpool::Append(const CollectedStats &stats)
+    {
+        CALL_STACK_TRACE;
+
+        /* The record is: its size, the time of the sample, the sample,
+        the aggregates (if any), the burst and the metrics of the client (if any): */
+        m_record.clear();
+        Write(m_record, static_cast<uint32_t> (0));
+        WriteTime(m_record, stats.sample.times[0]);
+        WriteBatch(m_record, stats.sample);
+
+        Write(m_record, static_cast<uint8_t> (stats.HasAggregates() ? 1 : 0));
+        if (stats.HasAggregates())
+        {
+            auto &aggregates = stats.aggregates;
+            Write(m_record, aggregates.sampleCount);
+            Write(m_record, static_cast<uint32_t> (aggregates.counterIds.size()));
+            Write(m_record, aggregates.counterIds.data(), aggregates.counterIds.size());
+            Write(m_record, aggregates.values.data(), aggregates.counterIds.size() * numSupAggregates);
+            Write(m_record, aggregates.qualities.data(), aggregates.counterIds.size());
+        }
+
+        WriteBatch(m_record, stats.burst);
+
+        Write(m_record, static_cast<uint8_t> (stats.hasSelfMetrics ? 1 : 0));
+        if (stats.hasSelfMetrics)
+        {
+            for (auto &metric : stats.selfMetrics)
+            {
+                Write(m_record, metric.value);
+                Write(m_record, metric.quality);
+            }
+        }
+
+        auto recordSize = static_cast<uint32_t> (m_record.size());
+        memcpy(m_record.data(), &recordSize, sizeof recordSize);
+
+        if (recordSize > m_header->capacity)
+        {
+            Logger::Write("Stats collected in cycle are too large for the spool, so they are lost", Logger::PRIO_ERROR);
+            return;
+        }
+
+        if (m_header->capacity - m_header->usedSize < recordSize)
+        {
+            do
+            {
+                if (!DropOldest())
+                    break; // the ring is now empty
+            }
+            while (m_header->capacity - m_header->usedSize < recordSize);
+
+            Flush(m_header, sizeof *m_header);
+        }
+
+        WriteRing((m_header->head + m_header->usedSize) % m_header->capacity, m_record.data(), recordSize);
+
+        m_header->usedSize += recordSize;
+        ++m_header->count;
+        Flush(m_header, sizeof *m_header);
+    }
+
+
+    // Reads a record of the spool, checking every field against the bounds of the record
+    class SpoolRecordReader
+    {
+    private:
+
+        const uint8_t *m_next;
+        const uint8_t *m_end;
+        size_t m_catalogSize;
+
+    public:
+
+        SpoolRecordReader(const std::vector<uint8_t> &record, size_t catalogSize)
+            : m_next(record.data())
+            , m_end(record.data() + record.size())
+            , m_catalogSize(catalogSize)
+        {}
+
+        bool IsAtEnd() const { return m_next == m_end; }
+
+        template <typename Type>
+        bool Read(Type &value)
+        {
+            return Read(&value, 1);
+        }
+
+        template <typename Type>
+        bool Read(Type *values, size_t count)
+        {
+            if (static_cast<size_t> (m_end - m_next) < count * sizeof *values)
+                return false;
+
+            memcpy(values, m_next, count * sizeof *values);
+            m_next += count * sizeof *values;
+            return true;
+        }
+
+        bool ReadTime(std::chrono::time_point<std::chrono::system_clock> &time)
+        {
+            using namespace std::chrono;
+            static const auto epoch = system_clock().from_time_t(0);
+
+            int64_t timeSinceEpochInMillisecs;
+            if (!Read(timeSinceEpochInMillisecs))
+                return false;
+
+            time = epoch + milliseconds(timeSinceEpochInMillisecs);
+            return true;
+        }
+
+        // Reads the counters, which must be in the catalog
+        bool ReadCounterIds(std::vector<uint32_t> &counterIds)
+        {
+            uint32_t count;
+            if (!Read(count) || count > m_catalogSize)
+                return false;
+
+            counterIds.resize(count);
+            if (!Read(counterIds.data(), count))
+                return false;
+
+            return std::all_of(counterIds.begin(), counterIds.end(), [this](uint32_t id)
+            {
+                return id < m_catalogSize;
+            });
+        }
+
+        bool ReadBatch(SamplesBatch &batch)
+        {
+            batch.Clear();
+
+            uint32_t sampleCount;
+            if (!ReadCounterIds(batch.counterIds) || !Read(sampleCount))
+                return false;
+
+            for (uint32_t idx = 0; idx < sampleCount; ++idx)
+            {
+                std::chrono::time_point<std::chrono::system_clock> time;
+                if (!ReadTime(time))
+                    return false;
+
+                auto row = batch.AddSample(time);
+                if (!Read(batch.GetValues(row), batch.GetCounterCount())
+                    || !Read(batch.GetQualities(row), batch.GetCounterCount()))
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+    };
+
+
+    // Parses a record of the spool, which is whole, but is checked against corruption
+    static bool ParseRecord(const std::vector<uint8_t> &record, size_t catalogSize, CollectedStats &stats)
+    {
+        SpoolRecordReader reader(record, catalogSize);
+
+        uint32_t recordSize;
+        std::chrono::time_point<std::chrono::system_clock> time;
+
+        if (!reader.Read(recordSize)
+            || !reader.ReadTime(time)
+            || !reader.ReadBatch(stats.sample)
+            || stats.sample.GetSampleCount() != 1)
+        {
+            return false;
+        }
+
+        stats.sendMask.clear(); // the sample goes whole
+
+        uint8_t hasAggregates;
+        if (!reader.Read(hasAggregates))
+            return false;
+
+        auto &aggregates = stats.aggregates;
+        aggregates.counterIds.clear();
+
+        if (hasAggregates != 0)
+        {
+            if (!reader.Read(aggregates.sampleCount) || !reader.ReadCounterIds(aggregates.counterIds))
+                return false;
+
+            aggregates.values.resize(aggregates.counterIds.size() * numSupAggregates);
+            aggregates.qualities.resize(aggregates.counterIds.size());
+
+            if (!reader.Read(aggregates.values.data(), aggregates.values.size())
+                || !reader.Read(aggregates.qualities.data(), aggregates.qualities.size()))
+            {
+                return false;
+            }
+        }
+
+        if (!reader.ReadBatch(stats.burst))
+            return false;
+
+        uint8_t hasSelfMetrics;
+        if (!reader.Read(hasSelfMetrics))
+            return false;
+
+        stats.hasSelfMetrics = (hasSelfMetrics != 0);
+
+        if (stats.hasSelfMetrics)
+        {
+            for (auto &metric : stats.selfMetrics)
+            {
+                if (!reader.Read(metric.value) || !reader.Read(metric.quality))
+                    return false;
+            }
+        }
+
+        return reader.IsAtEnd();
+    }
+
+
+    /// <summary>
+    /// Copies the oldest records from the spool, without removing them.
+    /// Once they have been sent, call <see cref="Discard"/>.
+    /// </summary>
+    /// <param name="items">Receives the stats of a cycle in each record, from the first item on.
+    /// The items are reused, so their memory is kept from previous calls, and the vector never
+    /// shrinks, hence only as many items as returned hold records of this call.</param>
+    /// <param name="maxCount">The maximum amount of records to copy.</param>
+    /// <returns>How many records have been copied.</returns>
+    uint32_t StatsSpool::Peek(std::vector<CollectedStats> &items, uint32_t maxCount)
+    {
+        CALL_STACK_TRACE;
+
+        DiscardExpired();
+
+        auto count = (std::min)(maxCount, m_header->count);
+        if (items.size() < count)
+            items.resize(count);
+
+        uint32_t peekedSize(0);
+        auto pos = m_header->head;
+        for (uint32_t idx = 0; idx < count; ++idx)
+        {
+            uint32_t recordSize;
+            ReadRing(pos, &recordSize, sizeof recordSize);
+
+            bool isValid = IsValidRecordSize(recordSize, peekedSize);
+            if (isValid)
+            {
+                m_record.resize(recordSize);
+                ReadRing(pos, m_record.data(), recordSize);
+            }
+
+            if (!isValid || !ParseRecord(m_record, m_catalogSize, items[idx]))
+            {
+                // what comes from this record on cannot be trusted:
+                DropCorrupted(pos, idx);
+                count = idx;
+                break;
+            }
+
+            peekedSize += recordSize;
+            pos = (pos + recordSize) % m_header->capacity;
+        }
+
+        return count;
+    }
+
+
+    /// <summary>
+    /// Removes the oldest records from the spool.
+    /// </summary>
+    /// <param name="count">How many records to remove.</param>
+    void StatsSpool::Discard(uint32_t count)
+    {
+        CALL_STACK_TRACE;
+
+        count = (std::min)(count, m_header->count);
+
+        for (uint32_t idx = 0; idx < count; ++idx)
+        {
+            if (!DropOldest())
+                break;
+        }
+
+        Flush(m_header, sizeof *m_header);
+    }
+
+}// end of namespace application
\ No newline at end of file
@@ -0,0 +1,94 @@
+#ifndef __StatsSpool_h__ // header guard
+#define __StatsSpool_h__
+
+#include "CommonDataExchange.h"
+#include <cinttypes>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <Windows.h>
+
+namespace application
+{
+    /// <summary>
+    /// A memory-mapped file that keeps the stats the client could not send, so they survive
+    /// until the server is available again, or even a crash of the client. Each record holds
+    /// all that was collected in a cycle (the sample of every counter in the catalog, the
+    /// aggregates, the burst and the metrics of the client), so replaying it sends the same
+    /// content. The records have variable size and are appended to a ring of fixed size, so
+    /// the oldest ones are overwritten when the spool is full, and they are also discarded
+    /// once they are too old.
+    /// </summary>
+    /// <seealso cref="notcopiable" />
+    class StatsSpool
+    {
+    private:
+
+        /// <summary>
+        /// The layout of the header in the beginning of the file.
+        /// </summary>
+        struct Header
+        {
+            uint32_t magic;
+            uint32_t version; // of the layout of the records
+            uint32_t catalogHash; // the records refer to the counters by index in the catalog
+            uint32_t capacity; // in bytes, of the ring of records
+            uint32_t head; // offset of the oldest record in the ring
+            uint32_t usedSize; // in bytes
+            uint32_t count;
+        };
+
+        HANDLE m_fileHandle;
+        HANDLE m_fileMappingHandle;
+        void *m_fileView;
+
+        Header *m_header;
+        uint8_t *m_ring;
+
+        size_t m_catalogSize;
+        std::chrono::seconds m_maxAge;
+
+        std::vector<uint8_t> m_record; // the record being written or read
+
+        void Close();
+
+        void Flush(const void *address, size_t length);
+
+        void WriteRing(uint32_t offset, const void *data, uint32_t size);
+
+        void ReadRing(uint32_t offset, void *data, uint32_t size) const;
+
+        bool IsValidRecordSize(uint32_t recordSize, uint32_t precedingSize) const;
+
+        void DropCorrupted(uint32_t pos, uint32_t keptCount);
+
+        bool DropOldest();
+
+        void DiscardExpired();
+
+    public:
+
+        StatsSpool(const string &filePath,
+                   uint32_t maxSizeKBytes,
+                   uint32_t maxAgeSecs,
+                   const std::vector<PerfCounterDescriptor> &catalog);
+
+        StatsSpool(const StatsSpool &) = delete;
+
+        ~StatsSpool();
+
+        /// <summary>
+        /// Gets how many records (one per collection cycle) are waiting in the spool.
+        /// </summary>
+        uint32_t GetCount() const { return m_header->count; }
+
+        void Append(const CollectedStats &stats);
+
+        uint32_t Peek(std::vector<CollectedStats> &items, uint32_t maxCount);
+
+        void Discard(uint32_t count);
+    };
+
+}// end of namespace application
+
+#endif // end of header guard
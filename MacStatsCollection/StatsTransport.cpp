@@ -0,0 +1,178 @@
+#include "stdafx.h"
+#include "StatsTransport.h"
+#include <3FD/callstacktracer.h>
+#include <3FD/exceptions.h>
+#include <sstream>
+#include <thread>
+
+namespace application
+{
+    using namespace _3fd::core;
+
+
+    /// <summary>
+    /// Converts a sample into the package that the server extracts from a request carrying it,
+    /// hence the stats are split by value type, the mask is applied, and the aggregates (if any)
+    /// follow the stats of type float 32 bits.
+    /// </summary>
+    /// <param name="catalog">The catalog of performance counters.</param>
+    /// <param name="machine">The name of the machine.</param>
+    /// <param name="batch">The batch of samples.</param>
+    /// <param name="row">The row of the sample in the batch.</param>
+    /// <param name="aggregates">The aggregates to send along with the sample, or null.</param>
+    /// <param name="sendMask">One flag per column telling whether to send the value (and
+    /// its aggregates), or null to send all of them.</param>
+    /// <returns>The package of stats.</returns>
+    StatsPackage ToStatsPackage(const std::vector<PerfCounterDescriptor> &catalog,
+                                const std::wstring &machine,
+                                const SamplesBatch &batch,
+                                size_t row,
+                                const SamplesAggregates *aggregates,
+                                const uint8_t *sendMask)
+    {
+        using namespace std::chrono;
+
+        static const auto epoch = system_clock().from_time_t(0);
+
+        StatsPackage package;
+        package.timeSinceEpochInMillisecs = duration_cast<milliseconds>(batch.times[row] - epoch).count();
+        package.machine = machine;
+
+        auto values = batch.GetValues(row);
+        auto qualities = batch.GetQualities(row);
+
+        for (size_t idx = 0; idx < batch.GetCounterCount(); ++idx)
+        {
+            if (sendMask != nullptr && sendMask[idx] == 0)
+                continue;
+
+            auto &descriptor = catalog[batch.counterIds[idx]];
+
+            if (descriptor.valueType == StatValueType::Float32)
+                package.statSamplesFloat32.emplace_back(descriptor.statName, static_cast<float> (values[idx]), qualities[idx]);
+            else
+                package.statSamplesInt32.emplace_back(descriptor.statName, static_cast<int> (values[idx]), qualities[idx]);
+        }
+
+        if (aggregates == nullptr)
+            return package;
+
+        for (size_t idx = 0; idx < aggregates->counterIds.size(); ++idx)
+        {
+            if (sendMask != nullptr && sendMask[idx] == 0)
+                continue;
+
+            auto &descriptor = catalog[aggregates->counterIds[idx]];
+            auto aggregated = aggregates->GetValues(idx);
+
+            for (uint32_t aggIndex = 0; aggIndex < numSupAggregates; ++aggIndex)
+            {
+                package.statSamplesFloat32.emplace_back(descriptor.aggregateStatNames[aggIndex],
+                                                        aggregated[aggIndex],
+                                                        aggregates->qualities[idx]);
+            }
+        }
+
+        return package;
+    }
+
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="LoopbackTransport"/> class.
+    /// </summary>
+    /// <param name="catalog">The catalog of performance counters.</param>
+    /// <param name="machine">The name of the machine to set in the packages.</param>
+    /// <param name="latency">How long each request takes.</param>
+    LoopbackTransport::LoopbackTransport(const std::vector<PerfCounterDescriptor> &catalog,
+                                         const std::wstring &machine,
+                                         std::chrono::milliseconds latency)
+        : m_catalog(catalog)
+        , m_machine(machine)
+        , m_latency(latency)
+        , m_isFailing(false)
+        , m_requestCount(0)
+    {
+    }
+
+
+    /// <summary>
+    /// Sends the stats collected in one or more cycles, each one becoming a package (with
+    /// the metrics of the client, if any), followed by a package for every sample in its burst.
+    /// </summary>
+    /// <param name="items">The stats collected in each cycle.</param>
+    /// <returns>Whether the stats reached the "server".</returns>
+    bool LoopbackTransport::Send(const std::vector<const CollectedStats *> &items)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            std::this_thread::sleep_for(m_latency);
+
+            if (m_isFailing.load())
+                return false;
+
+            std::lock_guard<std::mutex> lock(m_packagesMutex);
+
+            ++m_requestCount;
+
+            for (auto item : items)
+            {
+                m_packages.push_back(
+                    ToStatsPackage(m_catalog,
+                                   m_machine,
+                                   item->sample,
+                                   0,
+                                   item->HasAggregates() ? &item->aggregates : nullptr,
+                                   item->GetSendMask())
+                );
+
+                if (item->hasSelfMetrics)
+                {
+                    auto &package = m_packages.back();
+
+                    for (uint32_t idx = 0; idx < numSelfMetrics; ++idx)
+                    {
+                        package.statSamplesFloat32.emplace_back(ToStatName(static_cast<SelfMetricCode> (idx)),
+                                                                item->selfMetrics[idx].value,
+                                                                item->selfMetrics[idx].quality);
+                    }
+                }
+
+                for (size_t row = 0; row < item->burst.GetSampleCount(); ++row)
+                    m_packages.push_back(ToStatsPackage(m_catalog, m_machine, item->burst, row, nullptr, nullptr));
+            }
+
+            return true;
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when sending stats through loopback: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    /// <summary>
+    /// Gets how many requests have reached the "server".
+    /// </summary>
+    size_t LoopbackTransport::GetRequestCount()
+    {
+        std::lock_guard<std::mutex> lock(m_packagesMutex);
+        return m_requestCount;
+    }
+
+
+    /// <summary>
+    /// Takes the packages received so far, in the order they were sent.
+    /// </summary>
+    std::vector<StatsPackage> LoopbackTransport::TakePackages()
+    {
+        std::lock_guard<std::mutex> lock(m_packagesMutex);
+        std::vector<StatsPackage> packages;
+        packages.swap(m_packages);
+        return packages;
+    }
+
+}// end of namespace application
@@ -0,0 +1,83 @@
+#ifndef __StatsTransport_h__ // header guard
+#define __StatsTransport_h__
+
+#include "CommonDataExchange.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace application
+{
+    /// <summary>
+    /// Interface for the transport that takes the stats collected
+    /// by the client to the server, used by the sending thread.
+    /// </summary>
+    class IStatsTransport
+    {
+    public:
+
+        virtual ~IStatsTransport() {}
+
+        /// <summary>
+        /// Sends the stats collected in one or more cycles, from the oldest to the newest.
+        /// Upon failure, the transport must keep whatever it needs (such as in a spool),
+        /// because the items are recycled right after the call.
+        /// </summary>
+        /// <param name="items">The stats collected in each cycle.</param>
+        /// <returns>Whether the stats reached the server.</returns>
+        virtual bool Send(const std::vector<const CollectedStats *> &items) = 0;
+    };
+
+
+    StatsPackage ToStatsPackage(const std::vector<PerfCounterDescriptor> &catalog,
+                                const std::wstring &machine,
+                                const SamplesBatch &batch,
+                                size_t row,
+                                const SamplesAggregates *aggregates,
+                                const uint8_t *sendMask);
+
+
+    /// <summary>
+    /// An in-process transport that stands in for the network: it converts the stats into
+    /// the packages the server would have extracted from the request, and keeps them.
+    /// The latency and the failure of a server can be simulated.
+    /// </summary>
+    /// <seealso cref="IStatsTransport" />
+    class LoopbackTransport : public IStatsTransport
+    {
+    private:
+
+        const std::vector<PerfCounterDescriptor> &m_catalog;
+        std::wstring m_machine;
+        std::chrono::milliseconds m_latency;
+        std::atomic<bool> m_isFailing;
+
+        std::mutex m_packagesMutex;
+        std::vector<StatsPackage> m_packages;
+        size_t m_requestCount;
+
+    public:
+
+        LoopbackTransport(const std::vector<PerfCounterDescriptor> &catalog,
+                          const std::wstring &machine,
+                          std::chrono::milliseconds latency);
+
+        LoopbackTransport(const LoopbackTransport &) = delete;
+
+        virtual bool Send(const std::vector<const CollectedStats *> &items) override;
+
+        /// <summary>
+        /// Sets whether the requests fail (after the latency), as if the server were down.
+        /// </summary>
+        void SetFailing(bool isFailing) { m_isFailing.store(isFailing); }
+
+        size_t GetRequestCount();
+
+        std::vector<StatsPackage> TakePackages();
+    };
+
+}// end of namespace application
+
+#endif // end of header guard
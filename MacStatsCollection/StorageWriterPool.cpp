@@ -0,0 +1,202 @@
+#include "stdafx.h"
+#include "StorageWriterPool.h"
+#include <3FD\callstacktracer.h>
+#include <3FD\exceptions.h>
+#include <cassert>
+#include <sstream>
+
+namespace application
+{
+    using namespace _3fd::core;
+
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="StorageWriterPool"/> class,
+    /// which creates the writers and starts their threads.
+    /// </summary>
+    /// <param name="writerCount">How many writers work in parallel.</param>
+    /// <param name="factory">Creates each writer (with its own session).</param>
+    StorageWriterPool::StorageWriterPool(size_t writerCount, const StatsWriterFactory &factory)
+        : m_generation(0)
+        , m_pendingCount(0)
+        , m_isClosing(false)
+    {
+        CALL_STACK_TRACE;
+
+        assert(writerCount > 0);
+
+        try
+        {
+            // the writers connect before any thread starts, so a failure leaves nothing behind:
+            for (size_t idx = 0; idx < writerCount; ++idx)
+            {
+                std::unique_ptr<Worker> worker(new Worker());
+                worker->writer = factory();
+                m_workers.push_back(std::move(worker));
+            }
+
+            for (auto &worker : m_workers)
+            {
+                auto workerPtr = worker.get();
+                worker->thread = std::thread(&StorageWriterPool::WorkLoop, this, std::ref(*workerPtr));
+            }
+        }
+        catch (IAppException &)
+        {
+            Close();
+            throw; // just forward already prepared application exceptions
+        }
+        catch (std::exception &ex)
+        {
+            Close();
+            std::ostringstream oss;
+            oss << "Generic failure when creating pool of storage writers: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    /// <summary>
+    /// Finalizes an instance of the <see cref="StorageWriterPool"/> class.
+    /// </summary>
+    StorageWriterPool::~StorageWriterPool()
+    {
+        Close();
+    }
+
+
+    // Stops the threads of the workers
+    void StorageWriterPool::Close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_isClosing = true;
+        }
+
+        m_workAvailable.notify_all();
+
+        for (auto &worker : m_workers)
+        {
+            if (worker->thread.joinable())
+                worker->thread.join();
+        }
+    }
+
+
+    // Waits for the tasks of a worker, then writes them (in its own thread)
+    void StorageWriterPool::WorkLoop(Worker &worker)
+    {
+        uint64_t lastGeneration(0);
+
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+
+                m_workAvailable.wait(lock, [this, lastGeneration]()
+                {
+                    return m_isClosing || m_generation != lastGeneration;
+                });
+
+                if (m_isClosing)
+                    return;
+
+                lastGeneration = m_generation;
+            }
+
+            worker.error = nullptr;
+
+            try
+            {
+                // a writer without tasks in this call still waits for its commit of the previous one:
+                if (!worker.tasks.empty())
+                    worker.writer->WriteStats(worker.tasks);
+                else
+                    worker.writer->Flush();
+            }
+            catch (...)
+            {
+                worker.error = std::current_exception();
+            }
+
+            worker.tasks.clear();
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            if (--m_pendingCount == 0)
+                m_workDone.notify_one();
+        }
+    }
+
+
+    /// <summary>
+    /// Gets the partition (the writer) of the tasks of a machine.
+    /// </summary>
+    /// <param name="machine">The machine.</param>
+    /// <returns>The index of the writer.</returns>
+    size_t StorageWriterPool::GetPartition(InternedName machine) const
+    {
+        // the handle identifies the name, and Fibonacci hashing spreads the consecutive ones:
+        auto hash = static_cast<uint32_t> (machine.GetHandle() * 2654435769U);
+        return static_cast<size_t> ((static_cast<uint64_t> (hash) * m_workers.size()) >> 32);
+    }
+
+
+    /// <summary>
+    /// Writes the stats of the tasks into storage, partitioned by machine among the writers,
+    /// which work in parallel. Returns once all of them have finished the call, so the stats
+    /// of the previous calls are in storage, while the last commit of each writer might still
+    /// be in flight (as explained in <see cref="IStatsWriter::WriteStats"/>).
+    /// </summary>
+    /// <param name="tasks">The tasks, which are cleared.</param>
+    void StorageWriterPool::WriteStats(std::vector<StorageWriteTask> &tasks)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            // the workers are idle now, so their tasks can be touched:
+            for (auto &task : tasks)
+                m_workers[GetPartition(task.machine)]->tasks.push_back(std::move(task));
+
+            tasks.clear();
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            m_pendingCount = m_workers.size();
+            ++m_generation;
+            m_workAvailable.notify_all();
+
+            m_workDone.wait(lock, [this]() { return m_pendingCount == 0; });
+        }
+        catch (IAppException &)
+        {
+            throw; // just forward already prepared application exceptions
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when writing stats with pool of storage writers: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+
+        // when some writer failed, the others might have committed their partitions:
+        for (auto &worker : m_workers)
+        {
+            if (worker->error)
+                std::rethrow_exception(worker->error);
+        }
+    }
+
+
+    /// <summary>
+    /// Waits until the stats of all calls of <see cref="WriteStats"/> are in storage.
+    /// </summary>
+    void StorageWriterPool::Flush()
+    {
+        // without tasks, every writer just waits for its commit in flight:
+        std::vector<StorageWriteTask> noTasks;
+        WriteStats(noTasks);
+    }
+
+}// end of namespace application
@@ -0,0 +1,78 @@
+#ifndef __StorageWriterPool_h__ // header guard
+#define __StorageWriterPool_h__
+
+#include "MSDStorageWriter.h"
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace application
+{
+    /// <summary>
+    /// Creates a writer for <see cref="StorageWriterPool"/>, which has its own session with storage.
+    /// </summary>
+    typedef std::function<std::unique_ptr<IStatsWriter> ()> StatsWriterFactory;
+
+
+    /// <summary>
+    /// Writes the stats into storage with several writers in parallel, each one in a thread of its
+    /// own and with its own session, so the throughput is not capped by the latency of a single
+    /// connection. The tasks are partitioned by machine, so the samples of a machine always go
+    /// through the same writer, in the order they were received.
+    /// </summary>
+    /// <seealso cref="notcopiable" />
+    class StorageWriterPool
+    {
+    private:
+
+        /// <summary>
+        /// A writer and the tasks of its partition, handled by a thread of its own.
+        /// </summary>
+        struct Worker
+        {
+            std::unique_ptr<IStatsWriter> writer;
+            std::vector<StorageWriteTask> tasks;
+            std::exception_ptr error; // from the last call, if it failed
+            std::thread thread;
+        };
+
+        std::vector<std::unique_ptr<Worker>> m_workers;
+
+        std::mutex m_mutex;
+        std::condition_variable m_workAvailable;
+        std::condition_variable m_workDone;
+        uint64_t m_generation; // counts the calls handed to the workers
+        size_t m_pendingCount; // workers yet to finish the current call
+        bool m_isClosing;
+
+        void WorkLoop(Worker &worker);
+
+        void Close();
+
+    public:
+
+        StorageWriterPool(size_t writerCount, const StatsWriterFactory &factory);
+
+        StorageWriterPool(const StorageWriterPool &) = delete;
+
+        ~StorageWriterPool();
+
+        void WriteStats(std::vector<StorageWriteTask> &tasks);
+
+        void Flush();
+
+        size_t GetPartition(InternedName machine) const;
+
+        /// <summary>
+        /// Gets how many writers are in the pool.
+        /// </summary>
+        size_t GetWriterCount() const { return m_workers.size(); }
+    };
+
+}// end of namespace application
+
+#endif // end of header guard
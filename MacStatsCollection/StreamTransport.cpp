@@ -0,0 +1,786 @@
+#include "stdafx.h"
+#include "StreamTransport.h"
+#include <3FD\callstacktracer.h>
+#include <3FD\exceptions.h>
+#include <3FD\logger.h>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <sstream>
+#include <system_error>
+
+namespace application
+{
+    using namespace _3fd;
+    using namespace _3fd::core;
+    using namespace std::chrono;
+
+
+    /// <summary>
+    /// Throws an exception for a failed call of Winsock.
+    /// </summary>
+    /// <param name="message">The main message.</param>
+    /// <param name="errorCode">The code of the error.</param>
+    /// <param name="funcName">Name of the API function.</param>
+    static void ThrowSocketError(const char *message, int errorCode, const char *funcName)
+    {
+        std::ostringstream oss;
+        oss << message << " - ";
+        WWAPI::AppendDWordErrorMessage(static_cast<DWORD> (errorCode), funcName, oss);
+        throw AppException<std::runtime_error>(oss.str());
+    }
+
+
+    /// <summary>
+    /// What a message in the stream carries.
+    /// </summary>
+    enum class MessageType : uint8_t
+    {
+        Frame, // a frame encoded by BinaryStatsEncoder to open a session (or the response to it)
+        Ack,   // the status and how many frames of stats the endpoint has taken so far
+        Stats  // the number of a frame of stats in the connection (counting from 1), then the frame
+    };
+
+    /* Every message starts with the size of the rest (in 4 bytes, little-endian),
+    then comes its type, followed by the content. */
+    static const size_t messageHeaderSize(5);
+
+    // The size of the number of a frame of stats, which precedes it in the message
+    static const size_t sequenceSize(8);
+
+    // The size of the content of an acknowledgement: the status, then the count in 8 bytes
+    static const size_t ackSize(9);
+
+    // A message larger than this breaks the connection
+    static const size_t maxMessageSize(4 * 1024 * 1024);
+
+    // How much is received at a time
+    static const size_t receiveChunkSize(64 * 1024);
+
+    // How long the client waits for the response to open a session
+    static const milliseconds responseTimeout(30000);
+
+
+    // Writes an unsigned integer in little-endian
+    static void WriteLittleEndian(uint8_t *destination, uint64_t value, size_t size)
+    {
+        for (size_t idx = 0; idx < size; ++idx)
+            destination[idx] = static_cast<uint8_t> (value >> (8 * idx));
+    }
+
+    // Reads an unsigned integer in little-endian
+    static uint64_t ReadLittleEndian(const uint8_t *source, size_t size)
+    {
+        uint64_t value(0);
+        for (size_t idx = 0; idx < size; ++idx)
+            value |= static_cast<uint64_t> (source[idx]) << (8 * idx);
+
+        return value;
+    }
+
+    // Makes a message with the given content (reusing the memory of the buffer)
+    static void MakeMessage(MessageType type, const uint8_t *content, size_t size, std::vector<uint8_t> &message)
+    {
+        message.resize(messageHeaderSize + size);
+        WriteLittleEndian(message.data(), size + 1, 4);
+        message[4] = static_cast<uint8_t> (type);
+        memcpy(message.data() + messageHeaderSize, content, size);
+    }
+
+    // Makes a message with a frame of stats and its number (reusing the memory of the buffer)
+    static void MakeStatsMessage(uint64_t sequence, const std::vector<uint8_t> &frame, std::vector<uint8_t> &message)
+    {
+        message.resize(messageHeaderSize + sequenceSize + frame.size());
+        WriteLittleEndian(message.data(), sequenceSize + frame.size() + 1, 4);
+        message[4] = static_cast<uint8_t> (MessageType::Stats);
+        WriteLittleEndian(message.data() + messageHeaderSize, sequence, sequenceSize);
+        memcpy(message.data() + messageHeaderSize + sequenceSize, frame.data(), frame.size());
+    }
+
+    // Sends a whole message, returning zero, or the code of the error
+    static int SendWholeMessage(SOCKET socket, const std::vector<uint8_t> &message)
+    {
+        size_t sentSize(0);
+
+        while (sentSize < message.size())
+        {
+            auto sent = send(socket,
+                             reinterpret_cast<const char *> (message.data() + sentSize),
+                             static_cast<int> (message.size() - sentSize),
+                             0);
+
+            if (sent == SOCKET_ERROR)
+                return WSAGetLastError();
+
+            sentSize += static_cast<size_t> (sent);
+        }
+
+        return 0;
+    }
+
+
+    ///////////////////
+    // Server Side
+    ///////////////////
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="StatsStreamEndpoint"/> class,
+    /// which starts accepting connections.
+    /// </summary>
+    /// <param name="port">The TCP port to listen to, in all interfaces.</param>
+    /// <param name="handler">The handler of the decoded stats, called by the thread of each connection.</param>
+    /// <param name="sessionOpener">Opens the sessions requested by the clients, called by the thread of each connection.</param>
+    /// <param name="ackEveryFrames">How many frames a connection takes before acknowledging them.</param>
+    /// <param name="ackInterval">How long at most a frame waits to be acknowledged.</param>
+    /// <param name="maxConnections">How many connections can be open at the same time.</param>
+    StatsStreamEndpoint::StatsStreamEndpoint(uint16_t port,
+                                             const BinaryStatsHandler &handler,
+                                             const BinarySessionOpener &sessionOpener,
+                                             uint32_t ackEveryFrames,
+                                             milliseconds ackInterval,
+                                             size_t maxConnections)
+        : m_listener(INVALID_SOCKET)
+        , m_handler(handler)
+        , m_sessionOpener(sessionOpener)
+        , m_ackEveryFrames((std::max)(ackEveryFrames, 1U))
+        , m_ackInterval((std::max)(ackInterval, milliseconds(1)))
+        , m_maxConnections(maxConnections)
+        , m_isClosing(false)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            WSADATA wsaData;
+            auto rc = WSAStartup(MAKEWORD(2, 2), &wsaData);
+            if (rc != 0)
+                ThrowSocketError("Failed to initialize Winsock", rc, "WSAStartup");
+
+            m_listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            if (m_listener == INVALID_SOCKET)
+            {
+                auto errorCode = WSAGetLastError();
+                WSACleanup();
+                ThrowSocketError("Failed to create socket for stream endpoint", errorCode, "socket");
+            }
+
+            // the accepting thread must never block but in the poll:
+            u_long isNonBlocking(1);
+
+            sockaddr_in address;
+            memset(&address, 0, sizeof address);
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_ANY);
+            address.sin_port = htons(port);
+
+            if (ioctlsocket(m_listener, FIONBIO, &isNonBlocking) == SOCKET_ERROR
+                || bind(m_listener, reinterpret_cast<const sockaddr *> (&address), sizeof address) == SOCKET_ERROR
+                || listen(m_listener, SOMAXCONN) == SOCKET_ERROR)
+            {
+                auto errorCode = WSAGetLastError();
+                closesocket(m_listener);
+                WSACleanup();
+                ThrowSocketError("Failed to listen in stream endpoint", errorCode, "ioctlsocket/bind/listen");
+            }
+
+            m_acceptingThread = std::thread(&StatsStreamEndpoint::AcceptLoop, this);
+        }
+        catch (IAppException &)
+        {
+            throw; // just forward exceptions regarding errors known to have been previously handled
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when starting stream endpoint: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    /// <summary>
+    /// Finalizes an instance of the <see cref="StatsStreamEndpoint"/> class.
+    /// </summary>
+    StatsStreamEndpoint::~StatsStreamEndpoint()
+    {
+        Close();
+    }
+
+
+    /// <summary>
+    /// Stops serving. The threads notice it as soon as they wake up, then all connections
+    /// are closed. The frames not yet acknowledged are dropped, as the clients expect them to be.
+    /// </summary>
+    void StatsStreamEndpoint::Close()
+    {
+        if (!m_acceptingThread.joinable())
+            return;
+
+        m_isClosing.store(true, std::memory_order_release);
+        m_acceptingThread.join();
+
+        // a connection whose stats are being handled closes once the handler returns:
+        for (auto &connection : m_connections)
+            connection->thread.join();
+
+        m_connections.clear();
+        closesocket(m_listener);
+        WSACleanup();
+    }
+
+
+    // Runs in the accepting thread, until closed
+    void StatsStreamEndpoint::AcceptLoop()
+    {
+        CALL_STACK_TRACE;
+
+        // wakes up at least this often, to check whether closed:
+        const INT pollTimeout(250);
+
+        while (!m_isClosing.load(std::memory_order_acquire))
+        {
+            WSAPOLLFD pollFd{ m_listener, POLLRDNORM, 0 };
+
+            if (WSAPoll(&pollFd, 1, pollTimeout) == SOCKET_ERROR)
+            {
+                std::ostringstream oss;
+                oss << "Failed to wait for connections in stream endpoint - ";
+                WWAPI::AppendDWordErrorMessage(WSAGetLastError(), "WSAPoll", oss);
+                Logger::Write(oss.str(), Logger::PRIO_CRITICAL);
+                return;
+            }
+
+            // the connections already closed by their threads are released:
+            for (size_t idx = m_connections.size(); idx > 0; --idx)
+            {
+                auto &connection = *m_connections[idx - 1];
+
+                if (connection.isClosed.load(std::memory_order_acquire))
+                {
+                    connection.thread.join();
+                    m_connections.erase(m_connections.begin() + (idx - 1));
+                }
+            }
+
+            if ((pollFd.revents & POLLRDNORM) != 0)
+                Accept();
+        }
+    }
+
+
+    // Accepts the pending connections, refusing those beyond the limit
+    void StatsStreamEndpoint::Accept()
+    {
+        while (true)
+        {
+            auto socket = accept(m_listener, nullptr, nullptr);
+
+            if (socket == INVALID_SOCKET)
+            {
+                auto errorCode = WSAGetLastError();
+
+                if (errorCode != WSAEWOULDBLOCK && errorCode != WSAECONNRESET)
+                {
+                    std::ostringstream oss;
+                    oss << "Failed to accept connection to stream endpoint - ";
+                    WWAPI::AppendDWordErrorMessage(errorCode, "accept", oss);
+                    Logger::Write(oss.str(), Logger::PRIO_ERROR);
+                }
+
+                return;
+            }
+
+            if (m_connections.size() >= m_maxConnections)
+            {
+                closesocket(socket);
+                Logger::Write("Stream endpoint refused connection, because too many are open", Logger::PRIO_WARNING);
+                continue;
+            }
+
+            // the acknowledgements are small and must not wait:
+            u_long isNonBlocking(1);
+            BOOL noDelay(TRUE);
+
+            if (ioctlsocket(socket, FIONBIO, &isNonBlocking) == SOCKET_ERROR
+                || setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char *> (&noDelay), sizeof noDelay) == SOCKET_ERROR)
+            {
+                closesocket(socket);
+                continue;
+            }
+
+            std::unique_ptr<Connection> connection(new Connection());
+            connection->socket = socket;
+            connection->sessionId = 0;
+            connection->ackedCount = 0;
+            connection->unackedCount = 0;
+            connection->isClosed.store(false, std::memory_order_relaxed);
+
+            try
+            {
+                connection->thread = std::thread(&StatsStreamEndpoint::ServeConnection, this, std::ref(*connection));
+            }
+            catch (std::system_error &ex)
+            {
+                closesocket(socket);
+
+                std::ostringstream oss;
+                oss << "Stream endpoint refused connection, because it could not start a thread: " << ex.what();
+                Logger::Write(oss.str(), Logger::PRIO_ERROR);
+                continue;
+            }
+
+            m_connections.push_back(std::move(connection));
+        }
+    }
+
+
+    // Runs in the thread of a connection, until either the connection or the endpoint is closed
+    void StatsStreamEndpoint::ServeConnection(Connection &connection)
+    {
+        CALL_STACK_TRACE;
+
+        // wakes up at least this often, to check whether closed and to acknowledge on time:
+        auto pollTimeout = static_cast<INT> ((std::min)(m_ackInterval, milliseconds(250)).count());
+
+        bool isOpen(true);
+
+        while (isOpen && !m_isClosing.load(std::memory_order_acquire))
+        {
+            try
+            {
+                WSAPOLLFD pollFd{ connection.socket, POLLRDNORM, 0 };
+
+                if (WSAPoll(&pollFd, 1, pollTimeout) == SOCKET_ERROR)
+                    ThrowSocketError("Failed to wait for messages in stream endpoint", WSAGetLastError(), "WSAPoll");
+
+                if ((pollFd.revents & (POLLRDNORM | POLLHUP | POLLERR)) != 0)
+                    isOpen = Receive(connection);
+
+                if (isOpen
+                    && connection.unackedCount > 0
+                    && steady_clock::now() - connection.firstUnackedTime >= m_ackInterval)
+                {
+                    isOpen = Acknowledge(connection);
+                }
+            }
+            catch (IAppException &ex)
+            {
+                Logger::Write(ex, Logger::PRIO_CRITICAL);
+                isOpen = false;
+            }
+            catch (std::exception &ex)
+            {
+                std::ostringstream oss;
+                oss << "Generic failure when serving connection to stream endpoint: " << ex.what();
+                Logger::Write(oss.str(), Logger::PRIO_CRITICAL);
+                isOpen = false;
+            }
+        }
+
+        closesocket(connection.socket);
+        connection.isClosed.store(true, std::memory_order_release);
+    }
+
+
+    // Receives what is available in a connection and handles the whole messages. Returns whether still open.
+    bool StatsStreamEndpoint::Receive(Connection &connection)
+    {
+        auto &input = connection.input;
+
+        while (true)
+        {
+            auto offset = input.size();
+            input.resize(offset + receiveChunkSize);
+
+            auto received = recv(connection.socket,
+                                 reinterpret_cast<char *> (input.data() + offset),
+                                 static_cast<int> (receiveChunkSize),
+                                 0);
+
+            if (received == SOCKET_ERROR)
+            {
+                input.resize(offset);
+
+                if (WSAGetLastError() == WSAEWOULDBLOCK)
+                    break; // no more for now
+
+                return false; // broken
+            }
+
+            input.resize(offset + static_cast<size_t> (received));
+
+            if (received == 0)
+                return false; // closed by the client
+
+            if (static_cast<size_t> (received) < receiveChunkSize)
+                break;
+        }
+
+        size_t position(0);
+
+        while (input.size() - position >= messageHeaderSize)
+        {
+            auto size = static_cast<size_t> (ReadLittleEndian(input.data() + position, 4));
+
+            if (size == 0 || size > maxMessageSize)
+                return false;
+
+            if (input.size() - position - 4 < size)
+                break; // the rest of the message is yet to come
+
+            if (!HandleMessage(connection, input.data() + position + 4, size))
+                return false;
+
+            position += 4 + size;
+        }
+
+        input.erase(input.begin(), input.begin() + position);
+        return true;
+    }
+
+
+    /* Handles a message from the client, which is either a request to open a session (authenticating
+    the client) or a frame of stats by ID in that session, whose stats are kept until acknowledged.
+    Returns false when the connection must be closed, such as when the client is not authentic. */
+    bool StatsStreamEndpoint::HandleMessage(Connection &connection, const uint8_t *message, size_t size)
+    {
+        if (message[0] == static_cast<uint8_t> (MessageType::Frame))
+        {
+            auto frame = message + 1;
+            auto frameSize = size - 1;
+
+            FrameKind kind;
+            if (!PeekFrameKind(frame, frameSize, kind) || kind != FrameKind::OpenSession)
+                return false;
+
+            // the stats of the previous session (if any) are acknowledged first:
+            if (connection.unackedCount > 0 && !Acknowledge(connection))
+                return false;
+
+            std::wstring machine, authKey;
+            std::vector<std::wstring> statNames;
+            std::vector<int16_t> statIds;
+
+            if (!DecodeOpenSession(frame, frameSize, machine, authKey, statNames))
+                return false;
+
+            connection.sessionId = m_sessionOpener(machine, authKey, statNames, statIds);
+            if (connection.sessionId == 0)
+                return false; // not authentic
+
+            std::vector<uint8_t> response;
+            EncodeSessionOpened(connection.sessionId, statIds, response);
+            MakeMessage(MessageType::Frame, response.data(), response.size(), connection.output);
+            return SendWholeMessage(connection.socket, connection.output) == 0;
+        }
+
+        if (message[0] != static_cast<uint8_t> (MessageType::Stats) || size < 1 + sequenceSize)
+            return false;
+
+        auto sequence = ReadLittleEndian(message + 1, sequenceSize);
+        auto frame = message + 1 + sequenceSize;
+        auto frameSize = size - 1 - sequenceSize;
+
+        /* Once some frames are refused, those the client has sent meanwhile (in a session that might be
+        lost) are dropped without being counted, until it sends again the first frame not acknowledged: */
+        if (sequence != connection.ackedCount + connection.unackedCount + 1)
+            return true;
+
+        std::wstring authKey;
+        uint64_t sessionId;
+
+        // the stats must come by ID, in the session of this connection:
+        if (connection.sessionId == 0
+            || !DecodeStats(frame, frameSize, authKey, sessionId, connection.packages)
+            || sessionId != connection.sessionId)
+        {
+            return false;
+        }
+
+        if (connection.unackedCount++ == 0)
+            connection.firstUnackedTime = steady_clock::now();
+
+        // even when many frames arrive at once, they are acknowledged every so many:
+        if (connection.unackedCount >= m_ackEveryFrames)
+            return Acknowledge(connection);
+
+        return true;
+    }
+
+
+    /* Hands the stats of the frames not yet acknowledged to the handler, in a single call, then tells the
+    client how many frames were taken so far, which counts those frames only if the handler accepts them.
+    Returns false when the connection must be closed. */
+    bool StatsStreamEndpoint::Acknowledge(Connection &connection)
+    {
+        auto status = BinaryStatus::Accepted;
+
+        if (!connection.packages.empty())
+            status = m_handler(std::wstring(), connection.sessionId, connection.packages);
+
+        if (status == BinaryStatus::Accepted)
+            connection.ackedCount += connection.unackedCount;
+
+        connection.packages.clear();
+        connection.unackedCount = 0;
+
+        // the client must open another session:
+        if (status == BinaryStatus::UnknownSession)
+            connection.sessionId = 0;
+
+        uint8_t ack[ackSize];
+        ack[0] = static_cast<uint8_t> (status);
+        WriteLittleEndian(ack + 1, connection.ackedCount, 8);
+
+        MakeMessage(MessageType::Ack, ack, sizeof ack, connection.output);
+
+        /* When the client does not read the acknowledgements, the
+        socket cannot take more of them, and the connection is closed. */
+        return SendWholeMessage(connection.socket, connection.output) == 0 && status != BinaryStatus::Rejected;
+    }
+
+
+    ///////////////////
+    // Client Side
+    ///////////////////
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="StatsStreamClient"/> class, which connects to the endpoint.
+    /// </summary>
+    /// <param name="host">The host of the stream endpoint.</param>
+    /// <param name="port">The port of the stream endpoint.</param>
+    StatsStreamClient::StatsStreamClient(const std::wstring &host, uint16_t port)
+        : m_socket(INVALID_SOCKET)
+        , m_sentCount(0)
+        , m_ackedCount(0)
+        , m_status(BinaryStatus::Accepted)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            WSADATA wsaData;
+            auto rc = WSAStartup(MAKEWORD(2, 2), &wsaData);
+            if (rc != 0)
+                ThrowSocketError("Failed to initialize Winsock", rc, "WSAStartup");
+
+            // the endpoint listens to IPv4:
+            ADDRINFOW hints;
+            memset(&hints, 0, sizeof hints);
+            hints.ai_family = AF_INET;
+            hints.ai_socktype = SOCK_STREAM;
+            hints.ai_protocol = IPPROTO_TCP;
+
+            PADDRINFOW addresses;
+            rc = GetAddrInfoW(host.c_str(), std::to_wstring(port).c_str(), &hints, &addresses);
+            if (rc != 0)
+            {
+                WSACleanup();
+                ThrowSocketError("Failed to resolve host of stream endpoint", rc, "GetAddrInfoW");
+            }
+
+            m_socket = socket(addresses->ai_family, addresses->ai_socktype, addresses->ai_protocol);
+
+            // every message goes in a single call, so it must not wait for more:
+            BOOL noDelay(TRUE);
+
+            if (m_socket == INVALID_SOCKET
+                || setsockopt(m_socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char *> (&noDelay), sizeof noDelay) == SOCKET_ERROR
+                || connect(m_socket, addresses->ai_addr, static_cast<int> (addresses->ai_addrlen)) == SOCKET_ERROR)
+            {
+                auto errorCode = WSAGetLastError();
+                FreeAddrInfoW(addresses);
+
+                if (m_socket != INVALID_SOCKET)
+                    closesocket(m_socket);
+
+                WSACleanup();
+                ThrowSocketError("Failed to connect to stream endpoint", errorCode, "socket/setsockopt/connect");
+            }
+
+            FreeAddrInfoW(addresses);
+        }
+        catch (IAppException &)
+        {
+            throw; // just forward exceptions regarding errors known to have been previously handled
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when connecting to stream endpoint: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    /// <summary>
+    /// Finalizes an instance of the <see cref="StatsStreamClient"/> class.
+    /// </summary>
+    StatsStreamClient::~StatsStreamClient()
+    {
+        closesocket(m_socket);
+        WSACleanup();
+    }
+
+
+    /* Takes the messages from the endpoint, waiting for them up to the timeout. When a response is
+    expected, it is done upon the first frame (the acknowledgements before it are taken as well),
+    otherwise it is done when all frames were acknowledged. Returns whether it is done. */
+    bool StatsStreamClient::Receive(milliseconds timeout, std::vector<uint8_t> *response)
+    {
+        auto deadline = steady_clock::now() + timeout;
+
+        while (true)
+        {
+            size_t position(0);
+            bool isDone(false);
+
+            while (!isDone && m_input.size() - position >= messageHeaderSize)
+            {
+                auto size = static_cast<size_t> (ReadLittleEndian(m_input.data() + position, 4));
+
+                if (size == 0 || size > maxMessageSize)
+                    throw AppException<std::runtime_error>("Stream endpoint sent malformed message");
+
+                if (m_input.size() - position - 4 < size)
+                    break; // the rest of the message is yet to come
+
+                auto type = m_input[position + 4];
+                auto content = m_input.data() + position + messageHeaderSize;
+                auto contentSize = size - 1;
+
+                if (type == static_cast<uint8_t> (MessageType::Ack)
+                    && contentSize == ackSize
+                    && content[0] <= static_cast<uint8_t> (BinaryStatus::RetryLater))
+                {
+                    m_status = static_cast<BinaryStatus> (content[0]);
+                    m_ackedCount = ReadLittleEndian(content + 1, 8);
+
+                    // the endpoint has dropped the frames not acknowledged, so their numbers are taken again:
+                    if (m_status != BinaryStatus::Accepted)
+                        m_sentCount = m_ackedCount;
+                }
+                else if (type == static_cast<uint8_t> (MessageType::Frame) && response != nullptr)
+                {
+                    response->assign(content, content + contentSize);
+                    isDone = true;
+                }
+                else
+                    throw AppException<std::runtime_error>("Stream endpoint sent unexpected message");
+
+                position += 4 + size;
+            }
+
+            m_input.erase(m_input.begin(), m_input.begin() + position);
+
+            if (isDone || (response == nullptr && m_ackedCount == m_sentCount))
+                return true;
+
+            auto remaining = duration_cast<microseconds>(deadline - steady_clock::now());
+            if (remaining.count() < 0)
+                remaining = microseconds(0);
+
+            fd_set readSet;
+            FD_ZERO(&readSet);
+            FD_SET(m_socket, &readSet);
+
+            timeval waitTime{ static_cast<long> (remaining.count() / 1000000),
+                              static_cast<long> (remaining.count() % 1000000) };
+
+            auto rc = select(0, &readSet, nullptr, nullptr, &waitTime);
+            if (rc == SOCKET_ERROR)
+                ThrowSocketError("Failed to wait for messages from stream endpoint", WSAGetLastError(), "select");
+
+            if (rc == 0)
+                return false; // timeout
+
+            auto offset = m_input.size();
+            m_input.resize(offset + receiveChunkSize);
+
+            auto received = recv(m_socket,
+                                 reinterpret_cast<char *> (m_input.data() + offset),
+                                 static_cast<int> (receiveChunkSize),
+                                 0);
+
+            if (received == SOCKET_ERROR)
+                ThrowSocketError("Failed to receive messages from stream endpoint", WSAGetLastError(), "recv");
+
+            if (received == 0)
+                throw AppException<std::runtime_error>("Stream endpoint has closed the connection");
+
+            m_input.resize(offset + static_cast<size_t> (received));
+        }
+    }
+
+
+    /// <summary>
+    /// Sends a frame and waits for the frame in response (used to open a session).
+    /// </summary>
+    /// <param name="frame">The frame to send.</param>
+    /// <param name="response">Where to save the frame in response.</param>
+    void StatsStreamClient::Exchange(const std::vector<uint8_t> &frame, std::vector<uint8_t> &response)
+    {
+        CALL_STACK_TRACE;
+
+        MakeMessage(MessageType::Frame, frame.data(), frame.size(), m_output);
+
+        auto rc = SendWholeMessage(m_socket, m_output);
+        if (rc != 0)
+            ThrowSocketError("Failed to send message to stream endpoint", rc, "send");
+
+        if (!Receive(responseTimeout, &response))
+            throw AppException<std::runtime_error>("Stream endpoint did not respond in time");
+
+        // the acknowledgements taken so far are about the frames before the response:
+        m_status = BinaryStatus::Accepted;
+    }
+
+
+    /// <summary>
+    /// Streams a frame of stats by ID, without waiting for it to be acknowledged.
+    /// </summary>
+    /// <param name="frame">The frame encoded by <see cref="BinaryStatsEncoder::Encode"/> in a session.</param>
+    /// <returns>The status in the last acknowledgement received since the previous call,
+    /// which is <see cref="BinaryStatus::Accepted"/> when there is none. Any other status means
+    /// the endpoint has dropped all frames not acknowledged so far, this one included.</returns>
+    BinaryStatus StatsStreamClient::Post(const std::vector<uint8_t> &frame)
+    {
+        CALL_STACK_TRACE;
+
+        // a refusal taken while flushing would drop this frame as well, hence it is not sent:
+        if (m_status != BinaryStatus::Accepted)
+        {
+            auto status = m_status;
+            m_status = BinaryStatus::Accepted;
+            return status;
+        }
+
+        MakeStatsMessage(m_sentCount + 1, frame, m_output);
+
+        auto rc = SendWholeMessage(m_socket, m_output);
+        if (rc != 0)
+            ThrowSocketError("Failed to send message to stream endpoint", rc, "send");
+
+        ++m_sentCount;
+
+        // take the acknowledgements already received:
+        Receive(milliseconds(0), nullptr);
+
+        auto status = m_status;
+        m_status = BinaryStatus::Accepted;
+        return status;
+    }
+
+
+    /// <summary>
+    /// Waits for the endpoint to acknowledge all the frames posted.
+    /// </summary>
+    /// <param name="timeout">How long to wait at most.</param>
+    /// <returns>Whether all frames were acknowledged.</returns>
+    bool StatsStreamClient::Flush(milliseconds timeout)
+    {
+        CALL_STACK_TRACE;
+        return Receive(timeout, nullptr);
+    }
+
+}// end of namespace application
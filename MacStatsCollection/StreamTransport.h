@@ -0,0 +1,145 @@
+#ifndef __StreamTransport_h__ // header guard
+#define __StreamTransport_h__
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include "BinaryHttp.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace application
+{
+    ///////////////////
+    // Server Side
+    ///////////////////
+
+    /// <summary>
+    /// Serves long-lived TCP connections on which the clients stream the frames encoded by
+    /// <see cref="BinaryStatsEncoder"/>, each one in a message prefixed by its length. A client
+    /// authenticates once, by opening a session in the connection, then streams the stats by ID
+    /// with no response for each frame. The endpoint gathers the stats of a connection and hands
+    /// them to the handler at once, then acknowledges cumulatively how many frames were taken,
+    /// which happens every some frames or after some time. When the handler does not take them,
+    /// the count does not advance, and the frames that follow are dropped, until the client sends
+    /// them again. Each connection is served by a thread of its own, so a handler that waits for
+    /// the stats to be durable holds back only the connection whose stats it is handling.
+    /// </summary>
+    /// <seealso cref="notcopiable" />
+    class StatsStreamEndpoint
+    {
+    private:
+
+        /// <summary>
+        /// The state of a connection with a client.
+        /// </summary>
+        struct Connection
+        {
+            SOCKET socket;
+            std::vector<uint8_t> input; // received, but not yet a whole message
+            std::vector<uint8_t> output;
+            uint64_t sessionId; // zero until the client opens a session
+            uint64_t ackedCount; // frames whose stats were taken
+            uint32_t unackedCount;
+            std::chrono::time_point<std::chrono::steady_clock> firstUnackedTime;
+            std::vector<StatsPackage> packages; // from the frames not yet acknowledged
+            std::thread thread;
+            std::atomic<bool> isClosed; // once the thread is done
+        };
+
+        SOCKET m_listener;
+        BinaryStatsHandler m_handler;
+        BinarySessionOpener m_sessionOpener;
+        uint32_t m_ackEveryFrames;
+        std::chrono::milliseconds m_ackInterval;
+        size_t m_maxConnections;
+        std::vector<std::unique_ptr<Connection>> m_connections; // used by the accepting thread only
+        std::atomic<bool> m_isClosing;
+        std::thread m_acceptingThread;
+
+        void AcceptLoop();
+
+        void Accept();
+
+        void ServeConnection(Connection &connection);
+
+        bool Receive(Connection &connection);
+
+        bool HandleMessage(Connection &connection, const uint8_t *message, size_t size);
+
+        bool Acknowledge(Connection &connection);
+
+    public:
+
+        StatsStreamEndpoint(uint16_t port,
+                            const BinaryStatsHandler &handler,
+                            const BinarySessionOpener &sessionOpener,
+                            uint32_t ackEveryFrames,
+                            std::chrono::milliseconds ackInterval,
+                            size_t maxConnections);
+
+        StatsStreamEndpoint(const StatsStreamEndpoint &) = delete;
+
+        ~StatsStreamEndpoint();
+
+        void Close();
+    };
+
+
+    ///////////////////
+    // Client Side
+    ///////////////////
+
+    /// <summary>
+    /// Streams the frames encoded by <see cref="BinaryStatsEncoder"/> to <see cref="StatsStreamEndpoint"/>
+    /// in a single connection. Posting a frame does not wait: the acknowledgements are taken as they come.
+    /// When the endpoint does not take some frames, it drops all those not yet acknowledged, and the count
+    /// of posted frames goes back to the acknowledged ones. Hence the caller keeps the stats of a frame until
+    /// acknowledged, to send them again (in a new frame) once the connection breaks or a frame is refused.
+    /// </summary>
+    /// <seealso cref="IBinaryStatsClient" />
+    /// <seealso cref="notcopiable" />
+    class StatsStreamClient : public IBinaryStatsClient
+    {
+    private:
+
+        SOCKET m_socket;
+        std::vector<uint8_t> m_output;
+        std::vector<uint8_t> m_input; // received, but not yet a whole message
+        uint64_t m_sentCount;
+        uint64_t m_ackedCount;
+        BinaryStatus m_status; // in the last acknowledgement, until reported
+
+        bool Receive(std::chrono::milliseconds timeout, std::vector<uint8_t> *response);
+
+    public:
+
+        StatsStreamClient(const std::wstring &host, uint16_t port);
+
+        StatsStreamClient(const StatsStreamClient &) = delete;
+
+        virtual ~StatsStreamClient();
+
+        virtual void Exchange(const std::vector<uint8_t> &frame, std::vector<uint8_t> &response) override;
+
+        virtual BinaryStatus Post(const std::vector<uint8_t> &frame) override;
+
+        bool Flush(std::chrono::milliseconds timeout);
+
+        /// <summary>
+        /// Gets how many frames of stats were posted.
+        /// </summary>
+        uint64_t GetSentCount() const { return m_sentCount; }
+
+        /// <summary>
+        /// Gets how many of the posted frames the endpoint has acknowledged so far.
+        /// </summary>
+        uint64_t GetAckedCount() const { return m_ackedCount; }
+    };
+
+}// end of namespace application
+
+#endif // end of header guard
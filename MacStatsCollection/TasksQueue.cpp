@@ -2,6 +2,11 @@
 #include "TasksQueue.h"
 #include <3FD\callstacktracer.h>
 #include <3FD\exceptions.h>
+#include <3FD\configuration.h>
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+#include <thread>
 
 namespace application
 {
@@ -28,7 +33,21 @@ namespace application
         {
             std::lock_guard<std::mutex> lock(singletonCreationMutex);
 
-            singleton.reset(new TasksQueue());
+            if (!singleton)
+            {
+                // by default, a shard for each hardware thread:
+                size_t shardCount = AppConfig::GetSettings().application.GetUInt("srvQueueShards", 0);
+                if (shardCount == 0)
+                    shardCount = (std::max)(std::thread::hardware_concurrency(), 1U);
+
+                size_t highWatermark = AppConfig::GetSettings().application.GetUInt("srvQueueHighWatermark", 262144);
+                size_t lowWatermark = AppConfig::GetSettings().application.GetUInt("srvQueueLowWatermark", 131072);
+
+                highWatermark = (std::max)(highWatermark, static_cast<size_t> (1));
+                lowWatermark = (std::min)(lowWatermark, highWatermark - 1);
+
+                singleton.reset(new TasksQueue(shardCount, highWatermark, lowWatermark));
+            }
 
             return *singleton;
         }
@@ -54,21 +73,119 @@ namespace application
     }
 
 
+    /// <summary>
+    /// Initializes a new instance of the <see cref="TasksQueue"/> class.
+    /// </summary>
+    /// <param name="shardCount">How many shards the queue is split in.</param>
+    /// <param name="highWatermark">The depth (in tasks) from which the queue refuses more tasks.</param>
+    /// <param name="lowWatermark">The depth (in tasks) below which the queue takes tasks again.</param>
+    TasksQueue::TasksQueue(size_t shardCount, size_t highWatermark, size_t lowWatermark)
+        : m_shards(new Shard[shardCount])
+        , m_shardCount(shardCount)
+        , m_highWatermark(highWatermark)
+        , m_lowWatermark(lowWatermark)
+        , m_depth(0)
+        , m_isSaturated(false)
+        , m_rejectedCount(0)
+        , m_wakeTarget(SIZE_MAX)
+        , m_takenTasks(new std::vector<StatsPackage>[shardCount])
+    {
+        assert(shardCount > 0 && lowWatermark < highWatermark);
+    }
+
+
     /// <summary>
     /// Enqueues the specified task.
     /// </summary>
-    /// <param name="task">The task.</param>
-    void TasksQueue::Enqueue(std::unique_ptr<StatsPackage> &&task)
+    /// <param name="task">The task, which is left untouched when refused.</param>
+    /// <returns>Whether the task was taken, otherwise the queue is full.</returns>
+    bool TasksQueue::Enqueue(std::unique_ptr<StatsPackage> &&task)
     {
         CALL_STACK_TRACE;
-        m_queue.Push(std::move(task));
+
+        if (!EnqueueTasks(task.get(), 1))
+            return false;
+
+        task.reset();
+        return true;
+    }
+
+    /// <summary>
+    /// Enqueues at once all the tasks coming from a single request.
+    /// </summary>
+    /// <param name="tasks">The tasks, which are moved into the queue, leaving the vector empty but
+    /// with its capacity (so it can be reused), or left untouched when refused.</param>
+    /// <returns>Whether the tasks were taken, otherwise the queue is full.</returns>
+    bool TasksQueue::Enqueue(std::vector<StatsPackage> &&tasks)
+    {
+        CALL_STACK_TRACE;
+
+        if (tasks.empty())
+            return true;
+
+        if (!EnqueueTasks(tasks.data(), tasks.size()))
+            return false;
+
+        tasks.clear();
+        return true;
+    }
+
+    /* Moves the tasks into the shard of the calling thread, unless refused, and then they are left
+    untouched. The tasks come from either overload of Enqueue, so neither makes a vector of its own. */
+    bool TasksQueue::EnqueueTasks(StatsPackage *tasks, size_t count)
+    {
+        /* Once saturated, the queue refuses everything until the consumer drains it below the
+        low watermark, so it does not flap at the high one. A batch larger than the high watermark
+        is still taken by an empty queue, otherwise it would never be. */
+        if (!m_isSaturated.load(std::memory_order_acquire))
+        {
+            auto depth = m_depth.fetch_add(count);
+
+            if (depth == 0 || depth + count <= m_highWatermark)
+            {
+                auto &shard = m_shards[std::hash<std::thread::id>()(std::this_thread::get_id()) % m_shardCount];
+
+                try
+                {
+                    std::lock_guard<std::mutex> lock(shard.mutex);
+
+                    // once reserved, moving the tasks cannot fail:
+                    shard.tasks.reserve(shard.tasks.size() + count);
+                    std::move(tasks, tasks + count, std::back_inserter(shard.tasks));
+                }
+                catch (std::exception &ex)
+                {
+                    m_depth.fetch_sub(count, std::memory_order_acq_rel);
+
+                    std::ostringstream oss;
+                    oss << "Generic failure when enqueuing tasks: " << ex.what();
+                    throw AppException<std::runtime_error>(oss.str());
+                }
+
+                // wake the consumer when this batch makes the depth reach its target:
+                auto wakeTarget = m_wakeTarget.load();
+                if (depth < wakeTarget && depth + count >= wakeTarget)
+                {
+                    std::lock_guard<std::mutex> lock(m_wakeMutex);
+                    m_wakeCondition.notify_one();
+                }
+
+                return true;
+            }
+
+            m_depth.fetch_sub(count, std::memory_order_acq_rel);
+            m_isSaturated.store(true, std::memory_order_release);
+        }
+
+        m_rejectedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
     }
 
     /// <summary>
-    /// Dequeues all tasks.
+    /// Dequeues all tasks. Must be called by a single thread.
     /// </summary>
     /// <param name="tasks">Will be cleared to receive the dequeued tasks.</param>
-    void TasksQueue::Dequeue(std::vector<std::unique_ptr<StatsPackage>> &tasks)
+    void TasksQueue::Dequeue(std::vector<StatsPackage> &tasks)
     {
         CALL_STACK_TRACE;
 
@@ -76,10 +193,25 @@ namespace application
         {
             tasks.clear();
 
-            m_queue.ForEach([&tasks](std::unique_ptr<StatsPackage> &entry)
+            // the shards are locked just for swapping their vectors with the ones emptied before:
+            for (size_t idx = 0; idx < m_shardCount; ++idx)
             {
-                tasks.emplace_back(entry.release());
-            });
+                auto &shard = m_shards[idx];
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                shard.tasks.swap(m_takenTasks[idx]);
+            }
+
+            for (size_t idx = 0; idx < m_shardCount; ++idx)
+            {
+                auto &taken = m_takenTasks[idx];
+                std::move(taken.begin(), taken.end(), std::back_inserter(tasks));
+                taken.clear();
+            }
+
+            auto depth = m_depth.fetch_sub(tasks.size(), std::memory_order_acq_rel) - tasks.size();
+
+            if (depth < m_lowWatermark)
+                m_isSaturated.store(false, std::memory_order_release);
         }
         catch (IAppException &)
         {
@@ -93,4 +225,43 @@ namespace application
         }
     }
 
+    /// <summary>
+    /// Waits until the queue holds some amount of tasks. Must be called by the consumer.
+    /// </summary>
+    /// <param name="count">How many tasks to wait for.</param>
+    /// <param name="timeout">How long to wait at most.</param>
+    /// <returns>Whether the queue holds the tasks, instead of timing out.</returns>
+    bool TasksQueue::WaitForTasks(size_t count, std::chrono::milliseconds timeout)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            count = (std::max)(count, static_cast<size_t> (1));
+
+            /* A producer reads the target after it adds to the depth, and the consumer reads
+            the depth after it sets the target, so either the consumer sees the depth reaching
+            the target, or the producer sees the target and notifies under the lock. */
+            m_wakeTarget.store(count);
+
+            std::unique_lock<std::mutex> lock(m_wakeMutex);
+
+            bool isReached = m_wakeCondition.wait_for(lock, timeout, [this, count]()
+            {
+                return m_depth.load() >= count;
+            });
+
+            m_wakeTarget.store(SIZE_MAX);
+            return isReached;
+        }
+        catch (std::exception &ex)
+        {
+            m_wakeTarget.store(SIZE_MAX);
+
+            std::ostringstream oss;
+            oss << "Generic failure when waiting for tasks: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
 }// end of namespace application
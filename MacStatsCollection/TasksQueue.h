@@ -2,39 +2,89 @@
 #define __TasksQueue_h__
 
 #include "CommonDataExchange.h"
-#include <3FD\utils_lockfreequeue.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <memory>
 #include <vector>
 #include <mutex>
 
 namespace application
 {
-    using namespace _3fd;
-
     /// <summary>
-    /// A lock-free queue for tasks to provide efficient concurrent access.
+    /// A bounded queue for the tasks, written by the threads serving the requests and read by the
+    /// main thread only. All the tasks coming from a single request are moved in at once. The queue
+    /// is split in shards, so the producing threads rarely contend, and the consumer takes each shard
+    /// at once, by swapping its vector with another. The vectors are never released, so in steady
+    /// state neither enqueuing nor dequeuing allocates. When the depth (in tasks) reaches the high
+    /// watermark, the batches are refused, so the server can tell the clients to retry later, until
+    /// the depth falls below the low one. The consumer can wait until the queue holds enough tasks
+    /// to be worth taking.
     /// </summary>
+    /// <seealso cref="notcopiable" />
     class TasksQueue
     {
     private:
 
-        utils::Win32ApiWrappers::LockFreeQueue<std::unique_ptr<StatsPackage>> m_queue;
+        /// <summary>
+        /// A shard of the queue, with the tasks enqueued by some of the threads.
+        /// </summary>
+        struct Shard
+        {
+            std::mutex mutex;
+            std::vector<StatsPackage> tasks;
+        };
+
+        std::unique_ptr<Shard[]> m_shards;
+        const size_t m_shardCount;
+        const size_t m_highWatermark;
+        const size_t m_lowWatermark;
+
+        std::atomic<size_t> m_depth;
+        std::atomic<bool> m_isSaturated;
+        std::atomic<uint64_t> m_rejectedCount;
+
+        // the consumer waits for the depth to reach the target (the maximum when not waiting):
+        std::atomic<size_t> m_wakeTarget;
+        std::mutex m_wakeMutex;
+        std::condition_variable m_wakeCondition;
+
+        std::unique_ptr<std::vector<StatsPackage>[]> m_takenTasks; // one per shard, used by the consumer only
 
         static std::mutex singletonCreationMutex;
 
         static std::unique_ptr<TasksQueue> singleton;
 
-        TasksQueue() {}
+        bool EnqueueTasks(StatsPackage *tasks, size_t count);
 
     public:
 
+        TasksQueue(size_t shardCount, size_t highWatermark, size_t lowWatermark);
+
+        TasksQueue(const TasksQueue &) = delete;
+
         static TasksQueue &GetInstance();
 
         static void Finalize();
 
-        void Enqueue(std::unique_ptr<StatsPackage> &&task);
+        bool Enqueue(std::unique_ptr<StatsPackage> &&task);
+
+        bool Enqueue(std::vector<StatsPackage> &&tasks);
+
+        void Dequeue(std::vector<StatsPackage> &tasks);
+
+        bool WaitForTasks(size_t count, std::chrono::milliseconds timeout);
+
+        /// <summary>
+        /// Gets how many tasks are in the queue.
+        /// </summary>
+        size_t GetDepth() const { return m_depth.load(std::memory_order_relaxed); }
 
-        void Dequeue(std::vector<std::unique_ptr<StatsPackage>> &tasks);
+        /// <summary>
+        /// Gets how many batches of tasks were refused so far.
+        /// </summary>
+        uint64_t GetRejectedCount() const { return m_rejectedCount.load(std::memory_order_relaxed); }
     };
 
 }// end of namespace application
@@ -0,0 +1,429 @@
+#include "stdafx.h"
+#include "UdpTransport.h"
+#include <3FD\callstacktracer.h>
+#include <3FD\exceptions.h>
+#include <3FD\logger.h>
+#include <codecvt>
+#include <cstring>
+#include <sstream>
+
+namespace application
+{
+    using namespace _3fd;
+    using namespace _3fd::core;
+
+
+    /// <summary>
+    /// Throws an exception for a failed call of Winsock.
+    /// </summary>
+    /// <param name="message">The main message.</param>
+    /// <param name="errorCode">The code of the error.</param>
+    /// <param name="funcName">Name of the API function.</param>
+    static void ThrowSocketError(const char *message, int errorCode, const char *funcName)
+    {
+        std::ostringstream oss;
+        oss << message << " - ";
+        WWAPI::AppendDWordErrorMessage(static_cast<DWORD> (errorCode), funcName, oss);
+        throw AppException<std::runtime_error>(oss.str());
+    }
+
+
+    /* The largest datagram sent, so it fits in the MTU of Ethernet (1500 bytes, minus
+    28 for the headers of IPv4 and UDP) and is never fragmented. A larger one is dropped. */
+    static const size_t maxDatagramSize(1472);
+
+
+    ///////////////////
+    // Server Side
+    ///////////////////
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="UdpStatsEndpoint"/> class,
+    /// which starts receiving datagrams.
+    /// </summary>
+    /// <param name="port">The UDP port to listen to, in all interfaces.</param>
+    /// <param name="verifier">Verifies the MAC of the frames, called by the receiving thread.</param>
+    /// <param name="handler">The handler of the decoded stats, called by the receiving thread.</param>
+    /// <param name="maxClockSkew">How far from now the time of a sample can be (which also limits
+    /// how long a captured datagram can be replayed).</param>
+    /// <param name="maxBatchSize">How many datagrams are received at most before calling the handler.</param>
+    UdpStatsEndpoint::UdpStatsEndpoint(uint16_t port,
+                                       const DatagramVerifier &verifier,
+                                       const DatagramStatsHandler &handler,
+                                       std::chrono::seconds maxClockSkew,
+                                       size_t maxBatchSize)
+        : m_socket(INVALID_SOCKET)
+        , m_verifier(verifier)
+        , m_handler(handler)
+        , m_maxClockSkew(maxClockSkew)
+        , m_maxBatchSize((std::max)(maxBatchSize, static_cast<size_t> (1)))
+        , m_isClosing(false)
+        , m_droppedCount(0)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            WSADATA wsaData;
+            auto rc = WSAStartup(MAKEWORD(2, 2), &wsaData);
+            if (rc != 0)
+                ThrowSocketError("Failed to initialize Winsock", rc, "WSAStartup");
+
+            m_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+            if (m_socket == INVALID_SOCKET)
+            {
+                auto errorCode = WSAGetLastError();
+                WSACleanup();
+                ThrowSocketError("Failed to create socket for UDP endpoint", errorCode, "socket");
+            }
+
+            // room for bursts of datagrams while the receiving thread is busy:
+            int bufferSize(static_cast<int> (m_maxBatchSize * maxDatagramSize * 4));
+            setsockopt(m_socket, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char *> (&bufferSize), sizeof bufferSize);
+
+            // draining the datagrams available must not block:
+            u_long isNonBlocking(1);
+
+            sockaddr_in address;
+            memset(&address, 0, sizeof address);
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_ANY);
+            address.sin_port = htons(port);
+
+            if (ioctlsocket(m_socket, FIONBIO, &isNonBlocking) == SOCKET_ERROR
+                || bind(m_socket, reinterpret_cast<const sockaddr *> (&address), sizeof address) == SOCKET_ERROR)
+            {
+                auto errorCode = WSAGetLastError();
+                closesocket(m_socket);
+                WSACleanup();
+                ThrowSocketError("Failed to bind socket of UDP endpoint", errorCode, "ioctlsocket/bind");
+            }
+
+            m_receivingThread = std::thread(&UdpStatsEndpoint::ReceiveLoop, this);
+        }
+        catch (IAppException &)
+        {
+            throw; // just forward exceptions regarding errors known to have been previously handled
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when starting UDP endpoint: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    /// <summary>
+    /// Finalizes an instance of the <see cref="UdpStatsEndpoint"/> class.
+    /// </summary>
+    UdpStatsEndpoint::~UdpStatsEndpoint()
+    {
+        Close();
+    }
+
+
+    /// <summary>
+    /// Stops receiving datagrams. The receiving thread notices
+    /// it as soon as it wakes up, then the socket is closed.
+    /// </summary>
+    void UdpStatsEndpoint::Close()
+    {
+        if (!m_receivingThread.joinable())
+            return;
+
+        m_isClosing.store(true, std::memory_order_release);
+        m_receivingThread.join();
+        closesocket(m_socket);
+        WSACleanup();
+    }
+
+
+    // Runs in the receiving thread, until closed
+    void UdpStatsEndpoint::ReceiveLoop()
+    {
+        CALL_STACK_TRACE;
+
+        // reused by every batch:
+        std::vector<uint8_t> buffer(m_maxBatchSize * maxDatagramSize);
+        std::vector<size_t> datagramSizes(m_maxBatchSize);
+        std::vector<StatsPackage> packages;
+
+        while (!m_isClosing.load(std::memory_order_acquire))
+        {
+            // wait for datagrams, waking up now and then to check whether closed:
+            fd_set readSet;
+            FD_ZERO(&readSet);
+            FD_SET(m_socket, &readSet);
+
+            timeval timeout{ 0, 250000 };
+
+            auto rc = select(0, &readSet, nullptr, nullptr, &timeout);
+            if (rc == 0)
+                continue;
+
+            if (rc == SOCKET_ERROR)
+            {
+                std::ostringstream oss;
+                oss << "Failed to wait for datagrams in UDP endpoint - ";
+                WWAPI::AppendDWordErrorMessage(WSAGetLastError(), "select", oss);
+                Logger::Write(oss.str(), Logger::PRIO_CRITICAL);
+                return;
+            }
+
+            // take all datagrams available, up to a batch:
+            size_t count(0);
+            while (count < m_maxBatchSize)
+            {
+                auto received = recv(m_socket,
+                                     reinterpret_cast<char *> (buffer.data() + count * maxDatagramSize),
+                                     static_cast<int> (maxDatagramSize),
+                                     0);
+
+                if (received != SOCKET_ERROR)
+                {
+                    datagramSizes[count++] = static_cast<size_t> (received);
+                    continue;
+                }
+
+                auto errorCode = WSAGetLastError();
+
+                if (errorCode == WSAEWOULDBLOCK)
+                    break; // no more for now
+
+                if (errorCode == WSAEMSGSIZE || errorCode == WSAECONNRESET)
+                {
+                    // too large, or an ICMP error from a previous send: skip it
+                    m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+
+                std::ostringstream oss;
+                oss << "Failed to receive datagram in UDP endpoint - ";
+                WWAPI::AppendDWordErrorMessage(errorCode, "recv", oss);
+                Logger::Write(oss.str(), Logger::PRIO_CRITICAL);
+                return;
+            }
+
+            try
+            {
+                for (size_t idx = 0; idx < count; ++idx)
+                {
+                    if (!HandleDatagram(buffer.data() + idx * maxDatagramSize, datagramSizes[idx], packages))
+                        m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                if (!packages.empty())
+                    m_handler(packages);
+            }
+            catch (IAppException &ex)
+            {
+                Logger::Write(ex, Logger::PRIO_CRITICAL);
+            }
+            catch (std::exception &ex)
+            {
+                std::ostringstream oss;
+                oss << "Generic failure when processing datagrams in UDP endpoint: " << ex.what();
+                Logger::Write(oss.str(), Logger::PRIO_CRITICAL);
+            }
+
+            packages.clear();
+        }
+    }
+
+
+    /* Authenticates a datagram, then decodes its stats, appending them to the packages of the batch.
+    The MAC is verified before decoding, so the names in a forged datagram are never interned. */
+    bool UdpStatsEndpoint::HandleDatagram(const uint8_t *data, size_t size, std::vector<StatsPackage> &packages)
+    {
+        if (size <= HmacSha256::macSize)
+            return false;
+
+        auto frameSize = size - HmacSha256::macSize;
+
+        InternedName machine;
+        if (!PeekMachine(data, frameSize, machine) || !m_verifier(machine, data, frameSize, data + frameSize))
+            return false;
+
+        std::wstring authKey;
+        uint64_t sessionId;
+        auto initialCount = packages.size();
+
+        if (!DecodeStats(data, frameSize, authKey, sessionId, packages))
+            return false;
+
+        // a sample too far from now is either from a bad clock or replayed:
+        using namespace std::chrono;
+        auto now = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+        auto maxSkew = m_maxClockSkew.count();
+
+        for (size_t idx = initialCount; idx < packages.size(); ++idx)
+        {
+            auto time = packages[idx].timeSinceEpochInMillisecs;
+            if (time < now - maxSkew || time > now + maxSkew)
+            {
+                packages.erase(packages.begin() + initialCount, packages.end());
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+
+    ///////////////////
+    // Client Side
+    ///////////////////
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="UdpStatsSender"/> class.
+    /// </summary>
+    /// <param name="host">The host of the UDP endpoint.</param>
+    /// <param name="port">The port of the UDP endpoint.</param>
+    /// <param name="machine">The name of this machine.</param>
+    /// <param name="authKey">The key for authentication of this machine, which never goes in the datagrams.</param>
+    UdpStatsSender::UdpStatsSender(const std::wstring &host,
+                                   uint16_t port,
+                                   const std::wstring &machine,
+                                   const std::wstring &authKey)
+        : m_socket(INVALID_SOCKET)
+        , m_authKey(std::wstring_convert<std::codecvt_utf8<wchar_t>>().to_bytes(authKey))
+        , m_encoder(machine, L"")
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            m_datagram.reserve(maxDatagramSize);
+
+            WSADATA wsaData;
+            auto rc = WSAStartup(MAKEWORD(2, 2), &wsaData);
+            if (rc != 0)
+                ThrowSocketError("Failed to initialize Winsock", rc, "WSAStartup");
+
+            // the endpoint listens to IPv4:
+            ADDRINFOW hints;
+            memset(&hints, 0, sizeof hints);
+            hints.ai_family = AF_INET;
+            hints.ai_socktype = SOCK_DGRAM;
+            hints.ai_protocol = IPPROTO_UDP;
+
+            PADDRINFOW addresses;
+            rc = GetAddrInfoW(host.c_str(), std::to_wstring(port).c_str(), &hints, &addresses);
+            if (rc != 0)
+            {
+                WSACleanup();
+                ThrowSocketError("Failed to resolve host of UDP endpoint", rc, "GetAddrInfoW");
+            }
+
+            m_socket = socket(addresses->ai_family, addresses->ai_socktype, addresses->ai_protocol);
+
+            // "connected", so every datagram goes to the endpoint without resolving it again:
+            if (m_socket == INVALID_SOCKET
+                || connect(m_socket, addresses->ai_addr, static_cast<int> (addresses->ai_addrlen)) == SOCKET_ERROR)
+            {
+                auto errorCode = WSAGetLastError();
+                FreeAddrInfoW(addresses);
+
+                if (m_socket != INVALID_SOCKET)
+                    closesocket(m_socket);
+
+                WSACleanup();
+                ThrowSocketError("Failed to create socket for UDP endpoint", errorCode, "socket/connect");
+            }
+
+            FreeAddrInfoW(addresses);
+        }
+        catch (IAppException &)
+        {
+            throw; // just forward exceptions regarding errors known to have been previously handled
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when creating sender for UDP endpoint: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    /// <summary>
+    /// Finalizes an instance of the <see cref="UdpStatsSender"/> class.
+    /// </summary>
+    UdpStatsSender::~UdpStatsSender()
+    {
+        closesocket(m_socket);
+        WSACleanup();
+    }
+
+
+    // Sends the given rows of a batch, splitting them in halves until each part fits in a datagram
+    void UdpStatsSender::SendRows(const std::vector<PerfCounterDescriptor> &catalog,
+                                  const SamplesBatch &batch,
+                                  size_t firstRow,
+                                  size_t endRow)
+    {
+        m_part.counterIds = batch.counterIds;
+        m_part.Clear();
+
+        for (size_t row = firstRow; row < endRow; ++row)
+            m_part.AddSampleFrom(batch, row);
+
+        auto &frame = m_encoder.Encode(catalog, m_part);
+
+        if (frame.size() + HmacSha256::macSize > maxDatagramSize)
+        {
+            if (endRow - firstRow == 1)
+                throw AppException<std::runtime_error>("Sample is too large for a datagram to UDP endpoint");
+
+            auto middleRow = firstRow + (endRow - firstRow) / 2;
+            SendRows(catalog, batch, firstRow, middleRow);
+            SendRows(catalog, batch, middleRow, endRow);
+            return;
+        }
+
+        m_datagram.assign(frame.begin(), frame.end());
+        m_datagram.resize(frame.size() + HmacSha256::macSize);
+        m_hmac.Compute(m_authKey, frame.data(), frame.size(), m_datagram.data() + frame.size());
+
+        if (send(m_socket,
+                 reinterpret_cast<const char *> (m_datagram.data()),
+                 static_cast<int> (m_datagram.size()),
+                 0) == SOCKET_ERROR)
+        {
+            auto errorCode = WSAGetLastError();
+
+            // an ICMP error from a previous datagram is no reason to fail
+            if (errorCode != WSAECONNRESET)
+                ThrowSocketError("Failed to send datagram to UDP endpoint", errorCode, "send");
+        }
+    }
+
+
+    /// <summary>
+    /// Sends a batch of samples, in as many datagrams as needed, not knowing whether they arrive.
+    /// </summary>
+    /// <param name="catalog">The catalog of performance counters.</param>
+    /// <param name="batch">The batch of samples to send.</param>
+    void UdpStatsSender::Send(const std::vector<PerfCounterDescriptor> &catalog, const SamplesBatch &batch)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            if (batch.GetSampleCount() > 0)
+                SendRows(catalog, batch, 0, batch.GetSampleCount());
+        }
+        catch (IAppException &)
+        {
+            throw; // just forward exceptions regarding errors known to have been previously handled
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when sending datagram to UDP endpoint: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+}// end of namespace application
@@ -0,0 +1,125 @@
+#ifndef __UdpTransport_h__ // header guard
+#define __UdpTransport_h__
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include "BinaryCodec.h"
+#include "HmacSha256.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace application
+{
+    /// <summary>
+    /// Verifies the MAC of a frame received by <see cref="UdpStatsEndpoint"/>,
+    /// with the key of the machine it claims to come from.
+    /// </summary>
+    typedef std::function<bool (InternedName machine,
+                                const uint8_t *frame,
+                                size_t size,
+                                const uint8_t *mac)> DatagramVerifier;
+
+    /// <summary>
+    /// Handles the stats decoded from the authentic datagrams received by
+    /// <see cref="UdpStatsEndpoint"/> in a batch, which can be moved away.
+    /// </summary>
+    typedef std::function<void (std::vector<StatsPackage> &packages)> DatagramStatsHandler;
+
+
+    ///////////////////
+    // Server Side
+    ///////////////////
+
+    /// <summary>
+    /// Receives stats in fire-and-forget UDP datagrams, for metrics sampled more often than a request
+    /// per sample could bear. A datagram carries a frame of stats by name made by <see cref="BinaryStatsEncoder"/>
+    /// (without the key), followed by its HMAC-SHA256 with the key of the machine. A dedicated thread waits
+    /// for datagrams, then takes at once all that are available (up to a batch), so the handler is called
+    /// once for the whole batch. Datagrams that are malformed, whose MAC does not verify, or whose samples
+    /// are not recent, are dropped, since there is no response.
+    /// </summary>
+    /// <seealso cref="notcopiable" />
+    class UdpStatsEndpoint
+    {
+    private:
+
+        SOCKET m_socket;
+        DatagramVerifier m_verifier;
+        DatagramStatsHandler m_handler;
+        std::chrono::milliseconds m_maxClockSkew;
+        size_t m_maxBatchSize;
+        std::atomic<bool> m_isClosing;
+        std::atomic<uint64_t> m_droppedCount;
+        std::thread m_receivingThread;
+
+        void ReceiveLoop();
+
+        bool HandleDatagram(const uint8_t *data, size_t size, std::vector<StatsPackage> &packages);
+
+    public:
+
+        UdpStatsEndpoint(uint16_t port,
+                         const DatagramVerifier &verifier,
+                         const DatagramStatsHandler &handler,
+                         std::chrono::seconds maxClockSkew,
+                         size_t maxBatchSize);
+
+        UdpStatsEndpoint(const UdpStatsEndpoint &) = delete;
+
+        ~UdpStatsEndpoint();
+
+        void Close();
+
+        /// <summary>
+        /// Gets how many datagrams were dropped so far.
+        /// </summary>
+        uint64_t GetDroppedCount() const { return m_droppedCount.load(std::memory_order_relaxed); }
+    };
+
+
+    ///////////////////
+    // Client Side
+    ///////////////////
+
+    /// <summary>
+    /// Sends stats to <see cref="UdpStatsEndpoint"/> in datagrams, never waiting for a response.
+    /// A batch of samples too large for a single datagram is split into as many as needed.
+    /// </summary>
+    /// <seealso cref="notcopiable" />
+    class UdpStatsSender
+    {
+    private:
+
+        SOCKET m_socket;
+        std::string m_authKey; // in UTF-8
+        BinaryStatsEncoder m_encoder;
+        HmacSha256 m_hmac;
+        SamplesBatch m_part;
+        std::vector<uint8_t> m_datagram;
+
+        void SendRows(const std::vector<PerfCounterDescriptor> &catalog,
+                      const SamplesBatch &batch,
+                      size_t firstRow,
+                      size_t endRow);
+
+    public:
+
+        UdpStatsSender(const std::wstring &host,
+                       uint16_t port,
+                       const std::wstring &machine,
+                       const std::wstring &authKey);
+
+        UdpStatsSender(const UdpStatsSender &) = delete;
+
+        ~UdpStatsSender();
+
+        void Send(const std::vector<PerfCounterDescriptor> &catalog, const SamplesBatch &batch);
+    };
+
+}// end of namespace application
+
+#endif // end of header guard
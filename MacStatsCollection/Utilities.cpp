@@ -3,6 +3,7 @@
 #include <3FD\exceptions.h>
 #include <3FD\callstacktracer.h>
 #include <Poco\Data\ODBC\Connector.h>
+#include <atomic>
 #include <cstdlib>
 #include <sstream>
 
@@ -51,12 +52,8 @@ namespace application
     }
 
 
-    /// <summary>
-    /// Generates a batch identifier for use in database operations.
-    /// </summary>
-    /// <returns>An ID which is unlikely to collide with
-    /// another one generated by another thread or process.</returns>
-    int16_t GenerateBatchId()
+    // Makes the first batch identifier of this process, unlikely to be taken by another process
+    static uint16_t MakeFirstBatchId()
     {
         auto big = GetCurrentProcessId() + GetCurrentThreadId() + (time(nullptr) % 3600);
 
@@ -65,7 +62,21 @@ namespace application
         auto c = static_cast<int> ((big >> 32) & 0xffff);
         auto d = static_cast<int> ((big >> 48) & 0xffff);
 
-        return static_cast<int16_t> (rand() + (a ^ b ^ c ^ d));
+        return static_cast<uint16_t> (rand() + (a ^ b ^ c ^ d));
+    }
+
+
+    /// <summary>
+    /// Generates a batch identifier for use in database operations.
+    /// </summary>
+    /// <returns>An ID which never collides with another one generated by another
+    /// thread of this process, unless 65536 batches are in use at once, and which
+    /// is unlikely to collide with another one generated by another process.</returns>
+    int16_t GenerateBatchId()
+    {
+        // a counter shared by all threads, so the writers working in parallel take distinct ID's:
+        static std::atomic<uint16_t> nextBatchId(MakeFirstBatchId());
+        return static_cast<int16_t> (nextBatchId.fetch_add(1, std::memory_order_relaxed));
     }
 
 }// end of namespace application
@@ -4,7 +4,9 @@
 #include <3FD\exceptions.h>
 #include <3FD\logger.h>
 #include <3FD\configuration.h>
+#include "StatsPackagePool.h"
 #include "Utilities.h"
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <chrono>
@@ -20,48 +22,94 @@ namespace application
     /////////////////////
 
 
+    /// <summary>
+    /// Copies the time and the stats of a sample received in a request
+    /// (either <see cref="SendStatsSampleRequest"/> or <see cref="StatsSample"/>).
+    /// Either list of stats might be empty (and then have no array), because
+    /// the client omits the stats whose values did not change.
+    /// </summary>
+    /// <param name="sample">The sample in the payload of the HTTP request.</param>
+    /// <param name="package">The package to receive the copied data.</param>
+    template <typename SampleType>
+    static void CopyStatsData(const SampleType &sample, StatsPackage &package)
+    {
+        _ASSERTE((sample.statsFloat32Count == 0 || sample.statsFloat32 != nullptr)
+                 && (sample.statsInt32Count == 0 || sample.statsInt32 != nullptr));
+
+        package.timeSinceEpochInMillisecs = sample.time;
+
+        package.statSamplesInt32.reserve(sample.statsInt32Count);
+        package.statSamplesFloat32.reserve(sample.statsFloat32Count);
+
+        for (uint32_t idx = 0; idx < sample.statsFloat32Count; ++idx)
+        {
+            auto &entry = sample.statsFloat32[idx];
+            package.statSamplesFloat32.emplace_back(entry.statName,
+                                                    entry.statValue,
+                                                    static_cast<Quality> (entry.quality));
+        }
+
+        for (uint32_t idx = 0; idx < sample.statsInt32Count; ++idx)
+        {
+            auto &entry = sample.statsInt32[idx];
+            package.statSamplesInt32.emplace_back(entry.statName,
+                                                  entry.statValue,
+                                                  static_cast<Quality> (entry.quality));
+        }
+    }
+
     /// <summary>
     /// Extracts the data from an HTTP request that carries "machine stats",
     /// and whose memory is allocated from WWS API heap
     /// </summary>
     /// <param name="request">The payload of the HTTP request.</param>
-    /// <returns>A <see cref="StatsPackage"/> object for processing, containing the extracted data.</returns>
-    std::unique_ptr<StatsPackage> ExtractStatsDataFrom(const SendStatsSampleRequest &request)
+    /// <param name="packages">Where to append the <see cref="StatsPackage"/> object for processing,
+    /// containing the extracted data, which is taken from <see cref="StatsPackagePool"/>.</param>
+    void ExtractStatsDataFrom(const SendStatsSampleRequest &request, std::vector<StatsPackage> &packages)
     {
-        _ASSERTE(request.statsFloat32Count != 0 && request.statsInt32Count != 0);
-
         CALL_STACK_TRACE;
         
         try
         {
-            auto package = std::make_unique<StatsPackage>();
-            package->machine.clear();
-            package->statSamplesFloat32.clear();
-            package->statSamplesInt32.clear();
-            
-            package->timeSinceEpochInMillisecs = request.time;
-            
-            package->machine = request.machine;
-            package->statSamplesInt32.reserve(request.statsInt32Count);
-            package->statSamplesFloat32.reserve(request.statsFloat32Count);
+            packages.push_back(StatsPackagePool::GetInstance().Acquire());
+            auto &package = packages.back();
+            package.machine = request.machine;
+            CopyStatsData(request, package);
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when copying data from service request: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
 
-            for (uint32_t idx = 0; idx < request.statsFloat32Count; ++idx)
-            {
-                auto &entry = request.statsFloat32[idx];
-                package->statSamplesFloat32.emplace_back(entry.statName,
-                                                         entry.statValue,
-                                                         static_cast<Quality> (entry.quality));
-            }
+    /// <summary>
+    /// Extracts the data from an HTTP request that carries several samples of
+    /// "machine stats", and whose memory is allocated from WWS API heap.
+    /// </summary>
+    /// <param name="request">The payload of the HTTP request.</param>
+    /// <param name="packages">
+    /// Where to append the <see cref="StatsPackage"/> objects for processing, one per sample,
+    /// which are taken from <see cref="StatsPackagePool"/> and can be enqueued at once.
+    /// </param>
+    void ExtractStatsDataFrom(const SendStatsSamplesRequest &request, std::vector<StatsPackage> &packages)
+    {
+        _ASSERTE(request.samplesCount != 0);
+
+        CALL_STACK_TRACE;
 
-            for (uint32_t idx = 0; idx < request.statsInt32Count; ++idx)
+        try
+        {
+            packages.reserve(packages.size() + request.samplesCount);
+
+            for (uint32_t idx = 0; idx < request.samplesCount; ++idx)
             {
-                auto &entry = request.statsInt32[idx];
-                package->statSamplesInt32.emplace_back(entry.statName,
-                                                       entry.statValue,
-                                                       static_cast<Quality> (entry.quality));
+                packages.push_back(StatsPackagePool::GetInstance().Acquire());
+                auto &package = packages.back();
+                package.machine = request.machine;
+                CopyStatsData(request.samples[idx], package);
             }
-
-            return package;
         }
         catch (std::exception &ex)
         {
@@ -72,71 +120,355 @@ namespace application
     }
 
     /// <summary>
-    /// Creates the request from.
+    /// Sets the time and the stats of a sample to send in a request
+    /// (either <see cref="SendStatsSampleRequest"/> or <see cref="StatsSample"/>).
+    /// This is a single loop over the counters in the batch.
+    /// </summary>
+    /// <param name="catalog">The catalog of performance counters.</param>
+    /// <param name="batch">The batch of samples.</param>
+    /// <param name="row">The row of the sample in the batch.</param>
+    /// <param name="sendMask">One flag per column telling whether to send the value,
+    /// or null to send all of them.</param>
+    /// <param name="request">The sample in the payload of the request.</param>
+    /// <param name="heap">The heap.</param>
+    template <typename RequestType>
+    static void SetStatsData(const std::vector<PerfCounterDescriptor> &catalog,
+                             const SamplesBatch &batch,
+                             size_t row,
+                             const uint8_t *sendMask,
+                             RequestType *request,
+                             wws::WSHeap &heap)
+    {
+        using namespace std::chrono;
+
+        static const auto epoch = system_clock().from_time_t(0);
+
+        request->time = duration_cast<milliseconds>(batch.times[row] - epoch).count();
+
+        auto counterCount = batch.GetCounterCount();
+
+        unsigned int countFloat32(0), countInt32(0);
+
+        for (size_t idx = 0; idx < counterCount; ++idx)
+        {
+            bool isSent = (sendMask == nullptr || sendMask[idx] != 0);
+            bool isFloat32 = (catalog[batch.counterIds[idx]].valueType == StatValueType::Float32);
+            countFloat32 += (isSent && isFloat32) ? 1 : 0;
+            countInt32 += (isSent && !isFloat32) ? 1 : 0;
+        }
+
+        // when all stats of a type are omitted, there is no array for them:
+        request->statsFloat32Count = countFloat32;
+        request->statsFloat32 = (countFloat32 > 0) ? heap.Alloc<listOfStatsFloat32_entry>(countFloat32) : nullptr;
+
+        request->statsInt32Count = countInt32;
+        request->statsInt32 = (countInt32 > 0) ? heap.Alloc<listOfStatsInt32_entry>(countInt32) : nullptr;
+
+        auto values = batch.GetValues(row);
+        auto qualities = batch.GetQualities(row);
+        unsigned int idxFloat32(0), idxInt32(0);
+
+        for (size_t idx = 0; idx < counterCount; ++idx)
+        {
+            if (sendMask != nullptr && sendMask[idx] == 0)
+                continue;
+
+            auto &descriptor = catalog[batch.counterIds[idx]];
+            auto statName = const_cast<wchar_t *> (descriptor.statName.c_str());
+
+            if (descriptor.valueType == StatValueType::Float32)
+            {
+                auto &stat = request->statsFloat32[idxFloat32++];
+                stat.statName = statName;
+                stat.statValue = static_cast<float> (values[idx]);
+                stat.quality = static_cast<char> (qualities[idx]);
+            }
+            else
+            {
+                auto &stat = request->statsInt32[idxInt32++];
+                stat.statName = statName;
+                stat.statValue = static_cast<int> (values[idx]);
+                stat.quality = static_cast<char> (qualities[idx]);
+            }
+        }
+    }
+
+    /// <summary>
+    /// Appends the aggregates of a send cycle to the stats of a sample in a request
+    /// (either <see cref="SendStatsSampleRequest"/> or <see cref="StatsSample"/>),
+    /// among those whose value type is float 32 bits.
+    /// </summary>
+    /// <param name="catalog">The catalog of performance counters.</param>
+    /// <param name="aggregates">The aggregates.</param>
+    /// <param name="sendMask">One flag per column telling whether to send the aggregates,
+    /// or null to send all of them.</param>
+    /// <param name="request">The sample in the payload of the request, already set.</param>
+    /// <param name="heap">The heap.</param>
+    template <typename RequestType>
+    static void AppendAggregates(const std::vector<PerfCounterDescriptor> &catalog,
+                                 const SamplesAggregates &aggregates,
+                                 const uint8_t *sendMask,
+                                 RequestType *request,
+                                 wws::WSHeap &heap)
+    {
+        auto lastSampleCount = request->statsFloat32Count;
+        auto counterCount = aggregates.counterIds.size();
+        auto statsFloat32 = heap.Alloc<listOfStatsFloat32_entry>(lastSampleCount + counterCount * numSupAggregates);
+        std::copy(request->statsFloat32, request->statsFloat32 + lastSampleCount, statsFloat32);
+
+        auto stat = statsFloat32 + lastSampleCount;
+        for (size_t idx = 0; idx < counterCount; ++idx)
+        {
+            if (sendMask != nullptr && sendMask[idx] == 0)
+                continue;
+
+            auto &descriptor = catalog[aggregates.counterIds[idx]];
+            auto values = aggregates.GetValues(idx);
+            auto quality = static_cast<char> (aggregates.qualities[idx]);
+
+            for (uint32_t aggIndex = 0; aggIndex < numSupAggregates; ++aggIndex)
+            {
+                stat->statName = const_cast<wchar_t *> (descriptor.aggregateStatNames[aggIndex].c_str());
+                stat->statValue = values[aggIndex];
+                stat->quality = quality;
+                ++stat;
+            }
+        }
+
+        request->statsFloat32 = statsFloat32;
+        request->statsFloat32Count = static_cast<unsigned int> (stat - statsFloat32);
+    }
+
+    /// <summary>
+    /// Appends the metrics of the client about itself to the stats of a sample in a request
+    /// (either <see cref="SendStatsSampleRequest"/> or <see cref="StatsSample"/>), among
+    /// those whose value type is float 32 bits.
+    /// </summary>
+    /// <param name="metrics">The metrics, indexed by <see cref="SelfMetricCode"/>.</param>
+    /// <param name="request">The sample in the payload of the request, already set.</param>
+    /// <param name="heap">The heap.</param>
+    template <typename RequestType>
+    static void AppendSelfMetrics(const std::array<ValueWithQuality<float>, numSelfMetrics> &metrics,
+                                  RequestType *request,
+                                  wws::WSHeap &heap)
+    {
+        auto lastCount = request->statsFloat32Count;
+        auto statsFloat32 = heap.Alloc<listOfStatsFloat32_entry>(lastCount + numSelfMetrics);
+        std::copy(request->statsFloat32, request->statsFloat32 + lastCount, statsFloat32);
+
+        for (uint32_t idx = 0; idx < numSelfMetrics; ++idx)
+        {
+            auto &stat = statsFloat32[lastCount + idx];
+            stat.statName = const_cast<wchar_t *> (ToStatName(static_cast<SelfMetricCode> (idx)));
+            stat.statValue = metrics[idx].value;
+            stat.quality = static_cast<char> (metrics[idx].quality);
+        }
+
+        request->statsFloat32 = statsFloat32;
+        request->statsFloat32Count = lastCount + numSelfMetrics;
+    }
+
+    /// <summary>
+    /// Sets a sample in a request (either <see cref="SendStatsSampleRequest"/> or
+    /// <see cref="StatsSample"/>) with the stats collected in a cycle: the last sample
+    /// with the mask applied, then its aggregates and the metrics of the client (if any).
     /// </summary>
-    /// <param name="sample">The sample.</param>
+    /// <param name="catalog">The catalog of performance counters.</param>
+    /// <param name="item">The stats collected in the cycle.</param>
+    /// <param name="request">The sample in the payload of the request.</param>
+    /// <param name="heap">The heap.</param>
+    template <typename RequestType>
+    static void SetCollectedStats(const std::vector<PerfCounterDescriptor> &catalog,
+                                  const CollectedStats &item,
+                                  RequestType *request,
+                                  wws::WSHeap &heap)
+    {
+        SetStatsData(catalog, item.sample, 0, item.GetSendMask(), request, heap);
+
+        if (item.HasAggregates())
+            AppendAggregates(catalog, item.aggregates, item.GetSendMask(), request, heap);
+
+        if (item.hasSelfMetrics)
+            AppendSelfMetrics(item.selfMetrics, request, heap);
+    }
+
+    /// <summary>
+    /// Creates the request from a sample in a batch.
+    /// </summary>
+    /// <param name="catalog">The catalog of performance counters.</param>
+    /// <param name="batch">The batch of samples.</param>
+    /// <param name="row">The row of the sample in the batch.</param>
+    /// <param name="sendMask">One flag per column telling whether to send the value,
+    /// or null to send all of them.</param>
     /// <param name="heap">The heap.</param>
     /// <returns></returns>
-    SendStatsSampleRequest *CreateRequestFrom(const PerfCountersValues &sample, wws::WSHeap &heap)
+    SendStatsSampleRequest *CreateRequestFrom(const std::vector<PerfCounterDescriptor> &catalog,
+                                              const SamplesBatch &batch,
+                                              size_t row,
+                                              const uint8_t *sendMask,
+                                              wws::WSHeap &heap)
     {
+        _ASSERTE(row < batch.GetSampleCount());
+
         CALL_STACK_TRACE;
 
         try
         {
-            using namespace std::chrono;
+            auto request = heap.Alloc<SendStatsSampleRequest>();
+            request->machine = const_cast<wchar_t *> (GetLocalHostName());
+            SetStatsData(catalog, batch, row, sendMask, request, heap);
+            return request;
+        }
+        catch (IAppException &)
+        {
+            throw; // just forward already prepared application exceptions
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when creating payload of service request: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
 
-            static const auto epoch = system_clock().from_time_t(0);
+    /// <summary>
+    /// Creates a request carrying all samples in a batch at once.
+    /// </summary>
+    /// <param name="catalog">The catalog of performance counters.</param>
+    /// <param name="batch">The batch of samples, which cannot be empty.</param>
+    /// <param name="heap">The heap.</param>
+    /// <returns></returns>
+    SendStatsSamplesRequest *CreateRequestFrom(const std::vector<PerfCounterDescriptor> &catalog,
+                                               const SamplesBatch &batch,
+                                               wws::WSHeap &heap)
+    {
+        _ASSERTE(batch.GetSampleCount() > 0);
 
-            auto request = heap.Alloc<SendStatsSampleRequest>();
+        CALL_STACK_TRACE;
 
-            request->time = duration_cast<milliseconds>(sample.time - epoch).count();
+        try
+        {
+            auto request = heap.Alloc<SendStatsSamplesRequest>();
             request->machine = const_cast<wchar_t *> (GetLocalHostName());
+            request->samplesCount = static_cast<unsigned int> (batch.GetSampleCount());
+            request->samples = heap.Alloc<StatsSample>(request->samplesCount);
 
-            // Stats whose value type is float 32 bits:
+            for (uint32_t row = 0; row < request->samplesCount; ++row)
+                SetStatsData(catalog, batch, row, nullptr, &request->samples[row], heap);
 
-            request->statsFloat32Count = 4;
-            request->statsFloat32 = heap.Alloc<listOfStatsFloat32_entry>(request->statsFloat32Count);
-
-            short idx(0);
-            request->statsFloat32[idx].statName = const_cast<wchar_t *> (ToStatName(PerfCounterCode::CpuUsage));
-            request->statsFloat32[idx].statValue = sample.cpuTotalUsage.value;
-            request->statsFloat32[idx].quality = static_cast<char> (sample.cpuTotalUsage.quality);
-            ++idx;
+            return request;
+        }
+        catch (IAppException &)
+        {
+            throw; // just forward already prepared application exceptions
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when creating payload of service request: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
 
-            request->statsFloat32[idx].statName = const_cast<wchar_t *> (ToStatName(PerfCounterCode::DiskRead));
-            request->statsFloat32[idx].statValue = sample.diskReadBytesPerSec.value;
-            request->statsFloat32[idx].quality = static_cast<char> (sample.diskReadBytesPerSec.quality);
-            ++idx;
+    /// <summary>
+    /// Creates the request from the last sample in a send cycle, plus
+    /// the aggregates of all samples taken during that cycle.
+    /// </summary>
+    /// <param name="catalog">The catalog of performance counters.</param>
+    /// <param name="batch">The batch of samples.</param>
+    /// <param name="row">The row of the last sample in the batch, sent under the plain stat names.</param>
+    /// <param name="aggregates">The aggregates, sent as extra stats of type float 32 bits.</param>
+    /// <param name="sendMask">One flag per column telling whether to send the value and its
+    /// aggregates, or null to send all of them. The aggregates must have the same columns.</param>
+    /// <param name="heap">The heap.</param>
+    /// <returns></returns>
+    SendStatsSampleRequest *CreateRequestFrom(const std::vector<PerfCounterDescriptor> &catalog,
+                                              const SamplesBatch &batch,
+                                              size_t row,
+                                              const SamplesAggregates &aggregates,
+                                              const uint8_t *sendMask,
+                                              wws::WSHeap &heap)
+    {
+        _ASSERTE(sendMask == nullptr || aggregates.counterIds == batch.counterIds);
 
-            request->statsFloat32[idx].statName = const_cast<wchar_t *> (ToStatName(PerfCounterCode::DiskWrite));
-            request->statsFloat32[idx].statValue = sample.diskWriteBytesPerSec.value;
-            request->statsFloat32[idx].quality = static_cast<char> (sample.diskWriteBytesPerSec.quality);
-            ++idx;
+        CALL_STACK_TRACE;
 
-            request->statsFloat32[idx].statName = const_cast<wchar_t *> (ToStatName(PerfCounterCode::MemAvailable));
-            request->statsFloat32[idx].statValue = sample.memAvailableMBytes.value;
-            request->statsFloat32[idx].quality = static_cast<char> (sample.memAvailableMBytes.quality);
-            ++idx;
+        try
+        {
+            auto request = CreateRequestFrom(catalog, batch, row, sendMask, heap);
+            AppendAggregates(catalog, aggregates, sendMask, request, heap);
+            return request;
+        }
+        catch (IAppException &)
+        {
+            throw; // just forward already prepared application exceptions
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when creating payload of service request: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
 
-            _ASSERTE(idx == request->statsFloat32Count);
+    /// <summary>
+    /// Creates the request from the stats collected in a cycle, with its
+    /// aggregates and the metrics of the client (if any) and its mask applied.
+    /// </summary>
+    /// <param name="catalog">The catalog of performance counters.</param>
+    /// <param name="item">The stats collected in the cycle.</param>
+    /// <param name="heap">The heap.</param>
+    /// <returns></returns>
+    SendStatsSampleRequest *CreateRequestFrom(const std::vector<PerfCounterDescriptor> &catalog,
+                                              const CollectedStats &item,
+                                              wws::WSHeap &heap)
+    {
+        CALL_STACK_TRACE;
 
-            // Stats whose value type is integer 32 bits:
+        try
+        {
+            auto request = heap.Alloc<SendStatsSampleRequest>();
+            request->machine = const_cast<wchar_t *> (GetLocalHostName());
+            SetCollectedStats(catalog, item, request, heap);
+            return request;
+        }
+        catch (IAppException &)
+        {
+            throw; // just forward already prepared application exceptions
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when creating payload of service request: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
 
-            request->statsInt32Count = 2;
-            request->statsInt32 = heap.Alloc<listOfStatsInt32_entry>(request->statsInt32Count);
+    /// <summary>
+    /// Creates a request carrying the stats collected in several cycles at once, each one
+    /// as a sample, with its aggregates and the metrics of the client (if any) and its mask applied.
+    /// </summary>
+    /// <param name="catalog">The catalog of performance counters.</param>
+    /// <param name="items">The stats collected in each cycle, which cannot be none.</param>
+    /// <param name="heap">The heap.</param>
+    /// <returns></returns>
+    SendStatsSamplesRequest *CreateRequestFrom(const std::vector<PerfCounterDescriptor> &catalog,
+                                               const std::vector<const CollectedStats *> &items,
+                                               wws::WSHeap &heap)
+    {
+        _ASSERTE(!items.empty());
 
-            idx = 0;
-            request->statsInt32[idx].statName = const_cast<wchar_t *> (ToStatName(PerfCounterCode::ProcessCount));
-            request->statsInt32[idx].statValue = sample.processCount.value;
-            request->statsInt32[idx].quality = static_cast<char> (sample.processCount.quality);
-            ++idx;
+        CALL_STACK_TRACE;
 
-            request->statsInt32[idx].statName = const_cast<wchar_t *> (ToStatName(PerfCounterCode::ThreadCount));
-            request->statsInt32[idx].statValue = sample.threadCount.value;
-            request->statsInt32[idx].quality = static_cast<char> (sample.threadCount.quality);
-            ++idx;
+        try
+        {
+            auto request = heap.Alloc<SendStatsSamplesRequest>();
+            request->machine = const_cast<wchar_t *> (GetLocalHostName());
+            request->samplesCount = static_cast<unsigned int> (items.size());
+            request->samples = heap.Alloc<StatsSample>(request->samplesCount);
 
-            _ASSERTE(idx == request->statsInt32Count);
+            for (uint32_t idx = 0; idx < request->samplesCount; ++idx)
+                SetCollectedStats(catalog, *items[idx], &request->samples[idx], heap);
 
             return request;
         }
@@ -162,7 +494,14 @@ namespace application
     /// The amount in bytes of memory to reserve in the
     /// heap of each request issued by the proxy.
     /// </summary>
-    static constexpr ULONG proxyOperBaseHeapSize(512);
+    static constexpr ULONG proxyOperBaseHeapSize(2048);
+
+
+    /// <summary>
+    /// The amount in bytes of memory to reserve in the heap
+    /// of a request for each stat of each sample it carries.
+    /// </summary>
+    static constexpr ULONG proxyOperHeapSizePerStat(64);
 
 
     /// <summary>
@@ -176,7 +515,7 @@ namespace application
             config,
             &wws::CreateWSProxy<WS_HTTP_BINDING_TEMPLATE, MacStatsCollectionBinding_CreateServiceProxy>
         ),
-        m_heap(512)
+        m_heap(proxyOperBaseHeapSize)
     {
     }
     catch (IAppException &ex)
@@ -194,15 +533,24 @@ namespace application
     /// Sends "machine stats" to the server.
     /// </summary>
     /// <param name="authKey">The authentication key.</param>
-    /// <param name="sample">The sample of "machine stats" data.</param>
+    /// <param name="catalog">The catalog of performance counters.</param>
+    /// <param name="batch">The batch of samples of "machine stats" data.</param>
+    /// <param name="row">The row of the sample to send.</param>
+    /// <param name="sendMask">One flag per column telling whether to send the value,
+    /// or null to send all of them.</param>
     /// <returns>
     /// Whether processing of the sample was available in the server.
     /// </returns>
-    bool MacStatsCollectionClient::SendStatsSample(const wchar_t *authKey, const PerfCountersValues &sample)
+    bool MacStatsCollectionClient::SendStatsSample(const wchar_t *authKey,
+                                                   const std::vector<PerfCounterDescriptor> &catalog,
+                                                   const SamplesBatch &batch,
+                                                   size_t row,
+                                                   const uint8_t *sendMask)
     {
         CALL_STACK_TRACE;
 
-        m_heap.Reset(); // reset the heap to make room for this request
+        // the heap of the proxy might be too small for many counters, so use one sized for them:
+        wws::WSHeap heap(proxyOperBaseHeapSize + proxyOperHeapSizePerStat * static_cast<ULONG> (batch.GetCounterCount()));
 
         HRESULT hr;
         BOOL result;
@@ -211,15 +559,185 @@ namespace application
         hr = MacStatsCollectionBinding_SendStatsSample(
             GetHandle(),
             const_cast<wchar_t *> (authKey),
-            CreateRequestFrom(sample, m_heap),
+            CreateRequestFrom(catalog, batch, row, sendMask, heap),
             &result,
-            m_heap.GetHandle(),
+            heap.GetHandle(),
             nullptr, 0,
             nullptr,
             err.GetHandle()
         );
 
-        err.RaiseExClientNotOK(hr, "Machine stats collection service returned an error", m_heap);
+        err.RaiseExClientNotOK(hr, "Machine stats collection service returned an error", heap);
+
+        return static_cast<bool> (result);
+    }
+
+    /// <summary>
+    /// Sends "machine stats" to the server, along with
+    /// the aggregates of the samples taken in a send cycle.
+    /// </summary>
+    /// <param name="authKey">The authentication key.</param>
+    /// <param name="catalog">The catalog of performance counters.</param>
+    /// <param name="batch">The batch of samples of "machine stats" data.</param>
+    /// <param name="row">The row of the last sample in the send cycle.</param>
+    /// <param name="aggregates">The aggregates of all samples in the send cycle.</param>
+    /// <param name="sendMask">One flag per column telling whether to send the value and
+    /// its aggregates, or null to send all of them.</param>
+    /// <returns>
+    /// Whether processing of the sample was available in the server.
+    /// </returns>
+    bool MacStatsCollectionClient::SendStatsSample(const wchar_t *authKey,
+                                                   const std::vector<PerfCounterDescriptor> &catalog,
+                                                   const SamplesBatch &batch,
+                                                   size_t row,
+                                                   const SamplesAggregates &aggregates,
+                                                   const uint8_t *sendMask)
+    {
+        CALL_STACK_TRACE;
+
+        auto statCount = batch.GetCounterCount() + aggregates.counterIds.size() * numSupAggregates;
+
+        // the heap of the proxy might be too small for many counters, so use one sized for them:
+        wws::WSHeap heap(proxyOperBaseHeapSize + proxyOperHeapSizePerStat * static_cast<ULONG> (statCount));
+
+        HRESULT hr;
+        BOOL result;
+        wws::WSError err;
+
+        hr = MacStatsCollectionBinding_SendStatsSample(
+            GetHandle(),
+            const_cast<wchar_t *> (authKey),
+            CreateRequestFrom(catalog, batch, row, aggregates, sendMask, heap),
+            &result,
+            heap.GetHandle(),
+            nullptr, 0,
+            nullptr,
+            err.GetHandle()
+        );
+
+        err.RaiseExClientNotOK(hr, "Machine stats collection service returned an error", heap);
+
+        return static_cast<bool> (result);
+    }
+
+    /// <summary>
+    /// Sends all samples of "machine stats" in a batch to the server in a single request.
+    /// </summary>
+    /// <param name="authKey">The authentication key.</param>
+    /// <param name="catalog">The catalog of performance counters.</param>
+    /// <param name="batch">The batch of samples of "machine stats" data, which cannot be empty.</param>
+    /// <returns>
+    /// Whether processing of the samples was available in the server.
+    /// </returns>
+    bool MacStatsCollectionClient::SendStatsSamples(const wchar_t *authKey,
+                                                    const std::vector<PerfCounterDescriptor> &catalog,
+                                                    const SamplesBatch &batch)
+    {
+        CALL_STACK_TRACE;
+
+        auto statCount = batch.GetCounterCount() * batch.GetSampleCount();
+
+        // the heap of the proxy is too small for a batch, so use one sized for it:
+        wws::WSHeap heap(proxyOperBaseHeapSize + proxyOperHeapSizePerStat * static_cast<ULONG> (statCount));
+
+        HRESULT hr;
+        BOOL result;
+        wws::WSError err;
+
+        hr = MacStatsCollectionBinding_SendStatsSamples(
+            GetHandle(),
+            const_cast<wchar_t *> (authKey),
+            CreateRequestFrom(catalog, batch, heap),
+            &result,
+            heap.GetHandle(),
+            nullptr, 0,
+            nullptr,
+            err.GetHandle()
+        );
+
+        err.RaiseExClientNotOK(hr, "Machine stats collection service returned an error", heap);
+
+        return static_cast<bool> (result);
+    }
+
+    /// <summary>
+    /// Sends the stats collected in a cycle to the server.
+    /// </summary>
+    /// <param name="authKey">The authentication key.</param>
+    /// <param name="catalog">The catalog of performance counters.</param>
+    /// <param name="item">The stats collected in the cycle.</param>
+    /// <returns>
+    /// Whether processing of the sample was available in the server.
+    /// </returns>
+    bool MacStatsCollectionClient::SendStatsSample(const wchar_t *authKey,
+                                                   const std::vector<PerfCounterDescriptor> &catalog,
+                                                   const CollectedStats &item)
+    {
+        CALL_STACK_TRACE;
+
+        auto statCount = item.sample.GetCounterCount() + item.aggregates.counterIds.size() * numSupAggregates + numSelfMetrics;
+
+        // the heap of the proxy might be too small for many counters, so use one sized for them:
+        wws::WSHeap heap(proxyOperBaseHeapSize + proxyOperHeapSizePerStat * static_cast<ULONG> (statCount));
+
+        HRESULT hr;
+        BOOL result;
+        wws::WSError err;
+
+        hr = MacStatsCollectionBinding_SendStatsSample(
+            GetHandle(),
+            const_cast<wchar_t *> (authKey),
+            CreateRequestFrom(catalog, item, heap),
+            &result,
+            heap.GetHandle(),
+            nullptr, 0,
+            nullptr,
+            err.GetHandle()
+        );
+
+        err.RaiseExClientNotOK(hr, "Machine stats collection service returned an error", heap);
+
+        return static_cast<bool> (result);
+    }
+
+    /// <summary>
+    /// Sends the stats collected in several cycles to the server in a single request.
+    /// </summary>
+    /// <param name="authKey">The authentication key.</param>
+    /// <param name="catalog">The catalog of performance counters.</param>
+    /// <param name="items">The stats collected in each cycle, which cannot be none.</param>
+    /// <returns>
+    /// Whether processing of the samples was available in the server.
+    /// </returns>
+    bool MacStatsCollectionClient::SendStatsSamples(const wchar_t *authKey,
+                                                    const std::vector<PerfCounterDescriptor> &catalog,
+                                                    const std::vector<const CollectedStats *> &items)
+    {
+        CALL_STACK_TRACE;
+
+        size_t statCount(0);
+        for (auto item : items)
+            statCount += item->sample.GetCounterCount() + item->aggregates.counterIds.size() * numSupAggregates + numSelfMetrics;
+
+        // the heap of the proxy is too small for many samples, so use one sized for them:
+        wws::WSHeap heap(proxyOperBaseHeapSize + proxyOperHeapSizePerStat * static_cast<ULONG> (statCount));
+
+        HRESULT hr;
+        BOOL result;
+        wws::WSError err;
+
+        hr = MacStatsCollectionBinding_SendStatsSamples(
+            GetHandle(),
+            const_cast<wchar_t *> (authKey),
+            CreateRequestFrom(catalog, items, heap),
+            &result,
+            heap.GetHandle(),
+            nullptr, 0,
+            nullptr,
+            err.GetHandle()
+        );
+
+        err.RaiseExClientNotOK(hr, "Machine stats collection service returned an error", heap);
 
         return static_cast<bool> (result);
     }
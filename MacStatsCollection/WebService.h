@@ -19,9 +19,34 @@ namespace application
     // HTTP Transport
     /////////////////////
 
-    std::unique_ptr<StatsPackage> ExtractStatsDataFrom(const SendStatsSampleRequest &request);
+    void ExtractStatsDataFrom(const SendStatsSampleRequest &request, std::vector<StatsPackage> &packages);
 
-    SendStatsSampleRequest *CreateRequestFrom(const PerfCountersValues &sample, wws::WSHeap &heap);
+    void ExtractStatsDataFrom(const SendStatsSamplesRequest &request, std::vector<StatsPackage> &packages);
+
+    SendStatsSampleRequest *CreateRequestFrom(const std::vector<PerfCounterDescriptor> &catalog,
+                                              const SamplesBatch &batch,
+                                              size_t row,
+                                              const uint8_t *sendMask,
+                                              wws::WSHeap &heap);
+
+    SendStatsSamplesRequest *CreateRequestFrom(const std::vector<PerfCounterDescriptor> &catalog,
+                                               const SamplesBatch &batch,
+                                               wws::WSHeap &heap);
+
+    SendStatsSampleRequest *CreateRequestFrom(const std::vector<PerfCounterDescriptor> &catalog,
+                                              const SamplesBatch &batch,
+                                              size_t row,
+                                              const SamplesAggregates &aggregates,
+                                              const uint8_t *sendMask,
+                                              wws::WSHeap &heap);
+
+    SendStatsSampleRequest *CreateRequestFrom(const std::vector<PerfCounterDescriptor> &catalog,
+                                              const CollectedStats &item,
+                                              wws::WSHeap &heap);
+
+    SendStatsSamplesRequest *CreateRequestFrom(const std::vector<PerfCounterDescriptor> &catalog,
+                                               const std::vector<const CollectedStats *> &items,
+                                               wws::WSHeap &heap);
 
 
     ///////////////////
@@ -43,7 +68,30 @@ namespace application
 
         MacStatsCollectionClient(const wws::SvcProxyConfig &config);
 
-        bool SendStatsSample(const wchar_t *authKey, const PerfCountersValues &sample);
+        bool SendStatsSample(const wchar_t *authKey,
+                             const std::vector<PerfCounterDescriptor> &catalog,
+                             const SamplesBatch &batch,
+                             size_t row,
+                             const uint8_t *sendMask = nullptr);
+
+        bool SendStatsSample(const wchar_t *authKey,
+                             const std::vector<PerfCounterDescriptor> &catalog,
+                             const SamplesBatch &batch,
+                             size_t row,
+                             const SamplesAggregates &aggregates,
+                             const uint8_t *sendMask = nullptr);
+
+        bool SendStatsSamples(const wchar_t *authKey,
+                              const std::vector<PerfCounterDescriptor> &catalog,
+                              const SamplesBatch &batch);
+
+        bool SendStatsSample(const wchar_t *authKey,
+                             const std::vector<PerfCounterDescriptor> &catalog,
+                             const CollectedStats &item);
+
+        bool SendStatsSamples(const wchar_t *authKey,
+                              const std::vector<PerfCounterDescriptor> &catalog,
+                              const std::vector<const CollectedStats *> &items);
 
         bool CloseService();
     };
@@ -0,0 +1,734 @@
+#include "stdafx.h"
+#include "WriteAheadLog.h"
+#include <3FD\callstacktracer.h>
+#include <3FD\exceptions.h>
+#include <3FD\logger.h>
+#include <3FD\configuration.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+namespace application
+{
+    using namespace _3fd;
+    using namespace _3fd::core;
+
+
+    std::mutex WriteAheadLog::singletonCreationMutex;
+
+    std::unique_ptr<WriteAheadLog> WriteAheadLog::singleton;
+
+
+    // Starts every segment file ("MSCW"), followed by the version of the format
+    static const uint32_t segmentMagic(0x5743534D);
+
+    static const uint32_t segmentVersion(1);
+
+    static const size_t segmentHeaderSize(8);
+
+    // Every record starts with the size of its content, followed by the checksum of the content
+    static const size_t recordHeaderSize(8);
+
+
+    /// <summary>
+    /// Throws an exception for a failed call of Win32 API.
+    /// </summary>
+    /// <param name="message">The main message.</param>
+    /// <param name="funcName">Name of the Win32 API function.</param>
+    static void ThrowWin32Error(const char *message, const char *funcName)
+    {
+        std::ostringstream oss;
+        oss << message << " - ";
+        WWAPI::AppendDWordErrorMessage(GetLastError(), funcName, oss);
+        throw AppException<std::runtime_error>(oss.str());
+    }
+
+
+    /// <summary>
+    /// Provides access to the singleton.
+    /// </summary>
+    /// <returns>A reference to the singleton.</returns>
+    WriteAheadLog & WriteAheadLog::GetInstance()
+    {
+        if (singleton)
+            return *singleton;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            std::lock_guard<std::mutex> lock(singletonCreationMutex);
+
+            if (!singleton)
+            {
+                singleton.reset(
+                    new WriteAheadLog(AppConfig::GetSettings().application.GetString("srvWalDirectory", "wal"),
+                                      TasksQueue::GetInstance())
+                );
+            }
+
+            return *singleton;
+        }
+        catch (IAppException &)
+        {
+            throw; // just forward already prepared application exceptions
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when instantiating write-ahead log: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    /// <summary>
+    /// Finalizes the singleton, which must take place after
+    /// no other thread can use the log anymore.
+    /// </summary>
+    void WriteAheadLog::Finalize()
+    {
+        singleton.reset(nullptr);
+    }
+
+
+    /// <summary>
+    /// Initializes a new instance of the <see cref="WriteAheadLog"/> class.
+    /// The segments left in the directory by a previous execution are kept for replay.
+    /// </summary>
+    /// <param name="directory">The directory of the segment files.</param>
+    /// <param name="queue">The queue that receives the packages.</param>
+    WriteAheadLog::WriteAheadLog(const string &directory, TasksQueue &queue)
+        : m_directory(directory)
+        , m_queue(queue)
+        , m_fileHandle(INVALID_HANDLE_VALUE)
+        , m_segment(0)
+        , m_appendedCount(0)
+        , m_durableCount(0)
+        , m_segmentRecordCount(0)
+        , m_hasFailed(false)
+        , m_isClosing(false)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            if (CreateDirectoryA(m_directory.c_str(), nullptr) == FALSE
+                && GetLastError() != ERROR_ALREADY_EXISTS)
+            {
+                ThrowWin32Error("Failed to create directory for write-ahead log", "CreateDirectory");
+            }
+
+            // the segments left by a previous execution are numbered before the new ones:
+            WIN32_FIND_DATAA findData;
+            auto findHandle = FindFirstFileA((m_directory + "\\*.wal").c_str(), &findData);
+
+            if (findHandle != INVALID_HANDLE_VALUE)
+            {
+                do
+                {
+                    char *end;
+                    uint64_t segment = strtoull(findData.cFileName, &end, 10);
+                    if (strcmp(end, ".wal") == 0)
+                    {
+                        m_sealedSegments.push_back(segment);
+                        m_segment = (std::max)(m_segment, segment + 1);
+                    }
+                }
+                while (FindNextFileA(findHandle, &findData) != FALSE);
+
+                FindClose(findHandle);
+            }
+            else if (GetLastError() != ERROR_FILE_NOT_FOUND)
+                ThrowWin32Error("Failed to look for segments of write-ahead log", "FindFirstFile");
+
+            std::sort(m_sealedSegments.begin(), m_sealedSegments.end());
+
+            OpenSegment();
+
+            m_writingThread = std::thread(&WriteAheadLog::WriteLoop, this);
+        }
+        catch (IAppException &)
+        {
+            Close();
+            throw; // just forward already prepared application exceptions
+        }
+        catch (std::exception &ex)
+        {
+            Close();
+            std::ostringstream oss;
+            oss << "Generic failure when opening write-ahead log: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    /// <summary>
+    /// Finalizes an instance of the <see cref="WriteAheadLog"/> class.
+    /// </summary>
+    WriteAheadLog::~WriteAheadLog()
+    {
+        Close();
+    }
+
+
+    // Writes what is left, then stops the writing thread and closes the file
+    void WriteAheadLog::Close()
+    {
+        if (m_writingThread.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_appendMutex);
+                m_isClosing = true;
+            }
+
+            m_groupAvailable.notify_one();
+            m_writingThread.join();
+        }
+
+        if (m_fileHandle != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(m_fileHandle);
+            m_fileHandle = INVALID_HANDLE_VALUE;
+        }
+    }
+
+
+    // Gets the path of a segment file, whose name is its number
+    string WriteAheadLog::GetSegmentPath(uint64_t segment) const
+    {
+        std::ostringstream oss;
+        oss << m_directory << '\\' << std::setw(20) << std::setfill('0') << segment << ".wal";
+        return oss.str();
+    }
+
+
+    // Creates the file of the current segment, starting with its header
+    void WriteAheadLog::OpenSegment()
+    {
+        m_fileHandle = CreateFileA(GetSegmentPath(m_segment).c_str(),
+                                   GENERIC_WRITE,
+                                   FILE_SHARE_READ, nullptr,
+                                   CREATE_ALWAYS,
+                                   FILE_ATTRIBUTE_NORMAL,
+                                   nullptr);
+
+        if (m_fileHandle == INVALID_HANDLE_VALUE)
+            ThrowWin32Error("Failed to create segment of write-ahead log", "CreateFile");
+
+        uint32_t header[] = { segmentMagic, segmentVersion };
+        DWORD writtenCount;
+
+        if (WriteFile(m_fileHandle, header, sizeof header, &writtenCount, nullptr) == FALSE)
+            ThrowWin32Error("Failed to write header of write-ahead log", "WriteFile");
+
+        m_segmentRecordCount = 0;
+    }
+
+
+    /* Writes the group of records appended so far to the file, with a single flush to disk, then
+    wakes up the threads waiting for them. Must be called with the mutex for the file held, and takes
+    the mutex for appending (given locked), which is released while writing. */
+    bool WriteAheadLog::WriteGroup(std::unique_lock<std::mutex> &appendLock)
+    {
+        if (m_group.empty())
+            return true;
+
+        m_group.swap(m_writing);
+        auto upToCount = m_appendedCount;
+        appendLock.unlock();
+
+        bool isWritten(true);
+        size_t offset(0);
+
+        while (isWritten && offset < m_writing.size())
+        {
+            DWORD writtenCount;
+            auto chunkSize = static_cast<DWORD> ((std::min)(m_writing.size() - offset, static_cast<size_t> (1UL << 30)));
+            isWritten = (WriteFile(m_fileHandle, m_writing.data() + offset, chunkSize, &writtenCount, nullptr) != FALSE);
+            offset += writtenCount;
+        }
+
+        // the group is durable only once flushed to disk:
+        isWritten = isWritten && (FlushFileBuffers(m_fileHandle) != FALSE);
+
+        if (!isWritten)
+        {
+            auto errorCode = GetLastError();
+            std::ostringstream oss;
+            oss << "Failed to write to write-ahead log - ";
+            WWAPI::AppendDWordErrorMessage(errorCode, "WriteFile/FlushFileBuffers", oss);
+            Logger::Write(oss.str(), Logger::PRIO_CRITICAL);
+        }
+
+        m_writing.clear();
+
+        appendLock.lock();
+
+        if (isWritten)
+            m_durableCount = upToCount;
+        else
+            m_hasFailed = true;
+
+        m_groupDurable.notify_all();
+        return isWritten;
+    }
+
+
+    // Runs in the writing thread, until closed
+    void WriteAheadLog::WriteLoop()
+    {
+        CALL_STACK_TRACE;
+
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> appendLock(m_appendMutex);
+                m_groupAvailable.wait(appendLock, [this]() { return !m_group.empty() || m_isClosing; });
+
+                if (m_group.empty() || m_hasFailed)
+                    return;
+            }
+
+            // the records appended while the previous group was written make the next group:
+            std::lock_guard<std::mutex> fileLock(m_fileMutex);
+            std::unique_lock<std::mutex> appendLock(m_appendMutex);
+            WriteGroup(appendLock);
+        }
+    }
+
+
+    // Appends to a record a value in little-endian
+    template <typename ValType>
+    static void AppendValue(std::vector<uint8_t> &record, ValType value)
+    {
+        uint8_t bytes[sizeof value];
+        memcpy(bytes, &value, sizeof value);
+        record.insert(record.end(), bytes, bytes + sizeof value);
+    }
+
+    // Appends to a record a name in UTF-16, prefixed by its length
+    static void AppendName(std::vector<uint8_t> &record, InternedName name)
+    {
+        auto &str = name.GetName();
+        AppendValue(record, static_cast<uint16_t> (str.size()));
+
+        for (auto ch : str)
+            AppendValue(record, static_cast<uint16_t> (ch));
+    }
+
+    template <typename ValType>
+    static void AppendSamples(std::vector<uint8_t> &record, const std::vector<StatSampleValue<ValType>> &samples)
+    {
+        AppendValue(record, static_cast<uint32_t> (samples.size()));
+
+        for (auto &sample : samples)
+        {
+            AppendValue(record, sample.statId);
+
+            if (sample.statId == 0)
+                AppendName(record, sample.statName);
+
+            AppendValue(record, sample.value);
+            AppendValue(record, static_cast<uint8_t> (sample.quality));
+        }
+    }
+
+    // FNV-1a hash of the content of a record, which tells a record torn by a crash
+    static uint32_t Checksum(const uint8_t *data, size_t size)
+    {
+        uint32_t hash(2166136261U);
+
+        for (size_t idx = 0; idx < size; ++idx)
+        {
+            hash ^= data[idx];
+            hash *= 16777619U;
+        }
+
+        return hash;
+    }
+
+    // Encodes the packages in a record, whose names are in full, because the handles do not survive a restart
+    static void EncodeRecord(const std::vector<StatsPackage> &packages, std::vector<uint8_t> &record)
+    {
+        record.resize(recordHeaderSize);
+        AppendValue(record, static_cast<uint32_t> (packages.size()));
+
+        for (auto &package : packages)
+        {
+            AppendValue(record, package.timeSinceEpochInMillisecs);
+            AppendName(record, package.machine);
+            AppendSamples(record, package.statSamplesFloat32);
+            AppendSamples(record, package.statSamplesInt32);
+        }
+
+        auto contentSize = static_cast<uint32_t> (record.size() - recordHeaderSize);
+        auto checksum = Checksum(record.data() + recordHeaderSize, contentSize);
+        memcpy(record.data(), &contentSize, sizeof contentSize);
+        memcpy(record.data() + sizeof contentSize, &checksum, sizeof checksum);
+    }
+
+
+    /// <summary>
+    /// Puts packages in the queue of tasks and appends them to the log, at once.
+    /// </summary>
+    /// <param name="packages">The packages, which are moved into the queue, leaving the vector
+    /// empty but with its capacity, or left untouched when refused.</param>
+    /// <param name="waitForDurability">Whether to wait until the packages are flushed to disk.</param>
+    /// <returns>Whether the packages were taken, otherwise the queue is full.</returns>
+    bool WriteAheadLog::Enqueue(std::vector<StatsPackage> &&packages, bool waitForDurability)
+    {
+        if (packages.empty())
+            return true;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            // encoding takes place before the lock, in a buffer that every thread reuses:
+            static thread_local std::vector<uint8_t> record;
+            EncodeRecord(packages, record);
+
+            std::unique_lock<std::mutex> appendLock(m_appendMutex);
+
+            if (m_hasFailed)
+                throw AppException<std::runtime_error>("Write-ahead log cannot take packages after failing to write to disk");
+
+            /* The packages go to the queue while the mutex is held, so when the consumer
+            seals a segment, all the packages in there are already in the queue: */
+            if (!m_queue.Enqueue(std::move(packages)))
+                return false;
+
+            m_group.insert(m_group.end(), record.begin(), record.end());
+            auto sequence = ++m_appendedCount;
+            ++m_segmentRecordCount;
+
+            m_groupAvailable.notify_one();
+
+            if (waitForDurability)
+            {
+                m_groupDurable.wait(appendLock, [this, sequence]()
+                {
+                    return m_durableCount >= sequence || m_hasFailed;
+                });
+
+                if (m_durableCount < sequence)
+                    throw AppException<std::runtime_error>("Failed to write packages to write-ahead log");
+            }
+
+            return true;
+        }
+        catch (IAppException &)
+        {
+            throw; // just forward already prepared application exceptions
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when appending to write-ahead log: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    /// <summary>
+    /// Seals the current segment, when it has records, so it holds only packages
+    /// already in the queue. Must be called by the consumer, before dequeuing.
+    /// Once writing to disk has failed, the log takes no more packages, so this
+    /// throws, for the server to stop (the log is replayed upon restart).
+    /// </summary>
+    void WriteAheadLog::Rotate()
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            std::lock_guard<std::mutex> fileLock(m_fileMutex);
+            std::unique_lock<std::mutex> appendLock(m_appendMutex);
+
+            if (m_hasFailed)
+                throw AppException<std::runtime_error>("Write-ahead log has failed to write to disk, hence the server cannot take packages anymore");
+
+            if (m_segmentRecordCount == 0)
+                return;
+
+            // the group not yet written belongs to the segment being sealed:
+            while (!m_group.empty())
+            {
+                if (!WriteGroup(appendLock))
+                    throw AppException<std::runtime_error>("Failed to write to write-ahead log");
+            }
+
+            CloseHandle(m_fileHandle);
+            m_fileHandle = INVALID_HANDLE_VALUE;
+
+            m_sealedSegments.push_back(m_segment++);
+            OpenSegment();
+        }
+        catch (IAppException &)
+        {
+            throw; // just forward already prepared application exceptions
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when sealing segment of write-ahead log: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+
+    /// <summary>
+    /// Deletes the sealed segments, once their packages are committed to database.
+    /// Must be called by the consumer. A segment that cannot be deleted is tried again later.
+    /// </summary>
+    /// <param name="keptCount">How many of the segments sealed last are kept, because the
+    /// commit of their packages is still in flight.</param>
+    void WriteAheadLog::Truncate(size_t keptCount)
+    {
+        CALL_STACK_TRACE;
+
+        if (m_sealedSegments.size() <= keptCount)
+            return;
+
+        auto last = m_sealedSegments.end() - keptCount;
+
+        auto end = std::remove_if(m_sealedSegments.begin(), last, [this](uint64_t segment)
+        {
+            if (DeleteFileA(GetSegmentPath(segment).c_str()) != FALSE)
+                return true;
+
+            auto errorCode = GetLastError();
+            if (errorCode == ERROR_FILE_NOT_FOUND)
+                return true;
+
+            std::ostringstream oss;
+            oss << "Failed to delete segment of write-ahead log - ";
+            WWAPI::AppendDWordErrorMessage(errorCode, "DeleteFile", oss);
+            Logger::Write(oss.str(), Logger::PRIO_ERROR);
+            return false;
+        });
+
+        m_sealedSegments.erase(end, last);
+    }
+
+
+    // Reads a record, checking every field against the bounds of the data
+    class RecordReader
+    {
+    private:
+
+        const uint8_t *m_next;
+        const uint8_t *m_end;
+
+    public:
+
+        RecordReader(const uint8_t *data, size_t size)
+            : m_next(data), m_end(data + size) {}
+
+        template <typename ValType>
+        bool Read(ValType &value)
+        {
+            if (static_cast<size_t> (m_end - m_next) < sizeof value)
+                return false;
+
+            memcpy(&value, m_next, sizeof value);
+            m_next += sizeof value;
+            return true;
+        }
+
+        bool ReadName(InternedName &name)
+        {
+            uint16_t length;
+            if (!Read(length) || static_cast<size_t> (m_end - m_next) < length * sizeof(uint16_t))
+                return false;
+
+            std::wstring str(length, L'\0');
+            for (auto &ch : str)
+            {
+                uint16_t code;
+                Read(code);
+                ch = static_cast<wchar_t> (code);
+            }
+
+            name = str.empty() ? InternedName() : InternedName(str);
+            return true;
+        }
+
+        template <typename ValType>
+        bool ReadSamples(std::vector<StatSampleValue<ValType>> &samples)
+        {
+            uint32_t count;
+            if (!Read(count) || count > static_cast<size_t> (m_end - m_next) / 7) // every sample takes 7 bytes at least
+                return false;
+
+            samples.reserve(count);
+
+            for (uint32_t idx = 0; idx < count; ++idx)
+            {
+                int16_t statId;
+                InternedName statName;
+                ValType value;
+                uint8_t quality;
+
+                if (!Read(statId)
+                    || (statId == 0 && !ReadName(statName))
+                    || !Read(value)
+                    || !Read(quality))
+                {
+                    return false;
+                }
+
+                if (statId == 0)
+                    samples.emplace_back(statName, value, static_cast<Quality> (quality));
+                else
+                    samples.emplace_back(statId, value, static_cast<Quality> (quality));
+            }
+
+            return true;
+        }
+
+        bool IsAtEnd() const { return m_next == m_end; }
+    };
+
+
+    // Decodes the packages in the content of a record
+    static bool DecodeRecord(const uint8_t *data, size_t size, std::vector<StatsPackage> &packages)
+    {
+        RecordReader reader(data, size);
+
+        uint32_t count;
+        if (!reader.Read(count))
+            return false;
+
+        auto initialCount = packages.size();
+
+        for (uint32_t idx = 0; idx < count; ++idx)
+        {
+            StatsPackage package;
+
+            if (!reader.Read(package.timeSinceEpochInMillisecs)
+                || !reader.ReadName(package.machine)
+                || !reader.ReadSamples(package.statSamplesFloat32)
+                || !reader.ReadSamples(package.statSamplesInt32))
+            {
+                packages.erase(packages.begin() + initialCount, packages.end());
+                return false;
+            }
+
+            packages.push_back(std::move(package));
+        }
+
+        return reader.IsAtEnd();
+    }
+
+
+    /// <summary>
+    /// Reads the packages in the segments left by a previous execution, so they can be written
+    /// to database before taking requests (then the segments are deleted by <see cref="Truncate"/>).
+    /// A segment is read up to the first record that is not whole, because writing was cut short.
+    /// </summary>
+    /// <param name="packages">Where to append the packages.</param>
+    void WriteAheadLog::Replay(std::vector<StatsPackage> &packages)
+    {
+        CALL_STACK_TRACE;
+
+        try
+        {
+            std::vector<uint8_t> content;
+
+            for (auto segment : m_sealedSegments)
+            {
+                auto path = GetSegmentPath(segment);
+
+                auto fileHandle = CreateFileA(path.c_str(),
+                                              GENERIC_READ,
+                                              FILE_SHARE_READ, nullptr,
+                                              OPEN_EXISTING,
+                                              FILE_ATTRIBUTE_NORMAL,
+                                              nullptr);
+
+                if (fileHandle == INVALID_HANDLE_VALUE)
+                    ThrowWin32Error("Failed to open segment of write-ahead log", "CreateFile");
+
+                LARGE_INTEGER fileSize;
+                DWORD readCount(0);
+                bool isRead = (GetFileSizeEx(fileHandle, &fileSize) != FALSE);
+
+                if (isRead)
+                {
+                    content.resize(static_cast<size_t> (fileSize.QuadPart));
+                    isRead = content.empty()
+                        || ReadFile(fileHandle, content.data(), static_cast<DWORD> (content.size()), &readCount, nullptr) != FALSE;
+                }
+
+                if (!isRead)
+                {
+                    auto errorCode = GetLastError();
+                    std::ostringstream oss;
+                    oss << "Failed to read segment of write-ahead log - ";
+                    WWAPI::AppendDWordErrorMessage(errorCode, "ReadFile", oss);
+                    CloseHandle(fileHandle);
+                    throw AppException<std::runtime_error>(oss.str(), path);
+                }
+
+                CloseHandle(fileHandle);
+                content.resize(readCount);
+
+                uint32_t header[2];
+                if (content.size() < segmentHeaderSize)
+                    continue; // cut short before the first record
+
+                memcpy(header, content.data(), sizeof header);
+                if (header[0] != segmentMagic || header[1] != segmentVersion)
+                    throw AppException<std::runtime_error>("Segment of write-ahead log has unexpected format", path);
+
+                size_t offset(segmentHeaderSize);
+                size_t replayedCount(0);
+
+                while (content.size() - offset >= recordHeaderSize)
+                {
+                    uint32_t contentSize, checksum;
+                    memcpy(&contentSize, content.data() + offset, sizeof contentSize);
+                    memcpy(&checksum, content.data() + offset + sizeof contentSize, sizeof checksum);
+
+                    auto record = content.data() + offset + recordHeaderSize;
+
+                    if (content.size() - offset - recordHeaderSize < contentSize
+                        || Checksum(record, contentSize) != checksum
+                        || !DecodeRecord(record, contentSize, packages))
+                    {
+                        break;
+                    }
+
+                    offset += recordHeaderSize + contentSize;
+                    ++replayedCount;
+                }
+
+                std::ostringstream oss;
+                oss << "Write-ahead log replayed " << replayedCount << " record(s) from a previous execution";
+
+                if (offset < content.size())
+                {
+                    oss << ", ignoring " << (content.size() - offset) << " byte(s) cut short";
+                    Logger::Write(oss.str(), path, Logger::PRIO_WARNING);
+                }
+                else
+                    Logger::Write(oss.str(), path, Logger::PRIO_NOTICE);
+            }
+        }
+        catch (IAppException &)
+        {
+            throw; // just forward already prepared application exceptions
+        }
+        catch (std::exception &ex)
+        {
+            std::ostringstream oss;
+            oss << "Generic failure when replaying write-ahead log: " << ex.what();
+            throw AppException<std::runtime_error>(oss.str());
+        }
+    }
+
+}// end of namespace application
@@ -0,0 +1,92 @@
+#ifndef __WriteAheadLog_h__ // header guard
+#define __WriteAheadLog_h__
+
+#include "CommonDataExchange.h"
+#include "TasksQueue.h"
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <Windows.h>
+
+namespace application
+{
+    /// <summary>
+    /// A write-ahead log of the packages accepted by the server but not yet written to database,
+    /// so they survive a crash. The log is binary and append-only, split in segment files numbered
+    /// in sequence. The threads serving the requests put the packages in the queue of tasks through
+    /// the log, with group commit: the records are gathered in memory, while a dedicated thread
+    /// writes each group to the file with a single flush to disk, then wakes up the threads waiting
+    /// for their records to be durable. Before the consumer dequeues, it seals the current segment,
+    /// which then holds only packages already in the queue, and deletes it once those are committed
+    /// to database. The segments left by a previous execution are replayed upon startup.
+    /// </summary>
+    /// <seealso cref="notcopiable" />
+    class WriteAheadLog
+    {
+    private:
+
+        string m_directory;
+        TasksQueue &m_queue;
+
+        HANDLE m_fileHandle; // of the current segment
+        uint64_t m_segment;
+        std::vector<uint64_t> m_sealedSegments; // used by the consumer only
+
+        // taken before the mutex for appending, while writing to the file:
+        std::mutex m_fileMutex;
+
+        std::mutex m_appendMutex;
+        std::condition_variable m_groupAvailable;
+        std::condition_variable m_groupDurable;
+        std::vector<uint8_t> m_group; // records appended since the last write
+        std::vector<uint8_t> m_writing; // the group being written
+        uint64_t m_appendedCount;
+        uint64_t m_durableCount;
+        uint64_t m_segmentRecordCount;
+        bool m_hasFailed;
+        bool m_isClosing;
+
+        std::thread m_writingThread;
+
+        static std::mutex singletonCreationMutex;
+
+        static std::unique_ptr<WriteAheadLog> singleton;
+
+        string GetSegmentPath(uint64_t segment) const;
+
+        void OpenSegment();
+
+        bool WriteGroup(std::unique_lock<std::mutex> &appendLock);
+
+        void WriteLoop();
+
+        void Close();
+
+    public:
+
+        WriteAheadLog(const string &directory, TasksQueue &queue);
+
+        WriteAheadLog(const WriteAheadLog &) = delete;
+
+        ~WriteAheadLog();
+
+        static WriteAheadLog &GetInstance();
+
+        static void Finalize();
+
+        bool Enqueue(std::vector<StatsPackage> &&packages, bool waitForDurability);
+
+        void Rotate();
+
+        void Truncate(size_t keptCount = 0);
+
+        void Replay(std::vector<StatsPackage> &packages);
+    };
+
+}// end of namespace application
+
+#endif // end of header guard
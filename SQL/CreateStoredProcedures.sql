@@ -22,6 +22,7 @@ begin
 
 	declare @timeSinceEpochInMillisecs bigint;
 	declare @macName nvarchar(50);
+	declare @stagStatId smallint;
 	declare @statName nvarchar(50);
 	declare @statValue float(24);
 	declare @quality tinyint;
@@ -29,6 +30,7 @@ begin
 	declare stagingCursor cursor for (
 		select instant
               ,macName
+			  ,statId
 			  ,statName
 			  ,statVal
 			  ,quality
@@ -40,6 +42,7 @@ begin
 	fetch next from stagingCursor
 		into @timeSinceEpochInMillisecs
 			,@macName
+			,@stagStatId
 			,@statName
 			,@statValue
 			,@quality;
@@ -53,40 +56,72 @@ begin
 
 		if @macId is null
 		begin
-			insert into Machine (macName) values (@macName);
+			begin try
+				insert into Machine (macName) values (@macName);
+			end try
+			begin catch
+				-- unless another writer has just inserted the same name (unique index):
+				if error_number() not in (2601, 2627)
+					throw;
+			end catch;
+
 			set @macId = (select macId from Machine where macName = @macName);
 		end;
 
-		-- ensure consistency regarding statistic:
+		/* ensure consistency regarding statistic, unless it came identified by ID (which
+		   the server assigned upon a session opened by the client, so it is already there): */
 
 		declare @statId smallint;
-		set @statId = (select statId from Statistic where statName = @statName);
-	
-		if @statId is null
+		set @statId = @stagStatId;
+
+		if @statId = 0
 		begin
-			insert into Statistic (statName) values (@statName);
 			set @statId = (select statId from Statistic where statName = @statName);
+	
+			if @statId is null
+			begin
+				begin try
+					insert into Statistic (statName) values (@statName);
+				end try
+				begin catch
+					-- unless another writer has just inserted the same name (unique index):
+					if error_number() not in (2601, 2627)
+						throw;
+				end catch;
+
+				set @statId = (select statId from Statistic where statName = @statName);
+			end;
 		end;
 
-		-- finally insert data:
-		insert into StatsValFloat32 (
-			macId,
-			statId,
-			instant,
-			statVal,
-			quality
+		/* finally insert data, unless already there (the same sample might come twice,
+		   when the client replays a request that timed out, or uploads a burst): */
+		if not exists (
+			select 1 from StatsValFloat32
+				where macId = @macId
+				  and statId = @statId
+				  and instant = @timeSinceEpochInMillisecs
 		)
-		values (
-			@macId,
-			@statId,
-			@timeSinceEpochInMillisecs,
-			@statValue,
-			@quality
-		);
+		begin
+			insert into StatsValFloat32 (
+				macId,
+				statId,
+				instant,
+				statVal,
+				quality
+			)
+			values (
+				@macId,
+				@statId,
+				@timeSinceEpochInMillisecs,
+				@statValue,
+				@quality
+			);
+		end;
 
 		fetch next from stagingCursor
 		into @timeSinceEpochInMillisecs
 			,@macName
+			,@stagStatId
 			,@statName
 			,@statValue
 			,@quality;
@@ -113,6 +148,7 @@ begin
 
 	declare @timeSinceEpochInMillisecs bigint;
 	declare @macName nvarchar(50);
+	declare @stagStatId smallint;
 	declare @statName nvarchar(50);
 	declare @statValue int;
 	declare @quality tinyint;
@@ -120,6 +156,7 @@ begin
 	declare stagingCursor cursor for (
 		select instant
               ,macName
+			  ,statId
 			  ,statName
 			  ,statVal
 			  ,quality
@@ -131,6 +168,7 @@ begin
 	fetch next from stagingCursor
 		into @timeSinceEpochInMillisecs
 			,@macName
+			,@stagStatId
 			,@statName
 			,@statValue
 			,@quality;
@@ -144,40 +182,72 @@ begin
 
 		if @macId is null
 		begin
-			insert into Machine (macName) values (@macName);
+			begin try
+				insert into Machine (macName) values (@macName);
+			end try
+			begin catch
+				-- unless another writer has just inserted the same name (unique index):
+				if error_number() not in (2601, 2627)
+					throw;
+			end catch;
+
 			set @macId = (select macId from Machine where macName = @macName);
 		end;
 
-		-- ensure consistency regarding statistic:
+		/* ensure consistency regarding statistic, unless it came identified by ID (which
+		   the server assigned upon a session opened by the client, so it is already there): */
 
 		declare @statId smallint;
-		set @statId = (select statId from Statistic where statName = @statName);
-	
-		if @statId is null
+		set @statId = @stagStatId;
+
+		if @statId = 0
 		begin
-			insert into Statistic (statName) values (@statName);
 			set @statId = (select statId from Statistic where statName = @statName);
+	
+			if @statId is null
+			begin
+				begin try
+					insert into Statistic (statName) values (@statName);
+				end try
+				begin catch
+					-- unless another writer has just inserted the same name (unique index):
+					if error_number() not in (2601, 2627)
+						throw;
+				end catch;
+
+				set @statId = (select statId from Statistic where statName = @statName);
+			end;
 		end;
 
-		-- finally insert data:
-		insert into StatsValInt32 (
-			macId,
-			statId,
-			instant,
-			statVal,
-			quality
+		/* finally insert data, unless already there (the same sample might come twice,
+		   when the client replays a request that timed out, or uploads a burst): */
+		if not exists (
+			select 1 from StatsValInt32
+				where macId = @macId
+				  and statId = @statId
+				  and instant = @timeSinceEpochInMillisecs
 		)
-		values (
-			@macId,
-			@statId,
-			@timeSinceEpochInMillisecs,
-			@statValue,
-			@quality
-		);
+		begin
+			insert into StatsValInt32 (
+				macId,
+				statId,
+				instant,
+				statVal,
+				quality
+			)
+			values (
+				@macId,
+				@statId,
+				@timeSinceEpochInMillisecs,
+				@statValue,
+				@quality
+			);
+		end;
 
 		fetch next from stagingCursor
 		into @timeSinceEpochInMillisecs
 			,@macName
+			,@stagStatId
 			,@statName
 			,@statValue
 			,@quality;
@@ -190,5 +260,55 @@ begin
 	delete from StagingStatsValInt32
 		where batchId = @batchId;
 
+end; -- end of stored procedure
+go
+
+if object_id(N'InsertIntoMachineSampleProc', N'P') is not null
+begin
+	drop procedure InsertIntoMachineSampleProc;
+end;
+go
+
+/* Records the instants at which the machines have sent samples. The client omits the
+   stats whose values stay within their deadband, so this is what tells apart a stat
+   that did not change (the machine sent a sample) from one that is missing. */
+create procedure InsertIntoMachineSampleProc (@batchId smallint) as
+begin
+
+	-- ensure consistency regarding machine:
+	begin try
+		insert into Machine (macName)
+			select distinct macName
+				from StagingMachineSample
+				where batchId = @batchId
+				  and macName not in (select macName from Machine);
+	end try
+	begin catch
+		-- another writer has just inserted some of the names (unique index), so try once more without them:
+		if error_number() not in (2601, 2627)
+			throw;
+
+		insert into Machine (macName)
+			select distinct macName
+				from StagingMachineSample
+				where batchId = @batchId
+				  and macName not in (select macName from Machine);
+	end catch;
+
+	-- insert data, unless already there (the same sample might come twice):
+	insert into MachineSample (macId, instant)
+		select distinct mac.macId, stag.instant
+			from StagingMachineSample as stag
+			inner join Machine as mac on mac.macName = stag.macName
+			where stag.batchId = @batchId
+			  and not exists (
+				select 1 from MachineSample as sample
+					where sample.macId = mac.macId
+					  and sample.instant = stag.instant
+			  );
+
+	delete from StagingMachineSample
+		where batchId = @batchId;
+
 end; -- end of stored procedure
 go
\ No newline at end of file
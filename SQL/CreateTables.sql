@@ -41,7 +41,8 @@ end;
 create table StagingStatsValFloat32 (
 	batchId  smallint     not null,
 	macName  nvarchar(50) not null,
-	statName nvarchar(50) not null,
+	statId   smallint     not null, -- zero when the statistic is identified by name
+	statName nvarchar(50) not null, -- empty when the statistic is identified by ID
 	instant  bigint       not null, -- time in milliseconds since 1970
 	statVal  float(24)    not null,
 	quality  tinyint	  not null
@@ -79,7 +80,8 @@ end;
 create table StagingStatsValInt32 (
 	batchId  smallint     not null,
 	macName  nvarchar(50) not null,
-	statName nvarchar(50) not null,
+	statId   smallint     not null, -- zero when the statistic is identified by name
+	statName nvarchar(50) not null, -- empty when the statistic is identified by ID
 	instant  bigint       not null, -- time in milliseconds since 1970
 	statVal  int          not null,
 	quality  tinyint	  not null
@@ -89,6 +91,41 @@ go
 create nonclustered index IdxStagStatsValInt32ByBatch on StagingStatsValInt32(batchId);
 go
 
+if exists (select * from sys.tables where name = N'MachineSample')
+begin
+	drop table MachineSample;
+end;
+
+/* This table holds the instants at which each machine has sent a sample. The client omits
+   the stats whose values did not leave their deadband since they were last sent, so at an
+   instant found here, a stat without a row of its own kept the value of its previous row
+   (it is unchanged), whereas an instant not found here means the machine did not report
+   at all (the values are missing) */
+create table MachineSample (
+	macId   smallint not null,
+	instant bigint   not null, -- time in milliseconds since 1970
+
+	primary key (macId, instant)
+);
+go
+
+if exists (select * from sys.tables where name = N'StagingMachineSample')
+begin
+	drop index IdxStagMachineSampleByBatch on StagingMachineSample;
+	drop table StagingMachineSample;
+end;
+
+-- This table is an staging area for insertion into MachineSample
+create table StagingMachineSample (
+	batchId  smallint     not null,
+	macName  nvarchar(50) not null,
+	instant  bigint       not null -- time in milliseconds since 1970
+);
+go
+
+create nonclustered index IdxStagMachineSampleByBatch on StagingMachineSample(batchId);
+go
+
 -- Normalization for machine ID and statitic ID:
 
 if exists (select * from sys.tables where name = N'Machine')
@@ -115,8 +152,10 @@ create table Statistic (
 );
 go
 
-create nonclustered index IdxMachineByName on Machine(macName);
-create nonclustered index IdxStatisticByName on Statistic(statName);
+/* The names are unique, so the writers that run in parallel (each with its own connection)
+   cannot both insert a new name: the one that comes last fails, then finds the name there. */
+create unique nonclustered index IdxMachineByName on Machine(macName);
+create unique nonclustered index IdxStatisticByName on Statistic(statName);
 go
 
 alter table StatsValFloat32
@@ -134,4 +173,8 @@ alter table StatsValInt32
 alter table StatsValInt32
 	add foreign key (statId)
 	references Statistic(statId);
+
+alter table MachineSample
+	add foreign key (macId)
+	references Machine(macId);
 go
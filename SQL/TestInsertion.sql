@@ -30,16 +30,16 @@ begin transaction;
 	declare @time bigint;
 	set @time = datediff_big(MILLISECOND, cast('1970-01-01 00:00:00' as datetime), SYSDATETIME());
 
-	insert into StagingStatsValFloat32 (batchId, macName, statName, instant, statVal, quality)
-		values (1, N'HAL9000', N'cpu_usage_percentage', @time, 21.6, 0);
+	insert into StagingStatsValFloat32 (batchId, macName, statId, statName, instant, statVal, quality)
+		values (1, N'HAL9000', 0, N'cpu_usage_percentage', @time, 21.6, 0);
 
 	set @time = @time + 400;
-	insert into StagingStatsValFloat32 (batchId, macName, statName, instant, statVal, quality)
-		values (1, N'HAL9000', N'cpu_usage_percentage', @time, 58.7, 0);
+	insert into StagingStatsValFloat32 (batchId, macName, statId, statName, instant, statVal, quality)
+		values (1, N'HAL9000', 0, N'cpu_usage_percentage', @time, 58.7, 0);
 
 	set @time = @time + 400;
-	insert into StagingStatsValFloat32 (batchId, macName, statName, instant, statVal, quality)
-		values (1, N'HAL9000', N'cpu_usage_percentage', @time, 2.94, 0);
+	insert into StagingStatsValFloat32 (batchId, macName, statId, statName, instant, statVal, quality)
+		values (1, N'HAL9000', 0, N'cpu_usage_percentage', @time, 2.94, 0);
 
 	exec InsertIntoStatsFloat32Proc 1;
 commit transaction;
@@ -66,16 +66,16 @@ begin transaction;
 	declare @time bigint;
 	set @time = datediff_big(MILLISECOND, cast('1970-01-01 00:00:00' as datetime), SYSDATETIME());
 
-	insert into StagingStatsValInt32 (batchId, macName, statName, instant, statVal, quality)
-		values (2, N'HAL9000', N'process_count', @time, 459, 0);
+	insert into StagingStatsValInt32 (batchId, macName, statId, statName, instant, statVal, quality)
+		values (2, N'HAL9000', 0, N'process_count', @time, 459, 0);
 
 	set @time = @time + 400;
-	insert into StagingStatsValInt32 (batchId, macName, statName, instant, statVal, quality)
-		values (2, N'HAL9000', N'process_count', @time, 123, 0);
+	insert into StagingStatsValInt32 (batchId, macName, statId, statName, instant, statVal, quality)
+		values (2, N'HAL9000', 0, N'process_count', @time, 123, 0);
 
 	set @time = @time + 400;
-	insert into StagingStatsValInt32 (batchId, macName, statName, instant, statVal, quality)
-		values (2, N'HAL9000', N'process_count', @time, 696, 0);
+	insert into StagingStatsValInt32 (batchId, macName, statId, statName, instant, statVal, quality)
+		values (2, N'HAL9000', 0, N'process_count', @time, 696, 0);
 
 	exec InsertIntoStatsInt32Proc 2;
 commit transaction;
@@ -2,9 +2,9 @@
 //
 
 #include "stdafx.h"
-#include <3FD\exceptions.h>
-#include <3FD\logger.h>
-#include <POCO\Exception.h>
+#include <3FD/exceptions.h>
+#include <3FD/logger.h>
+#include <Poco/Exception.h>
 #include <iostream>
 //#include <vld.h>
 
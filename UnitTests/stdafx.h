@@ -5,9 +5,11 @@
 
 #pragma once
 
-#include "targetver.h"
+#ifdef _WIN32
+#   include "targetver.h"
+#   include <tchar.h>
+#endif
 
 #include <stdio.h>
-#include <tchar.h>
 
-#include <gtest\gtest.h>
\ No newline at end of file
+#include <gtest/gtest.h>
\ No newline at end of file
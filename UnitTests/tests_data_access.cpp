@@ -3,9 +3,57 @@
 #include <3FD\configuration.h>
 #include <3FD\callstacktracer.h>
 #include "Authenticator.h"
+#include "BinaryCodec.h"
+#include "CommitPipeline.h"
+#include "FlushController.h"
 #include "MSDStorageWriter.h"
+#include "NameInterner.h"
+#include "PerfCountersCatalog.h"
+#include "StatIdDictionary.h"
+#include "StatsPackagePool.h"
+#include "StatsSpool.h"
+#include "StorageWriterPool.h"
+#include "TasksQueue.h"
+#include "WebService.h"
+#include "WriteAheadLog.h"
+#include <Poco\Data\SQLite\Connector.h>
 #include <codecvt>
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <thread>
+
+
+/* Counts the allocations made by a thread while it asks so, to check that some code does not
+allocate. The replacement of the global operators takes place in the whole test application. */
+static thread_local bool isCountingAllocations(false);
+static thread_local size_t allocationCount(0);
+
+void *operator new(size_t size)
+{
+    if (isCountingAllocations)
+        ++allocationCount;
+
+    if (auto ptr = malloc(size == 0 ? 1 : size))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
 
 namespace unit_tests
 {
@@ -70,6 +118,11 @@ namespace unit_tests
                 application::Authenticator::GetInstance().IsAuthentic(L"dummyMachine", L"dummyIdKey")
             );
 
+            // the machines of the credentials are interned, so they are also found by handle:
+            EXPECT_TRUE(
+                application::Authenticator::GetInstance().IsAuthentic(application::InternedName::Find(xMachine), xIdKey.c_str())
+            );
+
             dbSession << R"(
                 delete from SvcAccessCredential
                     where machine = cast(? as nvarchar);
@@ -86,6 +139,498 @@ namespace unit_tests
     }
 
 
+    /// <summary>
+    /// Tests the <see cref="application::NameInterner"/> class.
+    /// </summary>
+    TEST(TestCase_DataAccess, TestNameInterner)
+    {
+        FrameworkInstance _framework;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            using namespace application;
+
+            NameInterner interner(1000);
+
+            auto intern = [&interner](const std::wstring &name)
+            {
+                return interner.Intern(name.data(), name.length());
+            };
+
+            auto find = [&interner](const std::wstring &name)
+            {
+                return interner.Find(name.data(), name.length());
+            };
+
+            EXPECT_EQ(0, intern(L""));
+            EXPECT_EQ(0, find(L"HAL9000"));
+
+            auto handle = intern(L"HAL9000");
+            EXPECT_NE(0, handle);
+            EXPECT_EQ(handle, intern(L"HAL9000"));
+            EXPECT_EQ(handle, find(L"HAL9000"));
+            EXPECT_EQ(L"HAL9000", interner.GetName(handle));
+            EXPECT_EQ(0, find(L"HAL900"));
+            EXPECT_TRUE(interner.GetName(0).empty());
+
+            // several threads intern the same names at once, in different orders:
+            const size_t numThreads(8), numNames(500);
+
+            std::vector<std::wstring> names(numNames);
+            for (size_t idx = 0; idx < numNames; ++idx)
+                names[idx] = L"cpu_core_usage_percentage:" + std::to_wstring(idx);
+
+            std::vector<std::vector<uint32_t>> handlesByThread(numThreads, std::vector<uint32_t>(numNames));
+            std::vector<std::thread> threads;
+
+            for (size_t threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+            {
+                threads.emplace_back([&, threadIdx]()
+                {
+                    for (size_t count = 0; count < numNames; ++count)
+                    {
+                        auto idx = (threadIdx % 2 == 0) ? count : numNames - 1 - count;
+                        handlesByThread[threadIdx][idx] = intern(names[idx]);
+                    }
+                });
+            }
+
+            for (auto &thread : threads)
+                thread.join();
+
+            for (size_t idx = 0; idx < numNames; ++idx)
+            {
+                auto expected = handlesByThread[0][idx];
+                EXPECT_NE(handle, expected);
+                EXPECT_EQ(names[idx], interner.GetName(expected));
+                EXPECT_EQ(expected, find(names[idx]));
+
+                for (size_t threadIdx = 1; threadIdx < numThreads; ++threadIdx)
+                    EXPECT_EQ(expected, handlesByThread[threadIdx][idx]);
+            }
+
+            // the table is bounded:
+            NameInterner smallInterner(2);
+            EXPECT_NE(0, smallInterner.Intern(L"one", 3));
+            EXPECT_FALSE(smallInterner.IsFull());
+            EXPECT_NE(0, smallInterner.Intern(L"two", 3));
+            EXPECT_TRUE(smallInterner.IsFull());
+            EXPECT_THROW(smallInterner.Intern(L"three", 5), IAppException);
+            EXPECT_NE(0, smallInterner.Find(L"two", 3));
+            EXPECT_EQ(2, smallInterner.GetCount());
+
+            // names from the network do not throw, but are refused, unless already there:
+            uint32_t smallHandle;
+            EXPECT_FALSE(smallInterner.TryIntern(L"four", 4, smallHandle));
+            EXPECT_TRUE(smallInterner.TryIntern(L"two", 3, smallHandle));
+            EXPECT_EQ(smallInterner.Find(L"two", 3), smallHandle);
+
+            // the handles of the singleton:
+            InternedName machine(L"HAL9000");
+            EXPECT_EQ(machine, InternedName(std::wstring(L"HAL9000")));
+            EXPECT_EQ(machine, InternedName::Find(L"HAL9000"));
+            EXPECT_NE(machine, InternedName(L"HAL9001"));
+            EXPECT_EQ(L"HAL9000", machine.GetName());
+            EXPECT_TRUE(InternedName().IsEmpty());
+            EXPECT_TRUE(InternedName::Find(L"dryCatDoesNot_NeverInterned").IsEmpty());
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+
+    /// <summary>
+    /// Tests the <see cref="application::TasksQueue"/> class.
+    /// </summary>
+    TEST(TestCase_DataAccess, TestTasksQueue)
+    {
+        FrameworkInstance _framework;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            using namespace application;
+
+            auto makeBatch = [](size_t count, int64_t firstTime)
+            {
+                std::vector<StatsPackage> batch(count);
+                for (size_t idx = 0; idx < count; ++idx)
+                    batch[idx].timeSinceEpochInMillisecs = firstTime + static_cast<int64_t> (idx);
+
+                return batch;
+            };
+
+            TasksQueue queue(4, 10, 5);
+
+            auto batch = makeBatch(3, 0);
+            EXPECT_TRUE(queue.Enqueue(std::move(batch)));
+
+            std::unique_ptr<StatsPackage> task(new StatsPackage());
+            task->timeSinceEpochInMillisecs = 3;
+            EXPECT_TRUE(queue.Enqueue(std::move(task)));
+            EXPECT_EQ(nullptr, task.get());
+            EXPECT_EQ(4, queue.GetDepth());
+
+            // past the high watermark, the batch is refused and left untouched:
+            batch = makeBatch(7, 4);
+            EXPECT_FALSE(queue.Enqueue(std::move(batch)));
+            ASSERT_EQ(7, batch.size());
+            EXPECT_EQ(4, batch.front().timeSinceEpochInMillisecs);
+            EXPECT_EQ(4, queue.GetDepth());
+            EXPECT_EQ(1, queue.GetRejectedCount());
+
+            // then it refuses even what would fit, until drained below the low watermark:
+            task.reset(new StatsPackage());
+            task->timeSinceEpochInMillisecs = 11;
+            EXPECT_FALSE(queue.Enqueue(std::move(task)));
+            ASSERT_NE(nullptr, task.get());
+            EXPECT_EQ(11, task->timeSinceEpochInMillisecs);
+            EXPECT_EQ(2, queue.GetRejectedCount());
+
+            std::vector<StatsPackage> tasks;
+            queue.Dequeue(tasks);
+            ASSERT_EQ(4, tasks.size());
+            EXPECT_EQ(0, queue.GetDepth());
+
+            for (int64_t idx = 0; idx < 4; ++idx)
+                EXPECT_EQ(idx, tasks[idx].timeSinceEpochInMillisecs);
+
+            EXPECT_TRUE(queue.Enqueue(std::move(task)));
+
+            // a batch larger than the high watermark is taken by an empty queue only:
+            batch = makeBatch(12, 100);
+            EXPECT_FALSE(queue.Enqueue(std::move(batch)));
+            queue.Dequeue(tasks);
+            EXPECT_EQ(1, tasks.size());
+            EXPECT_TRUE(queue.Enqueue(std::move(batch)));
+            EXPECT_EQ(12, queue.GetDepth());
+            queue.Dequeue(tasks);
+            EXPECT_EQ(12, tasks.size());
+
+            // several threads enqueue while another dequeues, retrying when refused:
+            const size_t numThreads(8), numBatches(1000), batchSize(3);
+            std::atomic<bool> isProducing(true);
+            std::vector<int> timesSeen(numThreads * numBatches * batchSize, 0);
+
+            std::thread consumer([&queue, &isProducing, &timesSeen]()
+            {
+                std::vector<StatsPackage> taken;
+
+                while (true)
+                {
+                    bool wasProducing = isProducing.load();
+                    queue.Dequeue(taken);
+
+                    for (auto &package : taken)
+                        ++timesSeen[static_cast<size_t> (package.timeSinceEpochInMillisecs)];
+
+                    if (!wasProducing && taken.empty())
+                        break;
+
+                    std::this_thread::yield();
+                }
+            });
+
+            std::vector<std::thread> producers;
+
+            for (size_t threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+            {
+                producers.emplace_back([&, threadIdx]()
+                {
+                    for (size_t batchIdx = 0; batchIdx < numBatches; ++batchIdx)
+                    {
+                        auto firstTime = static_cast<int64_t> ((threadIdx * numBatches + batchIdx) * batchSize);
+                        auto batch = makeBatch(batchSize, firstTime);
+
+                        while (!queue.Enqueue(std::move(batch)))
+                            std::this_thread::yield();
+                    }
+                });
+            }
+
+            for (auto &thread : producers)
+                thread.join();
+
+            isProducing = false;
+            consumer.join();
+
+            EXPECT_EQ(0, queue.GetDepth());
+            EXPECT_TRUE(std::all_of(timesSeen.begin(), timesSeen.end(), [](int count) { return count == 1; }));
+
+            // the consumer waits until the queue holds enough tasks, or times out:
+            using namespace std::chrono;
+
+            auto startTime = steady_clock::now();
+            EXPECT_FALSE(queue.WaitForTasks(2, milliseconds(50)));
+            EXPECT_GE(steady_clock::now() - startTime, milliseconds(50));
+
+            std::thread producer([&queue, &makeBatch]()
+            {
+                std::this_thread::sleep_for(milliseconds(50));
+                EXPECT_TRUE(queue.Enqueue(makeBatch(1, 0)));
+                std::this_thread::sleep_for(milliseconds(50));
+                EXPECT_TRUE(queue.Enqueue(makeBatch(1, 1)));
+            });
+
+            startTime = steady_clock::now();
+            EXPECT_TRUE(queue.WaitForTasks(2, seconds(10)));
+            EXPECT_LT(steady_clock::now() - startTime, seconds(5));
+            producer.join();
+
+            queue.Dequeue(tasks);
+            EXPECT_EQ(2, tasks.size());
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+
+    /// <summary>
+    /// Tests the <see cref="application::StatsPackagePool"/> class.
+    /// </summary>
+    TEST(TestCase_DataAccess, TestStatsPackagePool)
+    {
+        FrameworkInstance _framework;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            using namespace application;
+
+            StatsPackagePool pool(4);
+
+            // an empty pool makes new packages:
+            auto package = pool.Acquire();
+            EXPECT_EQ(0, package.statSamplesFloat32.capacity());
+            EXPECT_EQ(0, package.statSamplesInt32.capacity());
+
+            std::vector<StatsPackage> packages(6);
+            for (auto &recycled : packages)
+            {
+                recycled.statSamplesFloat32.reserve(10);
+                recycled.statSamplesInt32.reserve(20);
+                recycled.statSamplesInt32.emplace_back(static_cast<int16_t> (1), 69, Quality::Good);
+            }
+
+            pool.Recycle(packages);
+            EXPECT_TRUE(packages.empty());
+
+            // the recycled packages keep the capacity, but not the stats, and only as many as fit in the pool:
+            for (int idx = 0; idx < 4; ++idx)
+            {
+                package = pool.Acquire();
+                EXPECT_TRUE(package.statSamplesInt32.empty());
+                EXPECT_LE(10, package.statSamplesFloat32.capacity());
+                EXPECT_LE(20, package.statSamplesInt32.capacity());
+            }
+
+            EXPECT_EQ(0, pool.Acquire().statSamplesInt32.capacity());
+
+            // several threads take and recycle packages, none of them ever held by two threads at once:
+            const int numThreads(8), numIterations(10000);
+            std::atomic<int> sharedCount(0);
+            std::vector<std::thread> threads;
+
+            for (int threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+            {
+                threads.emplace_back([&pool, &sharedCount, threadIdx]()
+                {
+                    std::vector<StatsPackage> held;
+
+                    for (int iteration = 0; iteration < numIterations; ++iteration)
+                    {
+                        for (int idx = 0; idx < 3; ++idx)
+                        {
+                            held.push_back(pool.Acquire());
+                            held.back().statSamplesInt32.emplace_back(static_cast<int16_t> (1), threadIdx, Quality::Good);
+                        }
+
+                        std::this_thread::yield();
+
+                        for (auto &heldPackage : held)
+                        {
+                            if (heldPackage.statSamplesInt32.size() != 1
+                                || heldPackage.statSamplesInt32.front().value != threadIdx)
+                            {
+                                ++sharedCount;
+                            }
+                        }
+
+                        pool.Recycle(held);
+                    }
+                });
+            }
+
+            for (auto &thread : threads)
+                thread.join();
+
+            EXPECT_EQ(0, sharedCount.load());
+
+            /* In steady state, a thread serving requests does not allocate from extracting the stats
+            of a request until they are durable in the log and in the queue, and neither does the
+            consumer, taking them from the queue then back to the pool. (Writing them to database
+            does allocate, inside the ODBC connector, and so does sealing or deleting segments.) */
+            const char *walDirectory("UnitTests.wal.pool");
+            TasksQueue queue(1, 1000, 500);
+            std::vector<StatsPackage> batch;
+            std::vector<StatsPackage> tasks;
+            size_t dequeuedCount(0);
+
+            // what a previous run might have left is discarded:
+            {
+                WriteAheadLog wal(walDirectory, queue);
+                wal.Replay(tasks);
+                wal.Truncate();
+                tasks.clear();
+            }
+
+            WriteAheadLog wal(walDirectory, queue);
+            wal.Replay(tasks);
+            wal.Truncate();
+            EXPECT_TRUE(tasks.empty());
+
+            wchar_t machineName[] = L"joeTheCrazyFrog_pool";
+            wchar_t statName0[] = L"dummy_stat_pool_0";
+            wchar_t statName1[] = L"dummy_stat_pool_1";
+
+            std::array<listOfStatsFloat32_entry, 2> statsFloat32 = {{ { statName0, 6.9F, 0 }, { statName1, 6.9F, 0 } }};
+            std::array<listOfStatsInt32_entry, 2> statsInt32 = {{ { statName0, 69, 0 }, { statName1, 69, 0 } }};
+            std::array<StatsSample, 16> samples;
+
+            for (size_t idx = 0; idx < samples.size(); ++idx)
+            {
+                samples[idx] = StatsSample{
+                    static_cast<int64_t> (idx),
+                    static_cast<unsigned int> (statsFloat32.size()), statsFloat32.data(),
+                    static_cast<unsigned int> (statsInt32.size()), statsInt32.data()
+                };
+            }
+
+            SendStatsSamplesRequest request = { machineName, static_cast<unsigned int> (samples.size()), samples.data() };
+
+            auto runCycle = [&]()
+            {
+                ExtractStatsDataFrom(request, batch);
+                EXPECT_TRUE(wal.Enqueue(std::move(batch), true));
+                queue.Dequeue(tasks);
+                dequeuedCount += tasks.size();
+                StatsPackagePool::GetInstance().Recycle(tasks);
+            };
+
+            // the first cycles make the packages and the capacity of the vectors:
+            for (int cycle = 0; cycle < 3; ++cycle)
+                runCycle();
+
+            allocationCount = 0;
+            isCountingAllocations = true;
+
+            for (int cycle = 0; cycle < 10; ++cycle)
+                runCycle();
+
+            isCountingAllocations = false;
+
+            EXPECT_EQ(13 * samples.size(), dequeuedCount);
+            EXPECT_EQ(0, allocationCount);
+
+            // enqueuing a single task does not allocate either (but making its holder does):
+            std::unique_ptr<StatsPackage> task(new StatsPackage(StatsPackagePool::GetInstance().Acquire()));
+
+            allocationCount = 0;
+            isCountingAllocations = true;
+            EXPECT_TRUE(queue.Enqueue(std::move(task)));
+            isCountingAllocations = false;
+
+            EXPECT_EQ(nullptr, task.get());
+            EXPECT_EQ(0, allocationCount);
+
+            queue.Dequeue(tasks);
+            EXPECT_EQ(1, tasks.size());
+            StatsPackagePool::GetInstance().Recycle(tasks);
+
+            wal.Rotate();
+            wal.Truncate();
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+
+    /// <summary>
+    /// Tests the <see cref="application::FlushController"/> class.
+    /// </summary>
+    TEST(TestCase_DataAccess, TestFlushController)
+    {
+        FrameworkInstance _framework;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            using namespace std::chrono;
+            using namespace application;
+
+            FlushController controller(100, 10, 5000, milliseconds(105));
+            EXPECT_EQ(100, controller.GetTarget());
+
+            // a commit takes 5 ms plus 0.1 ms per package, so the goal is met by 1000 packages:
+            auto commitLatency = [](size_t count, double factor)
+            {
+                return duration_cast<steady_clock::duration>(duration<double, std::milli>((5.0 + 0.1 * count) * factor));
+            };
+
+            // the target grows no more than doubling at once:
+            controller.RecordCommit(controller.GetTarget(), commitLatency(controller.GetTarget(), 1.0));
+            EXPECT_EQ(200, controller.GetTarget());
+
+            for (int idx = 0; idx < 30; ++idx)
+                controller.RecordCommit(controller.GetTarget(), commitLatency(controller.GetTarget(), 1.0));
+
+            EXPECT_GE(controller.GetTarget(), 990);
+            EXPECT_LE(controller.GetTarget(), 1010);
+
+            // a commit of fewer packages (upon the deadline) does not lower the target:
+            auto target = controller.GetTarget();
+            controller.RecordCommit(50, commitLatency(50, 1.0));
+            EXPECT_EQ(target, controller.GetTarget());
+
+            // when the database slows down, the target shrinks, but no lower than the bound:
+            for (int idx = 0; idx < 30; ++idx)
+                controller.RecordCommit(controller.GetTarget(), commitLatency(controller.GetTarget(), 10.0));
+
+            EXPECT_GE(controller.GetTarget(), 40);
+            EXPECT_LE(controller.GetTarget(), 60);
+
+            for (int idx = 0; idx < 30; ++idx)
+                controller.RecordCommit(controller.GetTarget(), seconds(10));
+
+            EXPECT_EQ(10, controller.GetTarget());
+
+            // nor higher than the other:
+            for (int idx = 0; idx < 30; ++idx)
+                controller.RecordCommit(controller.GetTarget(), microseconds(1));
+
+            EXPECT_EQ(5000, controller.GetTarget());
+
+            controller.RecordCommit(0, seconds(10));
+            EXPECT_EQ(5000, controller.GetTarget());
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+
     /// <summary>
     /// Tests the <see cref="application::MSDStorageWriter"/> class.
     /// </summary>
@@ -142,27 +687,27 @@ namespace unit_tests
             expStatSamplesInt.emplace_back(statIntNames[1], 9, Quality::Unknown);
             expStatSamplesInt.emplace_back(statIntNames[2], 696, Quality::Good);
 
-            std::vector<std::unique_ptr<StorageWriteTask>> tasks(2);
+            std::vector<StorageWriteTask> tasks(2);
 
-            tasks[0].reset(new StorageWriteTask());
-            tasks[0]->timeSinceEpochInMillisecs = theTime;
-            tasks[0]->machine = macNames[0];
-            tasks[0]->statSamplesFloat32 = expStatSamplesFloat;
-            tasks[0]->statSamplesInt32 = expStatSamplesInt;
+            tasks[0].timeSinceEpochInMillisecs = theTime;
+            tasks[0].machine = macNames[0];
+            tasks[0].statSamplesFloat32 = expStatSamplesFloat;
+            tasks[0].statSamplesInt32 = expStatSamplesInt;
 
-            tasks[1].reset(new StorageWriteTask());
-            tasks[1]->timeSinceEpochInMillisecs = theTime;
-            tasks[1]->machine = macNames[1];
-            tasks[1]->statSamplesFloat32 = expStatSamplesFloat;
-            tasks[1]->statSamplesInt32 = expStatSamplesInt;
+            tasks[1].timeSinceEpochInMillisecs = theTime;
+            tasks[1].machine = macNames[1];
+            tasks[1].statSamplesFloat32 = expStatSamplesFloat;
+            tasks[1].statSamplesInt32 = expStatSamplesInt;
 
-            // Write it to database:
+            // Write it to database (one package per commit, so one is converted while the other is committed):
 
             MSDStorageWriter dbWriter(
-                AppConfig::GetSettings().application.GetString("dbConnString", "NOT SET")
+                AppConfig::GetSettings().application.GetString("dbConnString", "NOT SET"),
+                1
             );
 
             dbWriter.WriteStats(tasks);
+            dbWriter.Flush();
 
             // And check what was written:
 
@@ -271,4 +816,950 @@ namespace unit_tests
         }
     }
 
+
+    /// <summary>
+    /// Tests the <see cref="application::CommitPipeline"/> template class, with which
+    /// <see cref="application::MSDStorageWriter"/> converts the next batch while the
+    /// previous one is committed.
+    /// </summary>
+    TEST(TestCase_DataAccess, TestCommitPipeline)
+    {
+        using namespace application;
+
+        std::mutex mutex;
+        std::condition_variable releaseChange;
+        bool isReleased(false);
+        std::vector<int> committed;
+
+        // the commit of each batch waits to be released, and fails for an empty batch:
+        CommitPipeline<std::vector<int>> pipeline([&mutex, &releaseChange, &isReleased, &committed](std::vector<int> &batch)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            releaseChange.wait(lock, [&isReleased]() { return isReleased; });
+            isReleased = false;
+
+            if (batch.empty())
+                throw std::runtime_error("Stand-in commit failed on purpose");
+
+            committed.insert(committed.end(), batch.begin(), batch.end());
+        });
+
+        auto releaseCommit = [&mutex, &releaseChange, &isReleased]()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            isReleased = true;
+            releaseChange.notify_one();
+        };
+
+        auto getCommitted = [&mutex, &committed]()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return committed;
+        };
+
+        // the first batch is handed over, and the call returns while it is committed:
+        auto &first = pipeline.GetNext();
+        first.assign({ 1, 2, 3 });
+        pipeline.HandOver();
+        EXPECT_TRUE(pipeline.IsCommitting());
+
+        // the second batch is converted meanwhile, into the other set of buffers:
+        auto &second = pipeline.GetNext();
+        EXPECT_NE(&first, &second);
+        second.assign({ 4, 5 });
+        EXPECT_TRUE(pipeline.IsCommitting());
+        EXPECT_TRUE(getCommitted().empty());
+
+        // it is handed over once the first commit has finished:
+        releaseCommit();
+        pipeline.HandOver();
+        EXPECT_EQ(std::vector<int>({ 1, 2, 3 }), getCommitted());
+        EXPECT_EQ(&first, &pipeline.GetNext());
+
+        releaseCommit();
+        EXPECT_FALSE(pipeline.WaitForCommit());
+        EXPECT_FALSE(pipeline.IsCommitting());
+        EXPECT_EQ(std::vector<int>({ 1, 2, 3, 4, 5 }), getCommitted());
+
+        // a failed commit is reported when the next batch is handed over, which then is not:
+        pipeline.GetNext().clear();
+        pipeline.HandOver();
+        releaseCommit();
+
+        pipeline.GetNext().assign({ 6 });
+        EXPECT_THROW(pipeline.HandOver(), std::runtime_error);
+        EXPECT_FALSE(pipeline.IsCommitting());
+
+        pipeline.HandOver();
+        releaseCommit();
+        EXPECT_FALSE(pipeline.WaitForCommit());
+        EXPECT_EQ(std::vector<int>({ 1, 2, 3, 4, 5, 6 }), getCommitted());
+    }
+
+
+    // Stands in for the writer to database, with an in-memory SQLite database of its own
+    class SQLiteStatsWriter_TestImpl : public application::IStatsWriter
+    {
+    private:
+
+        Poco::Data::Session m_dbSession;
+        std::mutex &m_mutex;
+        std::set<int16_t> &m_batchIdsInUse; // by all writers at once
+
+    public:
+
+        static const std::chrono::milliseconds commitLatency;
+
+        SQLiteStatsWriter_TestImpl(std::mutex &mutex, std::set<int16_t> &batchIdsInUse)
+            : m_dbSession("SQLite", ":memory:")
+            , m_mutex(mutex)
+            , m_batchIdsInUse(batchIdsInUse)
+        {
+            using namespace Poco::Data::Keywords;
+            m_dbSession << "create table MachineSample (batchId integer, macName text, instant integer);", now;
+        }
+
+        virtual void WriteStats(std::vector<application::StorageWriteTask> &tasks) override
+        {
+            using namespace Poco::Data::Keywords;
+
+            auto batchId = application::GenerateBatchId();
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                EXPECT_TRUE(m_batchIdsInUse.insert(batchId).second) << "batch ID " << batchId << " is already in use";
+            }
+
+            std::wstring_convert<std::codecvt_utf8<wchar_t>> transcoder;
+
+            m_dbSession.begin();
+
+            for (auto &task : tasks)
+            {
+                // a negative time makes the writer fail:
+                if (task.timeSinceEpochInMillisecs < 0)
+                {
+                    m_dbSession.rollback();
+
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_batchIdsInUse.erase(batchId);
+                    throw AppException<std::runtime_error>("Stand-in writer failed on purpose");
+                }
+
+                auto macName = transcoder.to_bytes(task.machine.GetName());
+
+                m_dbSession << "insert into MachineSample (batchId, macName, instant) values (?, ?, ?);"
+                    , use(batchId)
+                    , use(macName)
+                    , use(task.timeSinceEpochInMillisecs)
+                    , now;
+            }
+
+            // the latency of a database server:
+            std::this_thread::sleep_for(commitLatency);
+
+            m_dbSession.commit();
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_batchIdsInUse.erase(batchId);
+            }
+
+            tasks.clear();
+        }
+
+        // the commit above is done before returning:
+        virtual void Flush() override {}
+
+        std::vector<std::string> GetMachines()
+        {
+            using namespace Poco::Data::Keywords;
+
+            std::vector<std::string> machines;
+            m_dbSession << "select distinct macName from MachineSample order by macName;", into(machines), now;
+            return machines;
+        }
+
+        size_t GetRowCount()
+        {
+            using namespace Poco::Data::Keywords;
+
+            size_t count(0);
+            m_dbSession << "select count(*) from MachineSample;", into(count), now;
+            return count;
+        }
+    };
+
+    const std::chrono::milliseconds SQLiteStatsWriter_TestImpl::commitLatency(25);
+
+
+    /// <summary>
+    /// Tests the <see cref="application::StorageWriterPool"/> class.
+    /// </summary>
+    TEST(TestCase_DataAccess, TestStorageWriterPool)
+    {
+        FrameworkInstance _framework;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            using namespace std::chrono;
+            using namespace application;
+
+            Poco::Data::SQLite::Connector::registerConnector();
+
+            std::mutex mutex;
+            std::set<int16_t> batchIdsInUse;
+            std::vector<SQLiteStatsWriter_TestImpl *> writers;
+
+            const size_t numWriters(4);
+
+            StorageWriterPool pool(numWriters, [&mutex, &batchIdsInUse, &writers]()
+            {
+                std::unique_ptr<SQLiteStatsWriter_TestImpl> writer(new SQLiteStatsWriter_TestImpl(mutex, batchIdsInUse));
+                writers.push_back(writer.get());
+                return std::unique_ptr<IStatsWriter>(writer.release());
+            });
+
+            ASSERT_EQ(numWriters, pool.GetWriterCount());
+            ASSERT_EQ(numWriters, writers.size());
+
+            // several machines, each one sending several samples:
+            const size_t numMachines(20), numSamples(10), numRounds(8);
+
+            std::vector<InternedName> machines;
+            for (size_t idx = 0; idx < numMachines; ++idx)
+                machines.push_back(InternedName(L"joeTheCrazyFrog_pool_" + std::to_wstring(idx)));
+
+            auto makeTasks = [&machines, numSamples](std::vector<StorageWriteTask> &tasks)
+            {
+                tasks.clear();
+                for (size_t sampleIdx = 0; sampleIdx < numSamples; ++sampleIdx)
+                {
+                    for (auto machine : machines)
+                    {
+                        tasks.emplace_back();
+                        tasks.back().timeSinceEpochInMillisecs = static_cast<int64_t> (sampleIdx);
+                        tasks.back().machine = machine;
+                    }
+                }
+            };
+
+            std::vector<StorageWriteTask> tasks;
+            auto startTime = steady_clock::now();
+
+            for (size_t round = 0; round < numRounds; ++round)
+            {
+                makeTasks(tasks);
+                pool.WriteStats(tasks);
+                EXPECT_TRUE(tasks.empty());
+            }
+
+            // the writers work in parallel, rather than one after another:
+            EXPECT_LT(steady_clock::now() - startTime, SQLiteStatsWriter_TestImpl::commitLatency * numRounds * (numWriters - 1));
+
+            // all samples of a machine went through the same writer:
+            std::wstring_convert<std::codecvt_utf8<wchar_t>> transcoder;
+            size_t rowCount(0), busyWriterCount(0);
+            std::set<std::string> machinesSeen;
+
+            for (size_t writerIdx = 0; writerIdx < numWriters; ++writerIdx)
+            {
+                rowCount += writers[writerIdx]->GetRowCount();
+
+                auto writerMachines = writers[writerIdx]->GetMachines();
+                if (!writerMachines.empty())
+                    ++busyWriterCount;
+
+                for (auto &machine : writerMachines)
+                {
+                    EXPECT_TRUE(machinesSeen.insert(machine).second) << machine << " went through more than one writer";
+                    EXPECT_EQ(writerIdx, pool.GetPartition(InternedName(transcoder.from_bytes(machine))));
+                }
+            }
+
+            EXPECT_EQ(numMachines * numSamples * numRounds, rowCount);
+            EXPECT_EQ(numMachines, machinesSeen.size());
+            EXPECT_GT(busyWriterCount, 1);
+
+            // the failure of a writer is reported, and the pool keeps working:
+            makeTasks(tasks);
+            tasks.front().timeSinceEpochInMillisecs = -1;
+            EXPECT_THROW(pool.WriteStats(tasks), IAppException);
+
+            makeTasks(tasks);
+            pool.WriteStats(tasks);
+            EXPECT_TRUE(tasks.empty());
+            EXPECT_TRUE(batchIdsInUse.empty());
+
+            pool.Flush();
+
+            // the commits through the pool are measured for the tasks written, which the pool clears:
+            const size_t numTasks(numMachines * numSamples);
+            FlushController controller(numTasks, 10, 5000, SQLiteStatsWriter_TestImpl::commitLatency * 8);
+
+            makeTasks(tasks);
+            controller.Commit(pool, tasks);
+            EXPECT_TRUE(tasks.empty());
+            EXPECT_GT(controller.GetTarget(), numTasks);
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+
+    /// <summary>
+    /// Tests the <see cref="application::StatIdDictionary"/> class, and
+    /// the storage of stats identified by the ID's it has assigned.
+    /// </summary>
+    TEST(TestCase_DataAccess, TestStatIdDictionary)
+    {
+        FrameworkInstance _framework;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            using namespace application;
+
+            auto &dictionary = StatIdDictionary::GetInstance();
+
+            const std::wstring machine(L"joeTheCrazyFrog3");
+
+            std::vector<std::wstring> statNames =
+            {
+                L"dummy_stat_by_id_0",
+                L"dummy_stat_by_id_1",
+                L"dummy_stat_float_0" // might be already there, from another test
+            };
+
+            std::vector<int16_t> statIds;
+            auto sessionId = dictionary.OpenSession(machine, statNames, statIds);
+            EXPECT_NE(0, sessionId);
+            ASSERT_EQ(statNames.size(), statIds.size());
+
+            // the ID's are those in database:
+
+            using namespace Poco::Data;
+            using namespace Poco::Data::Keywords;
+
+            Session dbSession("ODBC",
+                AppConfig::GetSettings().application.GetString("dbConnString", "NOT SET")
+            );
+
+            for (size_t idx = 0; idx < statNames.size(); ++idx)
+            {
+                int16_t statId(0);
+
+                dbSession << "select statId from Statistic where statName = ?;"
+                    , into(statId)
+                    , useRef(statNames[idx])
+                    , now;
+
+                EXPECT_EQ(statId, statIds[idx]);
+            }
+
+            // a name that does not fit in database is rejected:
+            std::vector<int16_t> otherIds;
+            EXPECT_EQ(0, dictionary.OpenSession(machine, { std::wstring(51, L'x') }, otherIds));
+
+            // packages carrying ID's of the session get its machine:
+            auto theTime = time(nullptr) * 1000;
+
+            std::vector<StatsPackage> packages(1);
+            packages[0].timeSinceEpochInMillisecs = theTime;
+            packages[0].statSamplesFloat32.emplace_back(statIds[0], 12.5F, Quality::Good);
+            packages[0].statSamplesInt32.emplace_back(statIds[1], 125, Quality::Unknown);
+
+            EXPECT_EQ(BinaryStatus::Accepted, dictionary.ResolveSession(sessionId, packages));
+            EXPECT_EQ(machine, packages[0].machine.GetName());
+
+            // whereas an ID not assigned in the session is rejected:
+            std::vector<StatsPackage> forged(1);
+            forged[0].statSamplesInt32.emplace_back(static_cast<int16_t> (32000), 1, Quality::Good);
+            EXPECT_EQ(BinaryStatus::Rejected, dictionary.ResolveSession(sessionId, forged));
+
+            // opening another session for the machine replaces the previous:
+            auto newSessionId = dictionary.OpenSession(machine, statNames, otherIds);
+            EXPECT_NE(sessionId, newSessionId);
+            EXPECT_EQ(statIds, otherIds);
+            EXPECT_EQ(BinaryStatus::UnknownSession, dictionary.ResolveSession(sessionId, packages));
+
+            // write the stats identified by ID into storage:
+
+            MSDStorageWriter dbWriter(
+                AppConfig::GetSettings().application.GetString("dbConnString", "NOT SET")
+            );
+
+            dbWriter.WriteStats(packages);
+            dbWriter.Flush();
+
+            float statValFloat(0.0F);
+
+            dbSession << R"(
+                select statVal
+                    from StatsValFloat32 as stat
+                    inner join Machine as mac on mac.macId = stat.macId
+                    where mac.macName = ?
+                        and stat.statId = ?
+                        and stat.instant = ?;
+                )"
+                , into(statValFloat)
+                , useRef(machine)
+                , useRef(statIds[0])
+                , useRef(theTime)
+                , now;
+
+            EXPECT_EQ(12.5F, statValFloat);
+
+            int statValInt(0);
+
+            dbSession << R"(
+                select statVal
+                    from StatsValInt32 as stat
+                    inner join Machine as mac on mac.macId = stat.macId
+                    where mac.macName = ?
+                        and stat.statId = ?
+                        and stat.instant = ?;
+                )"
+                , into(statValInt)
+                , useRef(machine)
+                , useRef(statIds[1])
+                , useRef(theTime)
+                , now;
+
+            EXPECT_EQ(125, statValInt);
+
+            StatIdDictionary::Finalize();
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+
+    /// <summary>
+    /// Makes a catalog with a counter declared in configuration after the built-in ones.
+    /// </summary>
+    static std::vector<application::PerfCounterDescriptor> MakeSpoolCatalog()
+    {
+        using namespace application;
+
+        auto catalog = GetBuiltInPerfCountersCatalog();
+        catalog.push_back(MakePerfCounterDescriptor(L"gpu_usage_percentage",
+                                                    L"\\GPU Engine(_Total)\\Utilization Percentage",
+                                                    StatValueType::Float32));
+        return catalog;
+    }
+
+
+    /// <summary>
+    /// Fills the stats of a cycle as the client collects them: the sample of every counter
+    /// in the catalog, the aggregates and a burst of the last counter (declared in configuration)
+    /// and the metrics of the client. The values depend on the cycle.
+    /// </summary>
+    static void FillSpoolStats(const std::vector<application::PerfCounterDescriptor> &catalog,
+                               std::chrono::time_point<std::chrono::system_clock> time,
+                               uint16_t cycle,
+                               application::CollectedStats &stats)
+    {
+        using namespace application;
+        using namespace std::chrono;
+
+        auto lastCounterId = static_cast<uint32_t> (catalog.size() - 1);
+
+        stats.sample.Clear();
+        stats.sample.counterIds.clear();
+        for (uint32_t counterId = 0; counterId < catalog.size(); ++counterId)
+            stats.sample.counterIds.push_back(counterId);
+
+        auto row = stats.sample.AddSample(time);
+        for (size_t idx = 0; idx < catalog.size(); ++idx)
+        {
+            stats.sample.GetValues(row)[idx] = 100.0 * cycle + idx;
+            stats.sample.GetQualities(row)[idx] = (idx % 2 == 0) ? Quality::Good : Quality::Invalid;
+        }
+
+        // the deadband let nothing through, but the spool keeps everything:
+        stats.sendMask.assign(catalog.size(), 0);
+
+        stats.aggregates.sampleCount = 10;
+        stats.aggregates.counterIds = { lastCounterId };
+        stats.aggregates.values = { 1.0F * cycle, 2.0F, 3.0F, 4.0F };
+        stats.aggregates.qualities = { Quality::Good };
+
+        stats.burst.Clear();
+        stats.burst.counterIds = { lastCounterId };
+        for (int idx = 0; idx < 2; ++idx)
+        {
+            auto burstRow = stats.burst.AddSample(time - milliseconds(200 * (2 - idx)));
+            stats.burst.GetValues(burstRow)[0] = 50.0 + idx;
+            stats.burst.GetQualities(burstRow)[0] = Quality::Good;
+        }
+
+        stats.hasSelfMetrics = true;
+        for (auto &metric : stats.selfMetrics)
+            metric = ValueWithQuality<float>{ 0.5F * cycle, Quality::Good };
+    }
+
+
+    /// <summary>
+    /// Checks whether the stats replayed from the spool are those filled by <see cref="FillSpoolStats"/>.
+    /// </summary>
+    static void CheckSpoolStats(const std::vector<application::PerfCounterDescriptor> &catalog,
+                                std::chrono::time_point<std::chrono::system_clock> time,
+                                uint16_t cycle,
+                                const application::CollectedStats &stats)
+    {
+        using namespace application;
+        using namespace std::chrono;
+
+        CollectedStats expected;
+        FillSpoolStats(catalog, time, cycle, expected);
+
+        ASSERT_EQ(1, stats.sample.GetSampleCount());
+        EXPECT_EQ(duration_cast<milliseconds>(time.time_since_epoch()).count(),
+                  duration_cast<milliseconds>(stats.sample.times[0].time_since_epoch()).count());
+        EXPECT_EQ(expected.sample.counterIds, stats.sample.counterIds);
+        EXPECT_EQ(expected.sample.values, stats.sample.values);
+        EXPECT_EQ(expected.sample.qualities, stats.sample.qualities);
+        EXPECT_EQ(nullptr, stats.GetSendMask());
+
+        ASSERT_TRUE(stats.HasAggregates());
+        EXPECT_EQ(expected.aggregates.sampleCount, stats.aggregates.sampleCount);
+        EXPECT_EQ(expected.aggregates.counterIds, stats.aggregates.counterIds);
+        EXPECT_EQ(expected.aggregates.values, stats.aggregates.values);
+        EXPECT_EQ(expected.aggregates.qualities, stats.aggregates.qualities);
+
+        ASSERT_EQ(2, stats.burst.GetSampleCount());
+        EXPECT_EQ(expected.burst.counterIds, stats.burst.counterIds);
+        EXPECT_EQ(expected.burst.values, stats.burst.values);
+        EXPECT_EQ(expected.burst.qualities, stats.burst.qualities);
+
+        ASSERT_TRUE(stats.hasSelfMetrics);
+        for (auto &metric : stats.selfMetrics)
+            EXPECT_EQ(0.5F * cycle, metric.value);
+    }
+
+
+    /// <summary>
+    /// Tests the <see cref="application::StatsSpool"/> class.
+    /// </summary>
+    TEST(TestCase_DataAccess, TestStatsSpool)
+    {
+        FrameworkInstance _framework;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            using namespace application;
+            using namespace std::chrono;
+
+            const char *spoolFilePath("UnitTests.spool");
+            DeleteFileA(spoolFilePath);
+
+            auto catalog = MakeSpoolCatalog();
+            auto now = system_clock().now();
+
+            CollectedStats stats;
+
+            // the smallest spool holds just a few cycles:
+            {
+                StatsSpool spool(spoolFilePath, 0, 3600, catalog);
+
+                for (uint16_t cycle = 0; cycle < 20; ++cycle)
+                {
+                    FillSpoolStats(catalog, now + seconds(cycle), cycle, stats);
+                    spool.Append(stats);
+                }
+
+                // the oldest records have been overwritten:
+                auto count = spool.GetCount();
+                EXPECT_LT(0, count);
+                EXPECT_GT(20, count);
+
+                std::vector<CollectedStats> items;
+                ASSERT_EQ(count, spool.Peek(items, 20));
+                ASSERT_LE(count, items.size());
+
+                for (uint32_t idx = 0; idx < count; ++idx)
+                {
+                    auto cycle = static_cast<uint16_t> (20 - count + idx);
+                    CheckSpoolStats(catalog, now + seconds(cycle), cycle, items[idx]);
+                }
+            }
+
+            DeleteFileA(spoolFilePath);
+
+            const uint16_t numCycles(10);
+
+            // records are expected to survive until the next execution:
+            {
+                StatsSpool spool(spoolFilePath, 64, 3600, catalog);
+
+                for (uint16_t cycle = 0; cycle < numCycles; ++cycle)
+                {
+                    FillSpoolStats(catalog, now + seconds(cycle), cycle, stats);
+                    spool.Append(stats);
+                }
+            }
+
+            StatsSpool spool(spoolFilePath, 64, 3600, catalog);
+            EXPECT_EQ(numCycles, spool.GetCount());
+
+            std::vector<CollectedStats> items;
+
+            // replay in batches, from the oldest to the newest record:
+            for (uint16_t cycle = 0; cycle < numCycles; cycle += 4)
+            {
+                auto count = spool.Peek(items, 4);
+                EXPECT_EQ((std::min)(4, numCycles - cycle), static_cast<int> (count));
+                EXPECT_EQ(4, items.size()); // the items are kept for reuse
+
+                for (uint32_t idx = 0; idx < count; ++idx)
+                    CheckSpoolStats(catalog, now + seconds(cycle + idx), cycle + idx, items[idx]);
+
+                spool.Discard(count);
+            }
+
+            EXPECT_EQ(0, spool.GetCount());
+
+            // old records expire:
+            FillSpoolStats(catalog, now - seconds(7200), 0, stats);
+            spool.Append(stats);
+            EXPECT_EQ(0, spool.Peek(items, 4));
+            EXPECT_EQ(0, spool.GetCount());
+
+            const char *corruptedFilePath("UnitTests.corrupted.spool");
+            DeleteFileA(corruptedFilePath);
+
+            {
+                StatsSpool corruptedSpool(corruptedFilePath, 0, 3600, catalog);
+                FillSpoolStats(catalog, now, 0, stats);
+                corruptedSpool.Append(stats);
+            }
+
+            // zero the size of the oldest record, which comes right after the header:
+            {
+                auto fileHandle = CreateFileA(corruptedFilePath,
+                                              GENERIC_WRITE, 0, nullptr,
+                                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+                ASSERT_NE(INVALID_HANDLE_VALUE, fileHandle);
+
+                LARGE_INTEGER recordOffset;
+                recordOffset.QuadPart = 7 * sizeof(uint32_t);
+                EXPECT_NE(FALSE, SetFilePointerEx(fileHandle, recordOffset, nullptr, FILE_BEGIN));
+
+                const uint32_t recordSize(0);
+                DWORD writtenCount;
+                EXPECT_NE(FALSE, WriteFile(fileHandle, &recordSize, sizeof recordSize, &writtenCount, nullptr));
+                CloseHandle(fileHandle);
+            }
+
+            // once full, the spool cannot drop the corrupted record, so it is reset:
+            {
+                StatsSpool corruptedSpool(corruptedFilePath, 0, 3600, catalog);
+                EXPECT_EQ(1, corruptedSpool.GetCount());
+
+                for (uint16_t cycle = 1; cycle <= 20; ++cycle)
+                {
+                    FillSpoolStats(catalog, now + seconds(cycle), cycle, stats);
+                    corruptedSpool.Append(stats);
+                }
+
+                auto count = corruptedSpool.GetCount();
+                EXPECT_LT(0, count);
+                EXPECT_GT(20, count);
+
+                ASSERT_EQ(count, corruptedSpool.Peek(items, 20));
+
+                for (uint32_t idx = 0; idx < count; ++idx)
+                {
+                    auto cycle = static_cast<uint16_t> (21 - count + idx);
+                    CheckSpoolStats(catalog, now + seconds(cycle), cycle, items[idx]);
+                }
+            }
+
+            DeleteFileA(corruptedFilePath);
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+
+    /// <summary>
+    /// Tests whether the stats of a counter declared in configuration (along with its aggregates
+    /// and burst) survive the spool in <see cref="application::StatsSpool"/> and are sent in the
+    /// request made by <see cref="application::BinaryStatsEncoder"/> upon replay.
+    /// </summary>
+    TEST(TestCase_DataAccess, TestStatsSpool_CatalogCounter)
+    {
+        FrameworkInstance _framework;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            using namespace application;
+            using namespace std::chrono;
+
+            const char *spoolFilePath("UnitTests.spool");
+            DeleteFileA(spoolFilePath);
+
+            auto catalog = MakeSpoolCatalog();
+            auto time = system_clock().now();
+
+            {
+                CollectedStats stats;
+                FillSpoolStats(catalog, time, 7, stats);
+
+                StatsSpool spool(spoolFilePath, 64, 3600, catalog);
+                spool.Append(stats);
+            }
+
+            // another catalog would give the counters other meanings, so the records are dropped:
+            {
+                CollectedStats stats;
+                FillSpoolStats(catalog, time, 7, stats);
+
+                StatsSpool spool("UnitTests.other.spool", 64, 3600, catalog);
+                spool.Append(stats);
+            }
+
+            {
+                StatsSpool spool("UnitTests.other.spool", 64, 3600, GetBuiltInPerfCountersCatalog());
+                EXPECT_EQ(0, spool.GetCount());
+            }
+
+            DeleteFileA("UnitTests.other.spool");
+
+            StatsSpool spool(spoolFilePath, 64, 3600, catalog);
+            ASSERT_EQ(1, spool.GetCount());
+
+            std::vector<CollectedStats> items;
+            ASSERT_EQ(1, spool.Peek(items, 10));
+            CheckSpoolStats(catalog, time, 7, items[0]);
+
+            // replay the record in a request, just like the client does (from a known machine):
+            InternedName machine(L"joeTheCrazyFrog_spool");
+            std::vector<const CollectedStats *> itemRefs = { &items[0] };
+            BinaryStatsEncoder encoder(machine.GetName(), L"spoolKey");
+            auto &frame = encoder.Encode(catalog, itemRefs);
+
+            std::wstring authKey;
+            uint64_t sessionId;
+            std::vector<StatsPackage> packages;
+            ASSERT_TRUE(DecodeStats(frame.data(), frame.size(), authKey, sessionId, packages));
+            spool.Discard(1);
+
+            // the sample, followed by the burst:
+            ASSERT_EQ(3, packages.size());
+
+            auto findFloat = [](const StatsPackage &package, const wchar_t *statName) -> const StatSampleValue<float> *
+            {
+                for (auto &sample : package.statSamplesFloat32)
+                {
+                    if (sample.statName.GetName() == statName)
+                        return &sample;
+                }
+
+                return nullptr;
+            };
+
+            auto gpuSample = findFloat(packages[0], L"gpu_usage_percentage");
+            ASSERT_NE(nullptr, gpuSample);
+            EXPECT_EQ(700.0F + numSupPerfCounters, gpuSample->value);
+
+            auto gpuMax = findFloat(packages[0], L"gpu_usage_percentage_max");
+            ASSERT_NE(nullptr, gpuMax);
+            EXPECT_EQ(2.0F, gpuMax->value);
+
+            for (int idx = 0; idx < 2; ++idx)
+            {
+                auto gpuBurst = findFloat(packages[1 + idx], L"gpu_usage_percentage");
+                ASSERT_NE(nullptr, gpuBurst);
+                EXPECT_EQ(50.0F + idx, gpuBurst->value);
+            }
+
+            // all the built-in counters went too, regardless of the deadband:
+            EXPECT_EQ(numSupPerfCounters + 1,
+                      packages[0].statSamplesInt32.size()
+                      + packages[0].statSamplesFloat32.size()
+                      - numSupAggregates
+                      - numSelfMetrics);
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+
+    /// <summary>
+    /// Tests the <see cref="application::WriteAheadLog"/> class.
+    /// </summary>
+    TEST(TestCase_DataAccess, TestWriteAheadLog)
+    {
+        FrameworkInstance _framework;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            using namespace application;
+
+            const char *walDirectory("UnitTests.wal");
+
+            InternedName machine(L"joeTheCrazyFrog_wal");
+            InternedName statName(L"dummy_stat_wal");
+
+            auto makeBatch = [machine, statName](size_t count, int64_t firstTime)
+            {
+                std::vector<StatsPackage> batch(count);
+                for (size_t idx = 0; idx < count; ++idx)
+                {
+                    auto &package = batch[idx];
+                    package.timeSinceEpochInMillisecs = firstTime + static_cast<int64_t> (idx);
+                    package.machine = machine;
+                    package.statSamplesFloat32.emplace_back(statName, 6.9F * idx, Quality::Good);
+                    package.statSamplesInt32.emplace_back(static_cast<int16_t> (42), static_cast<int> (idx), Quality::Invalid);
+                }
+
+                return batch;
+            };
+
+            TasksQueue queue(2, 1000, 500);
+            std::vector<StatsPackage> tasks;
+            std::vector<StatsPackage> replayed;
+
+            // what a previous run might have left is discarded:
+            {
+                WriteAheadLog wal(walDirectory, queue);
+                wal.Replay(replayed);
+                wal.Truncate();
+                replayed.clear();
+            }
+
+            {
+                WriteAheadLog wal(walDirectory, queue);
+                wal.Replay(replayed);
+                EXPECT_TRUE(replayed.empty());
+                wal.Truncate();
+
+                // the packages go to the queue, and are on disk once the call returns:
+                auto batch = makeBatch(3, 0);
+                EXPECT_TRUE(wal.Enqueue(std::move(batch), true));
+                EXPECT_TRUE(batch.empty());
+                EXPECT_EQ(3, queue.GetDepth());
+
+                // several threads wait for their packages to be on disk at once:
+                const size_t numThreads(8), numBatches(100);
+                std::vector<std::thread> threads;
+
+                for (size_t threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+                {
+                    threads.emplace_back([&wal, &makeBatch, threadIdx, numBatches]()
+                    {
+                        for (size_t batchIdx = 0; batchIdx < numBatches; ++batchIdx)
+                        {
+                            auto firstTime = static_cast<int64_t> (1000 + threadIdx * numBatches + batchIdx);
+                            EXPECT_TRUE(wal.Enqueue(makeBatch(1, firstTime), true));
+                        }
+                    });
+                }
+
+                for (auto &thread : threads)
+                    thread.join();
+
+                EXPECT_EQ(3 + numThreads * numBatches, queue.GetDepth());
+
+                // once sealed, dequeued and committed to database, the packages are no longer needed:
+                wal.Rotate();
+                queue.Dequeue(tasks);
+                EXPECT_EQ(3 + numThreads * numBatches, tasks.size());
+                wal.Truncate();
+
+                // but those that come after the last commit are left, as if the server crashed:
+                EXPECT_TRUE(wal.Enqueue(makeBatch(2, 100), false));
+                wal.Rotate();
+                wal.Truncate(1); // the segment sealed last is kept while its commit is in flight
+                EXPECT_TRUE(wal.Enqueue(makeBatch(2, 102), true));
+                queue.Dequeue(tasks);
+            }
+
+            // a record that the crash cut short is ignored:
+            {
+                auto fileHandle = CreateFileA((std::string(walDirectory) + "\\00000000000099999999.wal").c_str(),
+                                              GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                                              CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+                ASSERT_NE(INVALID_HANDLE_VALUE, fileHandle);
+
+                const uint8_t content[] = { 'M', 'S', 'C', 'W', 1, 0, 0, 0, 9, 0, 0, 0, 1 };
+                DWORD writtenCount;
+                EXPECT_NE(FALSE, WriteFile(fileHandle, content, sizeof content, &writtenCount, nullptr));
+                CloseHandle(fileHandle);
+            }
+
+            // a full queue refuses packages, which then are not logged:
+            TasksQueue smallQueue(1, 2, 1);
+
+            {
+                WriteAheadLog wal(walDirectory, smallQueue);
+                wal.Replay(replayed);
+
+                ASSERT_EQ(4, replayed.size());
+
+                for (size_t idx = 0; idx < replayed.size(); ++idx)
+                {
+                    auto &package = replayed[idx];
+                    EXPECT_EQ(100 + idx, package.timeSinceEpochInMillisecs);
+                    EXPECT_EQ(machine, package.machine);
+
+                    ASSERT_EQ(1, package.statSamplesFloat32.size());
+                    EXPECT_EQ(statName, package.statSamplesFloat32[0].statName);
+                    EXPECT_EQ(6.9F * (idx % 2), package.statSamplesFloat32[0].value);
+                    EXPECT_EQ(Quality::Good, package.statSamplesFloat32[0].quality);
+
+                    ASSERT_EQ(1, package.statSamplesInt32.size());
+                    EXPECT_EQ(42, package.statSamplesInt32[0].statId);
+                    EXPECT_EQ(idx % 2, package.statSamplesInt32[0].value);
+                    EXPECT_EQ(Quality::Invalid, package.statSamplesInt32[0].quality);
+                }
+
+                wal.Truncate();
+
+                EXPECT_TRUE(wal.Enqueue(makeBatch(2, 200), true));
+
+                auto batch = makeBatch(1, 202);
+                EXPECT_FALSE(wal.Enqueue(std::move(batch), true));
+                EXPECT_EQ(1, batch.size());
+            }
+
+            replayed.clear();
+
+            {
+                WriteAheadLog wal(walDirectory, smallQueue);
+                wal.Replay(replayed);
+                wal.Truncate();
+            }
+
+            ASSERT_EQ(2, replayed.size());
+            EXPECT_EQ(200, replayed[0].timeSinceEpochInMillisecs);
+            EXPECT_EQ(201, replayed[1].timeSinceEpochInMillisecs);
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
 }// end of namespace unit_tests
\ No newline at end of file
@@ -0,0 +1,188 @@
+#include "stdafx.h"
+
+#ifndef _WIN32 // procfs is only available on Linux
+
+#include <3FD/runtime.h>
+#include <3FD/callstacktracer.h>
+#include <3FD/exceptions.h>
+#include "ProcFsCountersReader.h"
+#include <array>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace unit_tests
+{
+    using namespace _3fd;
+    using namespace _3fd::core;
+
+
+    void HandleException();
+
+
+    /// <summary>
+    /// Location of the fixture procfs trees, relative to the working directory.
+    /// Each subdirectory holds a snapshot of the files read by the procfs backend.
+    /// </summary>
+    static const char *procFsFixturesDir("procfs");
+
+    static const std::array<const char *, 4> procFsFileNames = { "stat", "meminfo", "diskstats", "loadavg" };
+
+    // Entries of the block devices in sysfs, which are listed in 'diskstats' along with their partitions:
+    static const std::array<const char *, 5> sysFsBlockDevices = { "loop0", "sda", "nvme0n1", "nvme0n10", "dm-0" };
+
+
+    /// <summary>
+    /// Creates a temporary procfs tree from fixtures, that can
+    /// be updated in place to simulate the passage of time.
+    /// Along with it, there is a sysfs tree with the block devices.
+    /// </summary>
+    class FixtureProcFsTree
+    {
+    private:
+
+        std::string m_rootDir;
+        std::string m_sysRootDir;
+
+    public:
+
+        FixtureProcFsTree()
+        {
+            char dirNameTemplate[] = "/tmp/msc_procfs_XXXXXX";
+
+            if (mkdtemp(dirNameTemplate) == nullptr)
+                throw std::runtime_error("Failed to create temporary directory for procfs fixture");
+
+            m_rootDir = dirNameTemplate;
+            m_sysRootDir = m_rootDir + "/sysfs";
+
+            mkdir(m_sysRootDir.c_str(), 0700);
+            mkdir((m_sysRootDir + "/block").c_str(), 0700);
+
+            for (auto devName : sysFsBlockDevices)
+                mkdir((m_sysRootDir + "/block/" + devName).c_str(), 0700);
+        }
+
+        ~FixtureProcFsTree()
+        {
+            for (auto fileName : procFsFileNames)
+                unlink((m_rootDir + '/' + fileName).c_str());
+
+            for (auto devName : sysFsBlockDevices)
+                rmdir((m_sysRootDir + "/block/" + devName).c_str());
+
+            rmdir((m_sysRootDir + "/block").c_str());
+            rmdir(m_sysRootDir.c_str());
+            rmdir(m_rootDir.c_str());
+        }
+
+        const char *GetRootDir() const { return m_rootDir.c_str(); }
+
+        const char *GetSysRootDir() const { return m_sysRootDir.c_str(); }
+
+        /* Overwrites the files with the content of a fixture snapshot. Truncating
+        the files keeps the same inodes, so the files held open by the reader see
+        the new content, just like it happens in the real procfs. */
+        void LoadSnapshot(const char *snapshotName)
+        {
+            for (auto fileName : procFsFileNames)
+            {
+                std::ostringstream oss;
+                oss << procFsFixturesDir << '/' << snapshotName << '/' << fileName;
+
+                std::ifstream input(oss.str(), std::ios::binary);
+                if (!input.is_open())
+                    throw std::runtime_error("Could not open fixture file " + oss.str());
+
+                std::ofstream output(m_rootDir + '/' + fileName, std::ios::binary | std::ios::trunc);
+                output << input.rdbuf();
+            }
+        }
+    };
+
+
+    /// <summary>
+    /// Tests the <see cref="application::ProcFsCountersReader"/> class
+    /// by reading a fixture procfs tree that changes between collections.
+    /// </summary>
+    TEST(TestCase_DataAccess, TestProcFsCountersReader)
+    {
+        FrameworkInstance _framework;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            using namespace application;
+
+            FixtureProcFsTree procFs;
+            procFs.LoadSnapshot("t0");
+
+            ProcFsCountersReader pcReader(procFs.GetRootDir(), procFs.GetSysRootDir());
+
+            procFs.LoadSnapshot("t1");
+
+            auto pcVals = pcReader.GetCurrentValues();
+
+            // 750 busy ticks out of 1500:
+            EXPECT_EQ(Quality::Good, pcVals.cpuTotalUsage.quality);
+            EXPECT_FLOAT_EQ(50.0F, pcVals.cpuTotalUsage.value);
+
+            // 2097152 kB:
+            EXPECT_EQ(Quality::Good, pcVals.memAvailableMBytes.quality);
+            EXPECT_FLOAT_EQ(2048.0F, pcVals.memAvailableMBytes.value);
+
+            /* Only whole disks count (sda, nvme0n1 & nvme0n10, which is not a partition of nvme0n1):
+            8192 sectors read and 8192 written. Because the elapsed time is not under control here,
+            check the proportion. */
+            EXPECT_EQ(Quality::Good, pcVals.diskReadBytesPerSec.quality);
+            EXPECT_EQ(Quality::Good, pcVals.diskWriteBytesPerSec.quality);
+            EXPECT_LT(0.0F, pcVals.diskReadBytesPerSec.value);
+            EXPECT_FLOAT_EQ(1.0F, pcVals.diskReadBytesPerSec.value / pcVals.diskWriteBytesPerSec.value);
+
+            // 1 process running and 1 blocked:
+            EXPECT_EQ(Quality::Good, pcVals.processCount.quality);
+            EXPECT_EQ(2, pcVals.processCount.value);
+
+            EXPECT_EQ(Quality::Good, pcVals.threadCount.quality);
+            EXPECT_EQ(871, pcVals.threadCount.value);
+
+            // Nothing changes in the next collection, so rates drop to zero:
+
+            pcVals = pcReader.GetCurrentValues();
+
+            EXPECT_EQ(Quality::Invalid, pcVals.cpuTotalUsage.quality);
+            EXPECT_EQ(Quality::Good, pcVals.diskReadBytesPerSec.quality);
+            EXPECT_EQ(0.0F, pcVals.diskReadBytesPerSec.value);
+            EXPECT_EQ(0.0F, pcVals.diskWriteBytesPerSec.value);
+            EXPECT_FLOAT_EQ(2048.0F, pcVals.memAvailableMBytes.value);
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+
+    /// <summary>
+    /// Tests whether <see cref="application::ProcFsCountersReader"/>
+    /// fails upon creation when the procfs tree is not available.
+    /// </summary>
+    TEST(TestCase_DataAccess, TestProcFsCountersReader_MissingTree)
+    {
+        FrameworkInstance _framework;
+
+        CALL_STACK_TRACE;
+
+        EXPECT_THROW(
+            application::ProcFsCountersReader pcReader("/nonexistent/procfs/tree"),
+            IAppException
+        );
+    }
+
+}// end of namespace unit_tests
+
+#endif // end of Linux only code
@@ -3,6 +3,22 @@
 #include <3FD\callstacktracer.h>
 #include <3FD\utils_io.h>
 #include "PerfCountersReader.h"
+#include "PerfCountersCatalog.h"
+#include "StatsAggregator.h"
+#include "AdaptiveSampler.h"
+#include "DeadbandFilter.h"
+#include "CollectionScheduler.h"
+#include "StatsForwarder.h"
+#include "SelfMonitor.h"
+#include "BinaryCodec.h"
+#include "GorillaCodec.h"
+#include "DeflateCodec.h"
+#include <thread>
+#include <array>
+#include <map>
+#include <random>
+#include <cmath>
+#include <iostream>
 
 #define format utils::FormatArg
 
@@ -31,11 +47,23 @@ namespace unit_tests
 
             PerfCountersReader pcReader;
 
+            // Wildcards in configuration are expanded in the catalog:
+            auto &catalog = pcReader.GetCatalog();
+            EXPECT_GT(catalog.size(), numSupPerfCounters);
+
+            SamplesBatch batch;
+
             for (int idx = 0; idx < 2; ++idx)
-            {
-                auto pcVals = pcReader.GetCurrentValues();
+                pcReader.GetCurrentValues(batch);
+
+            ASSERT_EQ(2, batch.GetSampleCount());
+            ASSERT_EQ(catalog.size(), batch.GetCounterCount());
+            EXPECT_EQ(catalog.size() * 2, batch.values.size());
+            EXPECT_EQ(catalog.size() * 2, batch.qualities.size());
 
-                auto timeSinceEpochInMillisecs = duration_cast<milliseconds>(pcVals.time - system_clock().from_time_t(0)).count();
+            for (size_t row = 0; row < batch.GetSampleCount(); ++row)
+            {
+                auto timeSinceEpochInMillisecs = duration_cast<milliseconds>(batch.times[row] - system_clock().from_time_t(0)).count();
                 time_t timeSinceEpochInSecs = timeSinceEpochInMillisecs / 1000;
 
                 std::array<char, 21> timestamp;
@@ -45,36 +73,1073 @@ namespace unit_tests
 
                 utils::SerializeTo<char>(stdout, "\nStats at ", timestamp.data(), " + ", remainingMillisecs, " ms\n");
 
-                utils::SerializeTo<char>(stdout,
-                    format(ToStatName(PerfCounterCode::CpuUsage)).width(24),
-                    ": value = ", pcVals.cpuTotalUsage.value,
-                    " / quality = ", static_cast<int8_t> (pcVals.cpuTotalUsage.quality), '\n');
-
-                utils::SerializeTo<char>(stdout,
-                    format(ToStatName(PerfCounterCode::MemAvailable)).width(24),
-                    ": value = ", pcVals.memAvailableMBytes.value,
-                    " / quality = ", static_cast<int8_t> (pcVals.memAvailableMBytes.quality), '\n');
-
-                utils::SerializeTo<char>(stdout,
-                    format(ToStatName(PerfCounterCode::DiskRead)).width(24),
-                    ": value = ", pcVals.diskReadBytesPerSec.value,
-                    " / quality = ", static_cast<int8_t> (pcVals.diskReadBytesPerSec.quality), '\n');
-
-                utils::SerializeTo<char>(stdout,
-                    format(ToStatName(PerfCounterCode::DiskWrite)).width(24),
-                    ": value = ", pcVals.diskWriteBytesPerSec.value,
-                    " / quality = ", static_cast<int8_t> (pcVals.diskWriteBytesPerSec.quality), '\n');
-
-                utils::SerializeTo<char>(stdout,
-                    format(ToStatName(PerfCounterCode::ProcessCount)).width(24),
-                    ": value = ", pcVals.processCount.value,
-                    " / quality = ", static_cast<int8_t> (pcVals.processCount.quality), '\n');
-
-                utils::SerializeTo<char>(stdout,
-                    format(ToStatName(PerfCounterCode::ThreadCount)).width(24),
-                    ": value = ", pcVals.threadCount.value,
-                    " / quality = ", static_cast<int8_t> (pcVals.threadCount.quality), '\n');
+                auto values = batch.GetValues(row);
+                auto qualities = batch.GetQualities(row);
+
+                for (size_t col = 0; col < batch.GetCounterCount(); ++col)
+                {
+                    utils::SerializeTo<char>(stdout,
+                        format(catalog[batch.counterIds[col]].statName).width(40),
+                        ": value = ", values[col],
+                        " / quality = ", static_cast<int8_t> (qualities[col]), '\n');
+                }
+            }
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+
+    /// <summary>
+    /// Tests the parsing of the catalog of performance counters.
+    /// </summary>
+    TEST(TestCase_DataAccess, TestPerfCountersCatalog)
+    {
+        FrameworkInstance _framework;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            using namespace application;
+
+            PerfCounterDescriptor descriptor;
+            EXPECT_TRUE(ParsePerfCounterDescriptor("nic_sent_bps;float;\\Network Interface(*)\\Bytes Sent/sec", descriptor));
+            EXPECT_EQ(L"nic_sent_bps", descriptor.statName);
+            EXPECT_EQ(L"\\Network Interface(*)\\Bytes Sent/sec", descriptor.path);
+            EXPECT_EQ(StatValueType::Float32, descriptor.valueType);
+
+            EXPECT_TRUE(ParsePerfCounterDescriptor("handle_count;int;\\Process(_Total)\\Handle Count", descriptor));
+            EXPECT_EQ(StatValueType::Int32, descriptor.valueType);
+
+            EXPECT_FALSE(ParsePerfCounterDescriptor("", descriptor));
+            EXPECT_FALSE(ParsePerfCounterDescriptor(";float;\\Memory\\Available MBytes", descriptor));
+            EXPECT_FALSE(ParsePerfCounterDescriptor("memory;double;\\Memory\\Available MBytes", descriptor));
+            EXPECT_FALSE(ParsePerfCounterDescriptor("memory;float;Memory\\Available MBytes", descriptor));
+            EXPECT_FALSE(ParsePerfCounterDescriptor("memory;float", descriptor));
+
+            EXPECT_EQ(L"cpu_core_usage_percentage_0", MakeInstanceStatName(L"cpu_core_usage_percentage", L"0"));
+            EXPECT_EQ(L"nic_sent_bps_intel_r__ethernet", MakeInstanceStatName(L"nic_sent_bps", L"Intel(R) Ethernet"));
+
+            // the built-in counters come first, then the ones in configuration:
+            auto catalog = LoadPerfCountersCatalog();
+            ASSERT_EQ(numSupPerfCounters + 2, catalog.size());
+
+            for (uint32_t idx = 0; idx < numSupPerfCounters; ++idx)
+                EXPECT_EQ(ToStatName(static_cast<PerfCounterCode> (idx)), catalog[idx].statName);
+
+            EXPECT_EQ(L"cpu_core_usage_percentage", catalog[numSupPerfCounters].statName);
+            EXPECT_EQ(L"cpu_core_usage_percentage_p95",
+                catalog[numSupPerfCounters].aggregateStatNames[static_cast<uint32_t> (AggregateCode::Percentile95)]);
+            EXPECT_EQ(L"\\Processor(*)\\% Processor Time", catalog[numSupPerfCounters].path);
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+
+    /// <summary>
+    /// Tests the <see cref="application::StatsAggregator"/> class.
+    /// </summary>
+    TEST(TestCase_DataAccess, TestStatsAggregator)
+    {
+        FrameworkInstance _framework;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            using namespace application;
+
+            const size_t capacity(20);
+            StatsAggregator aggregator(capacity);
+
+            auto cpuUsage = static_cast<uint32_t> (PerfCounterCode::CpuUsage);
+            auto memAvailable = static_cast<uint32_t> (PerfCounterCode::MemAvailable);
+            auto threadCount = static_cast<uint32_t> (PerfCounterCode::ThreadCount);
+
+            SamplesBatch batch;
+            SetBuiltInCounterIds(batch);
+
+            /* Fill the ring buffer beyond its capacity, so the oldest samples (with
+            huge values) are overwritten, and the remaining ones go from 1 to 20: */
+            for (int idx = -5; idx <= static_cast<int> (capacity); ++idx)
+            {
+                batch.Clear();
+                batch.AddSample(std::chrono::system_clock().now());
+
+                auto values = batch.GetValues(0);
+                auto qualities = batch.GetQualities(0);
+                std::fill(qualities, qualities + numSupPerfCounters, Quality::Good);
+
+                values[cpuUsage] = (idx > 0 ? idx : 1000);
+                values[threadCount] = (idx > 0 ? idx : 1000);
+
+                // samples of bad quality do not count in the aggregates:
+                qualities[threadCount] = (idx % 2 == 0) ? Quality::Good : Quality::Invalid;
+                qualities[memAvailable] = Quality::Error;
+
+                aggregator.AddSample(batch, 0);
+            }
+
+            EXPECT_EQ(capacity, aggregator.GetCount());
+
+            SamplesAggregates aggregates;
+            aggregator.Summarize(aggregates);
+
+            EXPECT_EQ(0, aggregator.GetCount());
+            EXPECT_EQ(capacity, aggregates.sampleCount);
+            EXPECT_EQ(batch.counterIds, aggregates.counterIds);
+            ASSERT_EQ(numSupPerfCounters * numSupAggregates, aggregates.values.size());
+
+            auto cpuUsageAggs = aggregates.GetValues(cpuUsage);
+            EXPECT_EQ(Quality::Good, aggregates.qualities[cpuUsage]);
+            EXPECT_EQ(1.0F, cpuUsageAggs[static_cast<uint32_t> (AggregateCode::Min)]);
+            EXPECT_EQ(20.0F, cpuUsageAggs[static_cast<uint32_t> (AggregateCode::Max)]);
+            EXPECT_FLOAT_EQ(10.5F, cpuUsageAggs[static_cast<uint32_t> (AggregateCode::Mean)]);
+            EXPECT_EQ(19.0F, cpuUsageAggs[static_cast<uint32_t> (AggregateCode::Percentile95)]);
+
+            // only the even values from 2 to 20:
+            auto threadCountAggs = aggregates.GetValues(threadCount);
+            EXPECT_EQ(Quality::Good, aggregates.qualities[threadCount]);
+            EXPECT_EQ(2.0F, threadCountAggs[static_cast<uint32_t> (AggregateCode::Min)]);
+            EXPECT_EQ(20.0F, threadCountAggs[static_cast<uint32_t> (AggregateCode::Max)]);
+            EXPECT_FLOAT_EQ(11.0F, threadCountAggs[static_cast<uint32_t> (AggregateCode::Mean)]);
+            EXPECT_EQ(20.0F, threadCountAggs[static_cast<uint32_t> (AggregateCode::Percentile95)]);
+
+            // no good samples at all:
+            EXPECT_EQ(Quality::Error, aggregates.qualities[memAvailable]);
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+
+    /// <summary>
+    /// Tests the <see cref="application::AdaptiveSampler"/> class.
+    /// </summary>
+    TEST(TestCase_DataAccess, TestAdaptiveSampler)
+    {
+        FrameworkInstance _framework;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            using namespace std::chrono;
+            using namespace application;
+
+            auto cpuUsage = static_cast<uint32_t> (PerfCounterCode::CpuUsage);
+
+            SamplesBatch batch;
+            SetBuiltInCounterIds(batch);
+
+            // a trigger on a counter that is not sampled is refused upfront:
+            EXPECT_THROW(
+                AdaptiveSampler(
+                    std::vector<BurstTrigger>{ BurstTrigger{ numSupPerfCounters, 10.0 } },
+                    batch.counterIds,
+                    milliseconds(1000), milliseconds(100), milliseconds(500), 3, 100
+                ),
+                IAppException
+            );
+
+            // burst when CPU usage changes 10 points per second, keeping 3 samples before the trigger:
+            AdaptiveSampler sampler(
+                std::vector<BurstTrigger>{ BurstTrigger{ cpuUsage, 10.0 } },
+                batch.counterIds,
+                milliseconds(1000), milliseconds(100), milliseconds(500), 3, 100
+            );
+
+            auto addSample = [&sampler, &batch, cpuUsage](int64_t timeMillisecs, double value)
+            {
+                batch.Clear();
+                auto row = batch.AddSample(system_clock().from_time_t(0) + milliseconds(timeMillisecs));
+                auto qualities = batch.GetQualities(row);
+                std::fill(qualities, qualities + numSupPerfCounters, Quality::Good);
+                batch.GetValues(row)[cpuUsage] = value;
+                return sampler.AddSample(batch, row).count();
+            };
+
+            // flat values do not change the interval:
+            for (int64_t time = 0; time < 5000; time += 1000)
+                EXPECT_EQ(1000, addSample(time, 5.0));
+
+            EXPECT_FALSE(sampler.IsBursting());
+            EXPECT_EQ(0, sampler.GetBurstSamples().GetSampleCount());
+
+            // a change of 50 points in 1 second triggers the burst:
+            EXPECT_EQ(100, addSample(5000, 55.0));
+            EXPECT_TRUE(sampler.IsBursting());
+            ASSERT_EQ(4, sampler.GetBurstSamples().GetSampleCount());
+            EXPECT_EQ(system_clock().from_time_t(0) + milliseconds(2000), sampler.GetBurstSamples().times[0]);
+
+            // the burst interval is held for a while after the trigger:
+            EXPECT_EQ(100, addSample(5100, 55.0));
+            EXPECT_EQ(100, addSample(5200, 55.0));
+            EXPECT_EQ(100, addSample(5300, 55.0));
+            EXPECT_EQ(100, addSample(5400, 55.0));
+
+            // then it backs off to the base interval:
+            EXPECT_EQ(200, addSample(5500, 55.0));
+            EXPECT_EQ(400, addSample(5700, 55.0));
+            EXPECT_EQ(800, addSample(6100, 55.0));
+            EXPECT_TRUE(sampler.IsBursting());
+            EXPECT_EQ(1000, addSample(6900, 55.0));
+            EXPECT_FALSE(sampler.IsBursting());
+
+            EXPECT_EQ(11, sampler.GetBurstSamples().GetSampleCount());
+
+            // samples of bad quality do not trigger:
+            batch.Clear();
+            auto row = batch.AddSample(system_clock().from_time_t(0) + milliseconds(7900));
+            batch.GetValues(row)[cpuUsage] = 99.0;
+            batch.GetQualities(row)[cpuUsage] = Quality::Invalid;
+            EXPECT_EQ(1000, sampler.AddSample(batch, row).count());
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+    /// <summary>
+    /// Tests the <see cref="application::DeadbandFilter"/> class.
+    /// </summary>
+    TEST(TestCase_DataAccess, TestDeadbandFilter)
+    {
+        FrameworkInstance _framework;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            using namespace application;
+
+            auto cpuUsage = static_cast<uint32_t> (PerfCounterCode::CpuUsage);
+            auto memAvailable = static_cast<uint32_t> (PerfCounterCode::MemAvailable);
+            auto processCount = static_cast<uint32_t> (PerfCounterCode::ProcessCount);
+
+            // a heartbeat every 4 samples, and no deadband for CPU usage:
+            DeadbandFilter filter(
+                std::vector<Deadband>{
+                    Deadband{ processCount, 2.0, 0.0 },
+                    Deadband{ memAvailable, 0.0, 0.1 }
+                },
+                4
+            );
+
+            SamplesBatch batch;
+            SetBuiltInCounterIds(batch);
+
+            auto filterSample = [&filter, &batch, cpuUsage, memAvailable, processCount]
+                (double memValue, Quality memQuality, double processValue, const SamplesAggregates *aggregates)
+            {
+                batch.Clear();
+                auto row = batch.AddSample(std::chrono::system_clock().now());
+                auto values = batch.GetValues(row);
+                auto qualities = batch.GetQualities(row);
+                std::fill(qualities, qualities + numSupPerfCounters, Quality::Good);
+                values[cpuUsage] = 5.0;
+                values[memAvailable] = memValue;
+                qualities[memAvailable] = memQuality;
+                values[processCount] = processValue;
+                return filter.Filter(batch, row, aggregates);
+            };
+
+            // the first sample is a heartbeat:
+            auto sendMask = filterSample(1000.0, Quality::Good, 100.0, nullptr);
+            EXPECT_EQ(0, filter.GetOmittedCount());
+
+            // within the deadbands:
+            sendMask = filterSample(1050.0, Quality::Good, 101.0, nullptr);
+            EXPECT_EQ(2, filter.GetOmittedCount());
+            EXPECT_EQ(1, sendMask[cpuUsage]);
+            EXPECT_EQ(0, sendMask[memAvailable]);
+            EXPECT_EQ(0, sendMask[processCount]);
+
+            // compared to the value last sent (100), not to the last sample (101):
+            sendMask = filterSample(1090.0, Quality::Good, 103.0, nullptr);
+            EXPECT_EQ(1, filter.GetOmittedCount());
+            EXPECT_EQ(0, sendMask[memAvailable]);
+            EXPECT_EQ(1, sendMask[processCount]);
+
+            // a change of quality is always sent:
+            sendMask = filterSample(1090.0, Quality::Invalid, 103.0, nullptr);
+            EXPECT_EQ(1, filter.GetOmittedCount());
+            EXPECT_EQ(1, sendMask[memAvailable]);
+            EXPECT_EQ(0, sendMask[processCount]);
+
+            // heartbeat:
+            sendMask = filterSample(1090.0, Quality::Good, 103.0, nullptr);
+            EXPECT_EQ(0, filter.GetOmittedCount());
+
+            // the aggregates reveal a spike out of the deadband, despite the last value:
+            SamplesAggregates aggregates;
+            aggregates.sampleCount = 10;
+            aggregates.counterIds = batch.counterIds;
+            aggregates.values.assign(numSupPerfCounters * numSupAggregates, 0.0F);
+            aggregates.qualities.assign(numSupPerfCounters, Quality::Good);
+            aggregates.values[processCount * numSupAggregates + static_cast<uint32_t> (AggregateCode::Min)] = 103.0F;
+            aggregates.values[processCount * numSupAggregates + static_cast<uint32_t> (AggregateCode::Max)] = 110.0F;
+            aggregates.values[memAvailable * numSupAggregates + static_cast<uint32_t> (AggregateCode::Min)] = 1080.0F;
+            aggregates.values[memAvailable * numSupAggregates + static_cast<uint32_t> (AggregateCode::Max)] = 1100.0F;
+
+            sendMask = filterSample(1090.0, Quality::Good, 103.0, &aggregates);
+            EXPECT_EQ(1, filter.GetOmittedCount());
+            EXPECT_EQ(0, sendMask[memAvailable]);
+            EXPECT_EQ(1, sendMask[processCount]);
+
+            // after a failure to send, the next sample is a heartbeat:
+            filter.ForceHeartbeat();
+            filterSample(1090.0, Quality::Good, 103.0, nullptr);
+            EXPECT_EQ(0, filter.GetOmittedCount());
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+    /// <summary>
+    /// Tests the <see cref="application::CollectionScheduler"/> class.
+    /// </summary>
+    TEST(TestCase_DataAccess, TestCollectionScheduler)
+    {
+        FrameworkInstance _framework;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            using namespace std::chrono;
+            using namespace application;
+
+            const milliseconds cycleTime(60000);
+
+            // the phase is deterministic, regardless of case:
+            auto phase = CollectionScheduler::CalculatePhase(L"HAL9000", cycleTime);
+            EXPECT_EQ(phase, CollectionScheduler::CalculatePhase(L"hal9000", cycleTime));
+            EXPECT_LT(phase, cycleTime);
+
+            // the phases of a fleet spread evenly across the cycle:
+            const int numMachines(1000), numSlots(10);
+            std::array<int, numSlots> machinesPerSlot = {};
+            for (int idx = 0; idx < numMachines; ++idx)
+            {
+                auto machinePhase = CollectionScheduler::CalculatePhase(L"PC" + std::to_wstring(idx), cycleTime);
+                ++machinesPerSlot[machinePhase * numSlots / cycleTime];
+            }
+
+            for (auto count : machinesPerSlot)
+            {
+                EXPECT_GT(count, numMachines / numSlots / 2);
+                EXPECT_LT(count, numMachines / numSlots * 2);
+            }
+
+            // the first deadline is when the wall clock is at the phase within a cycle:
+            const auto steadyNow = steady_clock::now();
+            const auto epoch = system_clock().from_time_t(0);
+
+            CollectionScheduler scheduler1(cycleTime, milliseconds(15000), epoch + milliseconds(130000), steadyNow);
+            EXPECT_EQ(steadyNow + milliseconds(5000), scheduler1.GetNextDeadline());
+
+            CollectionScheduler scheduler2(cycleTime, milliseconds(15000), epoch + milliseconds(140000), steadyNow);
+            EXPECT_EQ(steadyNow + milliseconds(55000), scheduler2.GetNextDeadline());
+
+            // the deadlines are absolute, so the time spent in a cycle does not make them drift:
+            auto deadline = scheduler1.GetNextDeadline();
+            EXPECT_EQ(deadline + cycleTime, scheduler1.Advance(deadline + milliseconds(1)));
+            EXPECT_EQ(deadline + cycleTime * 2, scheduler1.Advance(deadline + cycleTime + milliseconds(999)));
+            EXPECT_EQ(0, scheduler1.GetSkippedCount());
+
+            // when a cycle overruns, the deadlines gone are skipped:
+            deadline = scheduler1.GetNextDeadline();
+            EXPECT_EQ(deadline + cycleTime * 3, scheduler1.Advance(deadline + milliseconds(150000)));
+            EXPECT_EQ(2, scheduler1.GetSkippedCount());
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+    /// <summary>
+    /// Tests the <see cref="application::StatsForwarder"/> class,
+    /// with <see cref="application::LoopbackTransport"/> in place of the network.
+    /// </summary>
+    TEST(TestCase_DataAccess, TestStatsForwarder)
+    {
+        FrameworkInstance _framework;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            using namespace std::chrono;
+            using namespace application;
+
+            auto catalog = GetBuiltInPerfCountersCatalog();
+            auto cpuUsage = static_cast<uint32_t> (PerfCounterCode::CpuUsage);
+
+            SamplesBatch batch;
+            SetBuiltInCounterIds(batch);
+
+            // only CPU usage is sent when this mask is used:
+            std::vector<uint8_t> cpuOnlyMask(numSupPerfCounters, 0);
+            cpuOnlyMask[cpuUsage] = 1;
+
+            // collects the stats of a cycle and pushes them, returning how long the push took:
+            auto collectCycle = [&batch, cpuUsage](StatsForwarder &forwarder, double cpuValue, const std::vector<uint8_t> &sendMask)
+            {
+                batch.Clear();
+                auto row = batch.AddSample(system_clock().now());
+                std::fill(batch.GetValues(row), batch.GetValues(row) + numSupPerfCounters, 1.0);
+                std::fill(batch.GetQualities(row), batch.GetQualities(row) + numSupPerfCounters, Quality::Good);
+                batch.GetValues(row)[cpuUsage] = cpuValue;
+
+                auto startTime = steady_clock::now();
+
+                auto item = forwarder.BeginPush();
+                if (item != nullptr)
+                {
+                    item->sample.Clear();
+                    item->sample.counterIds = batch.counterIds;
+                    item->sample.AddSampleFrom(batch, row);
+                    item->aggregates.counterIds.clear();
+                    item->sendMask = sendMask;
+                    item->burst.Clear();
+                    forwarder.EndPush();
+                }
+
+                return steady_clock::now() - startTime;
+            };
+
+            const int numCycles(20);
+            const milliseconds cycleTime(10);
+
+            // A server 10 times slower than the cycle does not delay the collection:
+            {
+                LoopbackTransport transport(catalog, L"HAL9000", cycleTime * 10);
+                StatsForwarder forwarder(transport, numCycles, 8);
+
+                auto startTime = steady_clock::now();
+                auto deadline = startTime;
+
+                for (int idx = 0; idx < numCycles; ++idx)
+                {
+                    deadline += cycleTime;
+                    std::this_thread::sleep_until(deadline);
+                    auto pushTime = collectCycle(forwarder, idx, (idx % 2 == 0) ? std::vector<uint8_t>() : cpuOnlyMask);
+                    EXPECT_LT(pushTime, cycleTime);
+                }
+
+                EXPECT_LT(steady_clock::now() - startTime, cycleTime * (numCycles + 5));
+
+                forwarder.Stop(); // sends what is left in the queue
+                EXPECT_EQ(0, forwarder.GetDroppedCount());
+                EXPECT_FALSE(forwarder.TakeFailure());
+
+                // the cycles queued up while the server was busy went in batch:
+                EXPECT_LT(transport.GetRequestCount(), static_cast<size_t> (numCycles));
+
+                auto packages = transport.TakePackages();
+                ASSERT_EQ(static_cast<size_t> (numCycles), packages.size());
+
+                for (int idx = 0; idx < numCycles; ++idx)
+                {
+                    auto &package = packages[idx];
+                    EXPECT_EQ(L"HAL9000", package.machine.GetName());
+
+                    auto statCount = package.statSamplesFloat32.size() + package.statSamplesInt32.size();
+                    EXPECT_EQ((idx % 2 == 0) ? numSupPerfCounters : 1, statCount);
+
+                    auto iter = std::find_if(package.statSamplesFloat32.begin(),
+                                             package.statSamplesFloat32.end(),
+                                             [&catalog, cpuUsage](const StatSampleValue<float> &stat)
+                                             {
+                                                 return stat.statName.GetName() == catalog[cpuUsage].statName;
+                                             });
+
+                    ASSERT_TRUE(package.statSamplesFloat32.end() != iter);
+                    EXPECT_EQ(static_cast<float> (idx), iter->value);
+                }
             }
+
+            // When the server fails, the failure is reported, and a full queue drops cycles:
+            {
+                LoopbackTransport transport(catalog, L"HAL9000", cycleTime * 10);
+                transport.SetFailing(true);
+                StatsForwarder forwarder(transport, 2, 8);
+
+                for (int idx = 0; idx < numCycles; ++idx)
+                    collectCycle(forwarder, idx, cpuOnlyMask);
+
+                forwarder.Stop();
+                EXPECT_GT(forwarder.GetDroppedCount(), 0U);
+                EXPECT_TRUE(forwarder.TakeFailure());
+                EXPECT_FALSE(forwarder.TakeFailure());
+                EXPECT_EQ(0, transport.GetRequestCount());
+                EXPECT_TRUE(transport.TakePackages().empty());
+            }
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+    /// <summary>
+    /// Tests the <see cref="application::SelfMonitor"/> class.
+    /// </summary>
+    TEST(TestCase_DataAccess, TestSelfMonitor)
+    {
+        FrameworkInstance _framework;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            using namespace std::chrono;
+            using namespace application;
+
+            EXPECT_EQ(std::wstring(L"mscclient_spool_depth"), ToStatName(SelfMetricCode::SpoolDepth));
+
+            auto metricOf = [](const std::array<ValueWithQuality<float>, numSelfMetrics> &metrics, SelfMetricCode code)
+            {
+                return metrics[static_cast<uint32_t> (code)];
+            };
+
+            SelfMonitor selfMonitor;
+            std::array<ValueWithQuality<float>, numSelfMetrics> metrics;
+
+            // before anything is recorded, only the metrics of the process are known:
+            selfMonitor.TakeSnapshot(metrics);
+            EXPECT_EQ(Quality::Unknown, metricOf(metrics, SelfMetricCode::CollectMillisecs).quality);
+            EXPECT_EQ(Quality::Unknown, metricOf(metrics, SelfMetricCode::SendMillisecs).quality);
+            EXPECT_EQ(Quality::Unknown, metricOf(metrics, SelfMetricCode::SpoolDepth).quality);
+            EXPECT_EQ(Quality::Good, metricOf(metrics, SelfMetricCode::ResidentMemory).quality);
+            EXPECT_GT(metricOf(metrics, SelfMetricCode::ResidentMemory).value, 0.0F);
+
+            // the longest collection since the last snapshot is reported:
+            selfMonitor.RecordCollect(milliseconds(5));
+            selfMonitor.RecordCollect(milliseconds(12));
+            selfMonitor.RecordCollect(milliseconds(3));
+            selfMonitor.RecordSend(milliseconds(40));
+            selfMonitor.RecordSpoolDepth(7);
+
+            // burn some CPU, so its usage is measured:
+            auto startTime = steady_clock::now();
+            volatile double sink(0.0);
+            while (steady_clock::now() - startTime < milliseconds(50))
+                sink = sink + 1.0;
+
+            selfMonitor.TakeSnapshot(metrics);
+            EXPECT_EQ(Quality::Good, metricOf(metrics, SelfMetricCode::CollectMillisecs).quality);
+            EXPECT_EQ(12.0F, metricOf(metrics, SelfMetricCode::CollectMillisecs).value);
+            EXPECT_EQ(40.0F, metricOf(metrics, SelfMetricCode::SendMillisecs).value);
+            EXPECT_EQ(7.0F, metricOf(metrics, SelfMetricCode::SpoolDepth).value);
+            EXPECT_EQ(Quality::Good, metricOf(metrics, SelfMetricCode::CpuUsage).quality);
+            EXPECT_GT(metricOf(metrics, SelfMetricCode::CpuUsage).value, 10.0F);
+
+            // the collections are not carried over to the next snapshot, but the last request is:
+            selfMonitor.TakeSnapshot(metrics);
+            EXPECT_EQ(Quality::Unknown, metricOf(metrics, SelfMetricCode::CollectMillisecs).quality);
+            EXPECT_EQ(40.0F, metricOf(metrics, SelfMetricCode::SendMillisecs).value);
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+    /// <summary>
+    /// Tests the binary encoding of stats, by <see cref="application::BinaryStatsEncoder"/>
+    /// and <see cref="application::DecodeStats"/>, with stats identified by name, then by ID.
+    /// </summary>
+    TEST(TestCase_DataAccess, TestBinaryCodec)
+    {
+        FrameworkInstance _framework;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            using namespace std::chrono;
+            using namespace application;
+
+            auto catalog = GetBuiltInPerfCountersCatalog();
+            const std::wstring machine(L"HAL9000"), authKey(L"Entschuldigung");
+
+            auto fillSample = [](SamplesBatch &batch, system_clock::time_point time, double offset)
+            {
+                auto row = batch.AddSample(time);
+                for (size_t idx = 0; idx < batch.GetCounterCount(); ++idx)
+                {
+                    batch.GetValues(row)[idx] = offset + idx * 1.5;
+                    batch.GetQualities(row)[idx] = static_cast<Quality> ((idx % 4) * 4);
+                }
+            };
+
+            // a cycle with aggregates, a mask, the metrics of the client and a burst:
+            CollectedStats first;
+            SetBuiltInCounterIds(first.sample);
+            fillSample(first.sample, system_clock().now(), 10.0);
+
+            first.aggregates.sampleCount = 3;
+            first.aggregates.counterIds = first.sample.counterIds;
+            first.aggregates.values.resize(numSupPerfCounters * numSupAggregates, 0.25F);
+            first.aggregates.qualities.resize(numSupPerfCounters, Quality::Invalid);
+
+            first.sendMask.resize(numSupPerfCounters, 1);
+            first.sendMask[static_cast<uint32_t> (PerfCounterCode::DiskRead)] = 0;
+
+            for (uint32_t idx = 0; idx < numSelfMetrics; ++idx)
+                first.selfMetrics[idx] = ValueWithQuality<float>{ idx * 2.0F, Quality::Good };
+
+            first.hasSelfMetrics = true;
+
+            first.burst.counterIds = first.sample.counterIds;
+            for (int idx = 0; idx < 3; ++idx)
+                fillSample(first.burst, first.sample.times[0] - milliseconds(200 * idx), idx);
+
+            // a plain cycle, a second later:
+            CollectedStats second;
+            SetBuiltInCounterIds(second.sample);
+            fillSample(second.sample, first.sample.times[0] + seconds(1), -7.0);
+
+            std::vector<const CollectedStats *> items = { &first, &second };
+
+            // The decoded packages must be the same the server gets from a SOAP request:
+            LoopbackTransport loopback(catalog, machine, milliseconds(0));
+            loopback.Send(items);
+            auto expectedPackages = loopback.TakePackages();
+
+            BinaryStatsEncoder encoder(machine, authKey);
+            auto frame = encoder.Encode(catalog, items);
+
+            std::wstring decodedKey;
+            uint64_t sessionId;
+            std::vector<StatsPackage> packages;
+            ASSERT_TRUE(DecodeStats(frame.data(), frame.size(), decodedKey, sessionId, packages));
+            EXPECT_EQ(authKey, decodedKey);
+            EXPECT_EQ(0, sessionId);
+            ASSERT_EQ(expectedPackages.size(), packages.size());
+
+            for (size_t idx = 0; idx < packages.size(); ++idx)
+            {
+                auto &expected = expectedPackages[idx];
+                auto &actual = packages[idx];
+
+                EXPECT_EQ(expected.timeSinceEpochInMillisecs, actual.timeSinceEpochInMillisecs);
+                EXPECT_EQ(expected.machine, actual.machine);
+                ASSERT_EQ(expected.statSamplesFloat32.size(), actual.statSamplesFloat32.size());
+                ASSERT_EQ(expected.statSamplesInt32.size(), actual.statSamplesInt32.size());
+
+                for (size_t statIdx = 0; statIdx < actual.statSamplesFloat32.size(); ++statIdx)
+                {
+                    EXPECT_EQ(expected.statSamplesFloat32[statIdx].statName, actual.statSamplesFloat32[statIdx].statName);
+                    EXPECT_EQ(expected.statSamplesFloat32[statIdx].value, actual.statSamplesFloat32[statIdx].value);
+                    EXPECT_EQ(expected.statSamplesFloat32[statIdx].quality, actual.statSamplesFloat32[statIdx].quality);
+                }
+
+                for (size_t statIdx = 0; statIdx < actual.statSamplesInt32.size(); ++statIdx)
+                {
+                    EXPECT_EQ(expected.statSamplesInt32[statIdx].statName, actual.statSamplesInt32[statIdx].statName);
+                    EXPECT_EQ(expected.statSamplesInt32[statIdx].value, actual.statSamplesInt32[statIdx].value);
+                    EXPECT_EQ(expected.statSamplesInt32[statIdx].quality, actual.statSamplesInt32[statIdx].quality);
+                }
+            }
+
+            // A truncated or corrupted frame is rejected, leaving the packages untouched:
+            for (size_t size = 0; size < frame.size(); ++size)
+            {
+                EXPECT_FALSE(DecodeStats(frame.data(), size, decodedKey, sessionId, packages));
+                EXPECT_EQ(expectedPackages.size(), packages.size());
+            }
+
+            auto corrupted = frame;
+            corrupted[0] = 'X';
+            EXPECT_FALSE(DecodeStats(corrupted.data(), corrupted.size(), decodedKey, sessionId, packages));
+
+            corrupted = frame;
+            corrupted.push_back(0);
+            EXPECT_FALSE(DecodeStats(corrupted.data(), corrupted.size(), decodedKey, sessionId, packages));
+            EXPECT_EQ(expectedPackages.size(), packages.size());
+
+            // So is a frame from a machine whose name was never interned (thus without credential):
+            BinaryStatsEncoder strangerEncoder(L"UnknownMachine", authKey);
+            auto strangerFrame = strangerEncoder.Encode(catalog, items);
+            EXPECT_FALSE(DecodeStats(strangerFrame.data(), strangerFrame.size(), decodedKey, sessionId, packages));
+            EXPECT_TRUE(InternedName::Find(L"UnknownMachine").IsEmpty());
+            EXPECT_EQ(expectedPackages.size(), packages.size());
+
+            // Open a session, in which the server assigns IDs to the stat names:
+            auto openSessionFrame = encoder.EncodeOpenSession(catalog);
+
+            std::wstring decodedMachine;
+            std::vector<std::wstring> statNames;
+            ASSERT_TRUE(DecodeOpenSession(openSessionFrame.data(), openSessionFrame.size(), decodedMachine, decodedKey, statNames));
+            EXPECT_EQ(machine, decodedMachine);
+            EXPECT_EQ(authKey, decodedKey);
+            EXPECT_FALSE(DecodeStats(openSessionFrame.data(), openSessionFrame.size(), decodedKey, sessionId, packages));
+
+            std::map<int16_t, std::wstring> namesById;
+            std::vector<int16_t> statIds;
+            for (auto &name : statNames)
+            {
+                statIds.push_back(static_cast<int16_t> (1000 + statIds.size()));
+                namesById[statIds.back()] = name;
+            }
+
+            const uint64_t expectedSessionId(0x0123456789ABCDEFULL);
+            std::vector<uint8_t> sessionOpenedFrame;
+            EncodeSessionOpened(expectedSessionId, statIds, sessionOpenedFrame);
+
+            std::vector<int16_t> decodedIds;
+            ASSERT_TRUE(DecodeSessionOpened(sessionOpenedFrame.data(), sessionOpenedFrame.size(), sessionId, decodedIds));
+            EXPECT_EQ(expectedSessionId, sessionId);
+            EXPECT_EQ(statIds, decodedIds);
+
+            EXPECT_FALSE(encoder.SetSession(sessionId, std::vector<int16_t>(decodedIds.begin() + 1, decodedIds.end())));
+            ASSERT_TRUE(encoder.SetSession(sessionId, std::move(decodedIds)));
+
+            // Within the session, the stats go by ID, in a smaller frame:
+            auto frameById = encoder.Encode(catalog, items);
+            EXPECT_LT(frameById.size(), frame.size());
+
+            packages.clear();
+            ASSERT_TRUE(DecodeStats(frameById.data(), frameById.size(), decodedKey, sessionId, packages));
+            EXPECT_EQ(expectedSessionId, sessionId);
+            EXPECT_TRUE(decodedKey.empty());
+            ASSERT_EQ(expectedPackages.size(), packages.size());
+
+            for (size_t idx = 0; idx < packages.size(); ++idx)
+            {
+                auto &expected = expectedPackages[idx];
+                auto &actual = packages[idx];
+
+                EXPECT_EQ(expected.timeSinceEpochInMillisecs, actual.timeSinceEpochInMillisecs);
+                EXPECT_TRUE(actual.machine.IsEmpty());
+                ASSERT_EQ(expected.statSamplesFloat32.size(), actual.statSamplesFloat32.size());
+                ASSERT_EQ(expected.statSamplesInt32.size(), actual.statSamplesInt32.size());
+
+                for (size_t statIdx = 0; statIdx < actual.statSamplesFloat32.size(); ++statIdx)
+                {
+                    EXPECT_EQ(expected.statSamplesFloat32[statIdx].statName.GetName(), namesById[actual.statSamplesFloat32[statIdx].statId]);
+                    EXPECT_EQ(expected.statSamplesFloat32[statIdx].value, actual.statSamplesFloat32[statIdx].value);
+                    EXPECT_EQ(expected.statSamplesFloat32[statIdx].quality, actual.statSamplesFloat32[statIdx].quality);
+                }
+
+                for (size_t statIdx = 0; statIdx < actual.statSamplesInt32.size(); ++statIdx)
+                {
+                    EXPECT_EQ(expected.statSamplesInt32[statIdx].statName.GetName(), namesById[actual.statSamplesInt32[statIdx].statId]);
+                    EXPECT_EQ(expected.statSamplesInt32[statIdx].value, actual.statSamplesInt32[statIdx].value);
+                    EXPECT_EQ(expected.statSamplesInt32[statIdx].quality, actual.statSamplesInt32[statIdx].quality);
+                }
+            }
+
+            for (size_t size = 0; size < frameById.size(); ++size)
+                EXPECT_FALSE(DecodeStats(frameById.data(), size, decodedKey, sessionId, packages));
+
+            // Without the session, the stats go by name again:
+            encoder.ResetSession();
+            EXPECT_EQ(frame, encoder.Encode(catalog, items));
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+    /// <summary>
+    /// Tests the compression of batches by <see cref="application::GorillaEncoder"/>,
+    /// round-trip through <see cref="application::BinaryStatsEncoder"/>, over a synthetic
+    /// series like the ones replayed from the spool after an outage.
+    /// </summary>
+    TEST(TestCase_DataAccess, TestGorillaCodec)
+    {
+        FrameworkInstance _framework;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            using namespace std::chrono;
+            using namespace application;
+
+            auto catalog = GetBuiltInPerfCountersCatalog();
+            const std::wstring machine(L"HAL9000"), authKey(L"Entschuldigung");
+
+            // the server decodes only frames from machines it knows:
+            InternedName knownMachine(machine);
+
+            // A day of samples once a second, with jitter, slowly changing values and some gaps:
+            const size_t numSamples(86400);
+
+            SamplesBatch batch;
+            SetBuiltInCounterIds(batch);
+
+            std::mt19937 generator(42);
+            std::uniform_int_distribution<int> jitter(-3, 3);
+            std::uniform_int_distribution<int> percent(0, 99);
+
+            PerfCountersValues sample;
+            sample.time = system_clock().now();
+            sample.cpuTotalUsage = ValueWithQuality<float>{ 25.0F, Quality::Good };
+            sample.memAvailableMBytes = ValueWithQuality<float>{ 4096.0F, Quality::Good };
+            sample.diskReadBytesPerSec = ValueWithQuality<float>{ 0.0F, Quality::Good };
+            sample.diskWriteBytesPerSec = ValueWithQuality<float>{ 0.0F, Quality::Good };
+            sample.processCount = ValueWithQuality<uint16_t>{ 120, Quality::Good };
+            sample.threadCount = ValueWithQuality<uint16_t>{ 1500, Quality::Good };
+
+            for (size_t idx = 0; idx < numSamples; ++idx)
+            {
+                sample.time += milliseconds(1000 + jitter(generator));
+
+                if (idx % 10000 == 9999)
+                    sample.time += minutes(5); // the client was down
+
+                if (idx == 5)
+                    sample.time -= seconds(2); // the system clock went backwards
+
+                if (percent(generator) < 30)
+                    sample.cpuTotalUsage.value = std::round((sample.cpuTotalUsage.value + jitter(generator)) * 4.0F) / 4.0F;
+
+                if (percent(generator) < 5)
+                    sample.memAvailableMBytes.value += jitter(generator);
+
+                sample.diskReadBytesPerSec.value = percent(generator) < 5 ? 4096.0F * percent(generator) : 0.0F;
+                sample.diskWriteBytesPerSec.value = percent(generator) < 10 ? 512.0F * percent(generator) : 0.0F;
+
+                if (percent(generator) < 2)
+                    sample.processCount.value += static_cast<uint16_t> (jitter(generator));
+
+                if (percent(generator) < 20)
+                    sample.threadCount.value += static_cast<uint16_t> (jitter(generator));
+
+                sample.diskReadBytesPerSec.quality = percent(generator) < 1 ? Quality::Invalid : Quality::Good;
+
+                AddSampleTo(batch, sample);
+            }
+
+            BinaryStatsEncoder encoder(machine, authKey);
+
+            auto startTime = steady_clock::now();
+            auto frame = encoder.Encode(catalog, batch);
+            auto encodeTime = steady_clock::now() - startTime;
+
+            std::wstring decodedKey;
+            uint64_t sessionId;
+            std::vector<StatsPackage> packages;
+
+            startTime = steady_clock::now();
+            ASSERT_TRUE(DecodeStats(frame.data(), frame.size(), decodedKey, sessionId, packages));
+            auto decodeTime = steady_clock::now() - startTime;
+
+            EXPECT_EQ(authKey, decodedKey);
+            ASSERT_EQ(numSamples, packages.size());
+
+            // The decoded packages must be the same the server gets from a SOAP request:
+            for (size_t row = 0; row < numSamples; ++row)
+            {
+                auto expected = ToStatsPackage(catalog, machine, batch, row, nullptr, nullptr);
+                auto &actual = packages[row];
+
+                EXPECT_EQ(expected.timeSinceEpochInMillisecs, actual.timeSinceEpochInMillisecs);
+                EXPECT_EQ(expected.machine, actual.machine);
+                ASSERT_EQ(expected.statSamplesFloat32.size(), actual.statSamplesFloat32.size());
+                ASSERT_EQ(expected.statSamplesInt32.size(), actual.statSamplesInt32.size());
+
+                for (size_t statIdx = 0; statIdx < actual.statSamplesFloat32.size(); ++statIdx)
+                {
+                    EXPECT_EQ(expected.statSamplesFloat32[statIdx].statName, actual.statSamplesFloat32[statIdx].statName);
+                    EXPECT_EQ(expected.statSamplesFloat32[statIdx].value, actual.statSamplesFloat32[statIdx].value);
+                    EXPECT_EQ(expected.statSamplesFloat32[statIdx].quality, actual.statSamplesFloat32[statIdx].quality);
+                }
+
+                for (size_t statIdx = 0; statIdx < actual.statSamplesInt32.size(); ++statIdx)
+                {
+                    EXPECT_EQ(expected.statSamplesInt32[statIdx].statName, actual.statSamplesInt32[statIdx].statName);
+                    EXPECT_EQ(expected.statSamplesInt32[statIdx].value, actual.statSamplesInt32[statIdx].value);
+                    EXPECT_EQ(expected.statSamplesInt32[statIdx].quality, actual.statSamplesInt32[statIdx].quality);
+                }
+            }
+
+            // Uncompressed, each sample takes 8 bytes of time, plus 4 bytes of value and 2 bits of quality per stat:
+            auto uncompressedSize = numSamples * (8 + numSupPerfCounters * 4 + (numSupPerfCounters + 3) / 4);
+
+            auto toSamplesPerSec = [numSamples](steady_clock::duration time)
+            {
+                return numSamples / (std::max)(duration<double>(time).count(), 1e-9);
+            };
+
+            std::cout << "\nGorilla: " << static_cast<double> (frame.size()) / numSamples << " bytes per sample, "
+                      << static_cast<double> (uncompressedSize) / frame.size() << " times smaller than uncompressed"
+                      << "\nencodes " << toSamplesPerSec(encodeTime) << " samples/s, decodes "
+                      << toSamplesPerSec(decodeTime) << " samples/s\n" << std::endl;
+
+            EXPECT_LT(frame.size() * 4, uncompressedSize);
+
+            // Within a session, the counters go by ID:
+            std::vector<int16_t> statIds(catalog.size() * (1 + numSupAggregates) + numSelfMetrics);
+            for (size_t idx = 0; idx < statIds.size(); ++idx)
+                statIds[idx] = static_cast<int16_t> (idx + 1);
+
+            encoder.EncodeOpenSession(catalog);
+            ASSERT_TRUE(encoder.SetSession(0xABCDEF, std::move(statIds)));
+
+            auto frameById = encoder.Encode(catalog, batch);
+            EXPECT_LT(frameById.size(), frame.size());
+
+            packages.clear();
+            ASSERT_TRUE(DecodeStats(frameById.data(), frameById.size(), decodedKey, sessionId, packages));
+            EXPECT_EQ(0xABCDEF, sessionId);
+            ASSERT_EQ(numSamples, packages.size());
+            ASSERT_EQ(2, packages.back().statSamplesInt32.size());
+            EXPECT_EQ(static_cast<int16_t> (static_cast<uint32_t> (PerfCounterCode::ThreadCount) * (1 + numSupAggregates) + 1),
+                      packages.back().statSamplesInt32.back().statId);
+            EXPECT_EQ(sample.threadCount.value, packages.back().statSamplesInt32.back().value);
+
+            // A truncated or corrupted frame is rejected, leaving the packages untouched:
+            encoder.ResetSession();
+
+            SamplesBatch shortBatch;
+            shortBatch.counterIds = batch.counterIds;
+            for (size_t row = 0; row < 20; ++row)
+                shortBatch.AddSampleFrom(batch, row);
+
+            auto shortFrame = encoder.Encode(catalog, shortBatch);
+
+            for (size_t size = 0; size < shortFrame.size(); ++size)
+            {
+                EXPECT_FALSE(DecodeStats(shortFrame.data(), size, decodedKey, sessionId, packages));
+                EXPECT_EQ(numSamples, packages.size());
+            }
+
+            auto corrupted = shortFrame;
+            corrupted.push_back(0);
+            EXPECT_FALSE(DecodeStats(corrupted.data(), corrupted.size(), decodedKey, sessionId, packages));
+            EXPECT_EQ(numSamples, packages.size());
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+    /// <summary>
+    /// Tests the compression of frames by <see cref="application::FrameDeflater"/>
+    /// and their decompression in chunks by <see cref="application::FrameInflater"/>.
+    /// </summary>
+    TEST(TestCase_DataAccess, TestDeflateCodec)
+    {
+        FrameworkInstance _framework;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            using namespace std::chrono;
+            using namespace application;
+
+            auto catalog = GetBuiltInPerfCountersCatalog();
+
+            // A frame with the stats of some cycles, by name, as the client posts:
+            SamplesBatch batch;
+            SetBuiltInCounterIds(batch);
+
+            PerfCountersValues sample;
+            sample.time = system_clock().now();
+            sample.cpuTotalUsage = ValueWithQuality<float>{ 25.0F, Quality::Good };
+            sample.memAvailableMBytes = ValueWithQuality<float>{ 4096.0F, Quality::Good };
+            sample.diskReadBytesPerSec = ValueWithQuality<float>{ 0.0F, Quality::Good };
+            sample.diskWriteBytesPerSec = ValueWithQuality<float>{ 1024.0F, Quality::Good };
+            sample.processCount = ValueWithQuality<uint16_t>{ 120, Quality::Good };
+            sample.threadCount = ValueWithQuality<uint16_t>{ 1500, Quality::Good };
+
+            for (int idx = 0; idx < 8; ++idx)
+            {
+                sample.time += seconds(1);
+                sample.cpuTotalUsage.value += 1.0F;
+                AddSampleTo(batch, sample);
+            }
+
+            BinaryStatsEncoder encoder(L"HAL9000", L"Entschuldigung");
+            auto frame = encoder.Encode(catalog, batch);
+
+            FrameDeflater deflater;
+            std::vector<uint8_t> compressed;
+            deflater.Compress(frame.data(), frame.size(), compressed);
+            EXPECT_LT(compressed.size(), frame.size());
+
+            // The context is reused, with the same outcome every time:
+            std::vector<uint8_t> compressedAgain;
+            deflater.Compress(frame.data(), frame.size(), compressedAgain);
+            EXPECT_EQ(compressed, compressedAgain);
+
+            FrameInflater inflater;
+            std::vector<uint8_t> decompressed;
+
+            // Decompress in chunks of several sizes, as they arrive from the network:
+            for (size_t chunkSize : { size_t(1), size_t(7), size_t(64), compressed.size() })
+            {
+                inflater.Reset();
+                decompressed.clear();
+
+                for (size_t offset = 0; offset < compressed.size(); offset += chunkSize)
+                {
+                    auto size = (std::min)(chunkSize, compressed.size() - offset);
+                    ASSERT_TRUE(inflater.Inflate(compressed.data() + offset, size, decompressed, frame.size()));
+                }
+
+                EXPECT_TRUE(inflater.IsComplete());
+                EXPECT_EQ(frame, decompressed);
+            }
+
+            // Truncated data is not complete:
+            inflater.Reset();
+            decompressed.clear();
+            EXPECT_TRUE(inflater.Inflate(compressed.data(), compressed.size() / 2, decompressed, frame.size()));
+            EXPECT_FALSE(inflater.IsComplete());
+
+            // Data after the end of the compressed frame is rejected:
+            auto trailing = compressed;
+            trailing.push_back(0);
+            inflater.Reset();
+            decompressed.clear();
+            EXPECT_FALSE(inflater.Inflate(trailing.data(), trailing.size(), decompressed, frame.size()));
+
+            // Decompressing beyond the limit is rejected:
+            inflater.Reset();
+            decompressed.clear();
+            EXPECT_FALSE(inflater.Inflate(compressed.data(), compressed.size(), decompressed, frame.size() - 1));
+            EXPECT_GE(frame.size() - 1, decompressed.size());
+
+            // Corrupted data is rejected:
+            auto corrupted = compressed;
+            corrupted[0] ^= 0xFF;
+            inflater.Reset();
+            decompressed.clear();
+            EXPECT_FALSE(inflater.Inflate(corrupted.data(), corrupted.size(), decompressed, frame.size()));
+
+            // The decoder takes the decompressed frame:
+            std::wstring decodedKey;
+            uint64_t sessionId;
+            std::vector<StatsPackage> packages;
+            InternedName knownMachine(L"HAL9000");
+
+            inflater.Reset();
+            decompressed.clear();
+            ASSERT_TRUE(inflater.Inflate(compressed.data(), compressed.size(), decompressed, frame.size()));
+            ASSERT_TRUE(DecodeStats(decompressed.data(), decompressed.size(), decodedKey, sessionId, packages));
+            EXPECT_EQ(batch.GetSampleCount(), packages.size());
         }
         catch (...)
         {
@@ -1,11 +1,23 @@
 #include "stdafx.h"
 #include <3FD\runtime.h>
 #include <3FD\callstacktracer.h>
+#include <3FD\configuration.h>
 #include "WebService.h"
+#include "BinaryCodec.h"
+#include "BinaryHttp.h"
+#include "UdpTransport.h"
+#include "StreamTransport.h"
+#include "PerfCountersCatalog.h"
 #include "Utilities.h"
 #include <map>
 #include <string>
+#include <algorithm>
 #include <chrono>
+#include <codecvt>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
 
 
 namespace unit_tests
@@ -167,19 +179,27 @@ namespace unit_tests
 
         // Now check whether transformation of types is correct:
 
-        auto statsPackage = application::ExtractStatsDataFrom(*payload);
+        std::vector<application::StatsPackage> statsPackages;
+        application::ExtractStatsDataFrom(*payload, statsPackages);
 
-        EXPECT_EQ(ExpectedRequest::data.time, statsPackage->timeSinceEpochInMillisecs);
-        EXPECT_EQ(ExpectedRequest::data.machine, statsPackage->machine);
+        EXPECT_EQ(1, statsPackages.size());
+
+        if (statsPackages.empty())
+            return S_OK;
+
+        auto &statsPackage = statsPackages.front();
+
+        EXPECT_EQ(ExpectedRequest::data.time, statsPackage.timeSinceEpochInMillisecs);
+        EXPECT_EQ(ExpectedRequest::data.machine, statsPackage.machine.GetName());
         
-        EXPECT_EQ(ExpectedRequest::data.samplesFloatByName.size(), statsPackage->statSamplesFloat32.size());
+        EXPECT_EQ(ExpectedRequest::data.samplesFloatByName.size(), statsPackage.statSamplesFloat32.size());
 
-        for (auto &sample : statsPackage->statSamplesFloat32)
+        for (auto &sample : statsPackage.statSamplesFloat32)
         {
-            auto iter = ExpectedRequest::data.samplesFloatByName.find(sample.statName.c_str());
+            auto iter = ExpectedRequest::data.samplesFloatByName.find(sample.statName.GetName());
 
             EXPECT_TRUE(ExpectedRequest::data.samplesFloatByName.end() != iter)
-                << "stat name in request is " << sample.statName;
+                << "stat name in request is " << sample.statName.GetName();
 
             if (ExpectedRequest::data.samplesFloatByName.end() == iter)
             {
@@ -193,14 +213,14 @@ namespace unit_tests
             EXPECT_EQ(expectedSample.quality, static_cast<int8_t> (sample.quality));
         }
 
-        EXPECT_EQ(ExpectedRequest::data.samplesIntByName.size(), statsPackage->statSamplesInt32.size());
+        EXPECT_EQ(ExpectedRequest::data.samplesIntByName.size(), statsPackage.statSamplesInt32.size());
 
-        for (auto &sample : statsPackage->statSamplesInt32)
+        for (auto &sample : statsPackage.statSamplesInt32)
         {
-            auto iter = ExpectedRequest::data.samplesIntByName.find(sample.statName.c_str());
+            auto iter = ExpectedRequest::data.samplesIntByName.find(sample.statName.GetName());
 
             EXPECT_TRUE(ExpectedRequest::data.samplesIntByName.end() != iter)
-                << "stat name in request is " << sample.statName;
+                << "stat name in request is " << sample.statName.GetName();
 
             if (ExpectedRequest::data.samplesIntByName.end() == iter)
             {
@@ -218,6 +238,92 @@ namespace unit_tests
     }
 
 
+    // How many samples go in the batch for tests of SendStatsSamples
+    static const uint32_t batchSampleCount(5);
+
+
+    // Uses a test implementation to check whether transport of a batch from client to server did okay
+    HRESULT CALLBACK SendStatsSamples_ServerImpl(
+        _In_ const WS_OPERATION_CONTEXT *wsContextHandle,
+        _In_z_ WCHAR *key,
+        _In_ SendStatsSamplesRequest *payload,
+        _Out_ BOOL *status,
+        _In_ const WS_ASYNC_CONTEXT *wsAsyncContext,
+        _In_ WS_ERROR *wsErrorHandle)
+    {
+        CALL_STACK_TRACE;
+
+        *status = static_cast<BOOL> (STATUS_OKAY);
+
+        // Check whether raw payload is correct:
+
+        EXPECT_EQ(ExpectedRequest::data.machine, payload->machine);
+        EXPECT_EQ(ExpectedRequest::data.key, key);
+        EXPECT_EQ(batchSampleCount, payload->samplesCount);
+
+        for (uint32_t idx = 0; idx < payload->samplesCount; ++idx)
+        {
+            auto &sample = payload->samples[idx];
+            EXPECT_EQ(ExpectedRequest::data.time + idx, sample.time);
+            EXPECT_EQ(ExpectedRequest::data.samplesFloatByName.size(), sample.statsFloat32Count);
+            EXPECT_EQ(ExpectedRequest::data.samplesIntByName.size(), sample.statsInt32Count);
+        }
+
+        // Now check whether transformation of types is correct:
+
+        std::vector<application::StatsPackage> statsPackages;
+        application::ExtractStatsDataFrom(*payload, statsPackages);
+
+        EXPECT_EQ(payload->samplesCount, statsPackages.size());
+
+        int64_t expectedTime = ExpectedRequest::data.time;
+
+        for (auto &statsPackage : statsPackages)
+        {
+            EXPECT_EQ(expectedTime++, statsPackage.timeSinceEpochInMillisecs);
+            EXPECT_EQ(ExpectedRequest::data.machine, statsPackage.machine.GetName());
+
+            EXPECT_EQ(ExpectedRequest::data.samplesFloatByName.size(), statsPackage.statSamplesFloat32.size());
+
+            for (auto &sample : statsPackage.statSamplesFloat32)
+            {
+                auto iter = ExpectedRequest::data.samplesFloatByName.find(sample.statName.GetName());
+
+                EXPECT_TRUE(ExpectedRequest::data.samplesFloatByName.end() != iter)
+                    << "stat name in request is " << sample.statName.GetName();
+
+                if (ExpectedRequest::data.samplesFloatByName.end() == iter)
+                    continue;
+
+                auto &expectedSample = iter->second;
+
+                EXPECT_EQ(expectedSample.value, sample.value);
+                EXPECT_EQ(expectedSample.quality, static_cast<int8_t> (sample.quality));
+            }
+
+            EXPECT_EQ(ExpectedRequest::data.samplesIntByName.size(), statsPackage.statSamplesInt32.size());
+
+            for (auto &sample : statsPackage.statSamplesInt32)
+            {
+                auto iter = ExpectedRequest::data.samplesIntByName.find(sample.statName.GetName());
+
+                EXPECT_TRUE(ExpectedRequest::data.samplesIntByName.end() != iter)
+                    << "stat name in request is " << sample.statName.GetName();
+
+                if (ExpectedRequest::data.samplesIntByName.end() == iter)
+                    continue;
+
+                auto &expectedSample = iter->second;
+
+                EXPECT_EQ(expectedSample.value, sample.value);
+                EXPECT_EQ(expectedSample.quality, static_cast<int8_t> (sample.quality));
+            }
+        }
+
+        return S_OK;
+    }
+
+
     /// <summary>
     /// Tests the <see cref="application::MacStatsCollectionClient"/> class: setup
     /// </summary>
@@ -243,41 +349,35 @@ namespace unit_tests
     }
 
 
-    // Initialized some performance counter data for testing
-    static void Initialize(application::PerfCountersValues &pcvals)
+    // Adds to a batch a sample of performance counter data for testing
+    static void AddTestSampleTo(application::SamplesBatch &batch, int64_t extraMillisecs = 0)
     {
         ExpectedRequest::data.Initialize();
 
         using namespace std::chrono;
         using namespace application;
 
-        pcvals.time = system_clock().from_time_t(0) + milliseconds(ExpectedRequest::data.time);
-
-        ExpectedRequest::ExpectedSampleFloat expectedSampleFloat;
-        expectedSampleFloat = ExpectedRequest::data.samplesFloatByCode[static_cast<uint32_t> (PerfCounterCode::CpuUsage)];
-        pcvals.cpuTotalUsage.value = expectedSampleFloat.value;
-        pcvals.cpuTotalUsage.quality = static_cast<Quality> (expectedSampleFloat.quality);
+        if (batch.GetSampleCount() == 0)
+            SetBuiltInCounterIds(batch);
 
-        expectedSampleFloat = ExpectedRequest::data.samplesFloatByCode[static_cast<uint32_t> (PerfCounterCode::MemAvailable)];
-        pcvals.memAvailableMBytes.value = expectedSampleFloat.value;
-        pcvals.memAvailableMBytes.quality = static_cast<Quality> (expectedSampleFloat.quality);
+        auto row = batch.AddSample(
+            system_clock().from_time_t(0) + milliseconds(ExpectedRequest::data.time + extraMillisecs)
+        );
 
-        expectedSampleFloat = ExpectedRequest::data.samplesFloatByCode[static_cast<uint32_t> (PerfCounterCode::DiskRead)];
-        pcvals.diskReadBytesPerSec.value = expectedSampleFloat.value;
-        pcvals.diskReadBytesPerSec.quality = static_cast<Quality> (expectedSampleFloat.quality);
+        auto values = batch.GetValues(row);
+        auto qualities = batch.GetQualities(row);
 
-        expectedSampleFloat = ExpectedRequest::data.samplesFloatByCode[static_cast<uint32_t> (PerfCounterCode::DiskWrite)];
-        pcvals.diskWriteBytesPerSec.value = expectedSampleFloat.value;
-        pcvals.diskWriteBytesPerSec.quality = static_cast<Quality> (expectedSampleFloat.quality);
-
-        ExpectedRequest::ExpectedSampleInt expectedSampleInt;
-        expectedSampleInt = ExpectedRequest::data.samplesIntByCode[static_cast<uint32_t> (PerfCounterCode::ProcessCount)];
-        pcvals.processCount.value = expectedSampleInt.value;
-        pcvals.processCount.quality = static_cast<Quality> (expectedSampleInt.quality);
+        for (auto &entry : ExpectedRequest::data.samplesFloatByCode)
+        {
+            values[entry.first] = entry.second.value;
+            qualities[entry.first] = static_cast<Quality> (entry.second.quality);
+        }
 
-        expectedSampleInt = ExpectedRequest::data.samplesIntByCode[static_cast<uint32_t> (PerfCounterCode::ThreadCount)];
-        pcvals.threadCount.value = expectedSampleInt.value;
-        pcvals.threadCount.quality = static_cast<Quality> (expectedSampleInt.quality);
+        for (auto &entry : ExpectedRequest::data.samplesIntByCode)
+        {
+            values[entry.first] = entry.second.value;
+            qualities[entry.first] = static_cast<Quality> (entry.second.quality);
+        }
     }
 
 
@@ -293,12 +393,13 @@ namespace unit_tests
         try
         {
             // Generate performance counters data:
-            application::PerfCountersValues pcvals;
-            Initialize(pcvals);
+            auto catalog = application::GetBuiltInPerfCountersCatalog();
+            application::SamplesBatch batch;
+            AddTestSampleTo(batch);
 
             // Create the payload for the HTTP request:
-            wws::WSHeap heap(256);
-            auto payload = CreateRequestFrom(pcvals, heap);
+            wws::WSHeap heap(512);
+            auto payload = CreateRequestFrom(catalog, batch, 0, nullptr, heap);
 
             // Check whether payload is correct:
 
@@ -340,6 +441,103 @@ namespace unit_tests
                 EXPECT_EQ(expectedSample.value, payload->statsInt32[idx].statValue);
                 EXPECT_EQ(expectedSample.quality, payload->statsInt32[idx].quality);
             }
+
+            // Omit all stats but the CPU usage, as the deadband filter would do:
+            std::vector<uint8_t> sendMask(batch.GetCounterCount(), 0);
+            sendMask[static_cast<uint32_t> (application::PerfCounterCode::CpuUsage)] = 1;
+
+            payload = CreateRequestFrom(catalog, batch, 0, sendMask.data(), heap);
+
+            ASSERT_EQ(1, payload->statsFloat32Count);
+            EXPECT_STREQ(application::ToStatName(application::PerfCounterCode::CpuUsage), payload->statsFloat32[0].statName);
+            EXPECT_EQ(0, payload->statsInt32Count);
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+
+    /// <summary>
+    /// Tests the round trip of a request in which the deadband filter omitted
+    /// all the stats of a type, so that list is empty in the XML.
+    /// </summary>
+    TEST(TestCase_WebService, TestRequest_EmptyStatsList)
+    {
+        FrameworkInstance _framework;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            using namespace application;
+
+            auto catalog = GetBuiltInPerfCountersCatalog();
+            SamplesBatch batch;
+            AddTestSampleTo(batch);
+
+            // send only the CPU usage, so there is no stat in 32 bits integer:
+            std::vector<uint8_t> sendMask(batch.GetCounterCount(), 0);
+            sendMask[static_cast<uint32_t> (PerfCounterCode::CpuUsage)] = 1;
+
+            wws::WSHeap requestHeap(512);
+            _WrapSendStatsSampleRequest wrapper;
+            wrapper.key = const_cast<WCHAR *> (ExpectedRequest::data.key.c_str());
+            wrapper.payload = CreateRequestFrom(catalog, batch, 0, sendMask.data(), requestHeap);
+            auto wrapperPtr = &wrapper;
+
+            ASSERT_EQ(0, wrapper.payload->statsInt32Count);
+
+            auto &elementDescription = MacStatsCollection_wsdl.globalElements.WrapSendStatsSampleRequest;
+
+            WS_HEAP *heap;
+            ASSERT_EQ(S_OK, WsCreateHeap(64 * 1024, 0, nullptr, 0, &heap, nullptr));
+
+            WS_XML_WRITER *writer;
+            ASSERT_EQ(S_OK, WsCreateWriter(nullptr, 0, &writer, nullptr));
+
+            WS_XML_READER *reader;
+            ASSERT_EQ(S_OK, WsCreateReader(nullptr, 0, &reader, nullptr));
+
+            // serialize the request:
+            WS_XML_BUFFER *buffer;
+            void *bytes;
+            ULONG byteCount;
+
+            ASSERT_EQ(S_OK, WsCreateXmlBuffer(heap, nullptr, 0, &buffer, nullptr));
+            ASSERT_EQ(S_OK, WsSetOutputToBuffer(writer, buffer, nullptr, 0, nullptr));
+            ASSERT_EQ(S_OK, WsWriteElement(writer, &elementDescription, WS_WRITE_REQUIRED_POINTER,
+                                           &wrapperPtr, sizeof wrapperPtr, nullptr));
+            ASSERT_EQ(S_OK, WsWriteXmlBufferToBytes(writer, buffer, nullptr, nullptr, 0, heap,
+                                                    &bytes, &byteCount, nullptr));
+
+            // parse it back, as the server does, and extract the package:
+            WS_XML_READER_TEXT_ENCODING encoding = { { WS_XML_READER_ENCODING_TYPE_TEXT }, WS_CHARSET_AUTO };
+            WS_XML_READER_BUFFER_INPUT input = { { WS_XML_READER_INPUT_TYPE_BUFFER }, bytes, byteCount };
+            _WrapSendStatsSampleRequest *received;
+
+            ASSERT_EQ(S_OK, WsSetInput(reader, &encoding.encoding, &input.input, nullptr, 0, nullptr));
+            ASSERT_EQ(S_OK, WsReadToStartElement(reader, nullptr, nullptr, nullptr, nullptr));
+            ASSERT_EQ(S_OK, WsReadElement(reader, &elementDescription, WS_READ_REQUIRED_POINTER, heap,
+                                          &received, sizeof received, nullptr));
+
+            EXPECT_EQ(1, received->payload->statsFloat32Count);
+            EXPECT_EQ(0, received->payload->statsInt32Count);
+
+            std::vector<StatsPackage> packages;
+            ExtractStatsDataFrom(*received->payload, packages);
+
+            WsFreeReader(reader);
+            WsFreeWriter(writer);
+            WsFreeHeap(heap);
+
+            ASSERT_EQ(1, packages.size());
+            EXPECT_EQ(ExpectedRequest::data.time, packages[0].timeSinceEpochInMillisecs);
+            EXPECT_TRUE(packages[0].statSamplesInt32.empty());
+
+            ASSERT_EQ(1, packages[0].statSamplesFloat32.size());
+            EXPECT_EQ(ToStatName(PerfCounterCode::CpuUsage), packages[0].statSamplesFloat32[0].statName.GetName());
         }
         catch (...)
         {
@@ -362,6 +560,7 @@ namespace unit_tests
             // Function tables contains the service implementation:
             MacStatsCollectionBindingFunctionTable funcTableSvc = {
                 &SendStatsSample_ServerImpl,
+                &SendStatsSamples_ServerImpl,
                 &application::CloseService_ServerImpl
             };
 
@@ -404,6 +603,7 @@ namespace unit_tests
             // Function tables contains the service implementation:
             MacStatsCollectionBindingFunctionTable funcTableSvc = {
                 &SendStatsSample_ServerImpl,
+                &SendStatsSamples_ServerImpl,
                 &application::CloseService_ServerImpl
             };
 
@@ -465,6 +665,7 @@ namespace unit_tests
             // Function tables contains the service implementation:
             MacStatsCollectionBindingFunctionTable funcTableSvc = {
                 &SendStatsSample_ServerImpl,
+                &SendStatsSamples_ServerImpl,
                 &application::CloseService_ServerImpl
             };
 
@@ -492,11 +693,83 @@ namespace unit_tests
             client.Open();
 
             // Generate performance counters data:
-            application::PerfCountersValues pcvals;
-            Initialize(pcvals);
+            auto catalog = application::GetBuiltInPerfCountersCatalog();
+            application::SamplesBatch batch;
+            AddTestSampleTo(batch);
+
+            EXPECT_EQ(static_cast<bool> (STATUS_OKAY),
+                client.SendStatsSample(ExpectedRequest::data.key.c_str(), catalog, batch, 0)
+            );
+
+            // Request closure of server
+            EXPECT_TRUE(client.CloseService());
+
+            // Wait for the host closure requested by client
+            EXPECT_TRUE(
+                application::ServiceCloser::GetInstance().WaitForCloseRequest(3000, host)
+            );
+
+            EXPECT_TRUE(client.Close());
+
+            application::ServiceCloser::Finalize();
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+    /// <summary>
+    /// Tests data SOAP over HTTP transport, with several samples in a single request.
+    /// </summary>
+    TEST(TestCase_WebService, TestSoapHttpTransport_Batch)
+    {
+        FrameworkInstance _framework;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            ExpectedRequest::data.Initialize();
+
+            // Function tables contains the service implementation:
+            MacStatsCollectionBindingFunctionTable funcTableSvc = {
+                &SendStatsSample_ServerImpl,
+                &SendStatsSamples_ServerImpl,
+                &application::CloseService_ServerImpl
+            };
+
+            // Create the web service host with default configurations:
+            wws::SvcEndpointsConfig hostCfg;
+
+            wws::ServiceBindings bindings;
+
+            /* Map the binding used for the endpoint to
+            the corresponding implementations: */
+            bindings.MapBinding(
+                "MacStatsCollectionBinding",
+                &funcTableSvc,
+                &wws::CreateServiceEndpoint<WS_HTTP_BINDING_TEMPLATE, MacStatsCollectionBindingFunctionTable, MacStatsCollectionBinding_CreateServiceEndpoint>
+            );
+
+            // Create the service host:
+            wws::WebServiceHost host(2048);
+            host.Setup("MacStatsCollection.wsdl", hostCfg, bindings, nullptr, false);
+            host.Open(); // start listening
+
+            // Create the HTTP client:
+            wws::SvcProxyConfig proxyCfg;
+            application::MacStatsCollectionClient client(proxyCfg);
+            client.Open();
+
+            // Generate performance counters data, one millisecond apart:
+            auto catalog = application::GetBuiltInPerfCountersCatalog();
+            application::SamplesBatch batch;
+            for (uint32_t idx = 0; idx < batchSampleCount; ++idx)
+                AddTestSampleTo(batch, idx);
 
             EXPECT_EQ(static_cast<bool> (STATUS_OKAY),
-                client.SendStatsSample(ExpectedRequest::data.key.c_str(), pcvals)
+                client.SendStatsSamples(ExpectedRequest::data.key.c_str(), catalog, batch)
             );
 
             // Request closure of server
@@ -517,4 +790,627 @@ namespace unit_tests
         }
     }
 
+
+    // Creates the stats of a cycle for tests of binary encoding, with aggregates and metrics of the client
+    static void FillCollectedStats(application::CollectedStats &item)
+    {
+        using namespace application;
+
+        AddTestSampleTo(item.sample);
+
+        item.aggregates.sampleCount = 10;
+        item.aggregates.counterIds = item.sample.counterIds;
+        item.aggregates.values.resize(numSupPerfCounters * numSupAggregates, 123.456F);
+        item.aggregates.qualities.resize(numSupPerfCounters, Quality::Good);
+
+        for (uint32_t idx = 0; idx < numSelfMetrics; ++idx)
+            item.selfMetrics[idx] = ValueWithQuality<float>{ 0.5F * idx, Quality::Good };
+
+        item.hasSelfMetrics = true;
+    }
+
+
+    /// <summary>
+    /// Compares the binary encoding of stats with the XML of the SOAP request (not counting
+    /// the envelope), for the same content: the size of the payload, how long it takes to
+    /// encode it in the client, and how long it takes to decode it into packages in the server.
+    /// </summary>
+    TEST(TestCase_WebService, TestBinaryEncoding_Benchmark)
+    {
+        FrameworkInstance _framework;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            using namespace std::chrono;
+            using namespace application;
+
+            const int numIterations(1000);
+
+            auto catalog = GetBuiltInPerfCountersCatalog();
+
+            CollectedStats item;
+            FillCollectedStats(item);
+
+            wws::WSHeap requestHeap(8192);
+            _WrapSendStatsSampleRequest wrapper;
+            wrapper.key = const_cast<WCHAR *> (ExpectedRequest::data.key.c_str());
+            wrapper.payload = CreateRequestFrom(catalog, item, requestHeap);
+            auto wrapperPtr = &wrapper;
+
+            auto &elementDescription = MacStatsCollection_wsdl.globalElements.WrapSendStatsSampleRequest;
+
+            WS_HEAP *heap;
+            ASSERT_EQ(S_OK, WsCreateHeap(1024 * 1024, 0, nullptr, 0, &heap, nullptr));
+
+            WS_XML_WRITER *writer;
+            ASSERT_EQ(S_OK, WsCreateWriter(nullptr, 0, &writer, nullptr));
+
+            WS_XML_READER *reader;
+            ASSERT_EQ(S_OK, WsCreateReader(nullptr, 0, &reader, nullptr));
+
+            // XML: serialize the request
+            std::vector<uint8_t> xmlBytes;
+            auto startTime = steady_clock::now();
+
+            for (int iteration = 0; iteration < numIterations; ++iteration)
+            {
+                WS_XML_BUFFER *buffer;
+                void *bytes;
+                ULONG byteCount;
+
+                ASSERT_EQ(S_OK, WsResetHeap(heap, nullptr));
+                ASSERT_EQ(S_OK, WsCreateXmlBuffer(heap, nullptr, 0, &buffer, nullptr));
+                ASSERT_EQ(S_OK, WsSetOutputToBuffer(writer, buffer, nullptr, 0, nullptr));
+                ASSERT_EQ(S_OK, WsWriteElement(writer, &elementDescription, WS_WRITE_REQUIRED_POINTER,
+                                               &wrapperPtr, sizeof wrapperPtr, nullptr));
+                ASSERT_EQ(S_OK, WsWriteXmlBufferToBytes(writer, buffer, nullptr, nullptr, 0, heap,
+                                                        &bytes, &byteCount, nullptr));
+
+                xmlBytes.assign(static_cast<uint8_t *> (bytes), static_cast<uint8_t *> (bytes) + byteCount);
+            }
+
+            auto xmlEncodeTime = steady_clock::now() - startTime;
+
+            // XML: parse the request and extract the package
+            std::vector<StatsPackage> xmlPackages;
+            startTime = steady_clock::now();
+
+            for (int iteration = 0; iteration < numIterations; ++iteration)
+            {
+                WS_XML_READER_TEXT_ENCODING encoding = { { WS_XML_READER_ENCODING_TYPE_TEXT }, WS_CHARSET_AUTO };
+                WS_XML_READER_BUFFER_INPUT input = { { WS_XML_READER_INPUT_TYPE_BUFFER }, xmlBytes.data(), static_cast<ULONG> (xmlBytes.size()) };
+                _WrapSendStatsSampleRequest *received;
+
+                ASSERT_EQ(S_OK, WsResetHeap(heap, nullptr));
+                ASSERT_EQ(S_OK, WsSetInput(reader, &encoding.encoding, &input.input, nullptr, 0, nullptr));
+                ASSERT_EQ(S_OK, WsReadToStartElement(reader, nullptr, nullptr, nullptr, nullptr));
+                ASSERT_EQ(S_OK, WsReadElement(reader, &elementDescription, WS_READ_REQUIRED_POINTER, heap,
+                                              &received, sizeof received, nullptr));
+
+                xmlPackages.clear();
+                ExtractStatsDataFrom(*received->payload, xmlPackages);
+            }
+
+            auto xmlDecodeTime = steady_clock::now() - startTime;
+
+            WsFreeReader(reader);
+            WsFreeWriter(writer);
+            WsFreeHeap(heap);
+
+            // Binary: encode the same content
+            BinaryStatsEncoder encoder(ExpectedRequest::data.machine, ExpectedRequest::data.key);
+            std::vector<const CollectedStats *> items = { &item };
+            std::vector<uint8_t> binaryBytes;
+            startTime = steady_clock::now();
+
+            for (int iteration = 0; iteration < numIterations; ++iteration)
+                binaryBytes = encoder.Encode(catalog, items);
+
+            auto binaryEncodeTime = steady_clock::now() - startTime;
+
+            // Binary: decode the frame into packages
+            std::wstring authKey;
+            uint64_t sessionId;
+            std::vector<StatsPackage> binaryPackages;
+            startTime = steady_clock::now();
+
+            for (int iteration = 0; iteration < numIterations; ++iteration)
+            {
+                binaryPackages.clear();
+                ASSERT_TRUE(DecodeStats(binaryBytes.data(), binaryBytes.size(), authKey, sessionId, binaryPackages));
+            }
+
+            auto binaryDecodeTime = steady_clock::now() - startTime;
+
+            // Both give the same package:
+            ASSERT_EQ(1, binaryPackages.size());
+            ASSERT_EQ(1, xmlPackages.size());
+            EXPECT_EQ(ExpectedRequest::data.key, authKey);
+            EXPECT_EQ(xmlPackages[0].timeSinceEpochInMillisecs, binaryPackages[0].timeSinceEpochInMillisecs);
+            EXPECT_EQ(xmlPackages[0].machine, binaryPackages[0].machine);
+            EXPECT_EQ(xmlPackages[0].statSamplesFloat32.size(), binaryPackages[0].statSamplesFloat32.size());
+            EXPECT_EQ(xmlPackages[0].statSamplesInt32.size(), binaryPackages[0].statSamplesInt32.size());
+
+            auto toMicrosecs = [numIterations](steady_clock::duration time)
+            {
+                return duration<double, std::micro>(time).count() / numIterations;
+            };
+
+            std::cout << "\nXML:    " << xmlBytes.size() << " bytes, encode "
+                      << toMicrosecs(xmlEncodeTime) << " us, decode " << toMicrosecs(xmlDecodeTime) << " us"
+                      << "\nbinary: " << binaryBytes.size() << " bytes, encode "
+                      << toMicrosecs(binaryEncodeTime) << " us, decode " << toMicrosecs(binaryDecodeTime) << " us"
+                      << "\nbinary is " << static_cast<double> (xmlBytes.size()) / binaryBytes.size()
+                      << " times smaller and decodes " << toMicrosecs(xmlDecodeTime) / toMicrosecs(binaryDecodeTime)
+                      << " times faster\n" << std::endl;
+
+            EXPECT_LT(binaryBytes.size() * 2, xmlBytes.size());
+            EXPECT_LT(binaryDecodeTime, xmlDecodeTime);
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+
+    // The session opened by the test implementation, and the names to which it assigned ID's
+    static const uint64_t testSessionId(0xC0FFEE);
+    static std::vector<std::wstring> testSessionStatNames;
+
+
+    // Uses a test implementation that assigns ID's to the stat names in their order, starting at 1
+    static uint64_t OpenBinarySession_TestImpl(const std::wstring &machine,
+                                               const std::wstring &authKey,
+                                               const std::vector<std::wstring> &statNames,
+                                               std::vector<int16_t> &statIds)
+    {
+        EXPECT_EQ(ExpectedRequest::data.machine, machine);
+
+        if (ExpectedRequest::data.key != authKey)
+            return 0;
+
+        testSessionStatNames = statNames;
+
+        statIds.clear();
+        for (size_t idx = 0; idx < statNames.size(); ++idx)
+            statIds.push_back(static_cast<int16_t> (idx + 1));
+
+        return testSessionId;
+    }
+
+
+    // Authenticates the machine of binary encoded stats sent by name, with the expected key
+    static bool AuthenticateBinaryStats_TestImpl(application::InternedName machine, const std::wstring &authKey)
+    {
+        EXPECT_EQ(ExpectedRequest::data.machine, machine.GetName());
+        return ExpectedRequest::data.key == authKey;
+    }
+
+
+    // Uses a test implementation to check whether transport of binary encoded stats from client to server did okay
+    static application::BinaryStatus HandleBinaryStats_TestImpl(const std::wstring &authKey,
+                                                                uint64_t sessionId,
+                                                                std::vector<application::StatsPackage> &packages)
+    {
+        if (sessionId != 0)
+        {
+            if (sessionId != testSessionId)
+                return application::BinaryStatus::UnknownSession;
+        }
+        else
+            EXPECT_EQ(ExpectedRequest::data.key, authKey);
+
+        EXPECT_EQ(2, packages.size());
+
+        int64_t expectedTime = ExpectedRequest::data.time;
+
+        for (auto &package : packages)
+        {
+            EXPECT_EQ(expectedTime++, package.timeSinceEpochInMillisecs);
+            EXPECT_EQ(sessionId != 0 ? L"" : ExpectedRequest::data.machine, package.machine.GetName());
+            EXPECT_EQ(ExpectedRequest::data.samplesIntByName.size(), package.statSamplesInt32.size());
+
+            for (auto &sample : package.statSamplesInt32)
+            {
+                // within the session, the stats go by ID:
+                if (sessionId != 0)
+                {
+                    EXPECT_TRUE(sample.statName.IsEmpty());
+                    EXPECT_GT(sample.statId, 0);
+
+                    if (sample.statId <= 0 || sample.statId > static_cast<int16_t> (testSessionStatNames.size()))
+                        continue;
+
+                    sample.statName = testSessionStatNames[sample.statId - 1];
+                }
+
+                auto iter = ExpectedRequest::data.samplesIntByName.find(sample.statName.GetName());
+
+                EXPECT_TRUE(ExpectedRequest::data.samplesIntByName.end() != iter)
+                    << "stat name in request is " << sample.statName.GetName();
+
+                if (ExpectedRequest::data.samplesIntByName.end() == iter)
+                    continue;
+
+                EXPECT_EQ(iter->second.value, sample.value);
+                EXPECT_EQ(iter->second.quality, static_cast<int8_t> (sample.quality));
+            }
+        }
+
+        return application::BinaryStatus::Accepted;
+    }
+
+
+    /// <summary>
+    /// Tests transport of binary encoded stats over HTTP, first by name, then by ID in a session,
+    /// with the larger requests compressed.
+    /// </summary>
+    TEST(TestCase_WebService, TestBinaryHttpTransport)
+    {
+        FrameworkInstance _framework;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            using namespace application;
+
+            ExpectedRequest::data.Initialize();
+
+            // the server knows the machine, as if the authenticator had loaded its credential:
+            InternedName machine(ExpectedRequest::data.machine);
+
+            auto toWideString = [](const std::string &str)
+            {
+                return std::wstring_convert<std::codecvt_utf8<wchar_t>>().from_bytes(str);
+            };
+
+            BinaryHttpEndpoint endpoint(
+                toWideString(AppConfig::GetSettings().application.GetString("binarySvcHostEndpoint", "http://+:81/macstatsbin/")),
+                &AuthenticateBinaryStats_TestImpl,
+                &HandleBinaryStats_TestImpl,
+                &OpenBinarySession_TestImpl
+            );
+
+            // once told by the first response, the client compresses the frames larger than this:
+            const size_t deflateMinSize(64);
+
+            BinaryHttpClient client(
+                toWideString(AppConfig::GetSettings().application.GetString("webSvcBinaryEndpoint", "http://localhost:81/macstatsbin/")),
+                deflateMinSize
+            );
+
+            // Generate performance counters data, one millisecond apart:
+            auto catalog = GetBuiltInPerfCountersCatalog();
+            SamplesBatch batch;
+            AddTestSampleTo(batch);
+            AddTestSampleTo(batch, 1);
+
+            BinaryStatsEncoder encoder(ExpectedRequest::data.machine, ExpectedRequest::data.key);
+            EXPECT_EQ(BinaryStatus::Accepted, client.Post(encoder.Encode(catalog, batch)));
+
+            // A forged request is rejected before its names get into the interner:
+            auto forgedCatalog = catalog;
+            forgedCatalog[0].statName = L"forged_stat_NeverInterned";
+            BinaryStatsEncoder forger(ExpectedRequest::data.machine, L"notTheKey");
+            EXPECT_EQ(BinaryStatus::Rejected, client.Post(forger.Encode(forgedCatalog, batch)));
+            EXPECT_TRUE(InternedName::Find(L"forged_stat_NeverInterned").IsEmpty());
+
+            // So is a request from a machine the server does not know, rather than being a bad request:
+            BinaryStatsEncoder stranger(L"strangerMachine_NeverInterned", ExpectedRequest::data.key);
+            EXPECT_EQ(BinaryStatus::Rejected, client.Post(stranger.Encode(catalog, batch)));
+            EXPECT_TRUE(InternedName::Find(L"strangerMachine_NeverInterned").IsEmpty());
+
+            // Open a session (the request is compressed), then send the stats by ID:
+            std::vector<uint8_t> response;
+            auto openSessionFrame = encoder.EncodeOpenSession(catalog);
+            EXPECT_LE(deflateMinSize, openSessionFrame.size());
+            client.Exchange(openSessionFrame, response);
+
+            uint64_t sessionId;
+            std::vector<int16_t> statIds;
+            ASSERT_TRUE(DecodeSessionOpened(response.data(), response.size(), sessionId, statIds));
+            EXPECT_EQ(testSessionId, sessionId);
+            ASSERT_TRUE(encoder.SetSession(sessionId, std::move(statIds)));
+
+            EXPECT_EQ(BinaryStatus::Accepted, client.Post(encoder.Encode(catalog, batch)));
+
+            // A session the server does not know is reported:
+            statIds.assign(testSessionStatNames.size(), 1);
+            ASSERT_TRUE(encoder.SetSession(testSessionId + 1, std::move(statIds)));
+            EXPECT_EQ(BinaryStatus::UnknownSession, client.Post(encoder.Encode(catalog, batch)));
+
+            // A malformed frame is refused:
+            std::vector<uint8_t> garbage(16, 0xFF);
+            EXPECT_THROW(client.Post(garbage), IAppException);
+
+            endpoint.Close();
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+    /// <summary>
+    /// Tests transport of stats in datagrams over UDP (loopback), authenticated by HMAC.
+    /// </summary>
+    TEST(TestCase_WebService, TestUdpTransport)
+    {
+        FrameworkInstance _framework;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            using namespace std::chrono;
+            using namespace application;
+
+            HmacSha256 hmac;
+
+            // HMAC-SHA256 must match the test case 2 of RFC 4231:
+            const std::string rfcData("what do ya want for nothing?");
+            const uint8_t rfcMac[HmacSha256::macSize] = {
+                0x5b, 0xdc, 0xc1, 0x46, 0xbf, 0x60, 0x75, 0x4e, 0x6a, 0x04, 0x24, 0x26, 0x08, 0x95, 0x75, 0xc7,
+                0x5a, 0x00, 0x3f, 0x08, 0x9d, 0x27, 0x39, 0x83, 0x9d, 0xec, 0x58, 0xb9, 0x64, 0xec, 0x38, 0x43
+            };
+
+            uint8_t mac[HmacSha256::macSize];
+            hmac.Compute("Jefe", reinterpret_cast<const uint8_t *> (rfcData.data()), rfcData.size(), mac);
+            EXPECT_EQ(0, memcmp(rfcMac, mac, sizeof mac));
+            EXPECT_TRUE(hmac.Verify("Jefe", reinterpret_cast<const uint8_t *> (rfcData.data()), rfcData.size(), rfcMac));
+            EXPECT_FALSE(hmac.Verify("jefe", reinterpret_cast<const uint8_t *> (rfcData.data()), rfcData.size(), rfcMac));
+
+            ExpectedRequest::data.Initialize();
+
+            // the server knows the machine and its key, as if the authenticator had loaded its credential:
+            InternedName machine(ExpectedRequest::data.machine);
+            auto key = std::wstring_convert<std::codecvt_utf8<wchar_t>>().to_bytes(ExpectedRequest::data.key);
+
+            auto verifier = [machine, &key, &hmac](InternedName sender, const uint8_t *frame, size_t size, const uint8_t *mac)
+            {
+                return sender == machine && hmac.Verify(key, frame, size, mac);
+            };
+
+            std::mutex mutex;
+            std::condition_variable received;
+            std::vector<StatsPackage> packages;
+
+            auto handler = [&mutex, &received, &packages](std::vector<StatsPackage> &batch)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                std::move(batch.begin(), batch.end(), std::back_inserter(packages));
+                received.notify_all();
+            };
+
+            auto waitFor = [&mutex, &received, &packages](size_t count)
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                return received.wait_for(lock, seconds(5), [&packages, count]() { return packages.size() >= count; });
+            };
+
+            auto port = static_cast<uint16_t> (AppConfig::GetSettings().application.GetUInt("udpSvcHostPort", 8126));
+
+            UdpStatsEndpoint endpoint(port, verifier, handler, seconds(300), 64);
+
+            UdpStatsSender sender(L"localhost", port, ExpectedRequest::data.machine, ExpectedRequest::data.key);
+
+            // Generate performance counters data of now, one millisecond apart:
+            auto catalog = GetBuiltInPerfCountersCatalog();
+            auto now = system_clock::now();
+
+            auto makeBatch = [now](size_t sampleCount, SamplesBatch &batch)
+            {
+                batch = SamplesBatch();
+
+                for (size_t idx = 0; idx < sampleCount; ++idx)
+                {
+                    AddTestSampleTo(batch);
+                    batch.times[idx] = now + milliseconds(idx);
+                }
+            };
+
+            SamplesBatch batch;
+            makeBatch(2, batch);
+            sender.Send(catalog, batch);
+
+            ASSERT_TRUE(waitFor(2));
+            EXPECT_EQ(0, endpoint.GetDroppedCount());
+
+            for (size_t idx = 0; idx < 2; ++idx)
+            {
+                EXPECT_EQ(machine, packages[idx].machine);
+                EXPECT_EQ(duration_cast<milliseconds>(batch.times[idx].time_since_epoch()).count(),
+                          packages[idx].timeSinceEpochInMillisecs);
+
+                for (auto &sample : packages[idx].statSamplesFloat32)
+                {
+                    auto iter = ExpectedRequest::data.samplesFloatByName.find(sample.statName.GetName());
+                    ASSERT_TRUE(ExpectedRequest::data.samplesFloatByName.end() != iter);
+                    EXPECT_EQ(iter->second.value, sample.value);
+                    EXPECT_EQ(iter->second.quality, static_cast<int8_t> (sample.quality));
+                }
+
+                EXPECT_EQ(ExpectedRequest::data.samplesIntByName.size(), packages[idx].statSamplesInt32.size());
+            }
+
+            // A datagram authenticated with another key is dropped:
+            UdpStatsSender impostor(L"localhost", port, ExpectedRequest::data.machine, L"NotTheKey");
+            impostor.Send(catalog, batch);
+
+            // So is a datagram whose samples are too old:
+            SamplesBatch oldBatch;
+            AddTestSampleTo(oldBatch);
+            sender.Send(catalog, oldBatch);
+
+            // A batch too large for a single datagram is split:
+            makeBatch(500, batch);
+            sender.Send(catalog, batch);
+
+            ASSERT_TRUE(waitFor(502));
+            EXPECT_EQ(502, packages.size());
+            EXPECT_EQ(2, endpoint.GetDroppedCount());
+            EXPECT_EQ(duration_cast<milliseconds>(batch.times.back().time_since_epoch()).count(),
+                      packages.back().timeSinceEpochInMillisecs);
+
+            endpoint.Close();
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
+    /// <summary>
+    /// Tests transport of binary encoded stats streamed in a long-lived TCP connection (loopback),
+    /// in which the client authenticates once and the server acknowledges cumulatively.
+    /// </summary>
+    TEST(TestCase_WebService, TestStreamTransport)
+    {
+        FrameworkInstance _framework;
+
+        CALL_STACK_TRACE;
+
+        try
+        {
+            using namespace std::chrono;
+            using namespace application;
+
+            ExpectedRequest::data.Initialize();
+
+            std::mutex mutex;
+            size_t handlerCallCount(0);
+            size_t packageCount(0);
+            bool isSessionLost(false);
+            bool isBusy(false);
+
+            // the stats of the frames taken between acknowledgements come in a single call:
+            auto handler = [&mutex, &handlerCallCount, &packageCount, &isSessionLost, &isBusy](const std::wstring &authKey,
+                                                                                                uint64_t sessionId,
+                                                                                                std::vector<StatsPackage> &packages)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+
+                if (sessionId != testSessionId || isSessionLost)
+                    return BinaryStatus::UnknownSession;
+
+                if (isBusy)
+                    return BinaryStatus::RetryLater;
+
+                ++handlerCallCount;
+                packageCount += packages.size();
+                return BinaryStatus::Accepted;
+            };
+
+            const uint32_t ackEveryFrames(4);
+            auto port = static_cast<uint16_t> (AppConfig::GetSettings().application.GetUInt("streamSvcHostPort", 8127));
+
+            StatsStreamEndpoint endpoint(port, handler, &OpenBinarySession_TestImpl, ackEveryFrames, milliseconds(100), 8);
+
+            StatsStreamClient client(L"localhost", port);
+
+            // Authenticate once, opening a session:
+            auto catalog = GetBuiltInPerfCountersCatalog();
+            BinaryStatsEncoder encoder(ExpectedRequest::data.machine, ExpectedRequest::data.key);
+
+            std::vector<uint8_t> response;
+            client.Exchange(encoder.EncodeOpenSession(catalog), response);
+
+            uint64_t sessionId;
+            std::vector<int16_t> statIds;
+            ASSERT_TRUE(DecodeSessionOpened(response.data(), response.size(), sessionId, statIds));
+            EXPECT_EQ(testSessionId, sessionId);
+            ASSERT_TRUE(encoder.SetSession(sessionId, std::move(statIds)));
+
+            // Then stream the stats, with no response for each frame:
+            SamplesBatch batch;
+            AddTestSampleTo(batch);
+            AddTestSampleTo(batch, 1);
+
+            const uint64_t frameCount(10);
+            for (uint64_t idx = 0; idx < frameCount; ++idx)
+                EXPECT_EQ(BinaryStatus::Accepted, client.Post(encoder.Encode(catalog, batch)));
+
+            // the last frames are acknowledged upon the timeout:
+            ASSERT_TRUE(client.Flush(seconds(5)));
+            EXPECT_EQ(frameCount, client.GetSentCount());
+            EXPECT_EQ(frameCount, client.GetAckedCount());
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                EXPECT_EQ(frameCount * 2, packageCount);
+                EXPECT_LT(handlerCallCount, frameCount);
+                EXPECT_GE(handlerCallCount, frameCount / ackEveryFrames);
+            }
+
+            /* When the server loses the session, the frame is not counted, and neither is sent
+            the next one, because the client must open another session to send them again: */
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                isSessionLost = true;
+            }
+
+            EXPECT_EQ(BinaryStatus::Accepted, client.Post(encoder.Encode(catalog, batch)));
+            ASSERT_TRUE(client.Flush(seconds(5)));
+            EXPECT_EQ(frameCount, client.GetSentCount());
+            EXPECT_EQ(frameCount, client.GetAckedCount());
+
+            EXPECT_EQ(BinaryStatus::UnknownSession, client.Post(encoder.Encode(catalog, batch)));
+            EXPECT_EQ(frameCount, client.GetSentCount());
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                isSessionLost = false;
+            }
+
+            client.Exchange(encoder.EncodeOpenSession(catalog), response);
+            ASSERT_TRUE(DecodeSessionOpened(response.data(), response.size(), sessionId, statIds));
+            ASSERT_TRUE(encoder.SetSession(sessionId, std::move(statIds)));
+
+            EXPECT_EQ(BinaryStatus::Accepted, client.Post(encoder.Encode(catalog, batch)));
+            ASSERT_TRUE(client.Flush(seconds(5)));
+            EXPECT_EQ(frameCount + 1, client.GetAckedCount());
+
+            // When the server is too busy, the frame is not counted either, so it can be sent again:
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                isBusy = true;
+            }
+
+            EXPECT_EQ(BinaryStatus::Accepted, client.Post(encoder.Encode(catalog, batch)));
+            ASSERT_TRUE(client.Flush(seconds(5)));
+            EXPECT_EQ(frameCount + 1, client.GetSentCount());
+            EXPECT_EQ(frameCount + 1, client.GetAckedCount());
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                isBusy = false;
+            }
+
+            EXPECT_EQ(BinaryStatus::RetryLater, client.Post(encoder.Encode(catalog, batch)));
+            EXPECT_EQ(BinaryStatus::Accepted, client.Post(encoder.Encode(catalog, batch)));
+            ASSERT_TRUE(client.Flush(seconds(5)));
+            EXPECT_EQ(frameCount + 2, client.GetAckedCount());
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                EXPECT_EQ((frameCount + 2) * 2, packageCount);
+            }
+
+            // A client that is not authentic is hung up on:
+            StatsStreamClient impostor(L"localhost", port);
+            BinaryStatsEncoder impostorEncoder(ExpectedRequest::data.machine, L"NotTheKey");
+            EXPECT_THROW(impostor.Exchange(impostorEncoder.EncodeOpenSession(catalog), response), IAppException);
+
+            endpoint.Close();
+        }
+        catch (...)
+        {
+            HandleException();
+        }
+    }
+
 }// end of namespace unit_tests
\ No newline at end of file